@@ -0,0 +1,64 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef BENCHMARK_BENCHMARK_UTIL_H_
+#define BENCHMARK_BENCHMARK_UTIL_H_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace happycpp::hcbenchmark {
+
+    // 防止编译器把被测代码优化掉
+    template<typename T>
+    inline void doNotOptimize(const T &value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    // 执行 f 共 iterations 次，返回每次调用的平均耗时，单位纳秒
+    template<typename F>
+    double nsPerOp(uint64_t iterations, F f) {
+        const auto start = std::chrono::steady_clock::now();
+
+        for (uint64_t i = 0; i < iterations; ++i)
+            f(i);
+
+        const auto end = std::chrono::steady_clock::now();
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+        return static_cast<double>(ns) / static_cast<double>(iterations);
+    }
+
+    inline void report(const std::string &name, double ns) {
+        printf("%-40s %10.2f ns/op\n", name.c_str(), ns);
+    }
+
+    inline void report(const std::string &name, double value, const std::string &unit) {
+        printf("%-40s %10.2f %s\n", name.c_str(), value, unit.c_str());
+    }
+
+} /* namespace happycpp */
+
+#endif  // BENCHMARK_BENCHMARK_UTIL_H_
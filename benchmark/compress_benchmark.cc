@@ -0,0 +1,103 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+// 线程内复用的压缩器与每个响应重新初始化 zlib 的性能对比
+
+#include "benchmark_util.h"
+#include "happycpp/http/compress.h"
+#include <zlib.h>
+#include <string>
+
+namespace hhhttp = happycpp::hchttp;
+namespace hhbench = happycpp::hcbenchmark;
+
+namespace {
+
+    // 每次调用都 deflateInit2/deflateEnd
+    std::string freshGzip(const std::string &data, int level) {
+        z_stream zs{};
+        deflateInit2(&zs, level, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY);
+
+        std::string out(deflateBound(&zs, data.size()), '\0');
+        zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+        zs.avail_in = static_cast<uInt>(data.size());
+        zs.next_out = reinterpret_cast<Bytef *>(&out[0]);
+        zs.avail_out = static_cast<uInt>(out.size());
+        deflate(&zs, Z_FINISH);
+        out.resize(zs.total_out);
+        deflateEnd(&zs);
+
+        return out;
+    }
+
+    std::string pooled(hhhttp::HttpContentCoding coding, const std::string &data, int level) {
+        hhhttp::CompressorPtr c(hhhttp::acquireCompressor(coding, level,
+                                                          static_cast<int64_t>(data.size())));
+        std::string out;
+        c->update(data, &out);
+        c->finish(&out);
+
+        return out;
+    }
+
+} /* namespace */
+
+int main() {
+    std::string small;
+
+    for (int i = 0; small.size() < 2048; ++i)
+        small += "{\"id\":" + std::to_string(i) + ",\"name\":\"happycpp\",\"ok\":true},";
+
+    std::string large;
+
+    while (large.size() < 64 * 1024)
+        large += small;
+
+    const uint64_t iterations = 20000;
+
+    hhbench::report("fresh zlib gzip 2KB", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        hhbench::doNotOptimize(freshGzip(small, 5));
+    }));
+
+    hhbench::report("pooled gzip 2KB", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        hhbench::doNotOptimize(pooled(hhhttp::HTTP_CODING_GZIP, small, 5));
+    }));
+
+    for (const auto coding : {hhhttp::HTTP_CODING_ZSTD, hhhttp::HTTP_CODING_BR}) {
+        if (!hhhttp::codingSupported(coding))
+            continue;
+
+        hhbench::report("pooled " + std::string(hhhttp::toName(coding)) + " 2KB",
+                        hhbench::nsPerOp(iterations, [&](uint64_t) {
+                            hhbench::doNotOptimize(pooled(coding, small, hhhttp::defaultLevel(coding)));
+                        }));
+    }
+
+    hhbench::report("fresh zlib gzip 64KB", hhbench::nsPerOp(iterations / 20, [&](uint64_t) {
+        hhbench::doNotOptimize(freshGzip(large, 5));
+    }));
+
+    hhbench::report("pooled gzip 64KB", hhbench::nsPerOp(iterations / 20, [&](uint64_t) {
+        hhbench::doNotOptimize(pooled(hhhttp::HTTP_CODING_GZIP, large, 5));
+    }));
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// 抛出并捕获 HappyException 的开销：动态消息与静态消息对比，以及解析失败时的 from4ByteArray。
+// 日志级别设置为 OFF，旧版本在构造异常时写日志的开销不计算在内
+
+#include "benchmark_util.h"
+#include "happycpp/algorithm/byte.h"
+#include "happycpp/exception.h"
+#include "happycpp/log.h"
+#include <cerrno>
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace hclog = happycpp::log;
+namespace hhbench = happycpp::hcbenchmark;
+
+int main() {
+    const uint64_t iterations = 200000;
+    const std::string name("eth0");
+    const std::vector<byte_t> bytes(3);
+
+    // 只测量异常本身，不输出日志
+    hclog::HappyLog::instance().setLogLevel(log4cplus::OFF_LOG_LEVEL);
+
+    hhbench::report("throw/catch (dynamic message)", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        try {
+            ThrowHappyException("Cannot find interface " + name + " in /proc/net/dev.");
+        } catch (const happycpp::HappyException &e) {
+            hhbench::doNotOptimize(&e);
+        }
+    }));
+
+    hhbench::report("throw/catch (literal message)", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        try {
+            ThrowHappyException("Cannot find the interface in /proc/net/dev.");
+        } catch (const happycpp::HappyException &e) {
+            hhbench::doNotOptimize(&e);
+        }
+    }));
+
+    hhbench::report("throw/catch (ThrowHappyError)", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        try {
+            ThrowHappyError(ENODEV, "Cannot find the interface in /proc/net/dev.");
+        } catch (const happycpp::HappyException &e) {
+            hhbench::doNotOptimize(&e);
+        }
+    }));
+
+    // 复制异常对象，比如 std::exception_ptr 跨线程传递异常时
+    const happycpp::HappyException literal(ENODEV, "Cannot find the interface in /proc/net/dev.");
+
+    hhbench::report("make_exception_ptr (literal message)", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        hhbench::doNotOptimize(std::make_exception_ptr(literal));
+    }));
+
+    const happycpp::HappyException dynamic("Cannot find interface " + name + " in /proc/net/dev.");
+
+    hhbench::report("make_exception_ptr (dynamic message)", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        hhbench::doNotOptimize(std::make_exception_ptr(dynamic));
+    }));
+
+    hhbench::report("from4ByteArray (invalid size)", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        try {
+            hhbench::doNotOptimize(happycpp::hcalgorithm::hcbyte::from4ByteArray(bytes));
+        } catch (const happycpp::HappyException &e) {
+            hhbench::doNotOptimize(&e);
+        }
+    }));
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// hcurl::encode/decode 与原逐字节实现的性能对比
+
+#include "benchmark_util.h"
+#include "happycpp/http.h"
+#include <cctype>
+#include <string>
+#include <vector>
+
+namespace hhhttp = happycpp::hchttp;
+namespace hhbench = happycpp::hcbenchmark;
+
+namespace {
+
+    // 原实现：isalnum/isspace，逐字节 push_back
+    std::string legacyEncode(const std::string &s) {
+        std::string val;
+
+        for (char i : s) {
+            const auto uc = static_cast<uint8_t>(i);
+
+            if (isalnum(uc) || uc == '-' || uc == '_' || uc == '.' || uc == '~') {
+                val.push_back(i);
+            } else if (isspace(uc)) {
+                val.push_back('+');
+            } else {
+                val.push_back('%');
+                val.push_back(static_cast<char>(uc >> 4 > 9 ? (uc >> 4) + 55 : (uc >> 4) + 48));
+                val.push_back(static_cast<char>(uc % 16 > 9 ? uc % 16 + 55 : uc % 16 + 48));
+            }
+        }
+
+        return val;
+    }
+
+    char legacyHex(char ch) {
+        if (ch >= '0' && ch <= '9')
+            return static_cast<char>(ch - '0');
+        if (ch >= 'a' && ch <= 'f')
+            return static_cast<char>(ch - 'a' + 10);
+        if (ch >= 'A' && ch <= 'F')
+            return static_cast<char>(ch - 'A' + 10);
+
+        return -1;
+    }
+
+    std::string legacyDecode(const std::string &s) {
+        std::string val;
+        size_t i = 0;
+
+        while (i < s.size()) {
+            if (s[i] == '%' && i + 2 < s.size()) {
+                val.push_back(static_cast<char>(legacyHex(s[i + 1]) << 4 | legacyHex(s[i + 2])));
+                i += 3;
+            } else if (s[i] == '+') {
+                val.push_back(' ');
+                ++i;
+            } else {
+                val.push_back(s[i]);
+                ++i;
+            }
+        }
+
+        return val;
+    }
+
+} /* namespace */
+
+int main() {
+    const uint64_t iterations = 1000000;
+
+    // 典型查询字符串：大部分字符不需要编码
+    const std::string query("q=happycpp+http+client&lang=zh-CN&page=2&sort=updated"
+                            "&redirect=https%3A%2F%2Fexample.com%2Fpath%2Fto%2Fresource%3Fid%3D42"
+                            "&utm_source=newsletter&utm_medium=email&utm_campaign=2016_summer");
+    const std::string plain(hhhttp::hcurl::decode(query));
+    std::vector<char> buf(hhhttp::hcurl::encodedMaxSize(plain.size()));
+
+    hhbench::report("legacy encode", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        hhbench::doNotOptimize(legacyEncode(plain));
+    }));
+
+    hhbench::report("hcurl::encode(std::string)", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        hhbench::doNotOptimize(hhhttp::hcurl::encode(plain));
+    }));
+
+    hhbench::report("hcurl::encode(buffer)", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        hhbench::doNotOptimize(hhhttp::hcurl::encode(plain, buf.data()));
+    }));
+
+    hhbench::report("legacy decode", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        hhbench::doNotOptimize(legacyDecode(query));
+    }));
+
+    hhbench::report("hcurl::decode(std::string)", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        hhbench::doNotOptimize(hhhttp::hcurl::decode(query));
+    }));
+
+    size_t size = 0;
+    hhbench::report("hcurl::decode(buffer)", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        hhhttp::hcurl::decode(query, buf.data(), &size);
+        hhbench::doNotOptimize(size);
+    }));
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// HttpMessage::toHmf 完美哈希与原 std::map 查找的性能对比
+
+#include "benchmark_util.h"
+#include "happycpp/http.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace hhhttp = happycpp::hchttp;
+namespace hhbench = happycpp::hcbenchmark;
+
+int main() {
+    const uint64_t iterations = 20000000;
+
+    // 原实现：std::map<std::string, HttpMsgField>，区分大小写
+    std::map<std::string, hhhttp::HttpMsgField> desc_hmf;
+
+    for (int32_t i = 0; i <= hhhttp::HTTP_MRESF_NONSTD_X_CONTENT_DURATION; ++i) {
+        const auto hmf = static_cast<hhhttp::HttpMsgField>(i);
+        desc_hmf[std::string(hhhttp::HttpMessage::toName(hmf))] = hmf;
+    }
+
+    // 常见请求头，以及少量未知字段
+    const std::vector<std::string> names = {
+            "Host", "User-Agent", "Accept", "Accept-Encoding", "Accept-Language",
+            "Connection", "Cookie", "Referer", "Content-Length", "Content-Type",
+            "Cache-Control", "If-None-Match", "If-Modified-Since", "X-Request-Id",
+            "Sec-Fetch-Mode", "Upgrade-Insecure-Requests"
+    };
+    const size_t mask = 15;
+
+    const double map_ns = hhbench::nsPerOp(iterations, [&](uint64_t i) {
+        const auto it = desc_hmf.find(names[i & mask]);
+        hhbench::doNotOptimize(it == desc_hmf.end() ? hhhttp::INVALID_HTTP_MSG_FIELD : it->second);
+    });
+
+    const double hash_ns = hhbench::nsPerOp(iterations, [&](uint64_t i) {
+        hhbench::doNotOptimize(hhhttp::HttpMessage::toHmf(names[i & mask]));
+    });
+
+    hhbench::report("std::map<std::string, HttpMsgField>", map_ns);
+    hhbench::report("HttpMessage::toHmf", hash_ns);
+
+    return 0;
+}
@@ -0,0 +1,217 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// HttpServer 吞吐量和延迟：本地负载生成器通过 keep-alive 连接持续发送请求
+//
+// 用法：http_server_benchmark [连接数] [秒数] [pipelining 深度] [服务端线程数]
+
+#include "benchmark_util.h"
+#include "happycpp/http/parser.h"
+#include "happycpp/http/server.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hhhttp = happycpp::hchttp;
+namespace hhbench = happycpp::hcbenchmark;
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    const std::string kRequest("GET /hello HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n");
+
+    // 客户端连接，记录每个请求从发送到收到完整响应的耗时
+    class ClientConn : public hhhttp::HttpParserHandler {
+    public:
+        ClientConn(int fd, std::vector<uint32_t> *latencies)
+                : fd(fd), parser_(this, hhhttp::HTTP_MSG_RESPONSE), latencies_(latencies) {}
+
+        ~ClientConn() override {
+            close(fd);
+        }
+
+        void onMessageComplete() override {
+            const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                    Clock::now() - sent_.front()).count();
+            latencies_->push_back(static_cast<uint32_t>(us));
+            sent_.pop_front();
+        }
+
+        // 保持 depth 个请求在途
+        bool fill(size_t depth) {
+            while (sent_.size() < depth) {
+                if (write(fd, kRequest.data(), kRequest.size()) != static_cast<ssize_t>(kRequest.size()))
+                    return false;
+
+                sent_.push_back(Clock::now());
+            }
+
+            return true;
+        }
+
+        bool onReadable() {
+            char buf[16384];
+            const ssize_t n = read(fd, buf, sizeof(buf));
+
+            if (n <= 0)
+                return false;
+
+            data_.append(buf, static_cast<size_t>(n));
+            data_.erase(0, parser_.execute(data_));
+
+            return parser_.error() == hhhttp::HTTP_PARSE_OK;
+        }
+
+        const int fd;
+
+    private:
+        hhhttp::HttpParser parser_;
+        std::vector<uint32_t> *latencies_;
+        std::deque<Clock::time_point> sent_;
+        std::string data_;
+    };
+
+    int connectTo(uint16_t port) {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+        if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) {
+            perror("connect");
+            exit(1);
+        }
+
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+        return fd;
+    }
+
+    // 单个负载线程，用 epoll 驱动 conns 个连接
+    void load(uint16_t port, size_t conns, size_t depth, Clock::time_point deadline,
+              std::vector<uint32_t> *latencies, size_t *errors) {
+        const int ep = epoll_create1(0);
+        std::vector<std::unique_ptr<ClientConn> > clients;
+
+        for (size_t i = 0; i < conns; ++i) {
+            clients.push_back(std::make_unique<ClientConn>(connectTo(port), latencies));
+
+            struct epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.ptr = clients.back().get();
+            epoll_ctl(ep, EPOLL_CTL_ADD, clients.back()->fd, &ev);
+            clients.back()->fill(depth);
+        }
+
+        struct epoll_event events[256];
+
+        while (Clock::now() < deadline) {
+            const int n = epoll_wait(ep, events, 256, 100);
+
+            for (int i = 0; i < n; ++i) {
+                auto *c = static_cast<ClientConn *>(events[i].data.ptr);
+
+                if (!c->onReadable() || !c->fill(depth)) {
+                    ++*errors;
+                    epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, nullptr);
+                }
+            }
+        }
+
+        close(ep);
+    }
+
+} /* namespace */
+
+int main(int argc, char **argv) {
+    const size_t hw = std::max(2u, std::thread::hardware_concurrency());
+    const size_t conns = argc > 1 ? strtoul(argv[1], nullptr, 10) : 64;
+    const int seconds = argc > 2 ? atoi(argv[2]) : 3;
+    const size_t depth = argc > 3 ? strtoul(argv[3], nullptr, 10) : 1;
+
+    hhhttp::HttpServerOptions options;
+    options.host = "127.0.0.1";
+    options.threads = argc > 4 ? strtoul(argv[4], nullptr, 10) : hw / 2;
+
+    hhhttp::HttpServer server(options);
+    server.route("/hello", [](const hhhttp::HttpRequestMsg &, hhhttp::HttpResponseMsg *resp) {
+        resp->setField(hhhttp::HTTP_MCOMF_CONTENT_TYPE, "text/plain");
+        resp->setBody("Hello, World!");
+    });
+    server.start();
+
+    // 负载线程与服务端线程各占一半 CPU
+    const size_t threads = std::min(conns, hw > options.threads ? hw - options.threads : 1);
+    const auto deadline = Clock::now() + std::chrono::seconds(seconds);
+    std::vector<std::vector<uint32_t> > latencies(threads);
+    std::vector<size_t> errors(threads, 0);
+    std::vector<std::thread> workers;
+
+    for (size_t i = 0; i < threads; ++i) {
+        const size_t n = conns / threads + (i < conns % threads ? 1 : 0);
+        workers.emplace_back(load, server.port(), n, depth, deadline, &latencies[i], &errors[i]);
+    }
+
+    for (auto &t : workers)
+        t.join();
+
+    server.stop();
+
+    std::vector<uint32_t> all;
+    size_t errorCount = 0;
+
+    for (size_t i = 0; i < threads; ++i) {
+        all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+        errorCount += errors[i];
+    }
+
+    if (all.empty()) {
+        printf("no response\n");
+        return 1;
+    }
+
+    std::sort(all.begin(), all.end());
+
+    printf("%zu server threads, %zu load threads, %zu connections, pipelining depth %zu\n",
+           options.threads, threads, conns, depth);
+    hhbench::report("requests", static_cast<double>(all.size()) / seconds, "req/s");
+    hhbench::report("latency p50", all[all.size() / 2], "us");
+    hhbench::report("latency p99", all[all.size() * 99 / 100], "us");
+    hhbench::report("latency max", all.back(), "us");
+    hhbench::report("errors", static_cast<double>(errorCount), "");
+
+    return 0;
+}
@@ -0,0 +1,189 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// 枚举网卡的开销：旧版本 IfaceFiller 的 ioctl 方式(SIOCGIFCONF、每个网卡两次 ioctl、
+// 读取 /proc/net/route 以及 res_init)与 rtnetlink dump 对比。
+// 以及 1000 个网卡时，IfaceFinder 原来的顺序查找与哈希索引、最长前缀匹配的对比
+
+#include "benchmark_util.h"
+#include "happycpp/linux.h"
+#include "happycpp/linux/netlink.h"
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <resolv.h>
+#include <linux/rtnetlink.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace hhbench = happycpp::hcbenchmark;
+namespace hcnet = happycpp::hclinux::hcnet;
+namespace hcnetlink = happycpp::hclinux::hcnetlink;
+
+namespace {
+
+    //! 与旧版本 IfaceFiller 相同的系统调用序列。旧版本最多 20 项，这里不截断，以便比较网卡很多时的开销
+    size_t legacyEnumerate() {
+        static struct ifreq ifreqs[4096]{};
+        struct ifconf ifc{};
+        ifc.ifc_buf = reinterpret_cast<char *>(ifreqs);
+        ifc.ifc_len = sizeof(ifreqs);
+
+        int sock = socket(AF_INET, SOCK_DGRAM, 0);
+        ioctl(sock, SIOCGIFCONF, &ifc);
+        close(sock);
+
+        std::ifstream route("/proc/net/route");
+        std::string line;
+
+        while (getline(route, line))
+            hhbench::doNotOptimize(line.data());
+
+        res_init();
+
+        const size_t count = ifc.ifc_len / sizeof(struct ifreq);
+
+        for (size_t i = 1; i < count; ++i) {
+            struct ifreq ifr{};
+            std::strncpy(ifr.ifr_name, ifreqs[i].ifr_name, IFNAMSIZ - 1);
+
+            sock = socket(AF_INET, SOCK_DGRAM, 0);
+            ioctl(sock, SIOCGIFNETMASK, &ifr);
+            close(sock);
+
+            sock = socket(AF_INET, SOCK_DGRAM, 0);
+            ioctl(sock, SIOCGIFHWADDR, &ifr);
+            close(sock);
+        }
+
+        return count;
+    }
+
+    //! n 个网卡，每个网卡一个地址和一条直连路由，另有一条默认路由
+    hcnetlink::NetlinkDump syntheticDump(int32_t n) {
+        hcnetlink::NetlinkDump dump;
+
+        for (int32_t i = 0; i < n; ++i) {
+            const int32_t index = i + 2;
+            const std::string net = "10." + std::to_string(i / 256) + "." + std::to_string(i % 256) + ".";
+
+            dump.links.push_back(hcnetlink::LinkInfo{index, IFF_UP, 1500, "eth" + std::to_string(i),
+                                                     "52:54:00:00:00:00"});
+
+            hcnetlink::AddrInfo addr{};
+            addr.index = index;
+            addr.prefixLen = 24;
+            hcnetlink::parseIpAddr(net + "1", &addr.address);
+            dump.addrs.push_back(addr);
+
+            hcnetlink::RouteInfo route{};
+            route.family = AF_INET;
+            route.dstLen = 24;
+            route.type = RTN_UNICAST;
+            route.table = RT_TABLE_MAIN;
+            route.oif = index;
+            hcnetlink::parseIpAddr(net + "0", &route.dst);
+            dump.routes.push_back(route);
+        }
+
+        hcnetlink::RouteInfo route{};
+        route.family = AF_INET;
+        route.type = RTN_UNICAST;
+        route.table = RT_TABLE_MAIN;
+        route.oif = 2;
+        hcnetlink::parseIpAddr("10.0.0.254", &route.gateway);
+        dump.routes.push_back(route);
+        return dump;
+    }
+
+    //! 原来 IfaceFinder::getIfaceByName 的方式：顺序比较，并且复制字段值
+    bool linearFind(const hcnet::IfaceList &list, const std::string &name, hcnet::Iface *iface) {
+        for (const hcnet::Iface &it : list) {
+            const std::string value(it.name_);
+
+            if (value == name) {
+                *iface = it;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+} /* namespace */
+
+int main() {
+    const uint64_t iterations = 2000;
+
+    hhbench::report("legacy ioctl enumeration", hhbench::nsPerOp(iterations, [](uint64_t) {
+        hhbench::doNotOptimize(legacyEnumerate());
+    }));
+
+    hhbench::report("hcnetlink::dumpAll", hhbench::nsPerOp(iterations, [](uint64_t) {
+        hcnetlink::NetlinkDump dump;
+        hhbench::doNotOptimize(hcnetlink::dumpAll(&dump));
+        hhbench::doNotOptimize(&dump);
+    }));
+
+    hhbench::report("IfaceFinder construction", hhbench::nsPerOp(iterations, [](uint64_t) {
+        hcnet::IfaceFinder finder;
+        hhbench::doNotOptimize(&finder);
+    }));
+
+    const hcnet::IfaceFinder finder(syntheticDump(1000));
+    std::vector<std::string> names;
+    std::vector<std::string> ips;
+
+    for (const hcnet::Iface &iface : finder.ifaces()) {
+        names.push_back(iface.name_);
+        ips.push_back(iface.ip_addr_.substr(0, iface.ip_addr_.size() - 1) + "77");
+    }
+
+    const uint64_t lookups = 200000;
+
+    hhbench::report("linear lookup by name, 1000 ifaces", hhbench::nsPerOp(lookups / 100, [&](uint64_t i) {
+        hcnet::Iface iface;
+        hhbench::doNotOptimize(linearFind(finder.ifaces(), names[i % names.size()], &iface));
+    }));
+
+    hhbench::report("IfaceFinder::ifaceByName, 1000 ifaces", hhbench::nsPerOp(lookups, [&](uint64_t i) {
+        hhbench::doNotOptimize(finder.ifaceByName(names[i % names.size()]));
+    }));
+
+    hhbench::report("IfaceFinder::ifaceByIp, 1000 ifaces", hhbench::nsPerOp(lookups, [&](uint64_t i) {
+        hhbench::doNotOptimize(finder.ifaceByIp(finder.ifaces()[i % names.size()].ip_addr_));
+    }));
+
+    hhbench::report("IfaceFinder::routeIface, 1001 routes", hhbench::nsPerOp(lookups, [&](uint64_t i) {
+        hhbench::doNotOptimize(finder.routeIface(ips[i % ips.size()]));
+    }));
+
+    hcnetlink::IpAddr dst{};
+    hcnetlink::parseIpAddr("192.0.2.1", &dst);
+
+    hhbench::report("IfaceFinder::routeIface, default route", hhbench::nsPerOp(lookups, [&](uint64_t) {
+        hhbench::doNotOptimize(finder.routeIface(dst));
+    }));
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// 未启用的日志级别的开销：HappyLog::trace 与 HC_LOG_TRACE 对比，以及获取实例的开销。
+// 启用的级别：文本格式 HC_LOG_INFO 与二进制格式 HC_BLOG_INFO 对比
+
+#include "benchmark_util.h"
+#include "happycpp/log.h"
+#include <string>
+
+namespace hclog = happycpp::log;
+namespace hhbench = happycpp::hcbenchmark;
+
+namespace {
+
+    // 低于 HAPPYCPP_LOG_MIN_LEVEL 的调用在编译时被删除
+#undef HAPPYCPP_LOG_MIN_LEVEL
+#define HAPPYCPP_LOG_MIN_LEVEL 20000
+
+    void compiledOut(const std::string &cmd) {
+        HC_LOG_TRACE("cmd=%s" EOL, cmd.c_str());
+    }
+
+#undef HAPPYCPP_LOG_MIN_LEVEL
+#define HAPPYCPP_LOG_MIN_LEVEL 0
+
+} /* namespace */
+
+int main() {
+    const uint64_t iterations = 10000000;
+    const std::string cmd("ls -l /proc/self/fd");
+
+    // 默认级别为 INFO，TRACE 未启用
+    hclog::HappyLogPtr hlog = hclog::HappyLog::getInstance(log4cplus::INFO_LOG_LEVEL);
+
+    hhbench::report("HappyLog::getInstance", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        hhbench::doNotOptimize(hclog::HappyLog::getInstance());
+    }));
+
+    hhbench::report("HappyLog::instance", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        hhbench::doNotOptimize(&hclog::HappyLog::instance());
+    }));
+
+    hhbench::report("HappyLog::trace (disabled)", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        hlog->trace("cmd=" + cmd + EOL);
+    }));
+
+    hhbench::report("HC_LOG_TRACE (disabled)", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        HC_LOG_TRACE("cmd=%s" EOL, cmd.c_str());
+    }));
+
+    hhbench::report("HC_LOG_TRACE (compiled out)", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        compiledOut(cmd);
+    }));
+
+    // 启用的级别：异步模式下格式化并放入队列
+    hclog::AsyncLogOptions options;
+    options.file = "/dev/null";
+    hlog->enableAsync(options);
+
+    hhbench::report("HC_LOG_INFO (async, enabled)", hhbench::nsPerOp(iterations / 10, [&](uint64_t i) {
+        HC_LOG_INFO("cmd=%s i=%llu", cmd.c_str(), static_cast<unsigned long long>(i));
+    }));
+
+    hlog->disableAsync();
+
+    // 二进制格式：只复制调用点 id、时间戳和参数
+    options.format = hclog::LOG_FORMAT_BINARY;
+    hlog->enableAsync(options);
+
+    hhbench::report("HC_BLOG_INFO (async binary, enabled)", hhbench::nsPerOp(iterations / 10, [&](uint64_t i) {
+        HC_BLOG_INFO("cmd=%s i=%llu", cmd.c_str(), static_cast<unsigned long long>(i));
+    }));
+
+    hlog->disableAsync();
+    return 0;
+}
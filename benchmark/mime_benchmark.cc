@@ -0,0 +1,83 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// hcmime::fromUri 与原 getMimeType(每次调用重建 std::map)的性能对比
+
+#include "benchmark_util.h"
+#include "happycpp/http.h"
+#include "happycpp/http/mime.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace hhhttp = happycpp::hchttp;
+namespace hhbench = happycpp::hcbenchmark;
+
+namespace {
+
+    // 原实现
+    std::string legacyGetMimeType(const std::string &uri, const std::string &charset) {
+        std::map<std::string, std::string> mime_types;
+        const std::string _charset(charset.empty() ? "utf-8" : charset);
+        mime_types["txt"] = "text/plain; charset=iso-8859-1";
+        mime_types["text"] = "text/plain; charset=iso-8859-1";
+        mime_types["htm"] = "text/html; charset=" + _charset;
+        mime_types["html"] = "text/html; charset=" + _charset;
+        mime_types["xml"] = "text/xml; charset=" + _charset;
+        mime_types["jpg"] = "image/jpeg";
+        mime_types["jpeg"] = "image/jpeg";
+        mime_types["gif"] = "image/gif";
+        mime_types["png"] = "image/png";
+        mime_types["css"] = "text/css";
+        mime_types["js"] = "image/javascript";
+        mime_types["cgi"] = "cgi";
+        mime_types["swf"] = "application/x-shockwave-flash";
+
+        const std::string ext_name = uri.substr(uri.find_last_of('.') + 1);
+        const auto it = mime_types.find(ext_name);
+
+        return it == mime_types.end() ? "application/octet-stream" : it->second;
+    }
+
+} /* namespace */
+
+int main() {
+    const uint64_t iterations = 2000000;
+
+    const std::vector<std::string> uris = {
+            "/index.html", "/static/css/site.css", "/static/js/app.js", "/img/logo.png",
+            "/img/photo.JPG", "/favicon.ico", "/docs/manual.pdf", "/download/file.bin"
+    };
+    const size_t mask = 7;
+
+    hhbench::report("legacy getMimeType", hhbench::nsPerOp(iterations, [&](uint64_t i) {
+        hhbench::doNotOptimize(legacyGetMimeType(uris[i & mask], ""));
+    }));
+
+    hhbench::report("getMimeType", hhbench::nsPerOp(iterations, [&](uint64_t i) {
+        hhbench::doNotOptimize(hhhttp::getMimeType(uris[i & mask], ""));
+    }));
+
+    hhbench::report("hcmime::fromUri", hhbench::nsPerOp(iterations, [&](uint64_t i) {
+        hhbench::doNotOptimize(hhhttp::hcmime::fromUri(uris[i & mask], ""));
+    }));
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// 读取 cpu 和内存信息的开销：popen 执行 shell 管道与直接解析保持打开的 /proc 文件对比，
+// 阻塞 100 毫秒的 getCpuUtil 与读取 MetricsSampler 快照对比，以及按 cpu、进程统计使用率的开销
+
+#include "benchmark_util.h"
+#include "happycpp/cmd.h"
+#include "happycpp/linux.h"
+#include "happycpp/linux/metrics.h"
+#include "happycpp/linux/procfs.h"
+#include "happycpp/log.h"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hclog = happycpp::log;
+namespace hhbench = happycpp::hcbenchmark;
+namespace hcmetrics = happycpp::hclinux::hcmetrics;
+namespace hcprocfs = happycpp::hclinux::hcprocfs;
+
+int main() {
+    const uint64_t popenIterations = 200;
+    const uint64_t iterations = 100000;
+
+    hclog::HappyLog::instance().setLogLevel(log4cplus::OFF_LOG_LEVEL);
+
+    hhbench::report("popen free -m (old totalSysMem)", hhbench::nsPerOp(popenIterations, [](uint64_t) {
+        const std::string out(happycpp::hccmd::getOutputOfCmd("free -m |egrep 'Mem:'|awk '{print $2}'"));
+        hhbench::doNotOptimize(&out);
+    }));
+
+    hhbench::report("popen /proc/stat (old getWorkCpuTime)", hhbench::nsPerOp(popenIterations, [](uint64_t) {
+        const std::string out(happycpp::hccmd::getOutputOfCmd(
+                "cat /proc/stat|egrep '^cpu[ ]+'|sed 's/^cpu[ ]\\+//g'"));
+        hhbench::doNotOptimize(&out);
+    }));
+
+    hhbench::report("hcmem::totalSysMem", hhbench::nsPerOp(iterations, [](uint64_t) {
+        hhbench::doNotOptimize(happycpp::hclinux::hcmem::totalSysMem());
+    }));
+
+    hhbench::report("hcprocfs::readCpuStat", hhbench::nsPerOp(iterations, [](uint64_t) {
+        hcprocfs::CpuStat stat{};
+        hhbench::doNotOptimize(hcprocfs::readCpuStat(&stat));
+        hhbench::doNotOptimize(&stat);
+    }));
+
+    hhbench::report("hcprocfs::readLoadAvg", hhbench::nsPerOp(iterations, [](uint64_t) {
+        hcprocfs::LoadAvg load{};
+        hhbench::doNotOptimize(hcprocfs::readLoadAvg(&load));
+        hhbench::doNotOptimize(&load);
+    }));
+
+    // 旧版本的 getCpuUtil：两次读取之间等待 100 毫秒
+    hhbench::report("old getCpuUtil (100ms apart)", hhbench::nsPerOp(5, [](uint64_t) {
+        happycpp::hclinux::hccpu::CpuTime time{};
+        happycpp::hclinux::hccpu::getWorkCpuTime(&time);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        happycpp::hclinux::hccpu::getWorkCpuTime(&time);
+        hhbench::doNotOptimize(&time);
+    }));
+
+    // 256 个 cpu 一次计算各项时间占比
+    std::vector<hcprocfs::CpuStat> before(256);
+    std::vector<hcprocfs::CpuStat> after(256);
+    std::vector<happycpp::hclinux::hccpu::CpuBreakdown> breakdown(256);
+
+    for (size_t i = 0; i < after.size(); ++i) {
+        after[i] = before[i];
+        after[i].user += i;
+        after[i].idle += 100;
+    }
+
+    hhbench::report("cpuBreakdown (256 cpus)", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        happycpp::hclinux::hccpu::cpuBreakdown(before.data(), after.data(), after.size(), breakdown.data());
+        hhbench::doNotOptimize(breakdown.data());
+    }));
+
+    happycpp::hclinux::hccpu::CpuAccounting accounting;
+    std::vector<happycpp::hclinux::hccpu::TaskUsage> tasks;
+    accounting.sampleProcesses(&tasks);
+
+    const double processNs = hhbench::nsPerOp(200, [&](uint64_t) {
+        accounting.sampleProcesses(&tasks);
+    });
+    hhbench::report("CpuAccounting::sampleProcesses", processNs);
+    hhbench::report("  per process", processNs / static_cast<double>(tasks.size()));
+
+    hcmetrics::MetricsSampler sampler;
+    hcmetrics::MetricsSnapshot snap{};
+
+    hhbench::report("MetricsSampler::snapshot", hhbench::nsPerOp(iterations, [&](uint64_t) {
+        hhbench::doNotOptimize(sampler.snapshot(&snap));
+        hhbench::doNotOptimize(&snap);
+    }));
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+#.rst:
+# FindBrotli
+# ---------
+#
+#
+# Defines the following variables:
+#
+# ::
+#
+#    BROTLI_FOUND - Found the brotli
+#    BROTLI_INCLUDE_DIRS - Include directories
+#
+#
+#
+# Also defines the library variables below as normal variables.  These
+# contain debug/optimized keywords when a debugging library is found.
+#
+# ::
+#
+#    BROTLI_BOTH_LIBRARIES - Both libbrotlienc, libbrotlidec and libbrotlicommon
+#    BROTLI_LIBRARIES - libbrotlienc, libbrotlidec and libbrotlicommon
+#
+#
+#
+# Accepts the following variables as input:
+#
+# ::
+#
+#    BROTLI_ROOT - (as a CMake or environment variable)
+#                 The root directory of the brotli install prefix
+#
+#
+#
+# Example Usage:
+#
+# ::
+#
+#     enable_testing()
+#     find_package(Brotli REQUIRED)
+#     include_directories(${BROTLI_INCLUDE_DIRS})
+#
+#
+#
+# ::
+#
+#     add_executable(foo foo.cc)
+#     target_link_libraries(foo ${BROTLI_BOTH_LIBRARIES})
+#
+#
+#
+# ::
+#
+#     add_test(AllTestsInFoo foo)
+#
+#
+#
+
+function(_brotli_find_library _name)
+    find_library(${_name}
+            NAMES ${ARGN}
+            HINTS
+            ENV BROTLI_ROOT
+            ${BROTLI_ROOT}
+            PATH_SUFFIXES ${_brotli_libpath_suffixes}
+            )
+    mark_as_advanced(${_name})
+endfunction()
+
+
+set(_brotli_libpath_suffixes lib)
+
+find_path(BROTLI_INCLUDE_DIR
+        NAMES brotli/encode.h
+        HINTS $ENV{BROTLI_ROOT} ${BROTLI_ROOT}
+        PATH_SUFFIXES include
+        )
+mark_as_advanced(BROTLI_INCLUDE_DIR)
+
+_brotli_find_library(BROTLI_LIBRARY brotlienc)
+_brotli_find_library(BROTLI_DEC_LIBRARY brotlidec)
+_brotli_find_library(BROTLI_COMMON_LIBRARY brotlicommon)
+
+include(${CMAKE_ROOT}/Modules/FindPackageHandleStandardArgs.cmake)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(Brotli DEFAULT_MSG BROTLI_LIBRARY BROTLI_DEC_LIBRARY
+        BROTLI_COMMON_LIBRARY BROTLI_INCLUDE_DIR)
+
+if (BROTLI_FOUND)
+    set(BROTLI_INCLUDE_DIRS ${BROTLI_INCLUDE_DIR})
+    set(BROTLI_LIBRARIES ${BROTLI_LIBRARY} ${BROTLI_DEC_LIBRARY} ${BROTLI_COMMON_LIBRARY})
+    set(BROTLI_BOTH_LIBRARIES ${BROTLI_LIBRARIES})
+endif ()
+
@@ -9,6 +9,7 @@
 #
 #    CURL_FOUND - Found the curl
 #    CURL_INCLUDE_DIRS - Include directories
+#    CURL_VERSION_STRING - Version of libcurl, from curl/curlver.h
 #
 #
 #
@@ -88,8 +89,19 @@ mark_as_advanced(CURL_INCLUDE_DIR)
 _curl_find_library(CURL_LIBRARY curl)
 _curl_find_library(CURL_LIBRARY_DEBUG curld)
 
+# 从 curlver.h 读取版本，供 find_package(Curl <version>) 检查
+if (CURL_INCLUDE_DIR AND EXISTS "${CURL_INCLUDE_DIR}/curl/curlver.h")
+    file(STRINGS "${CURL_INCLUDE_DIR}/curl/curlver.h" _curl_version_line
+            REGEX "^#define[ \t]+LIBCURL_VERSION[ \t]+\"[^\"]*\"")
+    string(REGEX REPLACE "^.*LIBCURL_VERSION[ \t]+\"([0-9.]+).*$" "\\1"
+            CURL_VERSION_STRING "${_curl_version_line}")
+    unset(_curl_version_line)
+endif ()
+
 include(${CMAKE_ROOT}/Modules/FindPackageHandleStandardArgs.cmake)
-FIND_PACKAGE_HANDLE_STANDARD_ARGS(Curl DEFAULT_MSG CURL_LIBRARY CURL_INCLUDE_DIR)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(Curl
+        REQUIRED_VARS CURL_LIBRARY CURL_INCLUDE_DIR
+        VERSION_VAR CURL_VERSION_STRING)
 
 if (CURL_FOUND)
     set(CURL_INCLUDE_DIRS ${CURL_INCLUDE_DIR})
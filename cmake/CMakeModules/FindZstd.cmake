@@ -0,0 +1,99 @@
+#.rst:
+# FindZstd
+# ---------
+#
+#
+# Defines the following variables:
+#
+# ::
+#
+#    ZSTD_FOUND - Found the zstd
+#    ZSTD_INCLUDE_DIRS - Include directories
+#
+#
+#
+# Also defines the library variables below as normal variables.  These
+# contain debug/optimized keywords when a debugging library is found.
+#
+# ::
+#
+#    ZSTD_BOTH_LIBRARIES - Both libzstd
+#    ZSTD_LIBRARIES - libzstd
+#
+#
+#
+# Accepts the following variables as input:
+#
+# ::
+#
+#    ZSTD_ROOT - (as a CMake or environment variable)
+#                 The root directory of the zstd install prefix
+#
+#
+#
+# Example Usage:
+#
+# ::
+#
+#     enable_testing()
+#     find_package(Zstd REQUIRED)
+#     include_directories(${ZSTD_INCLUDE_DIRS})
+#
+#
+#
+# ::
+#
+#     add_executable(foo foo.cc)
+#     target_link_libraries(foo ${ZSTD_BOTH_LIBRARIES})
+#
+#
+#
+# ::
+#
+#     add_test(AllTestsInFoo foo)
+#
+#
+#
+
+function(_zstd_append_debugs _endvar _library)
+    if (${_library} AND ${_library}_DEBUG)
+        set(_output optimized ${${_library}} debug ${${_library}_DEBUG})
+    else ()
+        set(_output ${${_library}})
+    endif ()
+    set(${_endvar} ${_output} PARENT_SCOPE)
+endfunction()
+
+function(_zstd_find_library _name)
+    find_library(${_name}
+            NAMES ${ARGN}
+            HINTS
+            ENV ZSTD_ROOT
+            ${ZSTD_ROOT}
+            PATH_SUFFIXES ${_zstd_libpath_suffixes}
+            )
+    mark_as_advanced(${_name})
+endfunction()
+
+
+set(_zstd_libpath_suffixes lib)
+
+find_path(ZSTD_INCLUDE_DIR
+        NAMES zstd.h
+        HINTS $ENV{ZSTD_ROOT} ${ZSTD_ROOT}
+        PATH_SUFFIXES include
+        )
+mark_as_advanced(ZSTD_INCLUDE_DIR)
+
+_zstd_find_library(ZSTD_LIBRARY zstd)
+_zstd_find_library(ZSTD_LIBRARY_DEBUG zstdd)
+
+include(${CMAKE_ROOT}/Modules/FindPackageHandleStandardArgs.cmake)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(Zstd DEFAULT_MSG ZSTD_LIBRARY ZSTD_INCLUDE_DIR)
+
+if (ZSTD_FOUND)
+    set(ZSTD_INCLUDE_DIRS ${ZSTD_INCLUDE_DIR})
+    _zstd_append_debugs(ZSTD_LIBRARIES ZSTD_LIBRARY)
+    set(ZSTD_BOTH_LIBRARIES ${ZSTD_LIBRARIES})
+endif ()
+
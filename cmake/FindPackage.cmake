@@ -23,7 +23,9 @@ INCLUDE_DIRECTORIES(${Boost_INCLUDE_DIRS})
 FIND_PACKAGE(Pugixml REQUIRED)
 INCLUDE_DIRECTORIES(${PUGIXML_INCLUDE_DIRS})
 
-FIND_PACKAGE(Curl REQUIRED)
+# HttpClient 和 probeUrls 使用 CURLINFO_*_TIME_T，需要 7.61.0。
+# 7.68.0 之前没有 curl_multi_poll/curl_multi_wakeup，改用 curl_multi_wait 和管道
+FIND_PACKAGE(Curl 7.61.0 REQUIRED)
 INCLUDE_DIRECTORIES(${CURL_INCLUDE_DIR})
 
 FIND_PACKAGE(OpenSSL REQUIRED)
@@ -32,5 +34,25 @@ INCLUDE_DIRECTORIES(${OPENSSL_INCLUDE_DIR})
 FIND_PACKAGE(Log4cplus REQUIRED)
 INCLUDE_DIRECTORIES(${LOG4CPLUS_INCLUDE_DIRS})
 
+FIND_PACKAGE(Threads REQUIRED)
+
 FIND_PACKAGE(Iconv REQUIRED)
-INCLUDE_DIRECTORIES(${Iconv_INCLUDE_DIRS})
\ No newline at end of file
+INCLUDE_DIRECTORIES(${Iconv_INCLUDE_DIRS})
+
+FIND_PACKAGE(ZLIB REQUIRED)
+INCLUDE_DIRECTORIES(${ZLIB_INCLUDE_DIRS})
+
+# 可选的压缩算法，找不到时 HttpContentCoding 中对应的编码不可用
+FIND_PACKAGE(Zstd)
+
+IF (ZSTD_FOUND)
+    INCLUDE_DIRECTORIES(${ZSTD_INCLUDE_DIRS})
+    ADD_DEFINITIONS(-DHAPPYCPP_HAVE_ZSTD)
+ENDIF ()
+
+FIND_PACKAGE(Brotli)
+
+IF (BROTLI_FOUND)
+    INCLUDE_DIRECTORIES(${BROTLI_INCLUDE_DIRS})
+    ADD_DEFINITIONS(-DHAPPYCPP_HAVE_BROTLI)
+ENDIF ()
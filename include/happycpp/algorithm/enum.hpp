@@ -52,7 +52,7 @@ namespace happycpp::hcalgorithm::henum {
                 return static_cast<T>(value);
             }
 
-            ThrowHappyException("无效的枚举值");
+            ThrowHappyError(EINVAL, "无效的枚举值");
         }
 
         bool exists(Y value) {
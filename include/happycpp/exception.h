@@ -25,25 +25,54 @@
 #define INCLUDE_HAPPYCPP_EXCEPTION_H_
 
 #include "happycpp/common.h"
-#include "happycpp/log.h"
+#include <atomic>
+#include <cerrno>
 #include <exception>
-#include <stdexcept>
 #include <string>
 
 namespace happycpp {
 
+    //! 库中所有函数抛出的异常
+    /*!
+     构造时不写日志，由捕获异常的地方决定是否写日志，比如 HappyLog::error(e)。
+
+     消息有两种：
+     1. 动态消息(std::string)，构造时复制一次到堆上，复制异常时共享这份文本；
+     2. 静态消息(字符串字面量)和错误码，构造时不分配内存，异常只保存一个字符串指针。
+        ThrowHappySysError 的错误描述在第一次调用 what() 时才格式化到堆上。
+     在解析等热路径上，使用 ThrowHappyError 或者 ThrowHappySysError。
+     */
     class HAPPYCPP_SHARED_LIB_API HappyException : public std::exception {
     private:
-        happycpp::log::HappyLogPtr hlog = happycpp::log::HappyLog::getInstance();
-        std::runtime_error _error;
+        struct Text;
+
+        const char *_static; /*! 静态消息，_text 为空时使用 */
+        mutable std::atomic<Text *> _text; /*! 动态消息或格式化后的错误描述，带引用计数 */
+        int _code;
+        bool _sysError; /*! _code 为 errno，what() 追加错误描述 */
 
     public:
         // explicit 只对构造函数起作用，用来抑制隐式转换。
         explicit HappyException(const std::string &msg);
 
+        //! 静态消息，msg 必须在异常的整个生命周期内有效，通常是字符串字面量
+        /*!
+         * @param code 错误码，比如 EINVAL
+         * @param msg 静态消息
+         * @param sysError code 是否为 errno。为 true 时，what() 追加 strerror(code)
+         */
+        HappyException(int code, const char *msg, bool sysError = false) noexcept;
+
+        HappyException(const HappyException &other) noexcept;
+
+        HappyException &operator=(const HappyException &) = delete;
+
         ~HappyException() noexcept override;
 
         [[nodiscard]] const char *what() const noexcept override;
+
+        //! 错误码，使用动态消息构造时为 0
+        [[nodiscard]] int code() const noexcept;
     };
 
 } /* namespace happycpp */
@@ -51,4 +80,12 @@ namespace happycpp {
 #define ThrowHappyException(msg) \
   throw happycpp::HappyException(msg)
 
+//! 抛出静态消息和错误码，msg 必须是字符串字面量
+#define ThrowHappyError(code, msg) \
+  throw happycpp::HappyException(code, "" msg)
+
+//! 抛出静态消息和当前的 errno，错误描述在 what() 时才格式化。msg 必须是字符串字面量
+#define ThrowHappySysError(msg) \
+  throw happycpp::HappyException(errno, "" msg, true)
+
 #endif  // INCLUDE_HAPPYCPP_EXCEPTION_H_
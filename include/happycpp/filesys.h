@@ -65,6 +65,9 @@ namespace happycpp::hcfilesys {
                                                std::vector<FileStat> *v,
                                                uint32_t max_num = 10000);
 
+    // 获取单个文件或者目录的状态，不存在或者没有权限时返回 false
+    HAPPYCPP_SHARED_LIB_API bool getFileStat(const std::string &path, FileStat *fs);
+
 } /* namespace happycpp */
 
 #endif  // INCLUDE_HAPPYCPP_FILESYS_H_
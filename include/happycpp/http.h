@@ -24,7 +24,11 @@
 #ifndef INCLUDE_HAPPYCPP_HTTP_H_
 #define INCLUDE_HAPPYCPP_HTTP_H_
 
+#include "happycpp/http/query.h"
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <map>
 #include <memory>
 #include <vector>
@@ -149,46 +153,131 @@ namespace happycpp::hchttp {
         HTTP_MSG_RESPONSE,
     } HttpMsgType;
 
+    //! HttpMsgField 有效枚举的数量
+    constexpr size_t kHttpMsgFieldCount = HTTP_MRESF_NONSTD_X_CONTENT_DURATION + 1;
+
     //! HTTP 消息基类
+    /*!
+     所有字段名和字段值都保存在同一个缓冲区中。已知字段按 HttpMsgField 枚举直接索引，
+     未知字段以及重复出现的字段(比如多个 Set-Cookie)按出现顺序保存在附加列表中。
+
+     返回 std::string_view 的字段访问函数，在下一次修改消息头之前有效。
+     */
     class HttpMessage {
     protected:
-        static std::map<std::string, HttpMethodType> mDescHm;
-        static std::map<std::string, HttpMsgField> mDescHmf;
+        //! 字段内容在 headerBuf_ 中的位置
+        struct FieldSpan {
+            uint32_t offset;
+            uint32_t size;
+        };
+
+        //! 未知字段或者重复字段
+        struct ExtraField {
+            HttpMsgField field; /*! 未知字段为 INVALID_HTTP_MSG_FIELD */
+            FieldSpan name; /*! 只有未知字段才有效 */
+            FieldSpan value;
+        };
+
+        static constexpr uint32_t kNoField = UINT32_MAX;
 
         HttpMsgType type_; /*! 消息类型 */
         std::string version_; /*! HTTP 版本 */
-        std::map<HttpMsgField, std::string> header_; /*! message-header 消息字段集合*/
+        std::string headerBuf_; /*! message-header 所有字段名和字段值 */
+        FieldSpan fields_[kHttpMsgFieldCount]; /*! 已知字段第一次出现的值 */
+        std::vector<ExtraField> extraFields_; /*! 未知字段以及重复字段 */
         std::string body_; /*! message-body */
 
     protected:
         HttpMessage();
 
+        FieldSpan appendToBuf(std::string_view s);
+
+        [[nodiscard]] std::string_view toView(const FieldSpan &span) const;
+
     public:
         virtual ~HttpMessage();
 
-        static HttpMethodType toHm(const std::string &k);
+        //! 请求方法名称转换为枚举，区分大小写
+        /*!
+         * @param k 请求方法名称，比如 GET
+         * @return 不存在时，返回 INVALID_HTTP_METHOD
+         */
+        static HttpMethodType toHm(std::string_view k);
 
-        static HttpMsgField toHmf(const std::string &k);
+        //! 字段名称转换为枚举，不区分大小写
+        /*!
+         * @param k 字段名称，比如 Content-Length
+         * @return 不存在时，返回 INVALID_HTTP_MSG_FIELD
+         */
+        static HttpMsgField toHmf(std::string_view k);
+
+        //! 请求方法枚举转换为名称。无效的枚举返回空
+        static std::string_view toName(HttpMethodType hm);
+
+        //! 字段枚举转换为标准写法的名称。无效的枚举返回空
+        static std::string_view toName(HttpMsgField hmf);
 
         void setVersion(const std::string &v);
 
-        void addField(HttpMsgField k, const std::string &v);
+        //! 添加字段，已经存在的同名字段会被保留
+        void addField(HttpMsgField k, std::string_view v);
+
+        //! 添加字段，名称不区分大小写，未知字段也会被保留
+        void addField(std::string_view name, std::string_view v);
+
+        //! 设置字段，删除已经存在的同名字段
+        void setField(HttpMsgField k, std::string_view v);
+
+        //! 删除所有字段
+        void clearFields();
+
+        //! 预分配字段缓冲区，避免添加字段时多次分配内存
+        void reserveFields(size_t size);
 
         void setBody(const std::string &v);
 
-        HttpMsgType type();
+        void setBody(std::string &&v);
+
+        [[nodiscard]] HttpMsgType type() const;
+
+        [[nodiscard]] const std::string &version() const;
 
-        std::string version();
         //! 获取指定字段的值
         /*!
          * @param hmf 指定字段
-         * @return 字符串 如果指定字段不存在值，则返回空
+         * @return 字段第一次出现时的值。如果指定字段不存在值，则返回空
          */
-        std::string header(HttpMsgField hmf);
+        [[nodiscard]] std::string_view header(HttpMsgField hmf) const;
+
+        //! 获取指定名称字段的值，名称不区分大小写，可以是未知字段
+        [[nodiscard]] std::string_view header(std::string_view name) const;
+
+        //! 获取指定字段的所有值，比如多个 Set-Cookie
+        void headers(HttpMsgField hmf, std::vector<std::string_view> *values) const;
 
-        void header(std::map<HttpMsgField, std::string> *hmf);
+        //! 获取所有已知字段第一次出现的值(会复制字段值)
+        void header(std::map<HttpMsgField, std::string> *hmf) const;
 
-        std::string body();
+        //! 按 "已知字段、附加字段" 的顺序，遍历所有字段
+        /*!
+         * @param f 回调函数，原型为 void(std::string_view name, std::string_view value)
+         */
+        template<typename F>
+        void forEachField(F f) const {
+            for (size_t i = 0; i < kHttpMsgFieldCount; ++i) {
+                if (fields_[i].offset != kNoField)
+                    f(toName(static_cast<HttpMsgField>(i)), toView(fields_[i]));
+            }
+
+            for (const auto &it : extraFields_) {
+                if (it.field == INVALID_HTTP_MSG_FIELD)
+                    f(toView(it.name), toView(it.value));
+                else
+                    f(toName(it.field), toView(it.value));
+            }
+        }
+
+        [[nodiscard]] const std::string &body() const;
     };
 
     //! HTTP 请求消息类
@@ -201,11 +290,18 @@ namespace happycpp::hchttp {
         /*! 请求字段。原始请求路径，包括路径和问号后面的参数 */
         std::string request_url_;
         std::string url_; /*! 请求字段。请求路径不包括问号后面的参数 */
-        std::string args_; /*! 请求字段 */
+        mutable std::string args_; /*! 请求字段。未调用 setArgs 时，由 args() 从 request_url_ 解码 */
+        bool argsSet_; /*! 是否调用过 setArgs */
+        /*! args_ 的解码状态：0 未解码，1 正在解码，2 已经从当前的 request_url_ 解码 */
+        mutable std::atomic<int> argsState_;
 
     public:
         HttpRequestMsg();
 
+        HttpRequestMsg(const HttpRequestMsg &other);
+
+        HttpRequestMsg &operator=(const HttpRequestMsg &other);
+
         ~HttpRequestMsg() override;
 
         void setMethod(HttpMethodType v);
@@ -216,13 +312,24 @@ namespace happycpp::hchttp {
 
         void setArgs(const std::string &v);
 
-        HttpMethodType method();
+        [[nodiscard]] HttpMethodType method() const;
 
-        std::string requestUrl();
+        [[nodiscard]] const std::string &requestUrl() const;
 
-        std::string url();
+        [[nodiscard]] const std::string &url() const;
+
+        //! 解码后的完整查询字符串。按名称读取参数时，使用 queryArgs() 更快
+        /*!
+         解析请求时只保存原始的请求路径，第一次调用时才解码查询字符串。
+         多个线程可以同时调用，只有一个线程解码，其它线程等待解码完成。
+         */
+        [[nodiscard]] const std::string &args() const;
 
-        std::string args();
+        //! 查询字符串的视图，只有读取的参数才会解码
+        /*!
+         * @return 视图指向 requestUrl()，在修改 HttpRequestMsg 之前有效
+         */
+        [[nodiscard]] QueryArgs queryArgs() const;
     };
 
     //! HTTP 响应消息类
@@ -243,9 +350,9 @@ namespace happycpp::hchttp {
 
         void setReasonPhrase(const std::string &v);
 
-        uint32_t status() const;
+        [[nodiscard]] uint32_t status() const;
 
-        std::string reasonPhrase();
+        [[nodiscard]] const std::string &reasonPhrase() const;
     };
 
     typedef std::shared_ptr<HttpMessage> HttpMessagePtr;
@@ -269,6 +376,8 @@ namespace happycpp::hchttp {
      */
     class HttpMsgCtx {
     private:
+        class HttpMsgBuilder;
+
         //! 初始化 HTTP 消息类智能指针
         /*!
          * @param http HTTP 消息原始数据
@@ -276,67 +385,41 @@ namespace happycpp::hchttp {
          */
         static HttpMessagePtr initHm(const std::string &http);
 
+    public:
         //! 转换 HTTP 消息请求行
         /*! 比如，
          GET /index?arg=test HTTP/1.0
          POST /index HTTP/1.0
-         */
-        /*!
-         * @param line 请求行字符串
-         * @param hm HTTP 消息类智能指针
-         */
-        static void parseRequestLine(const std::string &line, const HttpMessagePtr &hm);
 
-        //! 转换 HTTP 消息状态行
-        /*! 比如，
-         HTTP/1.1 200 OK
-         HTTP/1.1 416 Requested Range Not Satisfiable
+         使用 HttpParser 增量解析时(比如 HttpServer)，在 onRequestLine 回调中调用。
          */
         /*!
-         * @param line 状态行字符串
+         * @param method 请求方法
+         * @param target 请求路径，包括问号后面的参数
+         * @param version HTTP 版本
          * @param hm HTTP 消息类智能指针
          */
-        static void parseStatusLine(const std::string &line, const HttpMessagePtr &hm);
+        static void parseRequestLine(std::string_view method,
+                                     std::string_view target,
+                                     std::string_view version,
+                                     const HttpMessagePtr &hm);
 
-        //! 转换 HTTP 消息起始行
+        //! 转换 HTTP 消息状态行
         /*! 比如，
-         GET /index?arg=test HTTP/1.0
-         POST /index HTTP/1.0
          HTTP/1.1 200 OK
          HTTP/1.1 416 Requested Range Not Satisfiable
          */
         /*!
-         * @param line 起始行字符串
-         * @param hm HTTP 消息类智能指针
-         */
-        static void parseStartLine(const std::string &line, const HttpMessagePtr &hm);
-
-        //! 转换 HTTP 消息头
-
-        //! 比如，
-        //! Host: www.example.com\r\n
-        //! Accept: */*\r\n
-        /*!
-         * @param 起始行到消息体之间的字符串
-         * @param hm HTTP 消息类智能指针
-         */
-        static void parseHeader(const std::string &header, const HttpMessagePtr &hm);
-
-        //! 转换 HTTP 消息体
-        /*! 比如，
-         Content-Type: application/x-www-form-urlencoded\r\n
-         \r\n
-         hello world\n
-
-         中的"hello world"
-         */
-        /*!
-         * @param body 消息体字符串
+         * @param version HTTP 版本
+         * @param status 状态码
+         * @param reason 原因简述
          * @param hm HTTP 消息类智能指针
          */
-        static void parseBody(const std::string &body, const HttpMessagePtr &hm);
+        static void parseStatusLine(std::string_view version,
+                                    uint32_t status,
+                                    std::string_view reason,
+                                    const HttpMessagePtr &hm);
 
-    public:
         HttpMsgCtx();
 
         ~HttpMsgCtx() noexcept;
@@ -353,6 +436,12 @@ namespace happycpp::hchttp {
          @endverbatim
 
          http://www.w3.org/Protocols/rfc2616/rfc2616-sec4.html#sec4
+
+         需要一次性传入完整的消息，消息头之后的所有数据都作为消息体。
+         分块接收或者同一个连接上有多个消息时，请使用 HttpParser。
+
+         不规范的行(没有冒号的字段行、obs-fold 续行等)会被跳过，其余字段和消息体照常解析。
+         未知名称的字段也会保留，可以通过 header(name) 读取。
          */
         /*!
          * @param http HTTP 消息原始数据
@@ -361,21 +450,59 @@ namespace happycpp::hchttp {
         static HttpMessagePtr parse(const std::string &http);
     };
 
-    // 根据uri，返回对应的mime type
+    //! 根据 uri 的扩展名，返回对应的 MIME 类型
+    /*!
+     文本类型附加 "; charset=xxx"，charset 为空时使用 utf-8。
+     不需要 std::string 时，请使用 hcmime::fromUri，不分配内存。
+     */
     std::string getMimeType(const std::string &uri,
                             const std::string &charset);
+
     //! 从 URL 获取头信息
+    /*!
+     使用进程内共享的 HttpClient 发送 HEAD 请求，连接和 TLS 会话在多次调用之间复用。
+     需要并发请求时，请直接使用 HttpClient。
+     */
     /*!
      * @param url URL 地址
      * @return HttpResponseMsg 智能指针
      */
     HttpResponseMsgPtr getHeaderInfo(const std::string &url);
 
+    //! URL 编码(application/x-www-form-urlencoded)
+    /*!
+     字母、数字以及 "-_.~" 保持不变，空格编码为 "+"，其它字节编码为 "%XX"。
+     与 locale 无关。x86 平台上使用 SSE2/AVX2 一次扫描 16/32 字节，
+     不需要转换的连续字节整块复制。
+     */
     namespace hcurl {
 
-        std::string encode(const std::string &s);
+        //! 编码 n 字节数据，最多需要的缓冲区大小
+        constexpr size_t encodedMaxSize(size_t n) {
+            return n * 3;
+        }
+
+        //! 编码到调用者提供的缓冲区
+        /*!
+         * @param s 原始数据
+         * @param out 输出缓冲区，至少 encodedMaxSize(s.size()) 字节
+         * @return 写入的字节数
+         */
+        size_t encode(std::string_view s, char *out);
+
+        //! 解码到调用者提供的缓冲区
+        /*!
+         * @param s 编码后的数据
+         * @param out 输出缓冲区，至少 s.size() 字节
+         * @param size 返回写入的字节数。失败时为错误位置之前已经写入的字节数
+         * @return "%" 之后不是两个十六进制字符(包括在末尾被截断)时，返回 false
+         */
+        bool decode(std::string_view s, char *out, size_t *size);
+
+        std::string encode(std::string_view s);
 
-        std::string decode(const std::string &s);
+        //! 解码，格式错误的 "%" 原样保留
+        std::string decode(std::string_view s);
 
     } /* namespace hcurl */
 
@@ -0,0 +1,187 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_HTTP_CLIENT_H_
+#define INCLUDE_HAPPYCPP_HTTP_CLIENT_H_
+
+#include "happycpp/http.h"
+#include "happycpp/http/sink.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace happycpp::hchttp {
+
+    //! HttpClient 选项
+    struct HttpClientOptions {
+        size_t maxConnections = 0; /*! 最大连接数，0 表示不限制 */
+        size_t maxHostConnections = 8; /*! 单个主机最大连接数，超出的请求排队等待，0 表示不限制 */
+        size_t maxPoolSize = 64; /*! 最多缓存多少个空闲的 curl 句柄 */
+        uint32_t timeoutMs = 30000; /*! 默认超时时间(毫秒)，0 表示不限制 */
+        uint32_t connectTimeoutMs = 0; /*! 默认连接超时时间(毫秒)，0 使用 libcurl 默认值 */
+        bool verifyPeer = false; /*! 是否验证服务端证书 */
+    };
+
+    //! HttpClient 请求
+    struct HttpClientRequest {
+        HttpMethodType method = HTTP_METHOD_GET;
+        std::string url;
+        std::vector<std::string> headers; /*! 附加字段，格式为 "Name: value" */
+        std::string body; /*! 请求体，一般用于 POST、PUT */
+        uint32_t timeoutMs = 0; /*! 超时时间(毫秒)，0 使用 HttpClientOptions::timeoutMs */
+        /*! 消息体输出位置。为空时按 Content-Length 预分配内存，保存到 HttpResponseMsg::body() */
+        BodySinkPtr sink;
+    };
+
+    //! 请求结束的回调
+    /*!
+     成功时 error 为空，resp 为最终响应(跟随重定向、100-continue 之后的那个)；
+     失败时 resp 为空，error 为错误描述。指定了 HttpClientRequest::sink 时，
+     resp->body() 为空。
+     */
+    typedef std::function<void(const HttpResponseMsgPtr &resp,
+                               const std::string &error)> HttpClientCallback;
+
+    class HttpClientImpl;
+
+    //! 基于 libcurl multi 接口的异步 HTTP 客户端
+    /*!
+     所有请求在同一个后台线程中并发执行，连接、DNS 缓存以及 TLS 会话在请求之间复用，
+     请求结束后 curl 句柄放回池中，供后续请求使用。因此同一个 HttpClient 对同一主机
+     发起的多次请求，只需要一次 TCP 和 TLS 握手。
+
+     回调在后台线程中执行，不能阻塞，也不能在回调中等待同一个 HttpClient 的 future。
+     析构时，尚未结束的请求都以失败回调。
+
+     用法演示：
+     @verbatim
+     HttpClient client;
+
+     // future
+     HttpResponseMsgPtr resp = client.head("http://127.0.0.1/").get();
+
+     // 回调
+     client.get("http://127.0.0.1/", [](const HttpResponseMsgPtr &resp,
+                                        const std::string &error) {
+         ...
+     });
+     @endverbatim
+     */
+    class HttpClient {
+    public:
+        explicit HttpClient(const HttpClientOptions &options = HttpClientOptions());
+
+        ~HttpClient();
+
+        HttpClient(const HttpClient &) = delete;
+
+        HttpClient &operator=(const HttpClient &) = delete;
+
+        //! 发起请求，结束后调用 cb
+        void request(const HttpClientRequest &req, HttpClientCallback cb);
+
+        //! 发起请求
+        /*!
+         * @param req 请求
+         * @return 失败时 get() 抛出 HappyException
+         */
+        std::future<HttpResponseMsgPtr> request(const HttpClientRequest &req);
+
+        std::future<HttpResponseMsgPtr> get(const std::string &url);
+
+        void get(const std::string &url, HttpClientCallback cb);
+
+        std::future<HttpResponseMsgPtr> head(const std::string &url);
+
+        void head(const std::string &url, HttpClientCallback cb);
+
+        std::future<HttpResponseMsgPtr> post(const std::string &url,
+                                             const std::string &body,
+                                             const std::string &contentType);
+
+        void post(const std::string &url,
+                  const std::string &body,
+                  const std::string &contentType,
+                  HttpClientCallback cb);
+
+        //! 尚未结束的请求数量(包括排队中的)
+        [[nodiscard]] size_t pending() const;
+
+    private:
+        std::unique_ptr<HttpClientImpl> impl_;
+    };
+
+    //! 单个 URL 探测的耗时，单位为微秒
+    /*!
+     每一项都是该阶段本身的耗时，而不是从请求开始累计的时间。
+     复用已有连接时，dnsUs、connectUs 和 tlsUs 为 0。
+     */
+    struct ProbeTiming {
+        int64_t dnsUs = 0; /*! DNS 解析 */
+        int64_t connectUs = 0; /*! TCP 连接 */
+        int64_t tlsUs = 0; /*! TLS 握手，非 HTTPS 为 0 */
+        int64_t firstByteUs = 0; /*! 连接建立之后，到收到第一个字节 */
+        int64_t totalUs = 0; /*! 整个请求 */
+    };
+
+    //! 单个 URL 的探测结果
+    struct ProbeResult {
+        size_t index = 0; /*! 在 urls 中的下标 */
+        HttpResponseMsgPtr resp; /*! 失败时为空 */
+        std::string error; /*! 成功时为空 */
+        ProbeTiming timing;
+    };
+
+    //! probeUrls 选项
+    struct ProbeOptions {
+        size_t concurrency = 64; /*! 同时进行的请求数量 */
+        size_t maxHostConnections = 0; /*! 单个主机最大连接数，0 表示不限制 */
+        HttpMethodType method = HTTP_METHOD_HEAD; /*! GET 时丢弃消息体，只保留响应头 */
+        uint32_t connectTimeoutMs = 5000; /*! 单个请求的连接超时时间(毫秒) */
+        uint32_t timeoutMs = 10000; /*! 单个请求的超时时间(毫秒) */
+        bool verifyPeer = false; /*! 是否验证服务端证书 */
+        std::function<void(const ProbeResult &)> callback; /*! 每个请求结束时调用 */
+    };
+
+    //! 批量探测 URL
+    /*!
+     在当前线程中同时保持 concurrency 个请求，一个请求结束后立刻开始下一个，
+     结果按完成的先后顺序通过 options.callback 返回。所有请求结束后才返回。
+     连接、DNS 缓存和 TLS 会话在请求之间复用。
+
+     callback 抛出的异常会中止探测，并传给调用者。
+     */
+    /*!
+     * @param urls URL 列表
+     * @param options 选项
+     * @return 收到响应的 URL 数量
+     */
+    size_t probeUrls(const std::vector<std::string> &urls, const ProbeOptions &options);
+
+} /* namespace happycpp */
+
+#endif  // INCLUDE_HAPPYCPP_HTTP_CLIENT_H_
@@ -0,0 +1,180 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_HTTP_COMPRESS_H_
+#define INCLUDE_HAPPYCPP_HTTP_COMPRESS_H_
+
+#include "happycpp/http.h"
+#include "happycpp/http/sink.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace happycpp::hchttp {
+
+    //! 内容编码(Content-Encoding)
+    typedef enum {
+        HTTP_CODING_IDENTITY = 0, /// 不压缩
+        HTTP_CODING_GZIP,
+        HTTP_CODING_DEFLATE,      /// zlib 格式(RFC 1950)
+        HTTP_CODING_BR,           /// 编译时找到 brotli 才支持
+        HTTP_CODING_ZSTD          /// 编译时找到 zstd 才支持
+    } HttpContentCoding;
+
+    //! 内容编码名称，比如 gzip
+    std::string_view toName(HttpContentCoding coding);
+
+    //! 是否支持指定的内容编码
+    bool codingSupported(HttpContentCoding coding);
+
+    //! 根据 Accept-Encoding 选择内容编码
+    /*!
+     支持 q 值、"*" 以及 "identity"。q 值相同时，按 preferred 中的顺序选择，并且优先压缩。
+     identity 的 q 值高于所有可用的编码时不压缩；Accept-Encoding 中没有 identity 和 "*" 时，
+     identity 总是可以接受，但只在没有可用的编码时使用。preferred 中不支持的编码会被忽略。
+     * @param acceptEncoding 请求的 Accept-Encoding 字段值
+     * @param preferred 服务端可以使用的编码，按优先级排列
+     * @param acceptable 可以为空。没有可用的编码，并且 identity 也被排除
+     *        ("identity;q=0"，或者没有 identity 时 "*;q=0")时为 false，调用者可以返回 406
+     * @return 没有可用的编码时，返回 HTTP_CODING_IDENTITY
+     */
+    HttpContentCoding negotiateEncoding(std::string_view acceptEncoding,
+                                        const std::vector<HttpContentCoding> &preferred,
+                                        bool *acceptable = nullptr);
+
+    //! 流式压缩器
+    /*!
+     调用顺序为 reset、若干次 update、finish，之后可以再次 reset，压缩下一个数据流。
+     reset 复用已经分配的内部状态，不需要重新初始化。压缩失败时抛出 HappyException。
+     */
+    class Compressor {
+    public:
+        virtual ~Compressor();
+
+        [[nodiscard]] virtual HttpContentCoding coding() const = 0;
+
+        //! 开始一个新的数据流
+        /*!
+         * @param level 压缩级别，含义与对应的库相同
+         * @param sizeHint 数据总长度，未知时为 -1。zstd 和 brotli 据此选择参数
+         */
+        virtual void reset(int level, int64_t sizeHint) = 0;
+
+        //! 压缩一块数据，输出追加到 out
+        virtual void update(std::string_view data, std::string *out) = 0;
+
+        //! 结束数据流，剩余输出追加到 out
+        virtual void finish(std::string *out) = 0;
+    };
+
+    //! 把 Compressor 放回当前线程的池中
+    struct CompressorReleaser {
+        void operator()(Compressor *c) const;
+    };
+
+    typedef std::unique_ptr<Compressor, CompressorReleaser> CompressorPtr;
+
+    //! 从当前线程的池中获取压缩器，并调用 reset
+    /*!
+     每个线程按编码缓存若干个压缩器，CompressorPtr 析构时放回析构所在线程的池中，
+     zlib 等库的内部状态只在第一次使用时分配。不支持的编码抛出 HappyException。
+     */
+    CompressorPtr acquireCompressor(HttpContentCoding coding, int level, int64_t sizeHint = -1);
+
+    //! 不同编码的默认压缩级别，适合动态生成的响应
+    int defaultLevel(HttpContentCoding coding);
+
+    //! 压缩后输出到另一个 BodySink
+    class CompressSink : public BodySink {
+    public:
+        //! 构造函数
+        /*!
+         * @param coding 内容编码，不支持时抛出 HappyException
+         * @param next 输出位置，不能为空
+         * @param level 压缩级别，-1 使用 defaultLevel
+         */
+        CompressSink(HttpContentCoding coding, BodySinkPtr next, int level = -1);
+
+        ~CompressSink() override;
+
+        //! next 收到的 contentLength 为 -1，压缩后的长度无法预知
+        void begin(int64_t contentLength) override;
+
+        bool write(const char *data, size_t size) override;
+
+        bool finish() override;
+
+    private:
+        HttpContentCoding coding_;
+        int level_;
+        BodySinkPtr next_;
+        CompressorPtr compressor_;
+        std::string out_;
+    };
+
+    //! compressResponse 选项
+    struct CompressOptions {
+        size_t minSize = 1024; /*! 小于该长度的消息体不压缩 */
+        /*! 可以使用的编码，按优先级排列，不支持的编码会被忽略 */
+        std::vector<HttpContentCoding> codings = {HTTP_CODING_ZSTD, HTTP_CODING_BR,
+                                                  HTTP_CODING_GZIP, HTTP_CODING_DEFLATE};
+        /*! 可以压缩的 MIME 类型，以 "/" 结尾的项为前缀，比如 "text/" 匹配所有 text 类型 */
+        std::vector<std::string> mimeTypes = {"text/",
+                                              "application/javascript",
+                                              "application/json",
+                                              "application/xml",
+                                              "application/xhtml+xml",
+                                              "application/rss+xml",
+                                              "application/atom+xml",
+                                              "application/wasm",
+                                              "image/svg+xml"};
+        int gzipLevel = -1; /*! gzip 和 deflate 的压缩级别，-1 使用 defaultLevel */
+        int brotliLevel = -1;
+        int zstdLevel = -1;
+    };
+
+    //! 根据请求的 Accept-Encoding 压缩响应的消息体
+    /*!
+     以下情况不压缩：
+     - 状态码为 1xx、204、206、304，或者已经有 Content-Encoding；
+     - Cache-Control 包含 no-transform；
+     - 消息体小于 options.minSize；
+     - MIME 类型不在 options.mimeTypes 中。MIME 类型取自 Content-Type 字段，
+       没有该字段时，根据请求路径的扩展名确定(与 getMimeType 相同)；
+     - 压缩后没有变小。
+
+     可以压缩时添加 "Vary: Accept-Encoding"(即使客户端不支持压缩)。
+     压缩后替换消息体，设置 Content-Encoding，更新已有的 Content-Length，
+     强 ETag 改为弱 ETag。
+     * @return 使用的编码，没有压缩时返回 HTTP_CODING_IDENTITY
+     */
+    HttpContentCoding compressResponse(const HttpRequestMsg &req,
+                                       HttpResponseMsg *resp,
+                                       const CompressOptions &options = CompressOptions());
+
+} /* namespace happycpp */
+
+#endif  // INCLUDE_HAPPYCPP_HTTP_COMPRESS_H_
@@ -0,0 +1,89 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_HTTP_MIME_H_
+#define INCLUDE_HAPPYCPP_HTTP_MIME_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+//! 扩展名到 MIME 类型的转换
+/*!
+ 内置表为编译期生成的有序数组，覆盖 nginx mime.types 中的所有扩展名。
+ 查找不区分大小写，不分配内存。文本类型附加 charset 之后的结果预先生成，
+ 常用 charset 直接返回预先生成的字符串。
+ */
+namespace happycpp::hchttp::hcmime {
+
+    //! 未知扩展名对应的 MIME 类型
+    constexpr std::string_view kDefaultMimeType("application/octet-stream");
+
+    //! 未指定 charset 时使用的 charset
+    constexpr std::string_view kDefaultCharset("utf-8");
+
+    //! 根据扩展名返回 MIME 类型
+    /*!
+     * @param ext 扩展名，不包括 "."，不区分大小写
+     * @return 未知扩展名返回 kDefaultMimeType
+     */
+    std::string_view fromExtension(std::string_view ext);
+
+    //! 根据 uri 的扩展名返回 MIME 类型，忽略 "?" 和 "#" 之后的部分
+    std::string_view fromUri(std::string_view uri);
+
+    //! 是否是需要附加 charset 的文本类型
+    /*!
+     与 nginx charset_types 的默认值一致：text/html、text/xml、text/plain、
+     text/vnd.wap.wml、application/javascript、application/rss+xml。
+     load 加载的其它 text/ 类型同样视为文本类型。
+     */
+    bool isText(std::string_view mimeType);
+
+    //! 根据 uri 的扩展名返回 MIME 类型，文本类型附加 "; charset=xxx"
+    /*!
+     内置文本类型与常用 charset(utf-8、iso-8859-1、gbk、gb2312、gb18030、big5)的结果预先生成；
+     其它 charset 以及 load 加载的文本类型第一次使用时生成，之后不再分配内存。
+     * @param uri URI
+     * @param charset 为空时使用 kDefaultCharset
+     * @return 返回的视图在程序结束之前有效(调用 load 之后，load 之前的结果失效)
+     */
+    std::string_view fromUri(std::string_view uri, std::string_view charset);
+
+    //! 加载自定义的 mime.types 文件，覆盖或者补充内置表
+    /*!
+     支持 nginx("types { text/html html htm; }")和 Apache/系统(每行 "类型 扩展名...")
+     两种格式，"#" 之后为注释。
+
+     只能在启动时、其它线程开始查找之前调用。失败时抛出 HappyException。
+     * @param path 文件路径
+     * @return 加载的扩展名数量
+     */
+    size_t load(const std::string &path);
+
+    //! 清除 load 加载的内容，恢复为内置表
+    void reset();
+
+} /* namespace happycpp */
+
+#endif  // INCLUDE_HAPPYCPP_HTTP_MIME_H_
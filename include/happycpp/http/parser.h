@@ -0,0 +1,231 @@
+// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_HTTP_PARSER_H_
+#define INCLUDE_HAPPYCPP_HTTP_PARSER_H_
+
+#include "happycpp/http.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace happycpp::hchttp {
+
+    //! HTTP 解析错误枚举
+    typedef enum {
+        HTTP_PARSE_OK = 0,                  /// 没有错误
+        HTTP_PARSE_INVALID_START_LINE,      /// 请求行或者状态行格式错误
+        HTTP_PARSE_INVALID_VERSION,         /// HTTP 版本格式错误
+        HTTP_PARSE_INVALID_HEADER,          /// 消息头格式错误
+        HTTP_PARSE_INVALID_CONTENT_LENGTH,  /// Content-Length 无效或者重复
+        HTTP_PARSE_INVALID_TRANSFER_ENCODING, /// 请求使用了不支持的 Transfer-Encoding
+        HTTP_PARSE_INVALID_CHUNK,           /// chunked 分块格式错误
+        HTTP_PARSE_LINE_TOO_LONG,           /// 单行长度超过限制
+        HTTP_PARSE_UNEXPECTED_EOF           /// 消息未结束时，连接已经关闭
+    } HttpParseError;
+
+    //! HttpParser 回调接口
+    /*!
+     所有 std::string_view 参数都指向调用者传给 HttpParser::execute 的缓冲区，
+     只在回调期间有效。如果需要保存，由回调自行复制。
+     */
+    class HttpParserHandler {
+    public:
+        virtual ~HttpParserHandler();
+
+        //! 开始解析一条新消息
+        virtual void onMessageBegin() {}
+
+        //! 请求行，比如 GET /index?arg=test HTTP/1.1
+        virtual void onRequestLine(std::string_view method,
+                                   std::string_view target,
+                                   std::string_view version) {}
+
+        //! 状态行，比如 HTTP/1.1 200 OK
+        virtual void onStatusLine(std::string_view version,
+                                  uint32_t status,
+                                  std::string_view reason) {}
+
+        //! 消息头字段，value 已去除首尾空白
+        virtual void onHeader(std::string_view name, std::string_view value) {}
+
+        //! 消息头结束
+        /*!
+         * @return 返回 true 表示该消息没有消息体，比如 HEAD 请求的响应
+         */
+        virtual bool onHeadersComplete() { return false; }
+
+        //! 消息体数据，可能被调用多次。chunked 编码时，只包含解码后的数据
+        virtual void onBody(std::string_view data) {}
+
+        //! 消息结束
+        virtual void onMessageComplete() {}
+    };
+
+    //! 增量式 HTTP/1.1 解析器
+    /*!
+     可以分多次输入任意大小的数据块，解析过程中不分配内存，通过 HttpParserHandler
+     回调返回各个字段。支持 Content-Length、chunked 以及读到连接关闭为止三种消息体
+     长度的确定方式，同一个连接上的多个请求(pipelining)会依次回调。
+
+     execute 返回已经消费的字节数。不完整的行不会被消费，调用者需要保留未消费的数据，
+     在收到新数据后，将其和新数据连在一起再次传入。消息体数据到达多少就回调多少，不需要
+     保留。
+
+     用法演示：
+     @verbatim
+     HttpParser parser(&handler);
+     std::string buf;
+
+     while ((n = read(fd, tmp, sizeof(tmp))) > 0) {
+         buf.append(tmp, n);
+         buf.erase(0, parser.execute(buf));
+
+         if (parser.error() != HTTP_PARSE_OK)
+             break;
+     }
+
+     parser.finish();
+     @endverbatim
+
+     https://tools.ietf.org/html/rfc7230
+     */
+    class HttpParser {
+    public:
+        //! 默认单行最大长度，超过则返回 HTTP_PARSE_LINE_TOO_LONG
+        static constexpr size_t kDefaultMaxLineSize = 8192;
+
+        //! 构造函数
+        /*!
+         * @param handler 回调接口，不能为空
+         * @param type 消息类型。INVALID_HTTP_MSG_TYPE 表示根据起始行自动识别
+         */
+        explicit HttpParser(HttpParserHandler *handler,
+                            HttpMsgType type = INVALID_HTTP_MSG_TYPE);
+
+        ~HttpParser();
+
+        //! 解析数据
+        /*!
+         * @param data 数据起始地址
+         * @param size 数据长度
+         * @return 已经消费的字节数
+         */
+        size_t execute(const char *data, size_t size);
+
+        size_t execute(std::string_view data);
+
+        //! 通知解析器连接已经关闭
+        /*!
+         没有 Content-Length 和 chunked 的响应，以连接关闭作为消息结束。
+         * @return 如果当前没有未完成的消息，返回 true
+         */
+        bool finish();
+
+        //! 暂停解析，只能在回调中调用。execute 会在当前回调返回后立刻返回
+        void pause();
+
+        //! 恢复解析
+        void resume();
+
+        //! 重置解析器，丢弃所有状态(包括错误)
+        void reset();
+
+        [[nodiscard]] bool paused() const;
+
+        [[nodiscard]] HttpParseError error() const;
+
+        //! 当前消息类型
+        [[nodiscard]] HttpMsgType type() const;
+
+        [[nodiscard]] uint16_t httpMajor() const;
+
+        [[nodiscard]] uint16_t httpMinor() const;
+
+        //! 当前消息是否使用 chunked 编码
+        [[nodiscard]] bool chunked() const;
+
+        //! 当前消息 Content-Length 字段的值，不存在时为 -1
+        [[nodiscard]] int64_t contentLength() const;
+
+        //! 当前消息结束后，是否可以复用连接
+        /*!
+         HTTP/1.1 默认复用，除非 Connection 包含 close；
+         HTTP/1.0 默认不复用，除非 Connection 包含 keep-alive。
+         */
+        [[nodiscard]] bool keepAlive() const;
+
+        void setMaxLineSize(size_t size);
+
+    private:
+        enum State {
+            S_START,
+            S_START_LINE,
+            S_HEADER,
+            S_BODY_LENGTH,
+            S_BODY_EOF,
+            S_CHUNK_SIZE,
+            S_CHUNK_DATA,
+            S_CHUNK_DATA_END,
+            S_CHUNK_TRAILER,
+            S_ERROR
+        };
+
+        HttpParserHandler *handler_;
+        HttpMsgType fixedType_;
+        HttpMsgType type_;
+        State state_;
+        HttpParseError error_;
+        bool paused_;
+        size_t maxLineSize_;
+
+        uint16_t httpMajor_;
+        uint16_t httpMinor_;
+        uint32_t status_;
+        bool chunked_;
+        bool unknownEncoding_;
+        bool connectionClose_;
+        bool connectionKeepAlive_;
+        int64_t contentLength_;
+        uint64_t remaining_;
+
+        void startMessage();
+
+        void completeMessage();
+
+        void setError(HttpParseError e);
+
+        bool parseVersion(std::string_view v);
+
+        bool parseStartLine(std::string_view line);
+
+        bool parseHeaderLine(std::string_view line);
+
+        bool headersComplete();
+
+        bool parseChunkSize(std::string_view line);
+    };
+
+} /* namespace happycpp */
+
+#endif  // INCLUDE_HAPPYCPP_HTTP_PARSER_H_
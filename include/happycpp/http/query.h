@@ -0,0 +1,176 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_HTTP_QUERY_H_
+#define INCLUDE_HAPPYCPP_HTTP_QUERY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace happycpp::hchttp {
+
+    //! 查询字符串(key1=value1&key2=value2)的只读视图
+    /*!
+     不复制查询字符串，遍历时直接返回未解码的 std::string_view，只有通过 get/getAll
+     读取值时才解码。第一次按名称查找时建立索引，之后的查找为 O(1)。
+     同名参数按出现的顺序保存，get 返回第一个。
+
+     QueryArgs 只保存查询字符串的视图，使用期间原始数据必须有效。
+     索引延迟建立，同一个对象不能在多个线程中同时使用。
+
+     用法演示：
+     @verbatim
+     QueryArgs args(QueryArgs::fromTarget("/search?q=happy+cpp&tag=a&tag=b"));
+
+     args.get("q");             // "happy cpp"
+     args.getAll("tag");        // {"a", "b"}
+
+     for (const auto &arg : args)
+         ...                    // arg.key、arg.value 未解码
+     @endverbatim
+     */
+    class QueryArgs {
+    public:
+        //! 未解码的参数
+        struct Arg {
+            std::string_view key;
+            std::string_view value; /*! 没有 "=" 时为空 */
+        };
+
+        //! 按出现的顺序遍历参数，跳过空的参数(比如 "a=1&&b=2" 中间的空参数)
+        class const_iterator {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef Arg value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const Arg *pointer;
+            typedef const Arg &reference;
+
+            const_iterator() = default;
+
+            reference operator*() const { return arg_; }
+
+            pointer operator->() const { return &arg_; }
+
+            const_iterator &operator++();
+
+            const_iterator operator++(int);
+
+            bool operator==(const const_iterator &other) const {
+                return done_ == other.done_ && (done_ || rest_.data() == other.rest_.data());
+            }
+
+            bool operator!=(const const_iterator &other) const { return !(*this == other); }
+
+        private:
+            friend class QueryArgs;
+
+            std::string_view rest_; /*! 当前参数之后，还没有遍历的部分 */
+            Arg arg_;
+            bool done_ = true;
+
+            explicit const_iterator(std::string_view query);
+        };
+
+        QueryArgs() = default;
+
+        //! 构造函数
+        /*!
+         * @param query 查询字符串，不包括 "?"
+         */
+        explicit QueryArgs(std::string_view query);
+
+        //! 复制时只复制视图，索引在第一次查找时重新建立
+        QueryArgs(const QueryArgs &other);
+
+        QueryArgs &operator=(const QueryArgs &other);
+
+        QueryArgs(QueryArgs &&other) noexcept;
+
+        QueryArgs &operator=(QueryArgs &&other) noexcept;
+
+        //! 从请求目标(比如 /index?arg=test#top)中取出查询字符串
+        static QueryArgs fromTarget(std::string_view target);
+
+        [[nodiscard]] const_iterator begin() const;
+
+        [[nodiscard]] const_iterator end() const;
+
+        //! 原始查询字符串
+        [[nodiscard]] std::string_view query() const;
+
+        [[nodiscard]] bool empty() const;
+
+        //! 参数数量，包括同名参数
+        [[nodiscard]] size_t size() const;
+
+        //! 是否存在指定参数，key 为解码后的名称
+        [[nodiscard]] bool has(std::string_view key) const;
+
+        //! 指定参数出现的次数
+        [[nodiscard]] size_t count(std::string_view key) const;
+
+        //! 第一个同名参数未解码的值，不存在时返回 std::nullopt
+        [[nodiscard]] std::optional<std::string_view> raw(std::string_view key) const;
+
+        //! 第一个同名参数解码后的值，不存在时返回 std::nullopt
+        [[nodiscard]] std::optional<std::string> get(std::string_view key) const;
+
+        //! 第一个同名参数解码后的值，不存在时返回 def
+        [[nodiscard]] std::string get(std::string_view key, std::string_view def) const;
+
+        //! 所有同名参数解码后的值
+        [[nodiscard]] std::vector<std::string> getAll(std::string_view key) const;
+
+    private:
+        //! 参数少于该数量时，顺序查找比哈希表更快
+        static constexpr size_t kLinearScanMax = 8;
+        static constexpr uint32_t kNoEntry = UINT32_MAX;
+
+        struct Entry {
+            std::string_view key; /*! 解码后的名称 */
+            std::string_view value; /*! 未解码的值 */
+            uint32_t next; /*! 下一个同名参数 */
+        };
+
+        std::string_view query_;
+        mutable bool indexed_ = false;
+        mutable std::vector<Entry> entries_;
+        mutable std::unordered_map<std::string_view, uint32_t> index_; /*! 名称 -> 第一个参数 */
+        mutable std::deque<std::string> decodedKeys_; /*! 需要解码的名称，deque 保证地址不变 */
+
+        void buildIndex() const;
+
+        [[nodiscard]] uint32_t find(std::string_view key) const;
+    };
+
+} /* namespace happycpp */
+
+#endif  // INCLUDE_HAPPYCPP_HTTP_QUERY_H_
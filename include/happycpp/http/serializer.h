@@ -0,0 +1,133 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_HTTP_SERIALIZER_H_
+#define INCLUDE_HAPPYCPP_HTTP_SERIALIZER_H_
+
+#include "happycpp/http.h"
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef PLATFORM_WIN32
+//! 与 POSIX struct iovec 相同的布局
+struct iovec {
+    void *iov_base;
+    size_t iov_len;
+};
+#else
+#include <sys/uio.h>
+#endif
+
+namespace happycpp::hchttp {
+
+    //! 状态码对应的标准原因短语，未知状态码返回空
+    std::string_view reasonPhrase(uint32_t status);
+
+    //! 序列化后的 HTTP 消息
+    /*!
+     由若干个 iovec 组成，可以直接传给 writev/sendmsg。各个 iovec 指向：
+     - 静态字符串(预先生成的状态行、字段名、分隔符)；
+     - 原 HttpMessage 中的数据(请求路径、字段值、消息体)；
+     - 当前线程缓存的 Date 字段；
+     - 自身的小缓冲区(Content-Length 等数字)。
+
+     因此在 writev 完成之前，原 HttpMessage 不能修改或者销毁，HttpWireMsg 也只能在
+     序列化它的线程中发送(Date 缓存的地址不变，内容可能在发送前刷新为下一秒)。
+     移动 HttpWireMsg 不会使 iovec 失效。
+     */
+    class HttpWireMsg {
+    public:
+        HttpWireMsg();
+
+        //! 复制品的 iovec 会指向原对象的 scratch_，所以禁止复制
+        HttpWireMsg(const HttpWireMsg &) = delete;
+
+        HttpWireMsg &operator=(const HttpWireMsg &) = delete;
+
+        //! 源对象得到一个新的 scratch_，之后仍然可以用于序列化
+        HttpWireMsg(HttpWireMsg &&other);
+
+        //! 与源对象交换 scratch_，源对象被清空，之后仍然可以用于序列化
+        HttpWireMsg &operator=(HttpWireMsg &&other) noexcept;
+
+        //! iovec 数组
+        [[nodiscard]] const struct iovec *iov() const;
+
+        //! iovec 数量。可能超过 IOV_MAX，需要调用者分批写入
+        [[nodiscard]] size_t iovCount() const;
+
+        //! 所有 iovec 的总字节数
+        [[nodiscard]] size_t bytes() const;
+
+        //! 合并为一个字符串，用于调试和测试
+        [[nodiscard]] std::string toString() const;
+
+        //! 清空，保留已经分配的内存
+        void clear();
+
+    private:
+        friend void serialize(const HttpMessage &hm, HttpWireMsg *out);
+
+        //! 数字等需要生成的内容使用的缓冲区，大小固定为 kScratchSize，地址不会改变
+        static constexpr size_t kScratchSize = 64;
+
+        std::vector<struct iovec> iov_;
+        std::vector<char> scratch_;
+        size_t scratchUsed_;
+        size_t bytes_;
+
+        void append(std::string_view s);
+
+        //! 复制到 scratch_ 之后添加
+        void appendCopy(std::string_view s);
+    };
+
+    //! 序列化 HTTP 消息，不复制字段和消息体
+    /*!
+     - 响应：使用预先生成的状态行(常用状态码、HTTP/1.0 和 HTTP/1.1，原因短语为空
+       或者为标准短语时)，原因短语为空时使用标准短语；没有 Date 字段时，添加当前线程
+       每秒刷新一次的 Date 字段。
+     - 请求：请求路径使用 requestUrl()，为空时使用 "/"。
+     - 版本号为空时使用 HTTP/1.1。
+     - 没有 Content-Length 和 Transfer-Encoding 字段时，根据消息体长度添加 Content-Length
+       (请求的消息体为空，或者响应状态码为 1xx、204、304 时不添加)。
+     * @param hm HTTP 消息
+     * @param out 输出，原有内容会被清空，已经分配的内存会被复用
+     */
+    void serialize(const HttpMessage &hm, HttpWireMsg *out);
+
+    HttpWireMsg serialize(const HttpMessage &hm);
+
+    //! 当前时间的 IMF-fixdate 格式(比如 Sun, 06 Nov 1994 08:49:37 GMT)，每个线程每秒只格式化一次
+    std::string_view httpDate();
+
+    //! 指定时间的 IMF-fixdate 格式，用于 Last-Modified 等字段
+    std::string formatHttpDate(time_t t);
+
+} /* namespace happycpp */
+
+#endif  // INCLUDE_HAPPYCPP_HTTP_SERIALIZER_H_
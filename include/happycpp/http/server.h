@@ -0,0 +1,134 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_HTTP_SERVER_H_
+#define INCLUDE_HAPPYCPP_HTTP_SERVER_H_
+
+#include "happycpp/http.h"
+#include "happycpp/http/compress.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace happycpp::hchttp {
+
+    //! HttpServer 选项
+    struct HttpServerOptions {
+        std::string host = "0.0.0.0"; /*! 监听地址，只支持 IPv4 */
+        uint16_t port = 0; /*! 监听端口，0 表示随机端口，启动后通过 HttpServer::port() 获取 */
+        size_t threads = 0; /*! 事件循环线程数，0 表示 CPU 核数 */
+        size_t readBufferSize = 16384; /*! 每个连接的读缓冲区大小，也是请求行和单个字段的最大长度 */
+        size_t maxBodySize = 8 * 1024 * 1024; /*! 请求体最大长度，超过则返回 413 并关闭连接 */
+        size_t maxPipeline = 64; /*! 单个连接上尚未发送完的响应超过该数量时，暂停读取 */
+        uint32_t keepAliveTimeoutMs = 60000; /*! 空闲连接超时时间(毫秒)，0 表示不限制 */
+        int backlog = 1024; /*! listen 队列长度 */
+        bool compress = false; /*! 是否根据 Accept-Encoding 压缩响应，见 compressResponse */
+        CompressOptions compressOptions;
+    };
+
+    //! 请求处理函数
+    /*!
+     在事件循环线程中同步执行，不能阻塞。调用前 resp 的状态码为 200，版本与请求相同。
+     抛出异常时返回 500。
+     */
+    typedef std::function<void(const HttpRequestMsg &req,
+                               HttpResponseMsg *resp)> HttpHandler;
+
+    class HttpServerImpl;
+
+    //! 基于 epoll 的嵌入式 HTTP/1.1 服务器(仅支持 Linux)
+    /*!
+     每个线程一个事件循环，各自使用 SO_REUSEPORT 监听同一个端口，由内核分配新连接，
+     连接建立之后只在一个线程中处理，线程之间没有共享状态。
+
+     - 支持 keep-alive 和 pipelining，同一个连接上的响应按请求顺序通过 writev 批量发送；
+     - 读缓冲区从线程内的缓冲池中分配，连接空闲(没有未处理的数据)时归还；
+     - 按路径前缀路由，最长前缀优先。没有匹配的路由时返回 404。
+     - 静态文件目录支持 ETag、条件请求和范围请求，文件内容通过 sendfile 发送。
+
+     用法演示：
+     @verbatim
+     HttpServer server;
+
+     server.route("/hello", [](const HttpRequestMsg &req, HttpResponseMsg *resp) {
+         resp->setField(HTTP_MCOMF_CONTENT_TYPE, "text/plain");
+         resp->setBody("hello");
+     });
+
+     server.start();
+     ...
+     server.stop();
+     @endverbatim
+     */
+    class HttpServer {
+    public:
+        explicit HttpServer(const HttpServerOptions &options = HttpServerOptions());
+
+        //! 调用 stop()
+        ~HttpServer();
+
+        HttpServer(const HttpServer &) = delete;
+
+        HttpServer &operator=(const HttpServer &) = delete;
+
+        //! 添加路由，只能在 start() 之前调用
+        /*!
+         * @param prefix 路径前缀，与不包括参数的请求路径(HttpRequestMsg::url())按路径段比较，
+         *        "/api" 匹配 "/api" 和 "/api/x"，不匹配 "/apix"
+         * @param handler 处理函数。prefix 相同时替换原有的处理函数
+         */
+        void route(const std::string &prefix, HttpHandler handler);
+
+        //! 添加静态文件目录，只能在 start() 之前调用
+        /*!
+         请求路径去掉 prefix 之后解码，映射到 root 下的文件，以 "/" 结尾时映射到 index.html。
+         包含 ".." 的路径、目录以及不存在的文件返回 404，GET 和 HEAD 之外的方法返回 405。
+         条件请求和范围请求见 prepareFileResponse。
+         * @param prefix 路径前缀，与 route 的 prefix 一起按最长前缀匹配
+         * @param root 目录
+         */
+        void serveDirectory(const std::string &prefix, const std::string &root);
+
+        //! 监听端口，启动所有事件循环线程
+        /*!
+         失败时抛出 HappyException。
+         */
+        void start();
+
+        //! 停止所有事件循环线程，关闭所有连接。可以多次调用
+        void stop();
+
+        [[nodiscard]] bool running() const;
+
+        //! 实际监听的端口
+        [[nodiscard]] uint16_t port() const;
+
+    private:
+        std::unique_ptr<HttpServerImpl> impl_;
+    };
+
+} /* namespace happycpp */
+
+#endif  // INCLUDE_HAPPYCPP_HTTP_SERVER_H_
@@ -0,0 +1,216 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_HTTP_SINK_H_
+#define INCLUDE_HAPPYCPP_HTTP_SINK_H_
+
+#include "happycpp/common.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct evp_md_ctx_st;
+
+namespace happycpp::hchttp {
+
+    //! 消息体输出接口
+    /*!
+     消息体按到达的顺序分块写入，不需要整个消息体都在内存中。
+     调用顺序为 begin、若干次 write、finish。传输失败时不会调用 finish。
+     */
+    class BodySink {
+    public:
+        virtual ~BodySink();
+
+        //! 收到消息体之前调用
+        /*!
+         * @param contentLength Content-Length 字段的值，不存在时为 -1
+         */
+        virtual void begin(int64_t contentLength) {}
+
+        //! 写入一块数据
+        /*!
+         * @return 返回 false 表示中止传输
+         */
+        virtual bool write(const char *data, size_t size) = 0;
+
+        //! 传输成功结束
+        /*!
+         * @return 返回 false 表示输出失败
+         */
+        virtual bool finish() { return true; }
+    };
+
+    typedef std::shared_ptr<BodySink> BodySinkPtr;
+
+    //! 保存到内存中
+    /*!
+     根据 Content-Length 一次性预分配内存，避免追加数据时多次分配和复制。
+     */
+    class StringSink : public BodySink {
+    public:
+        //! 默认最多预分配 64MB，防止 Content-Length 过大时耗尽内存
+        static constexpr size_t kDefaultMaxReserve = 64 * 1024 * 1024;
+
+        explicit StringSink(size_t maxReserve = kDefaultMaxReserve);
+
+        ~StringSink() override;
+
+        void begin(int64_t contentLength) override;
+
+        bool write(const char *data, size_t size) override;
+
+        [[nodiscard]] const std::string &data() const;
+
+        //! 取出数据，之后 data() 为空
+        std::string take();
+
+    private:
+        size_t maxReserve_;
+        std::string data_;
+    };
+
+#ifndef PLATFORM_WIN32
+
+    //! 直接写入文件
+    /*!
+     使用 pwrite 按偏移写入，已知 Content-Length 时预先分配磁盘空间。
+
+     direct 为 true 时使用 O_DIRECT 绕过页缓存，数据先复制到对齐的缓冲区，
+     缓冲区满了再写入，适合远大于内存的文件。文件系统不支持 O_DIRECT 时(比如 tmpfs)，
+     自动使用普通方式写入。写入缓冲区时发生短写，文件偏移不再按块对齐，该文件剩余的部分也改用普通方式写入。
+     */
+    class FileSink : public BodySink {
+    public:
+        //! O_DIRECT 模式下缓冲区大小
+        static constexpr size_t kDirectBufferSize = 1024 * 1024;
+
+        //! 创建文件，已经存在时清空。失败时抛出 HappyException
+        explicit FileSink(const std::string &path, bool direct = false);
+
+        //! 没有调用 finish(比如传输中止)时，文件同样截断为已经写入的长度
+        ~FileSink() override;
+
+        FileSink(const FileSink &) = delete;
+
+        FileSink &operator=(const FileSink &) = delete;
+
+        void begin(int64_t contentLength) override;
+
+        bool write(const char *data, size_t size) override;
+
+        bool finish() override;
+
+        //! 当前是否以 O_DIRECT 方式写入，短写或者 finish 之后为 false
+        [[nodiscard]] bool direct() const;
+
+        //! 已经写入的字节数
+        [[nodiscard]] uint64_t size() const;
+
+    private:
+        int fd_;
+        bool direct_;
+        uint64_t offset_; /*! 已经写入文件的字节数 */
+        char *buf_; /*! O_DIRECT 模式下的对齐缓冲区 */
+        size_t bufSize_; /*! buf_ 中的字节数 */
+
+        bool writeAt(const char *data, size_t size, uint64_t offset);
+
+        //! 关闭 O_DIRECT，之后以普通方式写入
+        bool disableDirect();
+
+        //! 从 offset_ 开始写入 buf_。失败时没有写入的部分留在 buf_ 中
+        bool flushBuffer();
+    };
+
+#endif  // PLATFORM_WIN32
+
+    //! 通过固定大小的环形缓冲区，批量交给回调处理
+    /*!
+     不论数据以多大的块到达，consumer 都按缓冲区大小批量处理，内存占用固定。
+
+     consumer 返回已经处理的字节数，未处理的部分(比如不完整的一行)保留在缓冲区中，
+     和后续数据一起再次回调。缓冲区满了而 consumer 无法处理任何数据时，中止传输。
+     */
+    class RingBufferSink : public BodySink {
+    public:
+        typedef std::function<size_t(std::string_view data)> Consumer;
+
+        RingBufferSink(size_t capacity, Consumer consumer);
+
+        ~RingBufferSink() override;
+
+        bool write(const char *data, size_t size) override;
+
+        //! 把剩余数据交给 consumer，全部处理完返回 true
+        bool finish() override;
+
+        [[nodiscard]] size_t capacity() const;
+
+    private:
+        std::vector<char> buf_;
+        size_t head_; /*! 第一个未处理字节的位置 */
+        size_t count_; /*! 未处理的字节数 */
+        Consumer consumer_;
+
+        void drain();
+    };
+
+    //! 计算消息体的摘要，同时可以输出到另一个 BodySink
+    class HashSink : public BodySink {
+    public:
+        //! 构造函数
+        /*!
+         * @param algorithm 摘要算法名称，比如 md5、sha1、sha256。不支持时抛出 HappyException
+         * @param next 同时输出到 next，可以为空
+         */
+        explicit HashSink(const std::string &algorithm, BodySinkPtr next = nullptr);
+
+        ~HashSink() override;
+
+        HashSink(const HashSink &) = delete;
+
+        HashSink &operator=(const HashSink &) = delete;
+
+        void begin(int64_t contentLength) override;
+
+        bool write(const char *data, size_t size) override;
+
+        bool finish() override;
+
+        //! 小写十六进制格式的摘要，finish 之前为空
+        [[nodiscard]] const std::string &hexDigest() const;
+
+    private:
+        evp_md_ctx_st *ctx_;
+        BodySinkPtr next_;
+        std::string hexDigest_;
+    };
+
+} /* namespace happycpp */
+
+#endif  // INCLUDE_HAPPYCPP_HTTP_SINK_H_
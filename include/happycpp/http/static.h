@@ -0,0 +1,139 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_HTTP_STATIC_H_
+#define INCLUDE_HAPPYCPP_HTTP_STATIC_H_
+
+#include "happycpp/http.h"
+#include "happycpp/type.h"
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace happycpp::hchttp {
+
+    //! 根据 inode、文件大小和修改时间生成 ETag，不读取文件内容
+    /*!
+     格式为 "inode-size-mtime"，均为十六进制，mtime 精确到纳秒。
+     * @param fs 文件信息，来自 hcfilesys::getFileStat 或者 hcfilesys::getFilesInDir
+     * @param weak 是否生成弱 ETag(W/ 前缀)
+     */
+    std::string makeETag(const FileStat &fs, bool weak = false);
+
+    //! 解析 HTTP-date，支持 IMF-fixdate、RFC 850 和 asctime 三种格式
+    /*!
+     * @return 格式错误时返回 false
+     */
+    bool parseHttpDate(std::string_view s, time_t *t);
+
+    //! 字节范围
+    struct ByteRange {
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    //! Range 字段的解析结果
+    typedef enum {
+        HTTP_RANGE_NONE = 0,       /// 没有 Range 字段，或者应该忽略(格式错误、范围太多)
+        HTTP_RANGE_SATISFIABLE,    /// 至少有一个范围可以满足，返回 206
+        HTTP_RANGE_UNSATISFIABLE   /// 所有范围都超出文件大小，返回 416
+    } HttpRangeResult;
+
+    //! 解析 Range 字段，比如 "bytes=0-99,200-,-500"
+    /*!
+     结果按偏移排序，重叠或者相邻的范围会被合并。
+     * @param range Range 字段值
+     * @param size 文件大小
+     * @param ranges 输出
+     * @param maxRanges 范围数量超过该值时返回 HTTP_RANGE_NONE，防止大量小范围消耗资源
+     */
+    HttpRangeResult parseRange(std::string_view range, uint64_t size,
+                               std::vector<ByteRange> *ranges, size_t maxRanges = 16);
+
+    //! 消息体片段：内存中的数据，或者文件中的一段
+    struct BodyPart {
+        std::string data; /*! 不为空时发送 data，否则发送文件的 [offset, offset + length) */
+        uint64_t offset = 0;
+        uint64_t length = 0;
+
+        [[nodiscard]] uint64_t size() const {
+            return data.empty() ? length : data.size();
+        }
+    };
+
+    //! prepareFileResponse 选项
+    struct FileResponseOptions {
+        size_t maxRanges = 16; /*! 范围数量超过该值时，忽略 Range，返回整个文件 */
+        std::string charset = "utf-8"; /*! 文本类型的 Content-Type 附加的 charset */
+        bool weakETag = false; /*! 是否使用弱 ETag */
+    };
+
+    //! 根据文件元数据处理条件请求和范围请求
+    /*!
+     按 RFC 7232 第 6 节的顺序依次判断 If-Match、If-Unmodified-Since、If-None-Match 和
+     If-Modified-Since，然后根据 Range 和 If-Range 确定返回的范围(只处理 GET 请求)。
+     只使用 fs 中的元数据，不读取文件内容。
+
+     resp 的状态码设置为 200、206、304、412 或者 416，并设置 ETag、Last-Modified、
+     Accept-Ranges、Content-Type、Content-Length 和 Content-Range 等字段，不设置消息体。
+
+     parts 为需要发送的消息体：整个文件、单个范围，或者 multipart/byteranges 的各个部分
+     (分隔行在内存中，数据在文件中)。HEAD 请求以及 304、412、416 时为空。
+     * @param req 请求
+     * @param fs 文件信息，来自 hcfilesys::getFileStat 或者 hcfilesys::getFilesInDir
+     * @param resp 输出
+     * @param parts 输出
+     * @param options 选项
+     */
+    void prepareFileResponse(const HttpRequestMsg &req,
+                             const FileStat &fs,
+                             HttpResponseMsg *resp,
+                             std::vector<BodyPart> *parts,
+                             const FileResponseOptions &options = FileResponseOptions());
+
+#ifndef PLATFORM_WIN32
+
+    //! 发送 prepareFileResponse 生成的消息体
+    /*!
+     文件部分使用 sendfile，数据直接从页缓存复制到套接字，不经过用户空间。
+     套接字可以是非阻塞的，暂时不可写时返回，之后用相同的 index 和 sent 再次调用。
+     sendfile 不支持 MSG_NOSIGNAL，调用者需要忽略或者屏蔽 SIGPIPE。
+     * @param sock 套接字
+     * @param fd 文件
+     * @param parts 消息体
+     * @param index 输入输出，当前片段的下标
+     * @param sent 输入输出，当前片段已经发送的字节数
+     * @return 全部发送完返回 1，套接字暂时不可写返回 0，
+     *         出错(包括文件被截断)返回 -1，错误码在 errno 中
+     */
+    int sendFileParts(int sock, int fd, const std::vector<BodyPart> &parts,
+                      size_t *index, uint64_t *sent);
+
+#endif  // PLATFORM_WIN32
+
+} /* namespace happycpp */
+
+#endif  // INCLUDE_HAPPYCPP_HTTP_STATIC_H_
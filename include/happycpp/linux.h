@@ -30,7 +30,11 @@
 
 #include <cstdint>
 #include "happycpp/algorithm.h"
+#include "happycpp/linux/netlink.h"
+#include "happycpp/linux/procfs.h"
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <list>
 
@@ -78,6 +82,9 @@ namespace happycpp::hclinux {
             std::string netmask_;
             std::string dns1_;
             std::string dns2_;
+            int32_t index_{};  // 网卡序号(ifindex)
+            // 同一网卡的 IPv6 地址，只填充在该网卡的第一个 Iface 中
+            std::vector<std::string> ip6_addrs_;
 
             Iface();
 
@@ -91,48 +98,108 @@ namespace happycpp::hclinux {
         typedef std::vector<Iface>::iterator IfaceListIt;
 
         /*在一个或者多个Iface中，查找指定的Iface或者Iface的类成员对应的值*/
+        // 创建时按照名称、IP 地址和 mac 建立哈希索引，并按照前缀长度整理主路由表，
+        // 之后的查找不再遍历 ifaceList，也不复制 Iface。创建之后不再修改，可以在多个线程中同时查找
         class IfaceFinder {
         public:
+            // 通过 rtnetlink 一次获取所有网卡、地址以及路由，失败时抛出 HappyException
             IfaceFinder();
 
+            // 根据已经获取的信息创建，见 fillIfaceList。DNS 从 /etc/resolv.conf 读取
+            explicit IfaceFinder(const hcnetlink::NetlinkDump &dump);
+
             ~IfaceFinder();
 
-            std::string getIpAddrByName(const std::string &ifaceName);
+            std::string getIpAddrByName(const std::string &ifaceName) const;
+
+            std::string getIpAddrByKeyword(const std::string &keyword) const;
+
+            bool getIfaceByName(const std::string &ifaceName, Iface *iface) const;
+
+            bool getFrontIface(Iface *iface) const;
+
+            bool getBackIface(Iface *iface) const;
+
+            void getIfaceList(IfaceList *iface_list) const;
 
-            std::string getIpAddrByKeyword(const std::string &keyword);
+            // 以下查找返回的指针在 IfaceFinder 销毁之前有效，找不到时返回 nullptr
 
-            bool getIfaceByName(const std::string &ifaceName, Iface *iface);
+            // 按照名称查找，包括网卡别名，比如 eth0:0
+            [[nodiscard]] const Iface *ifaceByName(const std::string &ifaceName) const;
 
-            bool getFrontIface(Iface *iface);
+            // 按照 IPv4 地址或者 IPv6 地址查找。IPv6 地址可以使用任意合法的写法
+            [[nodiscard]] const Iface *ifaceByIp(const std::string &ip) const;
 
-            bool getBackIface(Iface *iface);
+            // 按照 mac 查找，不区分大小写。同一网卡的多个 Iface 返回第一个
+            [[nodiscard]] const Iface *ifaceByMac(const std::string &mac) const;
 
-            void getIfaceList(IfaceList *iface_list);
+            // 最长前缀匹配主路由表，返回发往 ip 的数据包使用的网卡。
+            // 出口网卡有多个 IPv4 地址时，优先返回与 ip 在同一子网的 Iface，否则返回该网卡的第一个 Iface。
+            // 没有匹配的路由，或者出口网卡没有 IPv4 地址(比如 loopback)时返回 nullptr
+            [[nodiscard]] const Iface *routeIface(const std::string &ip) const;
+
+            [[nodiscard]] const Iface *routeIface(const hcnetlink::IpAddr &ip) const;
+
+            [[nodiscard]] const IfaceList &ifaces() const {
+                return ifaceList;
+            }
 
         private:
-            enum IFACE_FIELD {
-                IFACE_GATEWAY = 0,
-                IFACE_IPADDR,
-                IFACE_MAC,
-                IFACE_NAME,
-                IFACE_NETMASK
+            // 128 位前缀，IPv4 只使用 lo 的低 32 位
+            struct Prefix {
+                uint64_t hi;
+                uint64_t lo;
+
+                bool operator==(const Prefix &other) const {
+                    return hi == other.hi && lo == other.lo;
+                }
             };
 
-            IfaceList ifaceList;
+            struct PrefixHash {
+                size_t operator()(const Prefix &prefix) const {
+                    return std::hash<uint64_t>()(prefix.hi * 0x9E3779B97F4A7C15ULL ^ prefix.lo);
+                }
+            };
 
-            std::string find(const IFACE_FIELD &findField,
-                             const IFACE_FIELD &field, const std::string &keyword);
+            // 同一协议族、同一前缀长度的路由，值为 metric 最小的出口网卡
+            struct RouteTable {
+                uint8_t family;
+                uint8_t prefixLen;
+                std::unordered_map<Prefix, std::pair<uint32_t, int32_t>, PrefixHash> routes;
+            };
 
-            std::string findByName(const std::string &ifaceName);
+            // 网卡上的一个 Iface 以及它的子网
+            struct LinkNet {
+                size_t pos;
+                uint8_t prefixLen;
+                Prefix net;
+            };
+
+            IfaceList ifaceList;
+            std::unordered_map<std::string, size_t> byName_;
+            std::unordered_map<std::string, size_t> byIp_;
+            std::unordered_map<std::string, size_t> byMac_;
+            std::unordered_map<int32_t, std::vector<LinkNet>> byIndex_;
+            std::vector<RouteTable> routeTables_; // 按照前缀长度从长到短排列
 
-            bool getIface(const IfaceListIt &ifaceListIt,
-                          const IFACE_FIELD &findField, const std::string &keyword,
-                          Iface *iface);
+            void fill(const hcnetlink::NetlinkDump &dump);
 
-            static std::string getIfaceFieldValue(const IFACE_FIELD &field, const Iface &iface);
+            void buildIndex(const hcnetlink::NetlinkDump &dump);
+
+            static Prefix makePrefix(const hcnetlink::IpAddr &addr, uint8_t prefixLen);
         };
 
-        // 获取网卡名称列表
+        // 根据 netlink 获取的网卡、地址和路由信息生成 IfaceList，不填充 DNS。
+        // 每个 IPv4 地址一项，不包括 loopback 网卡。没有标签的多个地址使用别名，比如 eth0:0。
+        // 网关为主路由表中 metric 最小的 IPv4 默认网关
+        HAPPYCPP_SHARED_LIB_API void fillIfaceList(const hcnetlink::NetlinkDump &dump, IfaceList *ifaceList);
+
+        // 解析 /etc/resolv.conf 的内容，返回前两个合法的 IPv4 nameserver，没有时为空字符串。
+        // 字段之间可以有多个空白，忽略 '#' 或者 ';' 之后的注释以及行尾的 '\r'。
+        // 第一个 nameserver 为本机地址时视为没有设置
+        HAPPYCPP_SHARED_LIB_API void parseResolvConf(std::string_view content, std::string *dns1, std::string *dns2);
+
+        // 获取网卡名称列表，包括网卡别名
         HAPPYCPP_SHARED_LIB_API bool getIfaceNames(std::vector<std::string> *names);
 
         // 单网卡绑定多IP时，需要创建网卡别名做为网卡名。比如，eth0的别名
@@ -204,8 +271,8 @@ namespace happycpp::hclinux {
         /* cpu时间，总时间，使用时间，空闲时间 */
         struct CpuTime {
             double total;
-            double idle;
-            double used;
+            double idle;  // 包括 iowait
+            double used;  // 除 idle 和 iowait 以外的时间，与 CpuBreakdown::busy 相同
         };
 
         /*cpu使用率和空闲率*/
@@ -234,9 +301,112 @@ namespace happycpp::hclinux {
         /* 获取cpu运行时间相关参数，用于计算cpu使用率 */
         HAPPYCPP_SHARED_LIB_API bool getWorkCpuTime(CpuTime *cpu_time);
 
-        /*获取cpu使用率和空闲率*/
+        /*获取cpu使用率和空闲率，iowait 算作空闲
+         调用者已经启动 hcmetrics::MetricsSampler::global() 并且采样结果较新时，直接返回最近一个采样周期
+         (默认 1 秒)的使用率，否则阻塞 100 毫秒测量。不会启动后台线程 */
         HAPPYCPP_SHARED_LIB_API void getCpuUtil(CpuUtil *cpu_util);
 
+        //! 一段时间内 cpu 各项时间的占比，百分比
+        struct CpuBreakdown {
+            double user;
+            double nice;
+            double system;
+            double idle;
+            double iowait;
+            double irq;
+            double softirq;
+            double steal;
+            double busy; /*! 除 idle 和 iowait 以外的时间 */
+        };
+
+        //! 计算每个 cpu 两次采样之间的时间占比
+        /*!
+         一次遍历所有 cpu，计数器减小(cpu 离线后重新上线)时按 0 处理，没有任何时间变化的 cpu 全部为 0。
+         * @param before 较早的采样，count 项
+         * @param after 较晚的采样，count 项
+         * @param count cpu 数量
+         * @param out 结果，count 项
+         */
+        HAPPYCPP_SHARED_LIB_API void cpuBreakdown(const hcprocfs::CpuStat *before,
+                                                  const hcprocfs::CpuStat *after,
+                                                  size_t count, CpuBreakdown *out);
+
+        //! 一个进程或者线程在两次采样之间的 cpu 使用率
+        struct TaskUsage {
+            int32_t id;         /*! 进程 id 或者线程 id */
+            int32_t processor;  /*! 最近一次运行所在的 cpu */
+            char state;
+            char comm[16];
+            uint64_t utime;     /*! 累计用户态时间，单位 USER_HZ */
+            uint64_t stime;     /*! 累计内核态时间，单位 USER_HZ */
+            double user;        /*! 用户态使用率，相对于单个 cpu 的百分比，多线程进程可以超过 100 */
+            double system;      /*! 内核态使用率 */
+            double total;       /*! user + system */
+        };
+
+        //! 按 cpu、进程和线程统计 cpu 使用率
+        /*!
+         每个 sample* 函数返回与上一次调用同一个函数之间的使用率。sampleCores 第一次调用时
+         相对于开机；sampleProcesses 和 sampleThreads 第一次调用时，以及新出现的任务，使用率为 0。
+         进程 id 被复用时，根据启动时间识别为新任务。
+
+         内部缓冲区和调用者传入的 vector 都保留容量，稳定运行时每次采样不分配内存，
+         可以每秒采样数千个任务。不是线程安全的。
+
+         用法演示：
+         @verbatim
+         CpuAccounting accounting;
+         std::vector<TaskUsage> threads;
+
+         accounting.sampleThreads(pid, &threads);
+         sleep(1);
+         accounting.sampleThreads(pid, &threads);
+
+         for (const TaskUsage &t : threads)
+             printf("%d %s %.1f%%\n", t.id, t.comm, t.total);
+         @endverbatim
+         */
+        class HAPPYCPP_SHARED_LIB_API CpuAccounting {
+        public:
+            CpuAccounting();
+
+            //! 每个 cpu 的时间占比，按照 cpu 编号排列
+            /*!
+             * @param cores 结果
+             * @param total 所有 cpu 合计的时间占比，可以为空
+             * @return /proc/stat 读取失败时返回 false
+             */
+            bool sampleCores(std::vector<CpuBreakdown> *cores, CpuBreakdown *total = nullptr);
+
+            //! 所有进程的使用率，按照 pid 排序
+            bool sampleProcesses(std::vector<TaskUsage> *tasks);
+
+            //! 进程 pid 中所有线程的使用率，按照 tid 排序。pid 与上一次调用不同时，重新开始统计
+            /*!
+             * @return 进程不存在时返回 false
+             */
+            bool sampleThreads(int32_t pid, std::vector<TaskUsage> *tasks);
+
+        private:
+            //! 一组任务的上一次采样
+            struct TaskHistory {
+                int32_t pid;
+                int64_t timestampNs;
+                std::vector<hcprocfs::TaskStat> previous;
+                std::vector<hcprocfs::TaskStat> current;
+            };
+
+            const double ticksPerSec_;
+            hcprocfs::CpuStat lastTotal_;
+            std::vector<hcprocfs::CpuStat> lastCores_;
+            std::vector<hcprocfs::CpuStat> cores_;
+            TaskHistory processes_;
+            TaskHistory threads_;
+
+            //! 与 history->previous 比较，计算 history->current 的使用率，然后交换两者
+            void account(TaskHistory *history, std::vector<TaskUsage> *tasks) const;
+        };
+
     } /* namespace hccpu */
 
     namespace hcmem {
@@ -244,7 +414,7 @@ namespace happycpp::hclinux {
         /* 获取系统总内存，单位MiB */
         HAPPYCPP_SHARED_LIB_API uint32_t totalSysMem();
 
-        /*获取系统空闲内存，单位MiB */
+        /*获取系统空闲内存，单位MiB。即 /proc/meminfo 中的 MemAvailable，包括可回收的缓存 */
         HAPPYCPP_SHARED_LIB_API uint32_t freeSysMem();
 
         /*获取系统使用内存，单位MiB */
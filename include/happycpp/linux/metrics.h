@@ -0,0 +1,190 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_LINUX_METRICS_H_
+#define INCLUDE_HAPPYCPP_LINUX_METRICS_H_
+
+#include "happycpp/config_platform.h"
+
+#ifndef PLATFORM_WIN32
+
+#include "happycpp/common.h"
+#include "happycpp/linux/procfs.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <sys/types.h>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace happycpp::hclinux::hcmetrics {
+
+    //! 每个指标保留的指数加权移动平均(EWMA)数量
+    constexpr size_t kEwmaWindows = 3;
+
+    //! 快照中最多保存的网卡数量，超出的网卡被忽略
+    constexpr size_t kMaxIfaces = 32;
+
+    //! 一个指标的最新值和各个时间窗口的移动平均值
+    struct MetricValue {
+        double last;                 /*! 最近一个采样周期的值 */
+        double ewma[kEwmaWindows];   /*! 按照 MetricsSamplerOptions::windows 的顺序 */
+    };
+
+    //! 网卡的累计计数器和速率(每秒)
+    struct IfaceMetrics {
+        char name[16];
+        uint64_t samples; /*! 该网卡的采样次数，小于 2 时速率为 0 */
+        uint64_t rxBytes;
+        uint64_t txBytes;
+        uint64_t rxPackets;
+        uint64_t txPackets;
+        MetricValue rxBytesRate;
+        MetricValue txBytesRate;
+        MetricValue rxPacketsRate;
+        MetricValue txPacketsRate;
+    };
+
+    //! 某一时刻的系统指标
+    /*!
+     速率和使用率需要两次采样，samples 小于 2 时它们为 0。
+     */
+    struct MetricsSnapshot {
+        uint64_t samples;      /*! 已经完成的采样次数 */
+        int64_t timestampNs;   /*! 采样时间，steady_clock */
+        MetricValue cpuUsed;   /*! cpu 使用率(除 idle 和 iowait 以外的时间)，百分比 */
+        MetricValue cpuIowait; /*! cpu 等待 I/O 的比例，百分比 */
+        MetricValue memUsed;   /*! 内存使用率(MemTotal - MemAvailable)，百分比 */
+        MetricValue swapUsed;  /*! 交换分区使用率，百分比 */
+        hcprocfs::MemInfo mem;
+        hcprocfs::LoadAvg load;
+        uint32_t ifaceCount;
+        IfaceMetrics ifaces[kMaxIfaces];
+
+        //! 按照名称查找网卡，找不到时返回 nullptr
+        [[nodiscard]] const IfaceMetrics *iface(std::string_view name) const;
+    };
+
+    //! MetricsSampler 选项
+    struct MetricsSamplerOptions {
+        std::chrono::milliseconds interval{1000}; /*! 采样间隔 */
+        //! 移动平均的时间窗口
+        std::array<std::chrono::milliseconds, kEwmaWindows> windows{
+                std::chrono::milliseconds(1000),
+                std::chrono::milliseconds(10000),
+                std::chrono::milliseconds(60000)};
+        bool netDev = true; /*! 是否采样 /proc/net/dev */
+    };
+
+    //! 后台线程定期采样 cpu、内存、交换分区、负载以及网卡计数器
+    /*!
+     采样结果以 seqlock 保护的快照发布，snapshot 不加锁、不分配内存、不进入内核，
+     只在后台线程写入快照的几微秒内重试，任意多个线程可以同时读取。
+
+     移动平均按照实际的采样间隔计算权重 1 - exp(-dt / window)，
+     第一次得到速率时直接使用该值作为初始值。
+
+     用法演示：
+     @verbatim
+     MetricsSnapshot snap;
+
+     if (MetricsSampler::global().snapshot(&snap))
+         printf("cpu %.1f%%, 1m %.1f%%\n", snap.cpuUsed.last, snap.cpuUsed.ewma[2]);
+     @endverbatim
+
+     析构时停止后台线程。
+     */
+    class HAPPYCPP_SHARED_LIB_API MetricsSampler {
+    public:
+        //! 立即采样一次，然后启动后台线程
+        explicit MetricsSampler(const MetricsSamplerOptions &options = MetricsSamplerOptions());
+
+        ~MetricsSampler();
+
+        MetricsSampler(const MetricsSampler &) = delete;
+
+        MetricsSampler &operator=(const MetricsSampler &) = delete;
+
+        //! 读取最新的快照，可以在任意线程中调用
+        /*!
+         * @return 还没有任何成功的采样时返回 false
+         */
+        bool snapshot(MetricsSnapshot *snap) const;
+
+        //! 不等待下一个周期，立即采样一次并发布快照
+        /*!
+         * @return /proc/stat 或者 /proc/meminfo 读取失败时返回 false
+         */
+        bool sampleNow();
+
+        [[nodiscard]] const MetricsSamplerOptions &options() const {
+            return options_;
+        }
+
+        //! 进程内共享的实例，第一次调用时创建，使用默认选项
+        static MetricsSampler &global();
+
+        //! 读取 global() 的快照，不会创建实例
+        /*!
+         fork 之后的子进程中没有后台线程，快照不会再更新，此时返回 false。
+         * @return 还没有调用过 global()、当前进程不是创建实例的进程，
+         *         或者最近一次采样早于两个采样间隔之前时返回 false
+         */
+        static bool globalSnapshot(MetricsSnapshot *snap);
+
+    private:
+        static constexpr size_t kWords = (sizeof(MetricsSnapshot) + 7) / 8;
+
+        const MetricsSamplerOptions options_;
+        const pid_t pid_; /*! 创建实例的进程，后台线程不会被 fork 复制 */
+
+        // 快照按照 8 字节拆分保存在原子变量中，读者和后台线程并发访问时没有数据竞争
+        alignas(64) std::atomic<uint32_t> sequence_;
+        std::atomic<uint64_t> words_[kWords];
+
+        // 以下成员只在持有 sampleMutex_ 时访问
+        std::mutex sampleMutex_;
+        MetricsSnapshot current_;
+        hcprocfs::CpuStat lastCpu_;
+        std::vector<hcprocfs::NetDevStat> netDev_;
+
+        std::atomic<bool> stop_;
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        std::thread thread_;
+
+        void publish(const MetricsSnapshot &snap);
+
+        void run();
+    };
+
+} /* namespace happycpp */
+
+#endif  // PLATFORM_WIN32
+
+#endif  // INCLUDE_HAPPYCPP_LINUX_METRICS_H_
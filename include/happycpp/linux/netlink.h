@@ -0,0 +1,174 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_LINUX_NETLINK_H_
+#define INCLUDE_HAPPYCPP_LINUX_NETLINK_H_
+
+#include "happycpp/config_platform.h"
+
+#ifndef PLATFORM_WIN32
+
+#include "happycpp/common.h"
+#include <sys/types.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct nlmsghdr;
+
+namespace happycpp::hclinux::hcnetlink {
+
+    //! 二进制 IP 地址，网络字节序。IPv4 只使用前 4 个字节
+    struct IpAddr {
+        uint8_t family;     /*! AF_INET、AF_INET6，没有地址时为 AF_UNSPEC */
+        uint8_t bytes[16];
+
+        //! 地址的字节数，IPv4 为 4，IPv6 为 16，没有地址时为 0
+        [[nodiscard]] size_t size() const;
+
+        //! 点分十进制或者 RFC 5952 格式，没有地址时为空
+        [[nodiscard]] std::string toString() const;
+
+        bool operator==(const IpAddr &other) const;
+    };
+
+    //! 解析 IPv4 或者 IPv6 地址字符串
+    HAPPYCPP_SHARED_LIB_API bool parseIpAddr(std::string_view text, IpAddr *addr);
+
+    //! 前缀长度转换为点分十进制掩码，比如 24 转换为 255.255.255.0
+    HAPPYCPP_SHARED_LIB_API std::string prefixToNetmask(uint8_t prefixLen);
+
+    //! RTM_NEWLINK 消息中的网卡
+    struct LinkInfo {
+        int32_t index;
+        uint32_t flags;     /*! IFF_UP、IFF_LOOPBACK 等 */
+        uint32_t mtu;
+        std::string name;
+        std::string mac;    /*! 大写十六进制，冒号分隔。没有硬件地址时为空 */
+    };
+
+    //! RTM_NEWADDR 消息中的地址
+    struct AddrInfo {
+        int32_t index;      /*! 所属网卡 */
+        uint8_t prefixLen;
+        uint8_t scope;      /*! RT_SCOPE_UNIVERSE、RT_SCOPE_LINK、RT_SCOPE_HOST 等 */
+        uint32_t flags;     /*! IFA_F_SECONDARY 等 */
+        IpAddr address;
+        std::string label;  /*! IPv4 地址的标签，比如 eth0:0。IPv6 地址为空 */
+    };
+
+    //! RTM_NEWROUTE 消息中的路由
+    struct RouteInfo {
+        uint8_t family;
+        uint8_t dstLen;     /*! 目的地址前缀长度，默认路由为 0 */
+        uint8_t type;       /*! RTN_UNICAST、RTN_LOCAL 等 */
+        uint8_t scope;
+        uint32_t table;     /*! RT_TABLE_MAIN、RT_TABLE_LOCAL 等 */
+        uint32_t priority;  /*! metric，越小越优先 */
+        int32_t oif;        /*! 出口网卡，没有时为 0 */
+        IpAddr dst;         /*! 默认路由时为 AF_UNSPEC */
+        IpAddr gateway;     /*! 直连路由时为 AF_UNSPEC */
+    };
+
+    //! 一次完整的网卡、地址以及路由信息
+    struct NetlinkDump {
+        std::vector<LinkInfo> links;
+        std::vector<AddrInfo> addrs;   /*! IPv4 和 IPv6，按照内核返回的顺序 */
+        std::vector<RouteInfo> routes; /*! IPv4 和 IPv6 的所有路由表 */
+    };
+
+    //! 解析 RTM_NEWLINK 或者 RTM_DELLINK 消息
+    HAPPYCPP_SHARED_LIB_API bool parseLink(const nlmsghdr *msg, LinkInfo *link);
+
+    //! 解析 RTM_NEWADDR 或者 RTM_DELADDR 消息
+    HAPPYCPP_SHARED_LIB_API bool parseAddr(const nlmsghdr *msg, AddrInfo *addr);
+
+    //! 解析 RTM_NEWROUTE 或者 RTM_DELROUTE 消息
+    HAPPYCPP_SHARED_LIB_API bool parseRoute(const nlmsghdr *msg, RouteInfo *route);
+
+    //! NETLINK_ROUTE 套接字
+    /*!
+     每次 recv 最多读取 32KiB，内核会在其中放入尽量多的消息，数千个网卡也只需要少量系统调用。
+     不是线程安全的。
+     */
+    class HAPPYCPP_SHARED_LIB_API NetlinkSocket {
+    public:
+        //! 消息回调，msg 只在回调期间有效
+        typedef std::function<void(const nlmsghdr *msg)> Handler;
+
+        //! 创建套接字，失败时抛出 HappyException
+        /*!
+         * @param groups 订阅的 RTMGRP_* 多播组，0 表示不订阅
+         */
+        explicit NetlinkSocket(uint32_t groups = 0);
+
+        ~NetlinkSocket();
+
+        NetlinkSocket(const NetlinkSocket &) = delete;
+
+        NetlinkSocket &operator=(const NetlinkSocket &) = delete;
+
+        [[nodiscard]] int fd() const {
+            return fd_;
+        }
+
+        //! 发送 dump 请求，对每条应答消息调用 handler，直到 NLMSG_DONE
+        /*!
+         订阅了多播组时，期间收到的通知消息被忽略。
+         * @param type RTM_GETLINK、RTM_GETADDR 或者 RTM_GETROUTE
+         * @param family AF_UNSPEC 表示所有协议族
+         * @return 失败时返回 false，errno 为失败原因。
+         *         dump 期间内容发生变化(NLM_F_DUMP_INTR)时 errno 为 EAGAIN，可以重试
+         */
+        bool dump(uint16_t type, uint8_t family, const Handler &handler);
+
+        //! 读取一次，对收到的每条消息调用 handler
+        /*!
+         * @param wait 为 false 时不等待数据
+         * @return 读取的字节数。没有数据时返回 0，失败时返回 -1。
+         *         接收缓冲区溢出、丢失了通知时返回 -1，errno 为 ENOBUFS
+         */
+        ssize_t receive(const Handler &handler, bool wait = true);
+
+    private:
+        int fd_;
+        uint32_t portid_;
+        uint32_t seq_;
+        std::vector<char> buf_;
+    };
+
+    //! 通过一个套接字依次 dump 网卡、地址以及路由
+    /*!
+     dump 期间内容发生变化时重试。创建套接字失败时抛出 HappyException。
+     * @return 失败时返回 false，errno 为失败原因
+     */
+    HAPPYCPP_SHARED_LIB_API bool dumpAll(NetlinkDump *dump);
+
+} /* namespace happycpp */
+
+#endif  // PLATFORM_WIN32
+
+#endif  // INCLUDE_HAPPYCPP_LINUX_NETLINK_H_
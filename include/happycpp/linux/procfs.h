@@ -0,0 +1,220 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_LINUX_PROCFS_H_
+#define INCLUDE_HAPPYCPP_LINUX_PROCFS_H_
+
+#include "happycpp/config_platform.h"
+
+#ifndef PLATFORM_WIN32
+
+#include "happycpp/common.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace happycpp::hclinux::hcprocfs {
+
+    //! 保持打开的 /proc 或者 /sys 文件
+    /*!
+     每次读取都用 pread 从偏移 0 开始读，内核重新生成文件内容，不需要重新打开文件。
+     缓冲区在读取之间保留容量，稳定运行时不分配内存。不是线程安全的，每个线程使用各自的实例。
+
+     用法演示：
+     @verbatim
+     ProcFile f("/proc/loadavg");
+     std::string_view content;
+
+     if (f.read(&content))
+         parseLoadAvg(content, &load);
+     @endverbatim
+     */
+    class HAPPYCPP_SHARED_LIB_API ProcFile {
+    public:
+        //! 第一次读取时才打开文件
+        explicit ProcFile(std::string path);
+
+        ~ProcFile();
+
+        ProcFile(const ProcFile &) = delete;
+
+        ProcFile &operator=(const ProcFile &) = delete;
+
+        //! 读取整个文件
+        /*!
+         * @param content 文件内容，在下一次调用 read 之前有效
+         * @return 失败时返回 false，errno 为失败原因
+         */
+        bool read(std::string_view *content);
+
+        [[nodiscard]] const std::string &path() const;
+
+    private:
+        const std::string path_;
+        int fd_;
+        std::vector<char> buf_;
+    };
+
+    //! /proc/stat 中一行 cpu 时间，单位为 USER_HZ(通常是 1/100 秒)
+    struct CpuStat {
+        uint64_t user;
+        uint64_t nice;
+        uint64_t system;
+        uint64_t idle;
+        uint64_t iowait;
+        uint64_t irq;
+        uint64_t softirq;
+        uint64_t steal;
+        uint64_t guest;      /*! 已经包含在 user 中 */
+        uint64_t guestNice;  /*! 已经包含在 nice 中 */
+
+        //! 总时间，不重复计算 guest
+        [[nodiscard]] uint64_t total() const {
+            return user + nice + system + idle + iowait + irq + softirq + steal;
+        }
+
+        //! 空闲时间，包括 iowait
+        [[nodiscard]] uint64_t idleAll() const {
+            return idle + iowait;
+        }
+    };
+
+    //! /proc/meminfo 中常用的字段，单位 KiB
+    struct MemInfo {
+        uint64_t memTotal;
+        uint64_t memFree;
+        uint64_t memAvailable; /*! 内核 3.14 之前没有该字段，由 MemFree + Buffers + Cached 估算 */
+        uint64_t buffers;
+        uint64_t cached;
+        uint64_t swapTotal;
+        uint64_t swapFree;
+    };
+
+    //! /proc/loadavg
+    struct LoadAvg {
+        double load1;
+        double load5;
+        double load15;
+        uint32_t running; /*! 正在运行的调度实体数 */
+        uint32_t total;   /*! 调度实体总数 */
+    };
+
+    //! /proc/cpuinfo 的摘要
+    struct CpuInfo {
+        std::string modelName; /*! 第一个处理器的型号 */
+        std::vector<std::string> modelNames; /*! 所有 model name 行的值，按出现的顺序，不去重 */
+        uint32_t processors;   /*! 逻辑处理器数量 */
+        uint32_t packages;     /*! 不同的 physical id 数量，没有该字段时为 0 */
+        uint32_t coresPerPackage; /*! cpu cores 字段，没有该字段时为 0 */
+    };
+
+    //! /proc/net/dev 中一个网卡的计数器
+    struct NetDevStat {
+        char name[16];   /*! 网卡名称，最长 IFNAMSIZ - 1 个字符 */
+        uint64_t rxBytes;
+        uint64_t rxPackets;
+        uint64_t rxErrors;
+        uint64_t rxDropped;
+        uint64_t txBytes;
+        uint64_t txPackets;
+        uint64_t txErrors;
+        uint64_t txDropped;
+    };
+
+    //! /proc/[pid]/stat 或者 /proc/[pid]/task/[tid]/stat 中常用的字段
+    struct TaskStat {
+        int32_t pid;        /*! 进程 id 或者线程 id */
+        int32_t ppid;
+        char state;         /*! R S D Z T 等 */
+        char comm[16];      /*! 可执行文件名或者线程名，可能包含空格和括号 */
+        int32_t numThreads;
+        int32_t processor;  /*! 最近一次运行所在的 cpu */
+        uint64_t utime;     /*! 用户态时间，单位 USER_HZ */
+        uint64_t stime;     /*! 内核态时间，单位 USER_HZ */
+        uint64_t startTime; /*! 开机之后的启动时间，单位 USER_HZ。与 pid 一起唯一标识一个任务 */
+    };
+
+    //! 解析 /proc/stat
+    /*!
+     * @param content 文件内容
+     * @param total 所有 cpu 的合计("cpu" 行)，可以为空
+     * @param perCpu 每个 cpu 一项("cpuN" 行)，按照 N 排列，可以为空
+     * @return 没有 "cpu" 行时返回 false
+     */
+    HAPPYCPP_SHARED_LIB_API bool parseCpuStat(std::string_view content, CpuStat *total,
+                                              std::vector<CpuStat> *perCpu = nullptr);
+
+    //! 解析 /proc/meminfo，没有 MemTotal 时返回 false
+    HAPPYCPP_SHARED_LIB_API bool parseMemInfo(std::string_view content, MemInfo *info);
+
+    //! 解析 /proc/loadavg
+    HAPPYCPP_SHARED_LIB_API bool parseLoadAvg(std::string_view content, LoadAvg *load);
+
+    //! 解析 /proc/cpuinfo，没有任何 processor 时返回 false
+    HAPPYCPP_SHARED_LIB_API bool parseCpuInfo(std::string_view content, CpuInfo *info);
+
+    //! 解析 /proc/net/dev，按照文件中的顺序返回每个网卡，不包括两行表头
+    HAPPYCPP_SHARED_LIB_API bool parseNetDev(std::string_view content, std::vector<NetDevStat> *stats);
+
+    //! 解析 /proc/[pid]/stat 格式的一行
+    HAPPYCPP_SHARED_LIB_API bool parseTaskStat(std::string_view content, TaskStat *stat);
+
+    //! 解析 /sys/devices/system/cpu/online 等文件中的 cpu 列表，比如 "0-3,8,10-11"，返回 cpu 数量
+    HAPPYCPP_SHARED_LIB_API uint32_t parseCpuList(std::string_view content);
+
+    //! 以下函数读取当前线程保持打开的文件，失败时返回 false
+    HAPPYCPP_SHARED_LIB_API bool readCpuStat(CpuStat *total, std::vector<CpuStat> *perCpu = nullptr);
+
+    HAPPYCPP_SHARED_LIB_API bool readMemInfo(MemInfo *info);
+
+    HAPPYCPP_SHARED_LIB_API bool readLoadAvg(LoadAvg *load);
+
+    HAPPYCPP_SHARED_LIB_API bool readCpuInfo(CpuInfo *info);
+
+    HAPPYCPP_SHARED_LIB_API bool readNetDev(std::vector<NetDevStat> *stats);
+
+    //! 读取一个进程(tid <= 0)或者线程的 stat，进程已经退出时返回 false
+    /*!
+     使用栈上的缓冲区，不分配内存。
+     */
+    HAPPYCPP_SHARED_LIB_API bool readTaskStat(int32_t pid, int32_t tid, TaskStat *stat);
+
+    //! 读取所有进程的 stat，按照 pid 排序。stats 保留容量，重复调用时不再分配内存
+    HAPPYCPP_SHARED_LIB_API bool readProcessStats(std::vector<TaskStat> *stats);
+
+    //! 读取进程 pid 所有线程的 stat，按照 tid 排序。进程不存在时返回 false
+    HAPPYCPP_SHARED_LIB_API bool readThreadStats(int32_t pid, std::vector<TaskStat> *stats);
+
+    //! 在线的逻辑 cpu 数量，读取 /sys/devices/system/cpu/online。失败时返回 0
+    HAPPYCPP_SHARED_LIB_API uint32_t onlineCpus();
+
+    //! 物理核心数量，由 /sys/devices/system/cpu/cpu*/topology 中不同的 (package, core) 计算。失败时返回 0
+    HAPPYCPP_SHARED_LIB_API uint32_t physicalCores();
+
+} /* namespace happycpp */
+
+#endif  // PLATFORM_WIN32
+
+#endif  // INCLUDE_HAPPYCPP_LINUX_PROCFS_H_
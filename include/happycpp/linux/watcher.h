@@ -0,0 +1,148 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_LINUX_WATCHER_H_
+#define INCLUDE_HAPPYCPP_LINUX_WATCHER_H_
+
+#include "happycpp/config_platform.h"
+
+#ifndef PLATFORM_WIN32
+
+#include "happycpp/common.h"
+#include "happycpp/linux.h"
+#include "happycpp/linux/netlink.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace happycpp::hclinux::hcnet {
+
+    //! 某一时刻完整的网卡信息，发布之后不再修改
+    struct IfaceSnapshot {
+        IfaceSnapshot(uint64_t version, hcnetlink::NetlinkDump dump);
+
+        const uint64_t version;             /*! 从 1 开始，每次发布加 1 */
+        const hcnetlink::NetlinkDump dump;  /*! 包括回环网卡在内的所有网卡、地址以及路由 */
+        const IfaceFinder finder;           /*! 由 dump 创建 */
+    };
+
+    //! 订阅 rtnetlink 多播通知，增量维护网卡列表
+    /*!
+     订阅 RTNLGRP_LINK、RTNLGRP_IPV4_IFADDR、RTNLGRP_IPV6_IFADDR，
+     以及 RTNLGRP_IPV4_ROUTE、RTNLGRP_IPV6_ROUTE(用于默认网关)。
+
+     后台线程在 poll 中等待通知，一次读完所有待处理的消息后，只在内容确实发生变化时
+     创建新的 IfaceSnapshot，用原子操作替换指针，再依次调用回调。
+     读者持有的旧快照在最后一个引用释放时销毁，snapshot 不会阻塞后台线程。
+
+     接收缓冲区溢出丢失通知时，重新 dump 一次全部信息。
+
+     用法演示：
+     @verbatim
+     IfaceWatcher watcher;
+
+     watcher.addCallback([](const IfaceWatcher::Snapshot &snap) {
+         printf("version %lu, %lu addresses\n", snap->version, snap->dump.addrs.size());
+     });
+
+     std::string ip(watcher.snapshot()->finder.getIpAddrByName("eth0"));
+     @endverbatim
+     */
+    class HAPPYCPP_SHARED_LIB_API IfaceWatcher {
+    public:
+        typedef std::shared_ptr<const IfaceSnapshot> Snapshot;
+
+        //! 变化回调，在后台线程中调用
+        typedef std::function<void(const Snapshot &snap)> Callback;
+
+        //! 先订阅通知，再获取全部信息并发布第一个快照，最后启动后台线程
+        /*!
+         失败时抛出 HappyException。
+         */
+        IfaceWatcher();
+
+        //! 停止并等待后台线程
+        ~IfaceWatcher();
+
+        IfaceWatcher(const IfaceWatcher &) = delete;
+
+        IfaceWatcher &operator=(const IfaceWatcher &) = delete;
+
+        //! 最新的快照，可以在任意线程中调用，不会返回空指针
+        [[nodiscard]] Snapshot snapshot() const;
+
+        //! 最新快照的版本
+        [[nodiscard]] uint64_t version() const;
+
+        //! 后台线程是否因为错误(比如 poll 连续失败)退出，退出之后快照不再更新
+        [[nodiscard]] bool failed() const;
+
+        //! 添加回调，只对之后发布的快照调用。回调抛出的异常被记录到日志，不会传给后台线程
+        void addCallback(Callback callback);
+
+    private:
+        typedef std::map<std::string, hcnetlink::RouteInfo> RouteMap;
+
+        hcnetlink::NetlinkSocket sock_;
+        int eventFd_;
+
+        Snapshot snapshot_;  // 只通过 std::atomic_load 和 std::atomic_store 访问
+        std::atomic<uint64_t> version_;
+        std::atomic<bool> failed_;
+
+        std::mutex callbackMutex_;
+        std::vector<Callback> callbacks_;
+
+        // 以下成员只在后台线程(以及启动后台线程之前)中访问
+        std::map<int32_t, hcnetlink::LinkInfo> links_;
+        std::map<int32_t, std::vector<hcnetlink::AddrInfo>> addrs_; // 按照网卡分组，主地址在前
+        RouteMap routes_;
+
+        std::thread thread_;
+
+        //! 用新获取的全部信息替换当前状态
+        bool resync();
+
+        //! 应用一条通知，返回内容是否发生变化
+        bool apply(const nlmsghdr *msg);
+
+        bool applyAddr(const hcnetlink::AddrInfo &addr, bool add);
+
+        bool applyRoute(const hcnetlink::RouteInfo &route, bool add);
+
+        void publish();
+
+        void run();
+    };
+
+} /* namespace happycpp */
+
+#endif  // PLATFORM_WIN32
+
+#endif  // INCLUDE_HAPPYCPP_LINUX_WATCHER_H_
@@ -25,14 +25,100 @@
 #define INCLUDE_HAPPYCPP_LOG_H_
 
 #include "happycpp/common.h"
+#include "happycpp/log/async.h"
+#include "happycpp/log/binary.h"
+#include "happycpp/log/limit.h"
 #include "log4cplus/logger.h"
 #include "log4cplus/loggingmacros.h"
 #include "log4cplus/loglevel.h"
 #include <boost/filesystem.hpp>
+#include <atomic>
+#include <mutex>
+#include <string>
 
 #define DEFAULT_LOG_PROFILE_NAME "log4cplus.properties"
 
+//! 编译期的最低日志级别，低于该级别的 HC_LOG_* 调用在编译时被删除
+/*!
+ 值为 log4cplus 的日志级别，比如 -DHAPPYCPP_LOG_MIN_LEVEL=20000 只保留 INFO 及以上的日志。
+ */
+#ifndef HAPPYCPP_LOG_MIN_LEVEL
+#define HAPPYCPP_LOG_MIN_LEVEL 0
+#endif
+
+#if defined(__GNUC__)
+#define HAPPYCPP_PRINTF_FORMAT(fmt, args) __attribute__((format(printf, fmt, args)))
+#else
+#define HAPPYCPP_PRINTF_FORMAT(fmt, args)
+#endif
+
+//! 先判断日志级别，再格式化参数
+/*!
+ 级别未启用时只有一次比较，不会求值任何参数。每个调用点单独限流，见 LogLimiter。
+ 用法与 printf 相同：
+ @verbatim
+ HC_LOG_TRACE("cmd=%s", cmd.c_str());
+ @endverbatim
+ */
+#define HC_LOG_(level, ...) \
+    do { \
+        if ((level) >= HAPPYCPP_LOG_MIN_LEVEL && happycpp::log::HappyLog::isEnabled(level)) { \
+            static happycpp::log::LogLimiter hcLogLimiter_(__FILE__, __LINE__); \
+            if (hcLogLimiter_.allow(level)) \
+                happycpp::log::HappyLog::instance().write(level, happycpp::log::formatLog(__VA_ARGS__)); \
+        } \
+    } while (0)
+
+#define HC_LOG_TRACE(...) HC_LOG_(log4cplus::TRACE_LOG_LEVEL, __VA_ARGS__)
+#define HC_LOG_DEBUG(...) HC_LOG_(log4cplus::DEBUG_LOG_LEVEL, __VA_ARGS__)
+#define HC_LOG_INFO(...) HC_LOG_(log4cplus::INFO_LOG_LEVEL, __VA_ARGS__)
+#define HC_LOG_WARN(...) HC_LOG_(log4cplus::WARN_LOG_LEVEL, __VA_ARGS__)
+#define HC_LOG_ERROR(...) HC_LOG_(log4cplus::ERROR_LOG_LEVEL, __VA_ARGS__)
+
+//! 结构化的二进制日志
+/*!
+ 每个调用点第一次执行时注册一次格式字符串和参数类型，之后只提交调用点 id 和参数的原始值，
+ 格式化由离线的 hclog-decode 完成。fmt 必须是字符串字面量，参数只能是整数、浮点数、
+ C 字符串和指针，格式在编译时检查。
+ 异步二进制模式(AsyncLogOptions::format 为 LOG_FORMAT_BINARY)之外，与 HC_LOG_* 相同。
+ @verbatim
+ HC_BLOG_INFO("accept fd=%d peer=%s", fd, peer.c_str());
+ @endverbatim
+ */
+#define HC_BLOG_(level, fmt, ...) \
+    do { \
+        if ((level) >= HAPPYCPP_LOG_MIN_LEVEL && happycpp::log::HappyLog::isEnabled(level)) { \
+            if (false) \
+                happycpp::log::checkLogFormat(fmt, ##__VA_ARGS__); \
+            static happycpp::log::LogLimiter hcLogLimiter_(__FILE__, __LINE__); \
+            static const uint32_t hcLogSite_ = happycpp::log::registerLogSite( \
+                    level, __FILE__, __LINE__, fmt, \
+                    decltype(happycpp::log::detail::logArgTypesOf(fmt, ##__VA_ARGS__))()); \
+            if (hcLogLimiter_.allow(level)) \
+                happycpp::log::HappyLog::instance().binary(level, hcLogSite_, fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define HC_BLOG_TRACE(fmt, ...) HC_BLOG_(log4cplus::TRACE_LOG_LEVEL, fmt, ##__VA_ARGS__)
+#define HC_BLOG_DEBUG(fmt, ...) HC_BLOG_(log4cplus::DEBUG_LOG_LEVEL, fmt, ##__VA_ARGS__)
+#define HC_BLOG_INFO(fmt, ...) HC_BLOG_(log4cplus::INFO_LOG_LEVEL, fmt, ##__VA_ARGS__)
+#define HC_BLOG_WARN(fmt, ...) HC_BLOG_(log4cplus::WARN_LOG_LEVEL, fmt, ##__VA_ARGS__)
+#define HC_BLOG_ERROR(fmt, ...) HC_BLOG_(log4cplus::ERROR_LOG_LEVEL, fmt, ##__VA_ARGS__)
+
 namespace happycpp::log {
+
+    //! printf 风格的格式化，供 HC_LOG_* 使用
+    std::string formatLog(const char *fmt, ...) HAPPYCPP_PRINTF_FORMAT(1, 2);
+
+    //! 与 formatLog 相同，但不在编译时检查格式。供 HC_BLOG_* 使用，格式已经在调用点检查过
+    std::string formatLogUnchecked(const char *fmt, ...);
+
+    //! 只用于在编译时检查 HC_BLOG_* 的格式，不会被调用
+    inline void checkLogFormat(const char *fmt, ...) HAPPYCPP_PRINTF_FORMAT(1, 2);
+
+    inline void checkLogFormat(const char *fmt, ...) {
+    }
+
     /*
      * 示例代码：
     #include "happycpp/happylog.h"
@@ -42,14 +128,56 @@ namespace happycpp::log {
     fs::path p = fs::current_path() / DEFAULT_LOG_PROFILE_NAME;
     HappyLogPtr hlog = HappyLog::getInstance(p);
     hlog->info("test message......");
+
+    // 热路径上使用 instance()，不复制 shared_ptr
+    HappyLog::instance().info("test message......");
      */
     class HappyLog {
     private:
         log4cplus::Logger _logger;
         static std::shared_ptr<HappyLog> _instance;
+        static std::atomic<HappyLog *> _ptr; /*! _instance.get()，初始化完成后才设置 */
+        static std::once_flag _once;
+        static std::atomic<log4cplus::LogLevel> _threshold;
         std::string _logPrefix;
+        std::unique_ptr<AsyncLogWriter> _async;
+        uint64_t _asyncDropped;
+
+        //! 异步模式下提交记录，同步模式下返回 false
+        bool writeAsync(log4cplus::LogLevel level, const std::string &s, const std::string &loggerName);
+
+        //! 设置了限流参数时，按照 logger 和级别限流。返回 true 表示丢弃这条记录
+        bool suppressed(log4cplus::LogLevel level, const std::string &loggerName);
+
+        //! 重新计算 _threshold
+        static void updateThreshold();
+
+        //! 只创建一次实例，多个线程同时调用时，其它线程等待第一个线程创建完成
+        template<typename F>
+        static HappyLog &create(F f);
+
+        //! 当前线程缓存的 logger，"root" 直接返回 _logger
+        /*!
+         log4cplus::Logger::getInstance 每次都要加锁查找，复制 Logger 也要修改引用计数。
+         */
+        const log4cplus::Logger &logger(const std::string &loggerName);
 
     public:
+        //! 获取实例的引用，不存在时使用默认设置创建
+        /*!
+         线程安全，实例创建之后只有一次原子读取，不修改引用计数。
+         实例只会创建一次，之后调用其它 instance/getInstance 时，参数被忽略。
+         */
+        static HappyLog &instance() {
+            HappyLog *p = _ptr.load(std::memory_order_acquire);
+            return p != nullptr ? *p : instance(log4cplus::INFO_LOG_LEVEL);
+        }
+
+        static HappyLog &instance(log4cplus::LogLevel level, const std::string &logPrefix = "");
+
+        static HappyLog &instance(const std::string &profile, const std::string &logPrefix = "");
+
+        //! 与 instance 相同，返回 shared_ptr。每次调用都会修改引用计数，不要在热路径上使用
         static std::shared_ptr<HappyLog>
         getInstance(log4cplus::LogLevel level = log4cplus::INFO_LOG_LEVEL, const std::string &logPrefix = "");
 
@@ -80,6 +208,10 @@ namespace happycpp::log {
             LOG4CPLUS_TRACE(_logger, LOG4CPLUS_TEXT(_logPrefix + "output->") << name << LOG4CPLUS_TEXT("=") << value);
         }
 
+        //! 按照级别输出，不限流。供已经在调用点限流的 HC_LOG_* 等使用
+        void write(log4cplus::LogLevel level, const std::string &s, const std::string &loggerName = "root");
+
+        //! 以下函数按照 logger 和级别限流，见 LogLimiter
         void error(const std::string &s, const std::string &loggerName = "root");
 
         void error(const std::exception &e, const std::string &loggerName = "root");
@@ -92,8 +224,61 @@ namespace happycpp::log {
 
         void trace(const std::string &s, const std::string &loggerName = "root");
 
+        //! 供 HC_BLOG_* 使用
+        /*!
+         异步二进制模式下只编码参数，提交到队列；其它模式下格式化之后按照级别输出。
+         */
+        template<typename... Args>
+        void binary(log4cplus::LogLevel level, uint32_t site, const char *fmt, const Args &...args) {
+            if (_async && _async->binary()) {
+                if (!_logger.isEnabledFor(level))
+                    return;
+
+                // 复用容量，稳定运行时不分配内存
+                thread_local std::string buf;
+                buf.clear();
+                encodeLogArgs(&buf, args...);
+                _async->pushBinary(level, site, buf);
+            } else {
+                write(level, formatLogUnchecked(fmt, args...));
+            }
+        }
+
         void setLogPrefix(const std::string &logPrefix);
 
+        //! 设置 logger 的级别。直接修改 log4cplus 的级别之后，也需要调用该函数
+        void setLogLevel(log4cplus::LogLevel level, const std::string &loggerName = "root");
+
+        //! 是否有 logger 启用了该级别
+        /*!
+         只比较缓存的最低级别(所有 logger 中最低的级别)，供 HC_LOG_* 在求值参数之前快速判断。
+         实例创建之前总是返回 true，第一次调用会创建默认实例。
+         */
+        static bool isEnabled(log4cplus::LogLevel level) {
+            return level >= _threshold.load(std::memory_order_relaxed);
+        }
+
+        //! 启用异步模式
+        /*!
+         之后 error/warn/info/debug/trace 等调用只格式化记录并放入队列，由后台线程写入
+         options.file，不再经过 log4cplus 的 appender。logger 的级别仍然有效。
+         options.format 为 LOG_FORMAT_BINARY 时，HC_BLOG_* 不再格式化，只提交参数的原始值。
+         只能在其它线程开始写日志之前调用。失败时抛出 HappyException。
+         */
+        void enableAsync(const AsyncLogOptions &options = AsyncLogOptions());
+
+        //! 关闭异步模式，等待队列中的记录全部写入，之后恢复同步输出
+        /*!
+         只能在其它线程不再写日志之后调用。HappyLog 析构时会自动写完队列中的记录。
+         */
+        void disableAsync();
+
+        //! 汇报所有调用点被抑制的记录数。异步模式下，等待已经提交的记录全部写入
+        void flush();
+
+        //! 异步模式下，因为队列已满而丢弃的记录总数
+        [[nodiscard]] uint64_t droppedRecords() const;
+
     protected:
         explicit HappyLog(const std::string &profile, const std::string &logPrefix = "");
 
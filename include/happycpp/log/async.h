@@ -0,0 +1,175 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_LOG_ASYNC_H_
+#define INCLUDE_HAPPYCPP_LOG_ASYNC_H_
+
+#include "happycpp/common.h"
+#include "log4cplus/loglevel.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace happycpp::log {
+
+    //! 异步日志队列已满时的处理方式
+    typedef enum {
+        LOG_OVERFLOW_BLOCK = 0,        /// 等待后台线程腾出空间，不丢弃任何记录
+        LOG_OVERFLOW_DROP_NEWEST,      /// 丢弃当前记录
+        LOG_OVERFLOW_DROP_DEBUG_FIRST  /// 队列超过 3/4 时丢弃 DEBUG 及以下的记录，其它记录等待
+    } LogOverflowPolicy;
+
+    //! 异步日志的输出格式
+    typedef enum {
+        LOG_FORMAT_TEXT = 0,  /// 文本，每条记录一行
+        LOG_FORMAT_BINARY     /// 二进制，见 happycpp/log/binary.h，需要用 hclog-decode 转换为文本
+    } LogFormat;
+
+    //! AsyncLogWriter 选项
+    struct AsyncLogOptions {
+        size_t capacity = 8192; /*! 队列能容纳的记录数，向上取整为 2 的幂 */
+        LogOverflowPolicy overflow = LOG_OVERFLOW_BLOCK;
+        std::string file; /*! 输出文件，追加写入。为空时输出到标准输出 */
+        size_t maxBatch = 64; /*! 每次 writev 最多合并的记录数 */
+        uint32_t idleWaitMs = 10; /*! 后台线程定期写入的间隔(毫秒)。队列超过一半、已满或者 flush 时立即写入 */
+        LogFormat format = LOG_FORMAT_TEXT;
+        bool reportSuppressed = false; /*! 空闲时把限流抑制的记录数(见 flushLogSummaries)写入队列，HappyLog 会打开 */
+    };
+
+    //! 异步日志输出
+    /*!
+     写日志的线程把格式化好的记录放入有界的无锁 MPSC 环形队列，后台线程一次取出多条，
+     通过一次 writev 写入文件。环形队列中每个槽位的字符串在写完之后保留容量，
+     稳定运行时写日志不分配内存，也不等待磁盘 I/O。
+
+     记录格式与 HappyLog 默认的控制台格式相同：
+     @verbatim
+     2016-01-02 03:04:05.678 1234  INFO  root --- message
+     @endverbatim
+
+     LOG_FORMAT_BINARY 格式下，写日志的线程只复制调用点 id、时间戳和参数的原始值，
+     格式化推迟到离线的 hclog-decode 中进行。
+
+     析构时等待队列中的所有记录写完。
+     */
+    class AsyncLogWriter {
+    public:
+        //! 打开输出文件，启动后台线程。失败时抛出 HappyException
+        explicit AsyncLogWriter(const AsyncLogOptions &options = AsyncLogOptions());
+
+        //! 写完所有记录，停止后台线程
+        ~AsyncLogWriter();
+
+        AsyncLogWriter(const AsyncLogWriter &) = delete;
+
+        AsyncLogWriter &operator=(const AsyncLogWriter &) = delete;
+
+        //! 格式化并提交一条记录，可以在任意线程中调用
+        /*!
+         * @param level 日志级别
+         * @param logger logger 名称
+         * @param prefix 消息前缀，见 HappyLog::setLogPrefix
+         * @param msg 消息
+         * @return 记录被丢弃时返回 false
+         */
+        bool push(log4cplus::LogLevel level, std::string_view logger,
+                  std::string_view prefix, std::string_view msg);
+
+        //! 提交一条二进制记录，只能在 LOG_FORMAT_BINARY 格式下使用
+        /*!
+         * @param level 日志级别，用于 LOG_OVERFLOW_DROP_DEBUG_FIRST
+         * @param site 调用点 id，见 registerLogSite
+         * @param args encodeLogArgs 编码的参数
+         * @return 记录被丢弃或者不是二进制格式时返回 false
+         */
+        bool pushBinary(log4cplus::LogLevel level, uint32_t site, std::string_view args);
+
+        //! 是否为 LOG_FORMAT_BINARY 格式
+        [[nodiscard]] bool binary() const {
+            return options_.format == LOG_FORMAT_BINARY;
+        }
+
+        //! 等待调用之前提交的记录全部写入
+        void flush();
+
+        //! 因为队列已满或者写入失败而丢弃的记录数
+        [[nodiscard]] uint64_t dropped() const;
+
+        //! 已经写入(或者写入失败)的记录数
+        [[nodiscard]] uint64_t written() const;
+
+    private:
+        struct Slot;
+
+        const AsyncLogOptions options_;
+        const size_t mask_;
+        const std::unique_ptr<Slot[]> slots_;
+        int fd_;
+        bool ownFd_;
+        const long pid_;
+
+        // 生产者和消费者频繁修改的计数器放在不同的缓存行中
+        alignas(64) std::atomic<uint64_t> enqueuePos_;
+        alignas(64) std::atomic<uint64_t> dequeuePos_;
+        alignas(64) std::atomic<uint64_t> dropped_;
+        std::atomic<bool> stop_;
+        std::atomic<bool> sleeping_;
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        std::thread thread_;
+        uint32_t sitesWritten_; /*! 已经写入定义的调用点数量，只在后台线程中使用 */
+        std::string siteBuf_;
+        std::string pending_; /*! 写入失败时部分写入的条目剩余的字节，下一批最先写入 */
+
+        //! 占用一个槽位，队列已满时返回 nullptr
+        Slot *tryAcquire(uint64_t *pos);
+
+        //! 按照 options_.overflow 占用一个槽位，记录被丢弃时返回 nullptr
+        Slot *acquire(log4cplus::LogLevel level, uint64_t *pos);
+
+        //! 槽位填充完成，交给后台线程
+        void commit(Slot *slot, uint64_t pos);
+
+        //! 写入二进制格式的文件头
+        void writeHeader();
+
+        void wakeup();
+
+        void run();
+
+        //! 取出并写入一批记录，返回写入的记录数
+        size_t drain();
+
+        //! 写入从 begin 开始的 count 个槽位
+        void writeBatch(uint64_t begin, size_t count);
+    };
+
+} /* namespace happycpp */
+
+#endif  // INCLUDE_HAPPYCPP_LOG_ASYNC_H_
@@ -0,0 +1,199 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_LOG_BINARY_H_
+#define INCLUDE_HAPPYCPP_LOG_BINARY_H_
+
+#include "happycpp/common.h"
+#include "log4cplus/loglevel.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+#include <string>
+#include <type_traits>
+
+namespace happycpp::log {
+
+    /*!
+     二进制日志格式(所有整数为小端)：
+
+     @verbatim
+     文件头: "HCBLOG1\0"  u64 实时时钟(纳秒)  u64 单调时钟(纳秒，与前者同时获取)
+     条目:   u32 条目长度(包括这 4 个字节)  u8 类型  数据
+       类型 LOG_ENTRY_SITE:   u32 id  i32 级别  u32 行号  u16 长度 文件名  u16 长度 格式  u8 参数个数  参数类型...
+       类型 LOG_ENTRY_RECORD: u32 调用点 id  u64 单调时钟(纳秒)  参数...
+     参数:   整数、浮点数和指针为 8 字节，字符串为 u32 长度加内容
+     @endverbatim
+
+     调用点的定义在第一条使用它的记录之前写入。
+     */
+
+    //! 二进制日志条目类型
+    typedef enum : uint8_t {
+        LOG_ENTRY_RECORD = 0,
+        LOG_ENTRY_SITE = 1
+    } LogEntryType;
+
+    //! 二进制日志参数类型
+    typedef enum : uint8_t {
+        LOG_ARG_INT = 1,  /// 有符号整数，int64_t
+        LOG_ARG_UINT,     /// 无符号整数，uint64_t
+        LOG_ARG_DOUBLE,   /// 浮点数，double
+        LOG_ARG_STRING,   /// 字符串，u32 长度加内容
+        LOG_ARG_POINTER   /// 指针，uint64_t
+    } LogArgType;
+
+    //! 日志调用点
+    struct LogSite {
+        uint32_t id;
+        log4cplus::LogLevel level;
+        std::string file;
+        uint32_t line;
+        std::string format; /*! printf 风格 */
+        std::string argTypes; /*! 每个字节为一个 LogArgType */
+    };
+
+    //! 文件头的魔数
+    constexpr char kBinaryLogMagic[8] = {'H', 'C', 'B', 'L', 'O', 'G', '1', '\0'};
+
+    //! 文件头长度
+    constexpr size_t kBinaryLogHeaderSize = 24;
+
+    //! LOG_ENTRY_RECORD 条目在参数之前的长度
+    constexpr size_t kBinaryRecordHeaderSize = 4 + 1 + 4 + 8;
+
+    //! 注册调用点，返回分配的 id。线程安全，调用点只增加不删除
+    uint32_t addLogSite(LogSite site);
+
+    //! 已经注册的调用点数量
+    size_t logSiteCount();
+
+    //! 获取调用点，id 不存在时抛出 HappyException
+    LogSite logSite(uint32_t id);
+
+    //! 文本日志(HappyLog::info 等)在二进制格式中使用的调用点
+    /*!
+     格式为 "%s --- %s%s"，参数依次为 logger 名称、前缀和消息。
+     */
+    uint32_t textLogSite(log4cplus::LogLevel level);
+
+    //! 二进制日志的时间戳，单调时钟(CLOCK_MONOTONIC_RAW)的纳秒数
+    uint64_t logTimestamp();
+
+    //! 把调用点的定义编码为 LOG_ENTRY_SITE 条目，追加到 out
+    void encodeLogSite(const LogSite &site, std::string *out);
+
+    //! 把二进制日志转换为文本，每条记录一行
+    /*!
+     @verbatim
+     2016-01-02 03:04:05.123456789 INFO  main.cc:42 --- message
+     @endverbatim
+     * @return 转换的记录数。格式错误时抛出 HappyException
+     */
+    uint64_t decodeBinaryLog(std::istream &in, std::ostream &out);
+
+    namespace detail {
+
+        template<typename T>
+        struct AlwaysFalse : std::false_type {
+        };
+
+        //! 参数类型列表
+        template<typename... Args>
+        struct LogArgTypes {
+        };
+
+        //! 只在 decltype 中使用，推导参数类型而不求值参数
+        template<typename... Args>
+        LogArgTypes<Args...> logArgTypesOf(const char *format, const Args &...args);
+
+        template<typename T>
+        constexpr LogArgType logArgType() {
+            typedef std::decay_t<T> D;
+
+            if constexpr (std::is_same_v<D, char *> || std::is_same_v<D, const char *>)
+                return LOG_ARG_STRING;
+            else if constexpr (std::is_pointer_v<D> || std::is_null_pointer_v<D>)
+                return LOG_ARG_POINTER;
+            else if constexpr (std::is_floating_point_v<D>)
+                return LOG_ARG_DOUBLE;
+            else if constexpr (std::is_enum_v<D>)
+                return std::is_signed_v<std::underlying_type_t<D> > ? LOG_ARG_INT : LOG_ARG_UINT;
+            else if constexpr (std::is_integral_v<D>)
+                return std::is_signed_v<D> ? LOG_ARG_INT : LOG_ARG_UINT;
+            else
+                static_assert(AlwaysFalse<D>::value, "Unsupported binary log argument type.");
+        }
+
+        inline void appendBytes(std::string *out, const void *p, size_t n) {
+            out->append(static_cast<const char *>(p), n);
+        }
+
+        template<typename T>
+        void encodeArg(std::string *out, const T &v) {
+            constexpr LogArgType type = logArgType<T>();
+
+            if constexpr (type == LOG_ARG_STRING) {
+                const char *s = v;
+
+                if (s == nullptr)
+                    s = "(null)";
+
+                const auto n = static_cast<uint32_t>(strlen(s));
+                appendBytes(out, &n, sizeof(n));
+                out->append(s, n);
+            } else if constexpr (type == LOG_ARG_POINTER) {
+                const auto x = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(static_cast<const void *>(v)));
+                appendBytes(out, &x, sizeof(x));
+            } else if constexpr (type == LOG_ARG_DOUBLE) {
+                const auto x = static_cast<double>(v);
+                appendBytes(out, &x, sizeof(x));
+            } else if constexpr (type == LOG_ARG_INT) {
+                const auto x = static_cast<int64_t>(v);
+                appendBytes(out, &x, sizeof(x));
+            } else {
+                const auto x = static_cast<uint64_t>(v);
+                appendBytes(out, &x, sizeof(x));
+            }
+        }
+
+    } /* namespace detail */
+
+    //! 注册调用点，参数类型由 HC_BLOG_* 通过 detail::logArgTypesOf 推导
+    template<typename... Args>
+    uint32_t registerLogSite(log4cplus::LogLevel level, const char *file, uint32_t line,
+                             const char *format, detail::LogArgTypes<Args...>) {
+        const char types[] = {static_cast<char>(detail::logArgType<Args>())..., '\0'};
+        return addLogSite(LogSite{0, level, file, line, format, std::string(types, sizeof...(Args))});
+    }
+
+    //! 编码参数，追加到 out
+    template<typename... Args>
+    void encodeLogArgs(std::string *out, const Args &...args) {
+        (detail::encodeArg(out, args), ...);
+    }
+
+} /* namespace happycpp */
+
+#endif  // INCLUDE_HAPPYCPP_LOG_BINARY_H_
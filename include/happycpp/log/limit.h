@@ -0,0 +1,163 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+/** @file */
+
+#ifndef INCLUDE_HAPPYCPP_LOG_LIMIT_H_
+#define INCLUDE_HAPPYCPP_LOG_LIMIT_H_
+
+#include "happycpp/common.h"
+#include "log4cplus/loglevel.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace log4cplus::helpers {
+    class Properties;
+}
+
+namespace happycpp::log {
+
+    //! 日志限流参数
+    struct LogLimitConfig {
+        double rate = 0; /*! 每个调用点每秒最多输出的记录数，0 表示不限制 */
+        double burst = 0; /*! 允许的突发记录数，0 表示与 rate 相同 */
+        uint32_t sample = 1; /*! INFO 及以下的记录每 sample 条只输出 1 条，1 表示不采样 */
+    };
+
+    //! 设置 logger 的限流参数，logger 为空时作为所有 logger 的默认值
+    /*!
+     子 logger 没有单独设置时，使用最近的上级 logger 的参数，比如 "net.http" 使用 "net" 的参数。
+     */
+    void setLogLimit(const std::string &logger, const LogLimitConfig &config);
+
+    //! 清除所有限流参数
+    void clearLogLimits();
+
+    //! 汇报被抑制的记录数的间隔(秒)，默认 10 秒
+    void setLogSummaryInterval(uint32_t seconds);
+
+    //! 从 log4cplus 配置文件中读取限流参数
+    /*!
+     @verbatim
+     # 所有 logger 的每个调用点每秒最多 10 条，允许突发 50 条
+     happycpp.limit.rate=10
+     happycpp.limit.burst=50
+     # logger net 及其子 logger 的 INFO 及以下的记录每 100 条保留 1 条
+     happycpp.limit.sample.net=100
+     happycpp.limit.summaryInterval=10
+     @endverbatim
+     */
+    void loadLogLimits(const log4cplus::helpers::Properties &props);
+
+    //! 接收被抑制记录数的汇报，参数为 logger 名称和汇报内容
+    typedef std::function<void(const char *logger, const std::string &msg)> LogSummarySink;
+
+    //! 汇报所有调用点被抑制的记录数
+    /*!
+     force 为 false 时，只汇报距离上次汇报超过 summaryInterval 的调用点。
+     sink 为空时，以 WARN 级别写入 HappyLog::instance()。
+     异步日志的后台线程空闲时以 force 为 false 调用，不再输出日志的调用点也能按时汇报，
+     汇报通过 sink 写入它自己的队列，后台线程不访问 HappyLog。
+     */
+    void flushLogSummaries(bool force = true, const LogSummarySink &sink = LogSummarySink());
+
+    //! 调用点的限流状态
+    /*!
+     HC_LOG_* 和 HC_BLOG_* 在每个调用点定义一个静态的 LogLimiter。
+     直接调用 HappyLog::error 等函数时，每个 logger 的每个级别作为一个调用点。
+
+     限流使用 GCRA(令牌桶的等价形式)，状态只有一个原子变量。被抑制的记录数每隔
+     summaryInterval 秒以 WARN 级别汇报一次。未设置任何限流参数时，allow 只有一次原子读取。
+
+     构造函数是 constexpr，静态的 LogLimiter 在编译时初始化，不需要线程安全的初始化检查。
+     */
+    class LogLimiter {
+    public:
+        //! file 和 logger 必须在 LogLimiter 的整个生命周期内有效。line 为 0 时，file 为级别名称
+        constexpr LogLimiter(const char *file, uint32_t line, const char *logger = "root")
+                : file_(file), line_(line), logger_(logger), generation_(0), intervalNs_(0), toleranceNs_(0),
+                  sample_(1), tat_(0), count_(0), suppressed_(0), lastSummary_(0), next_(nullptr) {
+        }
+
+        LogLimiter(const LogLimiter &) = delete;
+
+        LogLimiter &operator=(const LogLimiter &) = delete;
+
+        //! 是否输出这条记录
+        bool allow(log4cplus::LogLevel level) {
+            return !enabled() || check(level);
+        }
+
+        //! 上次汇报之后被抑制的记录数
+        [[nodiscard]] uint64_t suppressed() const {
+            return suppressed_.load(std::memory_order_relaxed);
+        }
+
+        //! 是否设置了任何限流参数
+        static bool enabled() {
+            return _enabled.load(std::memory_order_relaxed);
+        }
+
+    private:
+        friend void setLogLimit(const std::string &logger, const LogLimitConfig &config);
+
+        friend void clearLogLimits();
+
+        friend void loadLogLimits(const log4cplus::helpers::Properties &props);
+
+        friend void flushLogSummaries(bool force, const LogSummarySink &sink);
+
+        static std::atomic<bool> _enabled;
+        static std::atomic<uint32_t> _generation; /*! 每次修改参数后加 1 */
+
+        const char *file_;
+        const uint32_t line_;
+        const char *logger_;
+        std::atomic<uint32_t> generation_; /*! 缓存的参数对应的 _generation */
+        std::atomic<int64_t> intervalNs_; /*! 1 / rate，0 表示不限制 */
+        std::atomic<int64_t> toleranceNs_; /*! (burst - 1) / rate */
+        std::atomic<uint32_t> sample_;
+        std::atomic<int64_t> tat_; /*! 理论上下一条记录的到达时间 */
+        std::atomic<uint64_t> count_;
+        std::atomic<uint64_t> suppressed_;
+        std::atomic<int64_t> lastSummary_;
+        LogLimiter *next_; /*! 所有调用点组成的链表，用于 flushLogSummaries */
+
+        //! 修改参数之后调用，所有 LogLimiter 在下一次 check 时重新读取参数
+        static void changed(bool enabled);
+
+        bool check(log4cplus::LogLevel level);
+
+        //! 参数修改之后，重新读取 logger_ 的参数
+        void reload(int64_t now);
+
+        //! 汇报被抑制的记录数。force 为 false 时，只在距离上次汇报超过间隔时汇报
+        void summarize(int64_t now, bool force, const LogSummarySink &sink);
+    };
+
+    //! 直接调用 HappyLog::error 等函数时使用的 LogLimiter
+    LogLimiter &loggerLimiter(const std::string &logger, log4cplus::LogLevel level);
+
+} /* namespace happycpp */
+
+#endif  // INCLUDE_HAPPYCPP_LOG_LIMIT_H_
@@ -130,6 +130,8 @@ typedef struct {
     time_t atime;  // 文件访问时间，秒
     time_t ctime;  // 文件状态修改时间，秒
     time_t mtime;  // 文件修改时间，秒
+    long mtime_nsec;  // 文件修改时间的纳秒部分。Windows 上为 0
+    uint64_t ino;  // inode 编号。Windows 上为 0
 } FileStat;
 
 #endif  // INCLUDE_HAPPYCPP_TYPE_H_
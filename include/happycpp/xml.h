@@ -103,7 +103,7 @@ namespace happycpp::hcxml {
         const bool ret = getValue(src, key, &value);
 
         if (mode == VM_STRICT && !ret)  // 严格模式，并且获取失败，则抛出异常
-            ThrowHappyException("Node mismatched.");
+            ThrowHappyError(ENOENT, "Node mismatched.");
         else
             return value;
     }
@@ -125,7 +125,7 @@ namespace happycpp::hcalgorithm::hcbyte {
 
     HAPPYCPP_SHARED_LIB_API uint32_t from4ByteArray(const vector<byte_t> &bytes) {
         if (bytes.size() != 4U) {
-            ThrowHappyException("byte数组转为uint32_t时，长度必须为4");
+            ThrowHappyError(EINVAL, "byte数组转为uint32_t时，长度必须为4");
         }
 
         return ((bytes[0] & 0xFF) << 24) |
@@ -137,7 +137,7 @@ namespace happycpp::hcalgorithm::hcbyte {
 
     HAPPYCPP_SHARED_LIB_API HAPPYCPP_SHARED_LIB_API uint16_t from2ByteArray(const vector<byte_t> &bytes) {
         if (bytes.size() != 2U) {
-            ThrowHappyException("byte数组转为uint16_t时，长度必须为2");
+            ThrowHappyError(EINVAL, "byte数组转为uint16_t时，长度必须为2");
         }
 
         return static_cast<uint16_t> (
@@ -46,24 +46,22 @@ using happycpp::hcalgorithm::hcstring::trim;
 namespace happycpp::hccmd {
 
     HAPPYCPP_SHARED_LIB_API bool getExitStatusOfCmd(const std::string &cmd) {
-        happycpp::log::HappyLogPtr hlog = happycpp::log::HappyLog::getInstance();
-        hlog->trace("cmd=" + cmd + EOL);
+        HC_LOG_TRACE("cmd=%s" EOL, cmd.c_str());
 
         // 重定向输出到null
         const std::string redirect_cmd(cmd + ToNull);
         const bool ret = (system(redirect_cmd.c_str()) == 0);
 
         if (ret)
-            hlog->trace("ret=" EOL "successful");
+            HC_LOG_TRACE("ret=" EOL "successful");
         else
-            hlog->trace("ret=" EOL "unsuccessful");
+            HC_LOG_TRACE("ret=" EOL "unsuccessful");
 
         return ret;
     }
 
     HAPPYCPP_SHARED_LIB_API std::string getOutputOfCmd(const std::string &cmd) {
-        happycpp::log::HappyLogPtr hlog = happycpp::log::HappyLog::getInstance();
-        hlog->trace("cmd=" + cmd + EOL);
+        HC_LOG_TRACE("cmd=%s" EOL, cmd.c_str());
 
         int32_t size = 2048;
         char buffer[2048];
@@ -80,7 +78,7 @@ namespace happycpp::hccmd {
         }
 
         ret = trim(ret, " \r\n");
-        hlog->trace("ret=" + cmd + EOL);
+        HC_LOG_TRACE("ret=%s" EOL, ret.c_str());
 
         return ret;
     }
@@ -89,9 +87,8 @@ namespace happycpp::hccmd {
 
     HAPPYCPP_SHARED_LIB_API void ExecuteCmdWithSubProc(
         const std::string &cmd, const uint32_t &delay_secs) {
-      happycpp::log::HappyLogPtr hlog = happycpp::log::HappyLog::getInstance();
-      hlog->trace("cmd=" + cmd + EOL);
-      hlog->trace("delay_secs=" + cmd + std::atoi(delay_secs));
+      HC_LOG_TRACE("cmd=%s" EOL, cmd.c_str());
+      HC_LOG_TRACE("delay_secs=%u", delay_secs);
 
       STARTUPINFO startup_info;
       PROCESS_INFORMATION proc_info;
@@ -19,18 +19,107 @@
 // IN THE SOFTWARE.
 
 #include <happycpp/exception.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
 
 namespace happycpp {
 
+    namespace {
+
+        // GNU 的 strerror_r 返回 char *，XSI 的返回 int
+        [[maybe_unused]] const char *strerrorResult(const char *s, const char *) {
+            return s;
+        }
+
+        [[maybe_unused]] const char *strerrorResult(int, const char *buf) {
+            return buf;
+        }
+
+    } /* namespace */
+
+    //! 复制异常时共享同一份文本，最后一个副本负责释放
+    struct HappyException::Text {
+        std::atomic<long> refs;
+        const std::string str;
+
+        explicit Text(std::string s) : refs(1), str(std::move(s)) {
+        }
+    };
+
     HappyException::HappyException(const std::string &msg)
-            : _error(msg) {
-        hlog->error(msg);
+            : _static(nullptr),
+              _text(new Text(msg)),
+              _code(0),
+              _sysError(false) {
+    }
+
+    HappyException::HappyException(int code, const char *msg, bool sysError) noexcept
+            : _static(msg),
+              _text(nullptr),
+              _code(code),
+              _sysError(sysError) {
+    }
+
+    HappyException::HappyException(const HappyException &other) noexcept
+            : std::exception(other),
+              _static(other._static),
+              _text(other._text.load(std::memory_order_acquire)),
+              _code(other._code),
+              _sysError(other._sysError) {
+        Text *text = _text.load(std::memory_order_relaxed);
+
+        if (text)
+            text->refs.fetch_add(1, std::memory_order_relaxed);
     }
 
-    HappyException::~HappyException() noexcept = default;
+    HappyException::~HappyException() noexcept {
+        Text *text = _text.load(std::memory_order_acquire);
+
+        if (text && text->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete text;
+    }
 
     const char *HappyException::what() const noexcept {
-        return _error.what();
+        Text *text = _text.load(std::memory_order_acquire);
+
+        if (text)
+            return text->str.c_str();
+
+        if (!_sysError)
+            return _static;
+
+        // 与 hcerrno::errorToStr 的格式相同
+        char err[128] = "Unknown error";
+#ifdef PLATFORM_WIN32
+        strerror_s(err, sizeof(err), _code);
+        const char *desc = err;
+#else
+        const char *desc = strerrorResult(strerror_r(_code, err, sizeof(err)), err);
+#endif
+        char buf[256];
+        snprintf(buf, sizeof(buf), "%s: %s(errno: %d)", _static, desc, _code);
+
+        // 分配失败时退回静态消息。多个线程同时调用时，只保留第一个格式化的结果
+        try {
+            text = new Text(buf);
+        } catch (...) {
+            return _static;
+        }
+
+        Text *expected = nullptr;
+
+        if (!_text.compare_exchange_strong(expected, text, std::memory_order_acq_rel)) {
+            delete text;
+            return expected->str.c_str();
+        }
+
+        return text->str.c_str();
+    }
+
+    int HappyException::code() const noexcept {
+        return _code;
     }
 
 } /* namespace happycpp */
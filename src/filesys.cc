@@ -57,6 +57,42 @@ using happycpp::hcalgorithm::hcstring::toLower;
 
 namespace happycpp::hcfilesys {
 
+    namespace {
+
+        // 由 stat 的结果填充 FileStat，不是目录、文件或者链接时返回 false
+        bool toFileStat(const std::string &name, const std::string &path,
+                        const struct stat &st, FileStat *fs) {
+            if (S_ISDIR(st.st_mode)) {
+                fs->type = kDir;
+                fs->ext.clear();
+            } else if (S_ISREG(st.st_mode) || S_ISLNK(st.st_mode)) {
+                fs->type = kFile;
+                // 查找字符串中最后一个点，
+                // 如果有则截取点到字符串末尾之间的子字符串作为扩展名
+                const size_t sep_pos = name.find_last_of('.');
+                fs->ext = sep_pos == std::string::npos ? std::string() : toLower(name.substr(sep_pos));
+            } else {
+                return false;
+            }
+
+            fs->name = name;
+            fs->path = path;
+            fs->bytes = st.st_size;
+            fs->atime = st.st_atime;
+            fs->ctime = st.st_ctime;
+            fs->mtime = st.st_mtime;
+#ifdef PLATFORM_WIN32
+            fs->mtime_nsec = 0;
+            fs->ino = 0;
+#else
+            fs->mtime_nsec = st.st_mtim.tv_nsec;
+            fs->ino = st.st_ino;
+#endif
+            return true;
+        }
+
+    } /* namespace */
+
     HAPPYCPP_SHARED_LIB_API bool happyCreateFile(const std::string &file) {
         if (bfs::exists(file))
             return true;
@@ -109,8 +145,7 @@ namespace happycpp::hcfilesys {
         ifstream ifs(file.c_str(), ifstream::binary);
 
         if (!ifs) {
-            happycpp::log::HappyLogPtr hlog = happycpp::log::HappyLog::getInstance();
-            hlog->error(errorToStr());
+            happycpp::log::HappyLog::instance().error(errorToStr());
             return false;
         }
 
@@ -153,8 +188,7 @@ namespace happycpp::hcfilesys {
         if (ofs) {
             ofs << content;
         } else {
-            happycpp::log::HappyLogPtr hlog = happycpp::log::HappyLog::getInstance();
-            hlog->error(errorToStr());
+            happycpp::log::HappyLog::instance().error(errorToStr());
             return false;
         }
 
@@ -171,11 +205,8 @@ namespace happycpp::hcfilesys {
         v->clear();
 
         uint32_t num = 0;
-        FileType _type;
-        std::string ext;
         std::string _path;
         std::string name;
-        size_t sep_pos;
         FileStat file_stat;
         struct stat _stat{};
 #ifdef PLATFORM_WIN32
@@ -213,35 +244,15 @@ namespace happycpp::hcfilesys {
             if (stat(_path.c_str(), &_stat) != 0)
                 ThrowHappyException(hcerrno::errorToStr());
 
-            if (S_ISDIR(_stat.st_mode)) {
-                _type = kDir;
-            } else if (S_ISREG(_stat.st_mode) || S_ISLNK(_stat.st_mode)) {
-                _type = kFile;
-                // 查找字符串中最后一个点，
-                // 如果有则截取点到字符串末尾之间的子字符串作为扩展名
-                sep_pos = name.find_last_of('.');
-
-                if (sep_pos != std::string::npos)
-                    ext = toLower(name.substr(sep_pos));
-            } else {
+            if (!toFileStat(name, _path, _stat, &file_stat))
                 continue;
-            }
 
-            if (type == kAll || type == _type) {
-                file_stat.type = _type;
-                file_stat.name = name;
-                file_stat.ext = ext;
-                file_stat.path = _path;
-                file_stat.bytes = _stat.st_size;
-                file_stat.atime = _stat.st_atime;
-                file_stat.ctime = _stat.st_ctime;
-                file_stat.mtime = _stat.st_mtime;
+            if (type == kAll || type == file_stat.type) {
                 v->push_back(file_stat);
                 ++num;
 
                 if (num == max_num) {
-                    happycpp::log::HappyLogPtr hlog = happycpp::log::HappyLog::getInstance();
-                    hlog->error("Too many files or directorys in \"" + _path + "\".");
+                    happycpp::log::HappyLog::instance().error("Too many files or directorys in \"" + _path + "\".");
                     break;
                 }
             }
@@ -258,4 +269,16 @@ namespace happycpp::hcfilesys {
 #endif
     }
 
+    HAPPYCPP_SHARED_LIB_API bool getFileStat(const std::string &path, FileStat *fs) {
+        struct stat _stat{};
+
+        if (path.empty() || stat(path.c_str(), &_stat) != 0)
+            return false;
+
+        const size_t sep_pos = path.find_last_of("/\\");
+        const std::string name(sep_pos == std::string::npos ? path : path.substr(sep_pos + 1));
+
+        return toFileStat(name, path, _stat, fs);
+    }
+
 } /* namespace happycpp */
@@ -18,176 +18,428 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 
 #include "happycpp/http.h"
+#include "happycpp/http/parser.h"
+#include "happycpp/http/client.h"
+#include "happycpp/http/mime.h"
 #include "happycpp/exception.h"
 #include "happycpp/algorithm.h"
-#include <curl/curl.h>
-
-using happycpp::hcalgorithm::hcstring::split;
-using happycpp::hcalgorithm::hcstring::trim;
+#include "http/text.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
 
 namespace happycpp::hchttp {
 
-    std::map<std::string, HttpMethodType> HttpMessage::mDescHm = { // NOLINT
-            {"",        INVALID_HTTP_METHOD},
-            {"CONNECT", HTTP_METHOD_CONNECT},
-            {"DELETE",  HTTP_METHOD_DELETE},
-            {"GET",     HTTP_METHOD_GET},
-            {"HEAD",    HTTP_METHOD_HEAD},
-            {"POST",    HTTP_METHOD_POST},
-            {"PUT",     HTTP_METHOD_PUT},
-            {"TRACE",   HTTP_METHOD_TRACE}
-    };
+    namespace {
+
+        using detail::asciiLower;
+        using detail::iequals;
+
+        // HttpRequestMsg::argsState_ 的取值
+        constexpr int kArgsPending = 0;
+        constexpr int kArgsDecoding = 1;
+        constexpr int kArgsDecoded = 2;
+
+        // 与 HttpMethodType 枚举顺序一致
+        constexpr std::string_view kHmNames[] = {
+                "CONNECT",   // HTTP_METHOD_CONNECT
+                "DELETE",    // HTTP_METHOD_DELETE
+                "GET",       // HTTP_METHOD_GET
+                "HEAD",      // HTTP_METHOD_HEAD
+                "POST",      // HTTP_METHOD_POST
+                "PUT",       // HTTP_METHOD_PUT
+                "TRACE",     // HTTP_METHOD_TRACE
+        };
+
+        // 与 HttpMsgField 枚举顺序一致
+        constexpr std::string_view kHmfNames[] = {
+                "Cache-Control",                // HTTP_MCOMF_CACHE_CONTROL
+                "Connection",                   // HTTP_MCOMF_CONNECTION
+                "Content-Length",               // HTTP_MCOMF_CONTENT_LENGTH
+                "Content-MD5",                  // HTTP_MCOMF_CONTENT_MD5
+                "Content-Type",                 // HTTP_MCOMF_CONTENT_TYPE
+                "Date",                         // HTTP_MCOMF_DATE
+                "Pragma",                       // HTTP_MCOMF_PRAGMA
+                "Upgrade",                      // HTTP_MCOMF_UPGRADE
+                "Via",                          // HTTP_MCOMF_VIA
+                "Warning",                      // HTTP_MCOMF_WARNING
+                "Accept",                       // HTTP_MREQF_ACCEPT
+                "Accept-Charset",               // HTTP_MREQF_ACCEPT_CHARSET
+                "Accept-Encoding",              // HTTP_MREQF_ACCEPT_ENCODING
+                "Accept-Language",              // HTTP_MREQF_ACCEPT_LANGUAGE
+                "Accept-Datetime",              // HTTP_MREQF_ACCEPT_DATETIME
+                "Authorization",                // HTTP_MREQF_AUTHORIZATION
+                "Cookie",                       // HTTP_MREQF_COOKIE
+                "Expect",                       // HTTP_MREQF_EXPECT
+                "From",                         // HTTP_MREQF_FROM
+                "Host",                         // HTTP_MREQF_HOST
+                "If-Match",                     // HTTP_MREQF_IF_MATCH
+                "If-Modified-Since",            // HTTP_MREQF_IF_MODIFIED_SINCE
+                "If-None-Match",                // HTTP_MREQF_IF_NONE_MATCH
+                "If-Range",                     // HTTP_MREQF_IF_RANGE
+                "If-Unmodified-Since",          // HTTP_MREQF_IF_UNMODIFIED_SINCE
+                "Max-Forwards",                 // HTTP_MREQF_MAX_FORWARDS
+                "Origin",                       // HTTP_MREQF_ORIGIN
+                "Proxy-Authorization",          // HTTP_MREQF_PROXY_AUTHORIZATION
+                "Range",                        // HTTP_MREQF_RANGE
+                "Referer",                      // HTTP_MREQF_REFERER
+                "TE",                           // HTTP_MREQF_TE
+                "User-Agent",                   // HTTP_MREQF_USER_AGENT
+                "X_Requested_With",             // HTTP_MREQF_NONSTD_X_REQUESTED_WITH
+                "DNT",                          // HTTP_MREQF_NONSTD_DNT
+                "X_Forwarded_For",              // HTTP_MREQF_NONSTD_X_FORWARDED_FOR
+                "X_Forwarded_Host",             // HTTP_MREQF_NONSTD_X_FORWARDED_HOST
+                "X_Forwarded_Proto",            // HTTP_MREQF_NONSTD_X_FORWARDED_PROTO
+                "Front_End_Https",              // HTTP_MREQF_NONSTD_FRONT_END_HTTPS
+                "X_Http_Method_Override",       // HTTP_MREQF_NONSTD_X_HTTP_METHOD_OVERRIDE
+                "X_ATT_DeviceId",               // HTTP_MREQF_NONSTD_X_ATT_DEVICEID
+                "X_Wap_Profile",                // HTTP_MREQF_NONSTD_X_WAP_PROFILE
+                "Proxy_Connection",             // HTTP_MREQF_NONSTD_PROXY_CONNECTION
+                "X_UIDH",                       // HTTP_MREQF_NONSTD_X_UIDH
+                "X_Csrf_Token",                 // HTTP_MREQF_NONSTD_X_CSRF_TOKEN
+                "Access-Control-Allow-Origin",  // HTTP_MRESF_ACCESS_CONTROL_ALLOW_ORIGIN
+                "Accept-Patch",                 // HTTP_MRESF_ACCEPT_PATCH
+                "Accept-Ranges",                // HTTP_MRESF_ACCEPT_RANGES
+                "Age",                          // HTTP_MRESF_AGE
+                "Allow",                        // HTTP_MRESF_ALLOW
+                "Content-Disposition",          // HTTP_MRESF_CONTENT_DISPOSITION
+                "Content-Encoding",             // HTTP_MRESF_CONTENT_ENCODING
+                "Content-Language",             // HTTP_MRESF_CONTENT_LANGUAGE
+                "Content-Location",             // HTTP_MRESF_CONTENT_LOCATION
+                "Content-Range",                // HTTP_MRESF_CONTENT_RANGE
+                "ETag",                         // HTTP_MRESF_ETAG
+                "Expires",                      // HTTP_MRESF_EXPIRES
+                "Last-Modified",                // HTTP_MRESF_LAST_MODIFIED
+                "Link",                         // HTTP_MRESF_LINK
+                "Location",                     // HTTP_MRESF_LOCATION
+                "P3P",                          // HTTP_MRESF_P3P
+                "Proxy-Authenticate",           // HTTP_MRESF_PROXY_AUTHENTICATE
+                "Public-Key-Pins",              // HTTP_MRESF_PUBLIC_KEY_PINS
+                "Refresh",                      // HTTP_MRESF_REFRESH
+                "Retry-After",                  // HTTP_MRESF_RETRY_AFTER
+                "Server",                       // HTTP_MRESF_SERVER
+                "Set-Cookie",                   // HTTP_MRESF_SET_COOKIE
+                "Status",                       // HTTP_MRESF_STATUS
+                "Strict-Transport-Security",    // HTTP_MRESF_STRICT_TRANSPORT_SECURITY
+                "Trailer",                      // HTTP_MRESF_TRAILER
+                "Transfer-Encoding",            // HTTP_MRESF_TRANSFER_ENCODING
+                "TSV",                          // HTTP_MRESF_TSV
+                "Vary",                         // HTTP_MRESF_VARY
+                "WWW-Authenticate",             // HTTP_MRESF_WWW_AUTHENTICATE
+                "X-Frame-Options",              // HTTP_MRESF_X_FRAME_OPTIONS
+                "X-XSS-Protection",             // HTTP_MRESF_NONSTD_X_XSS_PROTECTION
+                "Content-Security-Policy",      // HTTP_MRESF_NONSTD_CONTENT_SECURITY_POLICY
+                "X-Content-Security-Policy",    // HTTP_MRESF_NONSTD_X_CONTENT_SECURITY_POLICY
+                "X-WebKit-CSP",                 // HTTP_MRESF_NONSTD_X_WEBKIT_CSP
+                "X-Content-Type-Options",       // HTTP_MRESF_NONSTD_X_CONTENT_TYPE_OPTIONS
+                "X-Powered-By",                 // HTTP_MRESF_NONSTD_X_POWERED_BY
+                "X-UA-Compatible",              // HTTP_MRESF_NONSTD_X_UA_COMPATIBLE
+                "X-Content-Duration",           // HTTP_MRESF_NONSTD_X_CONTENT_DURATION
+        };
+
+        constexpr size_t kHmCount = sizeof(kHmNames) / sizeof(kHmNames[0]);
+        constexpr size_t kHmfCount = sizeof(kHmfNames) / sizeof(kHmfNames[0]);
+
+        static_assert(kHmCount == HTTP_METHOD_TRACE + 1,
+                      "kHmNames does not match HttpMethodType");
+        static_assert(kHmfCount == kHttpMsgFieldCount,
+                      "kHmfNames does not match HttpMsgField");
+
+        // 字段名查找使用编译期生成的完美哈希表，不区分大小写(RFC 7230 3.2)
+        //
+        // 哈希值只取决于长度、首字符、尾字符以及中间字符(均转换为小写)，
+        // 乘以 kHmfHashSeed 后取高 8 位作为槽位。kHmfHashSeed 是离线搜索得到的，
+        // 保证 kHmfNames 中的字段互不冲突。新增字段后，如果下面的 static_assert
+        // 失败，需要重新搜索一个种子。
+        constexpr uint32_t kHmfHashSeed = 0xbeb7e5b7U;
+        constexpr size_t kHmfSlotBits = 8;
+        constexpr size_t kHmfSlotCount = 1U << kHmfSlotBits;
+
+        constexpr size_t hmfHash(std::string_view k) {
+            const auto c = [](char ch) {
+                return static_cast<uint32_t>(static_cast<uint8_t>(asciiLower(ch)));
+            };
+
+            const size_t n = k.size();
+            const uint32_t x = c(k[0])
+                               | c(k[n - 1]) << 8U
+                               | c(k[n / 2]) << 16U
+                               | static_cast<uint32_t>(n) << 24U;
+
+            return static_cast<uint32_t>(x * kHmfHashSeed) >> (32 - kHmfSlotBits);
+        }
 
-    std::map<std::string, HttpMsgField> HttpMessage::mDescHmf = { // NOLINT
-            {"",                            INVALID_HTTP_MSG_FIELD},
-            {"Cache-Control",               HTTP_MCOMF_CACHE_CONTROL},
-            {"Connection",                  HTTP_MCOMF_CONNECTION},
-            {"Content-Length",              HTTP_MCOMF_CONTENT_LENGTH},
-            {"Content-MD5",                 HTTP_MCOMF_CONTENT_MD5},
-            {"Content-Type",                HTTP_MCOMF_CONTENT_TYPE},
-            {"Date",                        HTTP_MCOMF_DATE},
-            {"Pragma",                      HTTP_MCOMF_PRAGMA},
-            {"Upgrade",                     HTTP_MCOMF_UPGRADE},
-            {"Via",                         HTTP_MCOMF_VIA},
-            {"Warning",                     HTTP_MCOMF_WARNING},
-            {"Accept",                      HTTP_MREQF_ACCEPT},
-            {"Accept-Charset",              HTTP_MREQF_ACCEPT_CHARSET},
-            {"Accept-Encoding",             HTTP_MREQF_ACCEPT_ENCODING},
-            {"Accept-Language",             HTTP_MREQF_ACCEPT_LANGUAGE},
-            {"Accept-Datetime",             HTTP_MREQF_ACCEPT_DATETIME},
-            {"Authorization",               HTTP_MREQF_AUTHORIZATION},
-            {"Cookie",                      HTTP_MREQF_COOKIE},
-            {"Expect",                      HTTP_MREQF_EXPECT},
-            {"From",                        HTTP_MREQF_FROM},
-            {"Host",                        HTTP_MREQF_HOST},
-            {"If-Match",                    HTTP_MREQF_IF_MATCH},
-            {"If-Modified-Since",           HTTP_MREQF_IF_MODIFIED_SINCE},
-            {"If-None-Match",               HTTP_MREQF_IF_NONE_MATCH},
-            {"If-Range",                    HTTP_MREQF_IF_RANGE},
-            {"If-Unmodified-Since",         HTTP_MREQF_IF_UNMODIFIED_SINCE},
-            {"Max-Forwards",                HTTP_MREQF_MAX_FORWARDS},
-            {"Origin",                      HTTP_MREQF_ORIGIN},
-            {"Proxy-Authorization",         HTTP_MREQF_PROXY_AUTHORIZATION},
-            {"Range",                       HTTP_MREQF_RANGE},
-            {"Referer",                     HTTP_MREQF_REFERER},
-            {"TE",                          HTTP_MREQF_TE},
-            {"User-Agent",                  HTTP_MREQF_USER_AGENT},
-            {"X_Requested_With",            HTTP_MREQF_NONSTD_X_REQUESTED_WITH},
-            {"DNT",                         HTTP_MREQF_NONSTD_DNT},
-            {"X_Forwarded_For",             HTTP_MREQF_NONSTD_X_FORWARDED_FOR},
-            {"X_Forwarded_Host",            HTTP_MREQF_NONSTD_X_FORWARDED_HOST},
-            {"X_Forwarded_Proto",           HTTP_MREQF_NONSTD_X_FORWARDED_PROTO},
-            {"Front_End_Https",             HTTP_MREQF_NONSTD_FRONT_END_HTTPS},
-            {"X_Http_Method_Override",      HTTP_MREQF_NONSTD_X_HTTP_METHOD_OVERRIDE},
-            {"X_ATT_DeviceId",              HTTP_MREQF_NONSTD_X_ATT_DEVICEID},
-            {"X_Wap_Profile",               HTTP_MREQF_NONSTD_X_WAP_PROFILE},
-            {"Proxy_Connection",            HTTP_MREQF_NONSTD_PROXY_CONNECTION},
-            {"X_UIDH",                      HTTP_MREQF_NONSTD_X_UIDH},
-            {"X_Csrf_Token",                HTTP_MREQF_NONSTD_X_CSRF_TOKEN},
-            {"Access-Control-Allow-Origin", HTTP_MRESF_ACCESS_CONTROL_ALLOW_ORIGIN},
-            {"Accept-Patch",                HTTP_MRESF_ACCEPT_PATCH},
-            {"Accept-Ranges",               HTTP_MRESF_ACCEPT_RANGES},
-            {"Age",                         HTTP_MRESF_AGE},
-            {"Allow",                       HTTP_MRESF_ALLOW},
-            {"Content-Disposition",         HTTP_MRESF_CONTENT_DISPOSITION},
-            {"Content-Encoding",            HTTP_MRESF_CONTENT_ENCODING},
-            {"Content-Language",            HTTP_MRESF_CONTENT_LANGUAGE},
-            {"Content-Location",            HTTP_MRESF_CONTENT_LOCATION},
-            {"Content-Range",               HTTP_MRESF_CONTENT_RANGE},
-            {"ETag",                        HTTP_MRESF_ETAG},
-            {"Expires",                     HTTP_MRESF_EXPIRES},
-            {"Last-Modified",               HTTP_MRESF_LAST_MODIFIED},
-            {"Link",                        HTTP_MRESF_LINK},
-            {"Location",                    HTTP_MRESF_LOCATION},
-            {"P3P",                         HTTP_MRESF_P3P},
-            {"Proxy-Authenticate",          HTTP_MRESF_PROXY_AUTHENTICATE},
-            {"Public-Key-Pins",             HTTP_MRESF_PUBLIC_KEY_PINS},
-            {"Refresh",                     HTTP_MRESF_REFRESH},
-            {"Retry-After",                 HTTP_MRESF_RETRY_AFTER},
-            {"Server",                      HTTP_MRESF_SERVER},
-            {"Set-Cookie",                  HTTP_MRESF_SET_COOKIE},
-            {"Status",                      HTTP_MRESF_STATUS},
-            {"Strict-Transport-Security",   HTTP_MRESF_STRICT_TRANSPORT_SECURITY},
-            {"Trailer",                     HTTP_MRESF_TRAILER},
-            {"Transfer-Encoding",           HTTP_MRESF_TRANSFER_ENCODING},
-            {"TSV",                         HTTP_MRESF_TSV},
-            {"Vary",                        HTTP_MRESF_VARY},
-            {"WWW-Authenticate",            HTTP_MRESF_WWW_AUTHENTICATE},
-            {"X-Frame-Options",             HTTP_MRESF_X_FRAME_OPTIONS},
-            {"X-XSS-Protection",            HTTP_MRESF_NONSTD_X_XSS_PROTECTION},
-            {"Content-Security-Policy",     HTTP_MRESF_NONSTD_CONTENT_SECURITY_POLICY},
-            {"X-Content-Security-Policy",   HTTP_MRESF_NONSTD_X_CONTENT_SECURITY_POLICY},
-            {"X-WebKit-CSP",                HTTP_MRESF_NONSTD_X_WEBKIT_CSP},
-            {"X-Content-Type-Options",      HTTP_MRESF_NONSTD_X_CONTENT_TYPE_OPTIONS},
-            {"X-Powered-By",                HTTP_MRESF_NONSTD_X_POWERED_BY},
-            {"X-UA-Compatible",             HTTP_MRESF_NONSTD_X_UA_COMPATIBLE},
-            {"X-Content-Duration",          HTTP_MRESF_NONSTD_X_CONTENT_DURATION}
-    };
+        struct HmfSlots {
+            int8_t field[kHmfSlotCount];
+            bool perfect;
+        };
+
+        constexpr HmfSlots buildHmfSlots() {
+            HmfSlots slots{};
+            slots.perfect = true;
+
+            for (size_t i = 0; i < kHmfSlotCount; ++i)
+                slots.field[i] = INVALID_HTTP_MSG_FIELD;
+
+            for (size_t i = 0; i < kHmfCount; ++i) {
+                const size_t h = hmfHash(kHmfNames[i]);
+
+                if (slots.field[h] != INVALID_HTTP_MSG_FIELD)
+                    slots.perfect = false;
+
+                slots.field[h] = static_cast<int8_t>(i);
+            }
+
+            return slots;
+        }
+
+        constexpr HmfSlots kHmfSlots = buildHmfSlots();
+
+        static_assert(kHmfSlots.perfect, "kHmfHashSeed is not a perfect hash seed for kHmfNames");
+
+    } /* namespace */
 
     HttpMessage::HttpMessage()
             : type_(INVALID_HTTP_MSG_TYPE) {
+        clearFields();
     }
 
     HttpMessage::~HttpMessage() = default;
 
-    HttpMethodType HttpMessage::toHm(const std::string &k) {
-        auto it = mDescHm.find(k);
-
-        if (it == mDescHm.end())
-            return INVALID_HTTP_METHOD;
+    // 请求方法区分大小写(RFC 7231 4.1)，按长度分派后直接比较
+    HttpMethodType HttpMessage::toHm(std::string_view k) {
+        switch (k.size()) {
+            case 3:
+                if (k == "GET")
+                    return HTTP_METHOD_GET;
+                if (k == "PUT")
+                    return HTTP_METHOD_PUT;
+                break;
+            case 4:
+                if (k == "POST")
+                    return HTTP_METHOD_POST;
+                if (k == "HEAD")
+                    return HTTP_METHOD_HEAD;
+                break;
+            case 5:
+                if (k == "TRACE")
+                    return HTTP_METHOD_TRACE;
+                break;
+            case 6:
+                if (k == "DELETE")
+                    return HTTP_METHOD_DELETE;
+                break;
+            case 7:
+                if (k == "CONNECT")
+                    return HTTP_METHOD_CONNECT;
+                break;
+            default:
+                break;
+        }
 
-        return it->second;
+        return INVALID_HTTP_METHOD;
     }
 
-    HttpMsgField HttpMessage::toHmf(const std::string &k) {
-        auto it = mDescHmf.find(k);
+    HttpMsgField HttpMessage::toHmf(std::string_view k) {
+        if (k.empty())
+            return INVALID_HTTP_MSG_FIELD;
+
+        const int8_t field = kHmfSlots.field[hmfHash(k)];
+
+        if (field == INVALID_HTTP_MSG_FIELD)
+            return INVALID_HTTP_MSG_FIELD;
+
+        const std::string_view name(kHmfNames[field]);
 
-        if (it == mDescHmf.end())
+        if (name.size() != k.size() || !iequals(k, name))
             return INVALID_HTTP_MSG_FIELD;
 
-        return it->second;
+        return static_cast<HttpMsgField>(field);
+    }
+
+    std::string_view HttpMessage::toName(HttpMethodType hm) {
+        if (hm < 0 || static_cast<size_t>(hm) >= kHmCount)
+            return {};
+
+        return kHmNames[hm];
+    }
+
+    std::string_view HttpMessage::toName(HttpMsgField hmf) {
+        if (hmf < 0 || static_cast<size_t>(hmf) >= kHmfCount)
+            return {};
+
+        return kHmfNames[hmf];
     }
 
     void HttpMessage::setVersion(const std::string &v) {
         version_ = v;
     }
 
-    void HttpMessage::addField(HttpMsgField k, const std::string &v) {
-        header_[k] = v;
+    HttpMessage::FieldSpan HttpMessage::appendToBuf(std::string_view s) {
+        const FieldSpan span{static_cast<uint32_t>(headerBuf_.size()),
+                             static_cast<uint32_t>(s.size())};
+        headerBuf_.append(s);
+
+        return span;
+    }
+
+    std::string_view HttpMessage::toView(const FieldSpan &span) const {
+        return std::string_view(headerBuf_.data() + span.offset, span.size);
+    }
+
+    void HttpMessage::addField(HttpMsgField k, std::string_view v) {
+        if (k < 0 || static_cast<size_t>(k) >= kHttpMsgFieldCount)
+            return;
+
+        if (fields_[k].offset == kNoField)
+            fields_[k] = appendToBuf(v);
+        else
+            extraFields_.push_back({k, {kNoField, 0}, appendToBuf(v)});
+    }
+
+    void HttpMessage::addField(std::string_view name, std::string_view v) {
+        const HttpMsgField k = toHmf(name);
+
+        if (k != INVALID_HTTP_MSG_FIELD) {
+            addField(k, v);
+            return;
+        }
+
+        if (name.empty())
+            return;
+
+        const FieldSpan name_span(appendToBuf(name));
+        extraFields_.push_back({INVALID_HTTP_MSG_FIELD, name_span, appendToBuf(v)});
+    }
+
+    void HttpMessage::setField(HttpMsgField k, std::string_view v) {
+        if (k < 0 || static_cast<size_t>(k) >= kHttpMsgFieldCount)
+            return;
+
+        // 旧值仍然占用缓冲区，直到 clearFields
+        extraFields_.erase(std::remove_if(extraFields_.begin(), extraFields_.end(),
+                                          [k](const ExtraField &it) { return it.field == k; }),
+                           extraFields_.end());
+        fields_[k] = appendToBuf(v);
+    }
+
+    void HttpMessage::clearFields() {
+        for (auto &it : fields_)
+            it = {kNoField, 0};
+
+        headerBuf_.clear();
+        extraFields_.clear();
+    }
+
+    void HttpMessage::reserveFields(size_t size) {
+        headerBuf_.reserve(size);
     }
 
     void HttpMessage::setBody(const std::string &v) {
         body_ = v;
     }
 
-    HttpMsgType HttpMessage::type() {
+    void HttpMessage::setBody(std::string &&v) {
+        body_ = std::move(v);
+    }
+
+    HttpMsgType HttpMessage::type() const {
         return type_;
     }
 
-    std::string HttpMessage::version() {
+    const std::string &HttpMessage::version() const {
         return version_;
     }
 
-    std::string HttpMessage::header(const HttpMsgField hmf) {
-        if (header_.find(hmf) == header_.end())
-            return "";
+    std::string_view HttpMessage::header(const HttpMsgField hmf) const {
+        if (hmf < 0 || static_cast<size_t>(hmf) >= kHttpMsgFieldCount
+            || fields_[hmf].offset == kNoField)
+            return {};
+
+        return toView(fields_[hmf]);
+    }
+
+    std::string_view HttpMessage::header(std::string_view name) const {
+        const HttpMsgField k = toHmf(name);
+
+        if (k != INVALID_HTTP_MSG_FIELD)
+            return header(k);
+
+        for (const auto &it : extraFields_) {
+            if (it.field == INVALID_HTTP_MSG_FIELD
+                && it.name.size == name.size() && iequals(toView(it.name), name))
+                return toView(it.value);
+        }
+
+        return {};
+    }
+
+    void HttpMessage::headers(HttpMsgField hmf, std::vector<std::string_view> *values) const {
+        values->clear();
+
+        if (hmf < 0 || static_cast<size_t>(hmf) >= kHttpMsgFieldCount
+            || fields_[hmf].offset == kNoField)
+            return;
+
+        values->push_back(toView(fields_[hmf]));
 
-        return header_[hmf];
+        for (const auto &it : extraFields_) {
+            if (it.field == hmf)
+                values->push_back(toView(it.value));
+        }
     }
 
-    void HttpMessage::header(std::map<HttpMsgField, std::string> *hmf) {
-        *hmf = header_;
+    void HttpMessage::header(std::map<HttpMsgField, std::string> *hmf) const {
+        hmf->clear();
+
+        for (size_t i = 0; i < kHttpMsgFieldCount; ++i) {
+            if (fields_[i].offset != kNoField)
+                (*hmf)[static_cast<HttpMsgField>(i)] = std::string(toView(fields_[i]));
+        }
     }
 
-    std::string HttpMessage::body() {
+    const std::string &HttpMessage::body() const {
         return body_;
     }
 
     HttpRequestMsg::HttpRequestMsg()
-            : method_(INVALID_HTTP_METHOD) {
+            : method_(INVALID_HTTP_METHOD), argsSet_(false), argsState_(kArgsPending) {
         type_ = HTTP_MSG_REQUEST;
     }
 
+    HttpRequestMsg::HttpRequestMsg(const HttpRequestMsg &other)
+            : HttpMessage(other),
+              method_(other.method_),
+              request_url_(other.request_url_),
+              url_(other.url_),
+              argsSet_(other.argsSet_),
+              argsState_(kArgsPending) {
+        // 另一个线程可能正在解码 other.args_，只复制已经完成的结果
+        if (argsSet_ || other.argsState_.load(std::memory_order_acquire) == kArgsDecoded) {
+            args_ = other.args_;
+            argsState_.store(kArgsDecoded, std::memory_order_relaxed);
+        }
+    }
+
+    HttpRequestMsg &HttpRequestMsg::operator=(const HttpRequestMsg &other) {
+        if (this != &other) {
+            HttpMessage::operator=(other);
+            method_ = other.method_;
+            request_url_ = other.request_url_;
+            url_ = other.url_;
+            argsSet_ = other.argsSet_;
+            args_.clear();
+            argsState_.store(kArgsPending, std::memory_order_relaxed);
+
+            if (argsSet_ || other.argsState_.load(std::memory_order_acquire) == kArgsDecoded) {
+                args_ = other.args_;
+                argsState_.store(kArgsDecoded, std::memory_order_relaxed);
+            }
+        }
+
+        return *this;
+    }
+
     HttpRequestMsg::~HttpRequestMsg() = default;
 
     void HttpRequestMsg::setMethod(HttpMethodType v) {
@@ -196,6 +448,7 @@ namespace happycpp::hchttp {
 
     void HttpRequestMsg::setRequestUrl(const std::string &v) {
         request_url_ = v;
+        argsState_.store(kArgsPending, std::memory_order_relaxed);
     }
 
     void HttpRequestMsg::setUrl(const std::string &v) {
@@ -204,22 +457,53 @@ namespace happycpp::hchttp {
 
     void HttpRequestMsg::setArgs(const std::string &v) {
         args_ = v;
+        argsSet_ = true;
     }
 
-    HttpMethodType HttpRequestMsg::method() {
+    HttpMethodType HttpRequestMsg::method() const {
         return method_;
     }
 
-    std::string HttpRequestMsg::requestUrl() {
+    const std::string &HttpRequestMsg::requestUrl() const {
         return request_url_;
     }
 
-    std::string HttpRequestMsg::url() {
+    const std::string &HttpRequestMsg::url() const {
         return url_;
     }
 
-    std::string HttpRequestMsg::args() {
-        return args_;
+    const std::string &HttpRequestMsg::args() const {
+        if (argsSet_)
+            return args_;
+
+        // 多个线程同时第一次调用时，只有一个线程解码，其它线程等待
+        for (;;) {
+            int state = argsState_.load(std::memory_order_acquire);
+
+            if (state == kArgsDecoded)
+                return args_;
+
+            if (state == kArgsPending &&
+                argsState_.compare_exchange_weak(state, kArgsDecoding, std::memory_order_acquire)) {
+                try {
+                    const size_t question = request_url_.find('?');
+                    args_ = question == std::string::npos
+                            ? std::string() : hcurl::decode(std::string_view(request_url_).substr(question + 1));
+                } catch (...) {
+                    argsState_.store(kArgsPending, std::memory_order_release);
+                    throw;
+                }
+
+                argsState_.store(kArgsDecoded, std::memory_order_release);
+                return args_;
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+    QueryArgs HttpRequestMsg::queryArgs() const {
+        return QueryArgs::fromTarget(request_url_);
     }
 
     HttpResponseMsg::HttpResponseMsg()
@@ -241,7 +525,7 @@ namespace happycpp::hchttp {
         return status_;
     }
 
-    std::string HttpResponseMsg::reasonPhrase() {
+    const std::string &HttpResponseMsg::reasonPhrase() const {
         return reasonPhrase_;
     }
 
@@ -249,327 +533,232 @@ namespace happycpp::hchttp {
 
     HttpMsgCtx::~HttpMsgCtx() = default;
 
-    void HttpMsgCtx::parseRequestLine(const std::string &line,
-                                      const HttpMessagePtr &hm) {
-        const std::string ARGS_FLAG("?");
-
-        HttpRequestMsgPtr _hm = std::dynamic_pointer_cast<HttpRequestMsg>(hm);
-
-        std::vector<std::string> start_line_cols;
-        split(line, &start_line_cols, " ");
-
-        if (start_line_cols.size() < 3)
-            return;
-
-        const HttpMethodType method = hm->toHm(start_line_cols[0]);
-
-        if (method == INVALID_HTTP_METHOD)
-            return;
+    //! 将 HttpParser 的回调结果填充到 HttpMessage
+    class HttpMsgCtx::HttpMsgBuilder : public HttpParserHandler {
+    public:
+        explicit HttpMsgBuilder(const HttpMessagePtr &hm)
+                : hm_(hm), parser_(this, hm->type()), startLine_(false), headComplete_(false) {
+        }
 
-        const std::string request_url(start_line_cols[1]);
+        //! 解析起始行和消息头
+        /*!
+         HttpParser 报错时(比如没有冒号的字段行、obs-fold、不规范的状态行)，
+         跳过出错的行，剩余部分按 "\r\n" 宽松地逐行解析，与原来的 parse 一致。
+         * @param http HTTP 消息原始数据
+         * @return 消息体在 http 中的起始位置。消息头不完整时，返回 std::string::npos
+         */
+        size_t parseHead(const std::string &http) {
+            // 字段名和字段值的总长度不会超过消息头的长度，一次分配即可
+            const size_t head_size = http.find("\r\n\r\n");
+            hm_->reserveFields(head_size == std::string::npos ? http.size() : head_size);
 
-        _hm->setMethod(method);
-        _hm->setRequestUrl(request_url);
-        _hm->setVersion(start_line_cols[2]);
+            const size_t pos = parser_.execute(http);
 
-        const size_t args_flag_pos = request_url.find(ARGS_FLAG);
+            if (headComplete_)
+                return pos;
 
-        if (args_flag_pos == std::string::npos) {
-            _hm->setUrl(request_url);
-        } else {
-            _hm->setUrl(request_url.substr(0, args_flag_pos));
+            if (parser_.error() == HTTP_PARSE_OK || head_size == std::string::npos)
+                return std::string::npos;
 
-            const std::string args(
-                    request_url.substr(args_flag_pos + ARGS_FLAG.size()));
-            _hm->setArgs(hcurl::decode(args));
+            return parseHeadLenient(http, pos, head_size);
         }
-    }
 
-    void HttpMsgCtx::parseStatusLine(const std::string &line,
-                                     const HttpMessagePtr &hm) {
-        const char SP = ' ';
-        const size_t SP_SIZE = 1;
+        void onRequestLine(std::string_view method, std::string_view target,
+                           std::string_view version) override {
+            startLine_ = true;
+            parseRequestLine(method, target, version, hm_);
+        }
 
-        HttpResponseMsgPtr _hm = std::dynamic_pointer_cast<HttpResponseMsg>(hm);
+        void onStatusLine(std::string_view version, uint32_t status,
+                          std::string_view reason) override {
+            startLine_ = true;
+            parseStatusLine(version, status, reason, hm_);
+        }
 
-        // 获取版本
-        const size_t version_end_pos = line.find(SP);
-        if (version_end_pos == std::string::npos)
-            return;
-        _hm->setVersion(line.substr(0, version_end_pos));
+        void onHeader(std::string_view name, std::string_view value) override {
+            hm_->addField(name, value);
+        }
 
-        // 获取状态码
-        const size_t status_start_pos = version_end_pos + SP_SIZE;
-        const size_t status_end_pos = line.find(SP, status_start_pos);
-        if (status_end_pos == std::string::npos)
-            return;
+        bool onHeadersComplete() override {
+            // 消息头之后的所有数据都作为消息体，由 parseHead 的调用者处理
+            headComplete_ = true;
+            parser_.pause();
+            return true;
+        }
 
-        const size_t status_size = status_end_pos - status_start_pos;
-        const std::string status(line.substr(status_start_pos, status_size));
-        _hm->setStatus(stoi(status));
+    private:
+        //! 从 pos 开始宽松地解析剩余的消息头，返回消息体的起始位置
+        size_t parseHeadLenient(const std::string &http, size_t pos, size_t head_size) {
+            const std::string_view head(http.data(), head_size);
 
-        // 获取原因简述
-        const size_t rp_start_pos = status_end_pos + SP_SIZE;
-        _hm->setReasonPhrase(line.substr(rp_start_pos));
-    }
+            // 起始行本身出错时，按空格分割
+            if (!startLine_) {
+                const std::string_view line(head.substr(0, head.find("\r\n")));
 
-    HttpMessagePtr HttpMsgCtx::initHm(const std::string &http) {
-        const std::string FLAG("HTTP");
-        const size_t FLAG_SIZE = 4;
+                if (hm_->type() == HTTP_MSG_REQUEST)
+                    parseRequestLineLenient(line);
+                else
+                    parseStatusLineLenient(line);
+            }
 
-        const std::string s(http.substr(0, FLAG_SIZE));
-        const size_t pos = s.find(FLAG);
+            while (pos < head_size) {
+                size_t line_end = head.find("\r\n", pos);
 
-        HttpMessagePtr _hm;
+                if (line_end == std::string_view::npos)
+                    line_end = head_size;
 
-        if (pos == std::string::npos)
-            _hm = std::make_shared<HttpRequestMsg>();
-        else
-            _hm = std::make_shared<HttpResponseMsg>();
+                const std::string_view line(head.substr(pos, line_end - pos));
+                pos = line_end + 2;
 
-        return _hm;
-    }
+                // 没有冒号的行和 obs-fold 的续行直接跳过
+                const size_t colon = line.find(':');
 
-    void HttpMsgCtx::parseStartLine(const std::string &line, const HttpMessagePtr &hm) {
-        if (hm->type() == HTTP_MSG_REQUEST)
-            parseRequestLine(line, hm);
-        else
-            parseStatusLine(line, hm);
-    }
+                if (colon == std::string_view::npos || colon == 0
+                    || line.front() == ' ' || line.front() == '\t')
+                    continue;
 
-    void HttpMsgCtx::parseHeader(const std::string &header, const HttpMessagePtr &hm) {
-        const std::string FIELD_FLAG(": ");
-        const size_t FIELD_FLAG_SIZE = 2;
+                const std::string_view name(line.substr(0, colon));
 
-        std::vector<std::string> field_lines;
-        split(header, &field_lines, "\r\n");
+                if (name.back() == ' ' || name.back() == '\t')
+                    continue;
 
-        if (field_lines.size() < 3)
-            return;
+                hm_->addField(name, detail::trimOws(line.substr(colon + 1)));
+            }
 
-        size_t field_pos = std::string::npos;
+            return head_size + 4;
+        }
 
-        for (const auto &it : field_lines) {
-            field_pos = it.find(FIELD_FLAG);
+        void parseRequestLineLenient(std::string_view line) {
+            const size_t method_end = line.find(' ');
 
-            if (field_pos == std::string::npos)
-                continue;
+            if (method_end == std::string_view::npos)
+                return;
 
-            const std::string name(it.substr(0, field_pos));
-            const std::string value(it.substr(field_pos + FIELD_FLAG_SIZE));
+            const size_t target_end = line.find(' ', method_end + 1);
 
-            const HttpMsgField field = hm->toHmf(name);
+            if (target_end == std::string_view::npos)
+                return;
 
-            if (field != INVALID_HTTP_MSG_FIELD)
-                hm->addField(field, value);
+            parseRequestLine(line.substr(0, method_end),
+                             line.substr(method_end + 1, target_end - method_end - 1),
+                             line.substr(target_end + 1), hm_);
         }
-    }
 
-    void HttpMsgCtx::parseBody(const std::string &body, const HttpMessagePtr &hm) {
-        hm->setBody(body);
-    }
+        void parseStatusLineLenient(std::string_view line) {
+            const size_t version_end = line.find(' ');
 
-    HttpMessagePtr HttpMsgCtx::parse(const std::string &http) {
-        HttpMessagePtr hm;
-        const std::string TWO_CRLF("\r\n\r\n");
-        const size_t TWO_CRLF_SIZE = 4;
+            if (version_end == std::string_view::npos)
+                return;
 
-        const std::string CRLF("\r\n");
-        const size_t CRLF_SIZE = 2;
+            // 状态码之后可以没有原因简述，状态码不是数字时为 0
+            const std::string_view rest(line.substr(version_end + 1));
+            const size_t status_end = rest.find(' ');
+            const std::string_view status_str(rest.substr(0, status_end));
+            uint32_t status = 0;
 
-        // 50 只是很随意的一个数字
-        if (http.size() < 50)
-            return hm;
+            for (const char c : status_str) {
+                if (c < '0' || c > '9' || status > 99999) {
+                    status = 0;
+                    break;
+                }
 
-        hm = initHm(http);
+                status = status * 10 + static_cast<uint32_t>(c - '0');
+            }
 
-        // 1. 获取起始行
-        const size_t start_line_pos = http.find(CRLF);
+            parseStatusLine(line.substr(0, version_end), status,
+                            status_end == std::string_view::npos
+                            ? std::string_view() : rest.substr(status_end + 1), hm_);
+        }
 
-        if (start_line_pos == std::string::npos)
-            return hm;
+        const HttpMessagePtr &hm_;
+        HttpParser parser_;
+        bool startLine_;
+        bool headComplete_;
+    };
 
-        const std::string start_line(http.substr(0, start_line_pos));
-        parseStartLine(start_line, hm);
+    void HttpMsgCtx::parseRequestLine(std::string_view method,
+                                      std::string_view target,
+                                      std::string_view version,
+                                      const HttpMessagePtr &hm) {
+        const char ARGS_FLAG = '?';
 
-        // 2. 获取消息头内容
-        const size_t body_pos = http.find(TWO_CRLF);
+        HttpRequestMsgPtr _hm = std::dynamic_pointer_cast<HttpRequestMsg>(hm);
 
-        if (body_pos == std::string::npos)
-            return hm;
+        const HttpMethodType _method = hm->toHm(method);
 
-        const std::string header(http.substr(start_line_pos + CRLF_SIZE, body_pos));
-        parseHeader(header, hm);
+        if (_method == INVALID_HTTP_METHOD)
+            return;
 
-        // 3. 获取消息体
-        parseBody(http.substr(body_pos + TWO_CRLF_SIZE), hm);
+        _hm->setMethod(_method);
+        _hm->setRequestUrl(std::string(target));
+        _hm->setVersion(std::string(version));
 
-        return hm;
-    }
+        const size_t args_flag_pos = target.find(ARGS_FLAG);
 
-/*根据uri，返回对应的mime type*/
-    std::string getMimeType(const std::string &uri,
-                            const std::string &charset) {
-        typedef std::map<std::string, std::string> mime_t;
-        mime_t mime_types;
-        mime_t::iterator it;
-        const std::string _charset(charset.empty() ? "utf-8" : charset);
-        mime_types["txt"] = "text/plain; charset=iso-8859-1";
-        mime_types["text"] = "text/plain; charset=iso-8859-1";
-        mime_types["htm"] = "text/html; charset=" + _charset;
-        mime_types["html"] = "text/html; charset=" + _charset;
-        mime_types["xml"] = "text/xml; charset=" + _charset;
-        mime_types["jpg"] = "image/jpeg";
-        mime_types["jpeg"] = "image/jpeg";
-        mime_types["gif"] = "image/gif";
-        mime_types["png"] = "image/png";
-        mime_types["css"] = "text/css";
-        mime_types["js"] = "image/javascript";
-        mime_types["cgi"] = "cgi";
-        mime_types["swf"] = "application/x-shockwave-flash";
-
-        /*例如：
-         * http://www.foo.com/image/logo.gif
-         * 取最后的扩展名 gif */
-        size_t last_dot = uri.find_last_of('.');
-        const std::string ext_name = trim(uri.substr(last_dot + 1));
-
-        std::string mime_type("application/octet-stream");
-
-        /*如果在map中存在key对应的值，则返回，否则返回空字符串*/
-        if (mime_types.find(ext_name) != mime_types.end())
-            mime_type = mime_types[ext_name];
-
-        return mime_type;
-    }
-
-    size_t CallbackWriteFunc(void *ptr, size_t size,
-                             size_t nmemb, std::string *data) {
-        data->append(reinterpret_cast<char *>(ptr), size * nmemb);
-        return size * nmemb;
+        // 查询字符串保留在 requestUrl 中，读取 args() 或者 queryArgs() 时才解码
+        _hm->setUrl(std::string(target.substr(0, args_flag_pos)));
     }
 
-    HttpResponseMsgPtr getHeaderInfo(const std::string &url) {
-        std::string header;
-        auto curl = curl_easy_init();
-        HAPPY_ASSERT(curl);
-
-        // 响应内容不包含 HTTP 头
-        curl_easy_setopt(curl, CURLOPT_HEADER, 0L);
-        // 禁止检查服务器SSL证书中是否存在一个公用名(common name)
-        // 禁止检查公用名是否存在，并且是否与提供的主机名匹配
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-        // 禁用服务端验证。
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, CallbackWriteFunc);
-        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &header);
-        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
-
-        const bool ret = curl_easy_perform(curl);
-        curl_easy_cleanup(curl);
-
-        if (ret == CURLE_OK) {
-            HttpMsgCtx ctx;
-            HttpResponseMsgPtr hm =
-                    std::dynamic_pointer_cast<HttpResponseMsg>(ctx.parse(header));
-            return hm;
-        }
+    void HttpMsgCtx::parseStatusLine(std::string_view version,
+                                     uint32_t status,
+                                     std::string_view reason,
+                                     const HttpMessagePtr &hm) {
+        HttpResponseMsgPtr _hm = std::dynamic_pointer_cast<HttpResponseMsg>(hm);
 
-        ThrowHappyException("Cannot get http header information.");
+        _hm->setVersion(std::string(version));
+        _hm->setStatus(status);
+        _hm->setReasonPhrase(std::string(reason));
     }
 
-    namespace hcurl {
-
-        uint8_t to_hex(const uint8_t &x);
-
-        char char_to_int(char ch);
-
-        char str_to_bin(char *str);
-
-        uint8_t to_hex(const uint8_t &x) {
-            return x > 9 ? x + 55 : x + 48;
-        }
+    HttpMessagePtr HttpMsgCtx::initHm(const std::string &http) {
+        const std::string FLAG("HTTP");
+        const size_t FLAG_SIZE = 4;
 
-        char char_to_int(char ch) {
-            if (ch >= '0' && ch <= '9')
-                return static_cast<char>(ch - '0');
-            if (ch >= 'a' && ch <= 'f')
-                return static_cast<char>(ch - 'a' + 10);
-            if (ch >= 'A' && ch <= 'F')
-                return static_cast<char>(ch - 'A' + 10);
+        const std::string s(http.substr(0, FLAG_SIZE));
+        const size_t pos = s.find(FLAG);
 
-            return -1;
-        }
+        HttpMessagePtr _hm;
 
-        char str_to_bin(char *str) {
-            char temp_word[2];
-            char chn;
+        if (pos == std::string::npos)
+            _hm = std::make_shared<HttpRequestMsg>();
+        else
+            _hm = std::make_shared<HttpResponseMsg>();
 
-            /* make the B to 11 -- 00001011 */
-            temp_word[0] = char_to_int(str[0]);
-            /* make the 0 to 0  -- 00000000 */
-            temp_word[1] = char_to_int(str[1]);
-            /* to change the BO to 10110000 */
-            chn = temp_word[0] << 4 | temp_word[1]; // NOLINT
+        return _hm;
+    }
 
-            return chn;
-        }
+    HttpMessagePtr HttpMsgCtx::parse(const std::string &http) {
+        HttpMessagePtr hm;
 
-        std::string encode(const std::string &s) {
-            std::string val;
+        // 50 只是很随意的一个数字
+        if (http.size() < 50)
+            return hm;
 
-            if (s.empty())
-                return val;
+        hm = initHm(http);
 
-            uint8_t uc;
+        HttpMsgBuilder builder(hm);
+        const size_t body_pos = builder.parseHead(http);
 
-            for (char i : s) {
-                uc = static_cast<uint8_t>(i);
+        if (body_pos != std::string::npos)
+            hm->setBody(http.substr(body_pos));
 
-                if (isalnum(uc) || uc == '-' || uc == '_' || uc == '.' || uc == '~') {
-                    val.push_back(i);
-                } else if (isspace(uc)) {
-                    val.push_back('+');
-                } else {
-                    val.push_back('%');
-                    val.push_back(to_hex(uc >> 4));
-                    val.push_back(to_hex(uc % 16));
-                }
-            }
+        return hm;
+    }
 
-            return val;
-        }
+    std::string getMimeType(const std::string &uri,
+                            const std::string &charset) {
+        return std::string(hcmime::fromUri(uri, charset));
+    }
 
-        std::string decode(const std::string &s) {
-            std::string val;
-
-            if (s.empty())
-                return val;
-
-            char buf[2];
-            size_t i = 0;
-            const size_t len = s.size();
-
-            while (i < len) {
-                if (s[i] == '%') {
-                    buf[0] = s[i + 1];
-                    buf[1] = s[i + 2];
-                    val.push_back(str_to_bin(buf));
-                    i += 3;
-                } else if (s[i] == '+') {
-                    val.push_back(' ');
-                    ++i;
-                } else {
-                    val.push_back(s[i]);
-                    ++i;
-                }
-            }
+    HttpResponseMsgPtr getHeaderInfo(const std::string &url) {
+        // 所有调用共用一个 HttpClient，同一主机的连接和 TLS 会话可以复用
+        static HttpClient client;
 
-            return val;
+        try {
+            return client.head(url).get();
+        } catch (const HappyException &e) {
+            ThrowHappyException(std::string("Cannot get http header information: ") + e.what());
         }
-
-    } /*namespace hcurl*/
+    }
 
 } /* namespace happycpp */
@@ -0,0 +1,786 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/http/client.h"
+#include "happycpp/http/parser.h"
+#include "happycpp/exception.h"
+#include "happycpp/log.h"
+#include <curl/curl.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// curl_multi_poll 和 curl_multi_wakeup 从 libcurl 7.68.0 开始提供。
+// 更早的版本使用 curl_multi_wait，后台线程通过管道唤醒
+#if LIBCURL_VERSION_NUM >= 0x074400
+#define HAPPYCPP_HAVE_CURL_MULTI_POLL 1
+#elif defined(PLATFORM_WIN32)
+#error "HttpClient requires libcurl 7.68.0 or later on Windows."
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace happycpp::hchttp {
+
+    namespace {
+
+        const char *const kInvalidMethod = "Invalid http method.";
+        const char *const kInvalidResponse = "Invalid http response header.";
+        const char *const kClientDestroyed = "HttpClient has been destroyed.";
+
+        std::once_flag curlInitFlag;
+
+        // curl_global_init 不是线程安全的，只能调用一次
+        void initCurl() {
+            std::call_once(curlInitFlag, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+        }
+
+        // 等待 multi 句柄上的事件或者 extra 中的描述符可读，最多 timeoutMs 毫秒
+        void pollMulti(CURLM *multi, curl_waitfd *extra, unsigned int count, int timeoutMs) {
+#ifdef HAPPYCPP_HAVE_CURL_MULTI_POLL
+            curl_multi_poll(multi, extra, count, timeoutMs, nullptr);
+#else
+            // 没有可以等待的套接字时(比如正在解析域名)，curl_multi_wait 立刻返回，
+            // 睡眠一小段时间，避免空转
+            int numfds = 0;
+
+            if (curl_multi_wait(multi, extra, count, timeoutMs, &numfds) != CURLM_OK || numfds == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+#endif
+        }
+
+        // libcurl 逐行输出响应头，直接交给 HttpParser 解析为 HttpResponseMsg
+        class ResponseBuilder : public HttpParserHandler {
+        public:
+            ResponseBuilder() : parser_(this, HTTP_MSG_RESPONSE), contentLength_(-1) {}
+
+            void feed(std::string_view line) {
+                // chunked 响应的 trailer 也会输出到这里，解析失败之后的数据直接忽略
+                if (parser_.error() == HTTP_PARSE_OK)
+                    parser_.execute(line);
+            }
+
+            // 100-continue、重定向等会产生多个响应头，只保留最后一个
+            void onStatusLine(std::string_view version,
+                              uint32_t status,
+                              std::string_view reason) override {
+                resp_ = std::make_shared<HttpResponseMsg>();
+                resp_->setVersion(std::string(version));
+                resp_->setStatus(status);
+                resp_->setReasonPhrase(std::string(reason));
+            }
+
+            void onHeader(std::string_view name, std::string_view value) override {
+                resp_->addField(name, value);
+            }
+
+            // 消息体由 libcurl 单独输出，每个响应头都视为一条完整的消息
+            bool onHeadersComplete() override {
+                contentLength_ = parser_.contentLength();
+                return true;
+            }
+
+            //! 最后一个响应头中 Content-Length 字段的值，不存在时为 -1
+            [[nodiscard]] int64_t contentLength() const {
+                return contentLength_;
+            }
+
+            void reset() {
+                parser_.reset();
+                resp_.reset();
+                contentLength_ = -1;
+            }
+
+            HttpResponseMsgPtr take() {
+                return std::move(resp_);
+            }
+
+        private:
+            HttpParser parser_;
+            HttpResponseMsgPtr resp_;
+            int64_t contentLength_;
+        };
+
+        // probeUrls 的一个并发槽位，请求结束后用于下一个 URL
+        struct ProbeSlot {
+            CURL *easy = nullptr;
+            size_t index = 0;
+            ResponseBuilder builder;
+            char error[CURL_ERROR_SIZE] = {0};
+        };
+
+        // 析构时释放 probeUrls 使用的 libcurl 句柄，callback 抛出异常时也不会泄漏
+        class ProbeContext {
+        public:
+            CURLM *multi;
+            CURLSH *share;
+            std::vector<std::unique_ptr<ProbeSlot>> slots;
+
+            ProbeContext() : multi(curl_multi_init()), share(curl_share_init()) {
+                HAPPY_ASSERT(multi);
+                HAPPY_ASSERT(share);
+            }
+
+            ~ProbeContext() {
+                for (const auto &slot : slots) {
+                    curl_multi_remove_handle(multi, slot->easy);
+                    curl_easy_cleanup(slot->easy);
+                }
+
+                curl_multi_cleanup(multi);
+                curl_share_cleanup(share);
+            }
+        };
+
+        size_t onProbeHeader(char *ptr, size_t size, size_t nmemb, void *userdata) {
+            const size_t n = size * nmemb;
+            static_cast<ProbeSlot *>(userdata)->builder.feed(std::string_view(ptr, n));
+            return n;
+        }
+
+        // 探测只关心响应头，丢弃消息体
+        size_t onProbeBody(char *, size_t size, size_t nmemb, void *) {
+            return size * nmemb;
+        }
+
+        int64_t infoUs(CURL *easy, CURLINFO info) {
+            curl_off_t v = 0;
+            curl_easy_getinfo(easy, info, &v);
+            return static_cast<int64_t>(v);
+        }
+
+        // libcurl 返回的是从请求开始累计的时间，转换为每个阶段的耗时
+        ProbeTiming probeTiming(CURL *easy) {
+            const int64_t dns = infoUs(easy, CURLINFO_NAMELOOKUP_TIME_T);
+            const int64_t connect = infoUs(easy, CURLINFO_CONNECT_TIME_T);
+            const int64_t tls = infoUs(easy, CURLINFO_APPCONNECT_TIME_T);
+            const int64_t firstByte = infoUs(easy, CURLINFO_STARTTRANSFER_TIME_T);
+            const int64_t ready = std::max(connect, tls);
+
+            ProbeTiming t;
+            t.dnsUs = dns;
+            t.connectUs = connect > dns ? connect - dns : 0;
+            t.tlsUs = tls > connect ? tls - connect : 0;
+            t.firstByteUs = firstByte > ready ? firstByte - ready : 0;
+            t.totalUs = infoUs(easy, CURLINFO_TOTAL_TIME_T);
+            return t;
+        }
+
+    } /* namespace */
+
+    //! 一个请求在后台线程中的全部状态，地址在请求结束之前不能改变
+    struct HttpClientTransfer {
+        HttpClientRequest req;
+        HttpClientCallback cb; /*! 为空时，结果通过 promise 返回 */
+        std::promise<HttpResponseMsgPtr> promise;
+        CURL *easy = nullptr;
+        curl_slist *headers = nullptr;
+        ResponseBuilder builder;
+        StringSink defaultSink; /*! 没有指定 req.sink 时使用 */
+        BodySink *sink = nullptr;
+        bool sinkBegun = false;
+        char error[CURL_ERROR_SIZE] = {0};
+    };
+
+    typedef std::unique_ptr<HttpClientTransfer> HttpClientTransferPtr;
+
+    class HttpClientImpl {
+    public:
+        explicit HttpClientImpl(const HttpClientOptions &options);
+
+        ~HttpClientImpl();
+
+        void submit(HttpClientTransferPtr t);
+
+        [[nodiscard]] size_t pending() const;
+
+    private:
+        HttpClientOptions options_;
+        happycpp::log::HappyLog &hlog_;
+        CURLM *multi_;
+        CURLSH *share_;
+        std::vector<CURL *> idle_; /*! 空闲的 curl 句柄，只在后台线程中访问 */
+        std::unordered_map<CURL *, HttpClientTransferPtr> running_; /*! 只在后台线程中访问 */
+        std::atomic<size_t> pending_;
+
+        mutable std::mutex mutex_;
+        std::vector<HttpClientTransferPtr> queue_; /*! 等待后台线程处理的请求 */
+        bool stop_;
+
+        std::thread worker_;
+
+#ifndef HAPPYCPP_HAVE_CURL_MULTI_POLL
+        int wakeupFds_[2]; /*! 没有 curl_multi_wakeup 时，写入 wakeupFds_[1] 唤醒后台线程 */
+#endif
+
+        static size_t onHeaderData(char *ptr, size_t size, size_t nmemb, void *userdata);
+
+        static size_t onBodyData(char *ptr, size_t size, size_t nmemb, void *userdata);
+
+        void run();
+
+        //! 唤醒在 wait 中等待的后台线程，可以在任意线程中调用
+        void wakeup();
+
+        //! 后台线程等待传输事件或者 wakeup，最多等待 1 秒
+        void wait();
+
+        CURL *acquire();
+
+        void release(CURL *easy);
+
+        void start(HttpClientTransferPtr t);
+
+        void finish(CURL *easy, CURLcode result);
+
+        void complete(const HttpClientTransferPtr &t,
+                      HttpResponseMsgPtr resp,
+                      const std::string &error);
+    };
+
+    HttpClientImpl::HttpClientImpl(const HttpClientOptions &options)
+            : options_(options),
+              hlog_(happycpp::log::HappyLog::instance()),
+              multi_(nullptr),
+              share_(nullptr),
+              pending_(0),
+              stop_(false) {
+        initCurl();
+
+        multi_ = curl_multi_init();
+        HAPPY_ASSERT(multi_);
+
+        curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(multi_, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                          static_cast<long>(options_.maxConnections));
+        curl_multi_setopt(multi_, CURLMOPT_MAX_HOST_CONNECTIONS,
+                          static_cast<long>(options_.maxHostConnections));
+
+        // 连接缓存属于 multi 句柄，TLS 会话和 DNS 缓存通过 share 句柄在请求之间共享。
+        // 只有后台线程使用这些句柄，不需要设置锁
+        share_ = curl_share_init();
+        HAPPY_ASSERT(share_);
+
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+
+#ifndef HAPPYCPP_HAVE_CURL_MULTI_POLL
+        // 两端都不阻塞：管道写满时已经有未处理的唤醒，读取时一次读完
+        const int ret = pipe2(wakeupFds_, O_NONBLOCK | O_CLOEXEC);
+        HAPPY_ASSERT(ret == 0);
+#endif
+
+        worker_ = std::thread(&HttpClientImpl::run, this);
+    }
+
+    HttpClientImpl::~HttpClientImpl() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+
+        wakeup();
+        worker_.join();
+
+        for (auto easy : idle_)
+            curl_easy_cleanup(easy);
+
+        curl_multi_cleanup(multi_);
+        curl_share_cleanup(share_);
+
+#ifndef HAPPYCPP_HAVE_CURL_MULTI_POLL
+        close(wakeupFds_[0]);
+        close(wakeupFds_[1]);
+#endif
+    }
+
+    void HttpClientImpl::submit(HttpClientTransferPtr t) {
+        ++pending_;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(std::move(t));
+        }
+
+        wakeup();
+    }
+
+    void HttpClientImpl::wakeup() {
+#ifdef HAPPYCPP_HAVE_CURL_MULTI_POLL
+        curl_multi_wakeup(multi_);
+#else
+        const char c = 0;
+        [[maybe_unused]] const ssize_t ret = write(wakeupFds_[1], &c, 1);
+#endif
+    }
+
+    void HttpClientImpl::wait() {
+#ifdef HAPPYCPP_HAVE_CURL_MULTI_POLL
+        pollMulti(multi_, nullptr, 0, 1000);
+#else
+        curl_waitfd fd;
+        fd.fd = wakeupFds_[0];
+        fd.events = CURL_WAIT_POLLIN;
+        fd.revents = 0;
+
+        pollMulti(multi_, &fd, 1, 1000);
+
+        if (fd.revents != 0) {
+            char buf[64];
+
+            while (read(wakeupFds_[0], buf, sizeof(buf)) > 0) {
+            }
+        }
+#endif
+    }
+
+    size_t HttpClientImpl::pending() const {
+        return pending_;
+    }
+
+    size_t HttpClientImpl::onHeaderData(char *ptr, size_t size, size_t nmemb, void *userdata) {
+        const size_t n = size * nmemb;
+        static_cast<HttpClientTransfer *>(userdata)->builder.feed(std::string_view(ptr, n));
+        return n;
+    }
+
+    size_t HttpClientImpl::onBodyData(char *ptr, size_t size, size_t nmemb, void *userdata) {
+        auto *t = static_cast<HttpClientTransfer *>(userdata);
+        const size_t n = size * nmemb;
+
+        // 第一块消息体到达时，最终响应的响应头已经解析完成
+        if (!t->sinkBegun) {
+            t->sink->begin(t->builder.contentLength());
+            t->sinkBegun = true;
+        }
+
+        // 返回值不等于 n 时，libcurl 以 CURLE_WRITE_ERROR 中止传输
+        return t->sink->write(ptr, n) ? n : 0;
+    }
+
+    void HttpClientImpl::run() {
+        std::vector<HttpClientTransferPtr> incoming;
+
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                incoming.swap(queue_);
+
+                if (stop_)
+                    break;
+            }
+
+            for (auto &t : incoming)
+                start(std::move(t));
+
+            incoming.clear();
+
+            int running = 0;
+            curl_multi_perform(multi_, &running);
+
+            int left = 0;
+            CURLMsg *msg;
+
+            while ((msg = curl_multi_info_read(multi_, &left)) != nullptr) {
+                if (msg->msg == CURLMSG_DONE)
+                    finish(msg->easy_handle, msg->data.result);
+            }
+
+            // 有新请求时，被 wakeup 唤醒
+            wait();
+        }
+
+        for (auto &t : incoming)
+            complete(t, nullptr, kClientDestroyed);
+
+        for (auto &it : running_) {
+            curl_multi_remove_handle(multi_, it.first);
+            complete(it.second, nullptr, kClientDestroyed);
+            curl_slist_free_all(it.second->headers);
+            release(it.first);
+        }
+
+        running_.clear();
+    }
+
+    CURL *HttpClientImpl::acquire() {
+        if (idle_.empty())
+            return curl_easy_init();
+
+        CURL *easy = idle_.back();
+        idle_.pop_back();
+        return easy;
+    }
+
+    void HttpClientImpl::release(CURL *easy) {
+        // 重置选项，但保留句柄内部的缓冲区
+        curl_easy_reset(easy);
+
+        if (idle_.size() < options_.maxPoolSize)
+            idle_.push_back(easy);
+        else
+            curl_easy_cleanup(easy);
+    }
+
+    void HttpClientImpl::start(HttpClientTransferPtr t) {
+        const HttpClientRequest &req = t->req;
+
+        if (req.method == INVALID_HTTP_METHOD) {
+            complete(t, nullptr, kInvalidMethod);
+            return;
+        }
+
+        CURL *easy = acquire();
+
+        if (easy == nullptr) {
+            complete(t, nullptr, "Cannot create curl handle.");
+            return;
+        }
+
+        t->easy = easy;
+        t->sink = req.sink ? req.sink.get() : &t->defaultSink;
+
+        curl_easy_setopt(easy, CURLOPT_SHARE, share_);
+        curl_easy_setopt(easy, CURLOPT_URL, req.url.c_str());
+        curl_easy_setopt(easy, CURLOPT_PRIVATE, t.get());
+        curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, t->error);
+        // 多线程环境下，禁止 libcurl 使用信号处理超时
+        curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, onHeaderData);
+        curl_easy_setopt(easy, CURLOPT_HEADERDATA, t.get());
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, onBodyData);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, t.get());
+
+        const long verify = options_.verifyPeer ? 1L : 0L;
+        curl_easy_setopt(easy, CURLOPT_SSL_VERIFYPEER, verify);
+        curl_easy_setopt(easy, CURLOPT_SSL_VERIFYHOST, verify * 2);
+
+        const uint32_t timeout = req.timeoutMs > 0 ? req.timeoutMs : options_.timeoutMs;
+        curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, static_cast<long>(timeout));
+        curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT_MS,
+                         static_cast<long>(options_.connectTimeoutMs));
+
+        switch (req.method) {
+            case HTTP_METHOD_GET:
+                curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L);
+                break;
+            case HTTP_METHOD_HEAD:
+                curl_easy_setopt(easy, CURLOPT_NOBODY, 1L);
+                break;
+            case HTTP_METHOD_POST:
+                curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE_LARGE,
+                                 static_cast<curl_off_t>(req.body.size()));
+                curl_easy_setopt(easy, CURLOPT_POSTFIELDS, req.body.data());
+                break;
+            default:
+                // toName 返回的是字符串常量，以 '\0' 结尾
+                curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, HttpMessage::toName(req.method).data());
+
+                if (!req.body.empty()) {
+                    curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE_LARGE,
+                                     static_cast<curl_off_t>(req.body.size()));
+                    curl_easy_setopt(easy, CURLOPT_POSTFIELDS, req.body.data());
+                }
+                break;
+        }
+
+        for (const auto &h : req.headers)
+            t->headers = curl_slist_append(t->headers, h.c_str());
+
+        if (t->headers != nullptr)
+            curl_easy_setopt(easy, CURLOPT_HTTPHEADER, t->headers);
+
+        const CURLMcode ret = curl_multi_add_handle(multi_, easy);
+
+        if (ret != CURLM_OK) {
+            curl_slist_free_all(t->headers);
+            release(easy);
+            complete(t, nullptr, curl_multi_strerror(ret));
+            return;
+        }
+
+        running_.emplace(easy, std::move(t));
+    }
+
+    void HttpClientImpl::finish(CURL *easy, CURLcode result) {
+        curl_multi_remove_handle(multi_, easy);
+
+        auto it = running_.find(easy);
+        HAPPY_ASSERT(it != running_.end());
+
+        HttpClientTransferPtr t(std::move(it->second));
+        running_.erase(it);
+
+        curl_slist_free_all(t->headers);
+        release(easy);
+
+        if (result != CURLE_OK) {
+            complete(t, nullptr, t->error[0] != '\0' ? t->error : curl_easy_strerror(result));
+            return;
+        }
+
+        HttpResponseMsgPtr resp(t->builder.take());
+
+        if (!resp) {
+            complete(t, nullptr, kInvalidResponse);
+            return;
+        }
+
+        if (!t->sinkBegun)
+            t->sink->begin(t->builder.contentLength());
+
+        if (!t->sink->finish()) {
+            complete(t, nullptr, "Cannot finish writing the response body.");
+            return;
+        }
+
+        if (t->sink == &t->defaultSink)
+            resp->setBody(t->defaultSink.take());
+
+        complete(t, std::move(resp), "");
+    }
+
+    void HttpClientImpl::complete(const HttpClientTransferPtr &t,
+                                  HttpResponseMsgPtr resp,
+                                  const std::string &error) {
+        --pending_;
+
+        // 后台线程不能保留响应的引用，future 返回时调用者持有唯一的引用
+        if (!t->cb) {
+            if (error.empty())
+                t->promise.set_value(std::move(resp));
+            else
+                t->promise.set_exception(std::make_exception_ptr(HappyException(error)));
+
+            return;
+        }
+
+        // 回调抛出的异常不能影响其它请求
+        try {
+            t->cb(resp, error);
+        } catch (const std::exception &e) {
+            hlog_.error(e);
+        } catch (...) {
+            hlog_.error("HttpClient callback threw an unknown exception.");
+        }
+    }
+
+    HttpClient::HttpClient(const HttpClientOptions &options)
+            : impl_(new HttpClientImpl(options)) {
+    }
+
+    HttpClient::~HttpClient() = default;
+
+    void HttpClient::request(const HttpClientRequest &req, HttpClientCallback cb) {
+        HttpClientTransferPtr t(new HttpClientTransfer);
+        t->req = req;
+        t->cb = std::move(cb);
+        impl_->submit(std::move(t));
+    }
+
+    std::future<HttpResponseMsgPtr> HttpClient::request(const HttpClientRequest &req) {
+        HttpClientTransferPtr t(new HttpClientTransfer);
+        t->req = req;
+
+        std::future<HttpResponseMsgPtr> future(t->promise.get_future());
+        impl_->submit(std::move(t));
+        return future;
+    }
+
+    std::future<HttpResponseMsgPtr> HttpClient::get(const std::string &url) {
+        HttpClientRequest req;
+        req.url = url;
+        return request(req);
+    }
+
+    void HttpClient::get(const std::string &url, HttpClientCallback cb) {
+        HttpClientRequest req;
+        req.url = url;
+        request(req, std::move(cb));
+    }
+
+    std::future<HttpResponseMsgPtr> HttpClient::head(const std::string &url) {
+        HttpClientRequest req;
+        req.method = HTTP_METHOD_HEAD;
+        req.url = url;
+        return request(req);
+    }
+
+    void HttpClient::head(const std::string &url, HttpClientCallback cb) {
+        HttpClientRequest req;
+        req.method = HTTP_METHOD_HEAD;
+        req.url = url;
+        request(req, std::move(cb));
+    }
+
+    std::future<HttpResponseMsgPtr> HttpClient::post(const std::string &url,
+                                                     const std::string &body,
+                                                     const std::string &contentType) {
+        HttpClientRequest req;
+        req.method = HTTP_METHOD_POST;
+        req.url = url;
+        req.body = body;
+        req.headers.push_back("Content-Type: " + contentType);
+        return request(req);
+    }
+
+    void HttpClient::post(const std::string &url,
+                          const std::string &body,
+                          const std::string &contentType,
+                          HttpClientCallback cb) {
+        HttpClientRequest req;
+        req.method = HTTP_METHOD_POST;
+        req.url = url;
+        req.body = body;
+        req.headers.push_back("Content-Type: " + contentType);
+        request(req, std::move(cb));
+    }
+
+    size_t HttpClient::pending() const {
+        return impl_->pending();
+    }
+
+    size_t probeUrls(const std::vector<std::string> &urls, const ProbeOptions &options) {
+        if (options.method == INVALID_HTTP_METHOD)
+            ThrowHappyException(kInvalidMethod);
+
+        if (urls.empty())
+            return 0;
+
+        initCurl();
+
+        ProbeContext ctx;
+        curl_multi_setopt(ctx.multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+                          static_cast<long>(options.maxHostConnections));
+        curl_share_setopt(ctx.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(ctx.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+
+        size_t next = 0;
+        size_t active = 0;
+        size_t responded = 0;
+
+        // 用 slot 开始下一个 URL。加入 multi 句柄失败的 URL 直接返回错误，槽位留给之后的 URL
+        const auto start = [&](ProbeSlot *slot) {
+            while (next < urls.size()) {
+                slot->index = next++;
+                slot->builder.reset();
+                slot->error[0] = '\0';
+                curl_easy_setopt(slot->easy, CURLOPT_URL, urls[slot->index].c_str());
+                const CURLMcode code = curl_multi_add_handle(ctx.multi, slot->easy);
+
+                if (code == CURLM_OK) {
+                    ++active;
+                    return;
+                }
+
+                ProbeResult r;
+                r.index = slot->index;
+                r.error = curl_multi_strerror(code);
+
+                if (options.callback)
+                    options.callback(r);
+            }
+        };
+
+        const size_t concurrency = std::min(std::max<size_t>(options.concurrency, 1), urls.size());
+        const long verify = options.verifyPeer ? 1L : 0L;
+
+        // 每个槽位的选项只设置一次，之后只替换 URL
+        for (size_t i = 0; i < concurrency; ++i) {
+            std::unique_ptr<ProbeSlot> slot(new ProbeSlot);
+            slot->easy = curl_easy_init();
+            HAPPY_ASSERT(slot->easy);
+
+            CURL *easy = slot->easy;
+            curl_easy_setopt(easy, CURLOPT_SHARE, ctx.share);
+            curl_easy_setopt(easy, CURLOPT_PRIVATE, slot.get());
+            curl_easy_setopt(easy, CURLOPT_ERRORBUFFER, slot->error);
+            curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+            curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, onProbeHeader);
+            curl_easy_setopt(easy, CURLOPT_HEADERDATA, slot.get());
+            curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, onProbeBody);
+            curl_easy_setopt(easy, CURLOPT_SSL_VERIFYPEER, verify);
+            curl_easy_setopt(easy, CURLOPT_SSL_VERIFYHOST, verify * 2);
+            curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, static_cast<long>(options.timeoutMs));
+            curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT_MS,
+                             static_cast<long>(options.connectTimeoutMs));
+
+            if (options.method == HTTP_METHOD_HEAD)
+                curl_easy_setopt(easy, CURLOPT_NOBODY, 1L);
+            else if (options.method != HTTP_METHOD_GET)
+                curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST,
+                                 HttpMessage::toName(options.method).data());
+
+            ctx.slots.push_back(std::move(slot));
+            start(ctx.slots.back().get());
+        }
+
+        while (active > 0) {
+            int running = 0;
+            curl_multi_perform(ctx.multi, &running);
+
+            int left = 0;
+            CURLMsg *msg;
+
+            while ((msg = curl_multi_info_read(ctx.multi, &left)) != nullptr) {
+                if (msg->msg != CURLMSG_DONE)
+                    continue;
+
+                CURL *easy = msg->easy_handle;
+                const CURLcode result = msg->data.result;
+                ProbeSlot *slot = nullptr;
+                curl_easy_getinfo(easy, CURLINFO_PRIVATE, &slot);
+                curl_multi_remove_handle(ctx.multi, easy);
+                --active;
+
+                ProbeResult r;
+                r.index = slot->index;
+                r.timing = probeTiming(easy);
+
+                if (result != CURLE_OK) {
+                    r.error = slot->error[0] != '\0' ? slot->error : curl_easy_strerror(result);
+                } else {
+                    r.resp = slot->builder.take();
+
+                    if (r.resp)
+                        ++responded;
+                    else
+                        r.error = kInvalidResponse;
+                }
+
+                // 先开始下一个请求，再执行回调
+                start(slot);
+
+                if (options.callback)
+                    options.callback(r);
+            }
+
+            if (active > 0)
+                pollMulti(ctx.multi, nullptr, 0, 1000);
+        }
+
+        return responded;
+    }
+
+} /* namespace happycpp */
@@ -0,0 +1,612 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/http/compress.h"
+#include "happycpp/http/mime.h"
+#include "happycpp/exception.h"
+#include "text.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cctype>
+#include <climits>
+
+#ifdef HAPPYCPP_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef HAPPYCPP_HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+namespace happycpp::hchttp {
+
+    namespace {
+
+        using detail::iequals;
+        using detail::trimOws;
+
+        const size_t kCodingCount = HTTP_CODING_ZSTD + 1;
+
+        //! 每个线程、每种编码最多缓存的压缩器数量
+        const size_t kMaxPooled = 8;
+
+        const size_t kMinChunk = 4096;
+        const size_t kMaxChunk = 128 * 1024;
+
+        // 输出缓冲区每次扩展的大小，按剩余输入估算，避免小消息体也扩展一大块
+        size_t chunkSize(size_t remaining) {
+            return std::clamp(remaining + 64, kMinChunk, kMaxChunk);
+        }
+
+        bool icontains(std::string_view s, std::string_view sub) {
+            if (sub.size() > s.size())
+                return false;
+
+            for (size_t i = 0; i + sub.size() <= s.size(); ++i) {
+                if (iequals(s.substr(i, sub.size()), sub))
+                    return true;
+            }
+
+            return false;
+        }
+
+        // q 值转换为 0~1000 的整数，格式错误时返回 -1
+        int parseQuality(std::string_view v) {
+            if (v.empty() || (v[0] != '0' && v[0] != '1'))
+                return -1;
+
+            int q = (v[0] - '0') * 1000;
+
+            if (v.size() == 1)
+                return q;
+
+            if (v[1] != '.' || v.size() > 5)
+                return -1;
+
+            int scale = 100;
+
+            for (size_t i = 2; i < v.size(); ++i, scale /= 10) {
+                if (!isdigit(static_cast<unsigned char>(v[i])))
+                    return -1;
+
+                q += (v[i] - '0') * scale;
+            }
+
+            return q > 1000 ? -1 : q;
+        }
+
+        // "gzip;q=0.8" 中的 q 值，没有 q 参数时为 1000
+        int codingQuality(std::string_view params) {
+            while (!params.empty()) {
+                const size_t end = params.find(';');
+                const std::string_view p(trimOws(params.substr(0, end)));
+
+                if (p.size() >= 2 && (p[0] == 'q' || p[0] == 'Q') && p[1] == '=')
+                    return parseQuality(trimOws(p.substr(2)));
+
+                params = end == std::string_view::npos ? std::string_view() : params.substr(end + 1);
+            }
+
+            return 1000;
+        }
+
+        //! gzip 和 deflate，只在第一次使用时调用 deflateInit2，之后通过 deflateReset 复用
+        class ZlibCompressor : public Compressor {
+        public:
+            explicit ZlibCompressor(bool gzip)
+                    : gzip_(gzip), level_(Z_DEFAULT_COMPRESSION) {
+                zs_ = z_stream();
+
+                // windowBits 加 16 输出 gzip 格式，否则输出 zlib 格式
+                if (deflateInit2(&zs_, level_, Z_DEFLATED, gzip ? MAX_WBITS + 16 : MAX_WBITS,
+                                 8, Z_DEFAULT_STRATEGY) != Z_OK)
+                    ThrowHappyException("Cannot initialize zlib.");
+            }
+
+            ~ZlibCompressor() override {
+                deflateEnd(&zs_);
+            }
+
+            [[nodiscard]] HttpContentCoding coding() const override {
+                return gzip_ ? HTTP_CODING_GZIP : HTTP_CODING_DEFLATE;
+            }
+
+            // zlib 的参数与数据长度无关，不使用 sizeHint
+            void reset(int level, int64_t /* sizeHint */) override {
+                deflateReset(&zs_);
+
+                if (level != level_) {
+                    if (deflateParams(&zs_, level, Z_DEFAULT_STRATEGY) != Z_OK)
+                        ThrowHappyException("Invalid zlib compression level.");
+
+                    level_ = level;
+                }
+            }
+
+            void update(std::string_view data, std::string *out) override {
+                // avail_in 是 uInt，超大的数据分段压缩
+                while (!data.empty()) {
+                    const size_t n = std::min<size_t>(data.size(), UINT_MAX);
+                    run(data.substr(0, n), Z_NO_FLUSH, out);
+                    data.remove_prefix(n);
+                }
+            }
+
+            void finish(std::string *out) override {
+                run(std::string_view(), Z_FINISH, out);
+            }
+
+        private:
+            bool gzip_;
+            int level_;
+            z_stream zs_;
+
+            void run(std::string_view data, int flush, std::string *out) {
+                zs_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+                zs_.avail_in = static_cast<uInt>(data.size());
+
+                for (;;) {
+                    const size_t used = out->size();
+                    const size_t chunk = chunkSize(zs_.avail_in);
+                    out->resize(used + chunk);
+
+                    zs_.next_out = reinterpret_cast<Bytef *>(&(*out)[used]);
+                    zs_.avail_out = static_cast<uInt>(chunk);
+
+                    const int ret = deflate(&zs_, flush);
+                    out->resize(used + chunk - zs_.avail_out);
+
+                    if (ret == Z_STREAM_ERROR)
+                        ThrowHappyException("zlib compression failed.");
+
+                    if (flush == Z_FINISH ? ret == Z_STREAM_END
+                                          : zs_.avail_in == 0 && zs_.avail_out != 0)
+                        break;
+                }
+            }
+        };
+
+#ifdef HAPPYCPP_HAVE_ZSTD
+
+        //! zstd，ZSTD_CCtx 通过 ZSTD_CCtx_reset 复用
+        class ZstdCompressor : public Compressor {
+        public:
+            ZstdCompressor() : ctx_(ZSTD_createCCtx()) {
+                if (ctx_ == nullptr)
+                    ThrowHappyException("Cannot initialize zstd.");
+            }
+
+            ~ZstdCompressor() override {
+                ZSTD_freeCCtx(ctx_);
+            }
+
+            [[nodiscard]] HttpContentCoding coding() const override {
+                return HTTP_CODING_ZSTD;
+            }
+
+            void reset(int level, int64_t sizeHint) override {
+                ZSTD_CCtx_reset(ctx_, ZSTD_reset_session_only);
+                check(ZSTD_CCtx_setParameter(ctx_, ZSTD_c_compressionLevel, level));
+
+                // 已知长度时写入帧头，并据此选择窗口大小
+                check(ZSTD_CCtx_setPledgedSrcSize(
+                        ctx_, sizeHint < 0 ? ZSTD_CONTENTSIZE_UNKNOWN
+                                           : static_cast<unsigned long long>(sizeHint)));
+            }
+
+            void update(std::string_view data, std::string *out) override {
+                run(data, ZSTD_e_continue, out);
+            }
+
+            void finish(std::string *out) override {
+                run(std::string_view(), ZSTD_e_end, out);
+            }
+
+        private:
+            ZSTD_CCtx *ctx_;
+
+            static size_t check(size_t ret) {
+                if (ZSTD_isError(ret))
+                    ThrowHappyException(std::string("zstd compression failed: ") + ZSTD_getErrorName(ret));
+
+                return ret;
+            }
+
+            void run(std::string_view data, ZSTD_EndDirective mode, std::string *out) {
+                ZSTD_inBuffer in = {data.data(), data.size(), 0};
+
+                for (;;) {
+                    const size_t used = out->size();
+                    const size_t chunk = chunkSize(in.size - in.pos);
+                    out->resize(used + chunk);
+
+                    ZSTD_outBuffer o = {&(*out)[used], chunk, 0};
+                    const size_t ret = ZSTD_compressStream2(ctx_, &o, &in, mode);
+                    out->resize(used + o.pos);
+                    check(ret);
+
+                    // ZSTD_e_end 返回 0 表示已经全部输出
+                    if (mode == ZSTD_e_end ? ret == 0 : in.pos == in.size && o.pos < o.size)
+                        break;
+                }
+            }
+        };
+
+#endif  // HAPPYCPP_HAVE_ZSTD
+
+#ifdef HAPPYCPP_HAVE_BROTLI
+
+        //! brotli 没有 reset 接口，每个数据流重新创建编码器，只复用 Compressor 对象
+        class BrotliCompressor : public Compressor {
+        public:
+            BrotliCompressor() : state_(nullptr) {}
+
+            ~BrotliCompressor() override {
+                if (state_ != nullptr)
+                    BrotliEncoderDestroyInstance(state_);
+            }
+
+            [[nodiscard]] HttpContentCoding coding() const override {
+                return HTTP_CODING_BR;
+            }
+
+            void reset(int level, int64_t sizeHint) override {
+                if (state_ != nullptr)
+                    BrotliEncoderDestroyInstance(state_);
+
+                state_ = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+
+                if (state_ == nullptr)
+                    ThrowHappyException("Cannot initialize brotli.");
+
+                BrotliEncoderSetParameter(state_, BROTLI_PARAM_QUALITY, static_cast<uint32_t>(level));
+
+                if (sizeHint > 0)
+                    BrotliEncoderSetParameter(state_, BROTLI_PARAM_SIZE_HINT,
+                                              static_cast<uint32_t>(std::min<int64_t>(sizeHint, 1 << 30)));
+            }
+
+            void update(std::string_view data, std::string *out) override {
+                run(data, BROTLI_OPERATION_PROCESS, out);
+            }
+
+            void finish(std::string *out) override {
+                run(std::string_view(), BROTLI_OPERATION_FINISH, out);
+            }
+
+        private:
+            BrotliEncoderState *state_;
+
+            void run(std::string_view data, BrotliEncoderOperation op, std::string *out) {
+                size_t availIn = data.size();
+                auto nextIn = reinterpret_cast<const uint8_t *>(data.data());
+
+                for (;;) {
+                    const size_t used = out->size();
+                    const size_t chunk = chunkSize(availIn);
+                    out->resize(used + chunk);
+
+                    size_t availOut = chunk;
+                    auto nextOut = reinterpret_cast<uint8_t *>(&(*out)[used]);
+                    const bool ok = BrotliEncoderCompressStream(state_, op, &availIn, &nextIn,
+                                                                &availOut, &nextOut, nullptr);
+                    out->resize(used + chunk - availOut);
+
+                    if (!ok)
+                        ThrowHappyException("brotli compression failed.");
+
+                    if (op == BROTLI_OPERATION_FINISH ? BrotliEncoderIsFinished(state_)
+                                                      : availIn == 0 && !BrotliEncoderHasMoreOutput(state_))
+                        break;
+                }
+            }
+        };
+
+#endif  // HAPPYCPP_HAVE_BROTLI
+
+        std::unique_ptr<Compressor> createCompressor(HttpContentCoding coding) {
+            switch (coding) {
+                case HTTP_CODING_GZIP:
+                    return std::make_unique<ZlibCompressor>(true);
+                case HTTP_CODING_DEFLATE:
+                    return std::make_unique<ZlibCompressor>(false);
+#ifdef HAPPYCPP_HAVE_BROTLI
+                case HTTP_CODING_BR:
+                    return std::make_unique<BrotliCompressor>();
+#endif
+#ifdef HAPPYCPP_HAVE_ZSTD
+                case HTTP_CODING_ZSTD:
+                    return std::make_unique<ZstdCompressor>();
+#endif
+                default:
+                    ThrowHappyException("Unsupported content coding: " + std::string(toName(coding)));
+            }
+        }
+
+        // 线程退出时，池已经析构，之后释放的压缩器直接删除
+        thread_local bool poolAlive = false;
+
+        struct CompressorPool {
+            std::vector<std::unique_ptr<Compressor> > free[kCodingCount];
+
+            CompressorPool() {
+                poolAlive = true;
+            }
+
+            ~CompressorPool() {
+                poolAlive = false;
+            }
+        };
+
+        thread_local CompressorPool pool;
+
+        int levelFor(const CompressOptions &options, HttpContentCoding coding) {
+            int level = -1;
+
+            if (coding == HTTP_CODING_GZIP || coding == HTTP_CODING_DEFLATE)
+                level = options.gzipLevel;
+            else if (coding == HTTP_CODING_BR)
+                level = options.brotliLevel;
+            else if (coding == HTTP_CODING_ZSTD)
+                level = options.zstdLevel;
+
+            return level < 0 ? defaultLevel(coding) : level;
+        }
+
+        bool mimeAllowed(const CompressOptions &options, std::string_view type) {
+            return std::any_of(options.mimeTypes.begin(), options.mimeTypes.end(),
+                               [type](const std::string &t) {
+                                   if (!t.empty() && t.back() == '/')
+                                       return type.size() > t.size() && iequals(type.substr(0, t.size()), t);
+
+                                   return iequals(type, t);
+                               });
+        }
+
+    } /* namespace */
+
+    std::string_view toName(HttpContentCoding coding) {
+        switch (coding) {
+            case HTTP_CODING_GZIP:
+                return "gzip";
+            case HTTP_CODING_DEFLATE:
+                return "deflate";
+            case HTTP_CODING_BR:
+                return "br";
+            case HTTP_CODING_ZSTD:
+                return "zstd";
+            default:
+                return "identity";
+        }
+    }
+
+    bool codingSupported(HttpContentCoding coding) {
+        switch (coding) {
+            case HTTP_CODING_IDENTITY:
+            case HTTP_CODING_GZIP:
+            case HTTP_CODING_DEFLATE:
+                return true;
+#ifdef HAPPYCPP_HAVE_BROTLI
+            case HTTP_CODING_BR:
+                return true;
+#endif
+#ifdef HAPPYCPP_HAVE_ZSTD
+            case HTTP_CODING_ZSTD:
+                return true;
+#endif
+            default:
+                return false;
+        }
+    }
+
+    HttpContentCoding negotiateEncoding(std::string_view acceptEncoding,
+                                        const std::vector<HttpContentCoding> &preferred,
+                                        bool *acceptable) {
+        // -1 表示 Accept-Encoding 中没有出现
+        int quality[kCodingCount] = {-1, -1, -1, -1, -1};
+        int any = -1;
+
+        while (!acceptEncoding.empty()) {
+            const size_t end = acceptEncoding.find(',');
+            const std::string_view item(acceptEncoding.substr(0, end));
+            const size_t semicolon = item.find(';');
+            const std::string_view name(trimOws(item.substr(0, semicolon)));
+            const int q = semicolon == std::string_view::npos ? 1000 : codingQuality(item.substr(semicolon + 1));
+
+            acceptEncoding = end == std::string_view::npos ? std::string_view() : acceptEncoding.substr(end + 1);
+
+            if (name.empty() || q < 0)
+                continue;
+
+            if (name == "*")
+                any = q;
+            else if (iequals(name, "identity"))
+                quality[HTTP_CODING_IDENTITY] = q;
+            else if (iequals(name, "gzip") || iequals(name, "x-gzip"))
+                quality[HTTP_CODING_GZIP] = q;
+            else if (iequals(name, "deflate"))
+                quality[HTTP_CODING_DEFLATE] = q;
+            else if (iequals(name, "br"))
+                quality[HTTP_CODING_BR] = q;
+            else if (iequals(name, "zstd"))
+                quality[HTTP_CODING_ZSTD] = q;
+        }
+
+        HttpContentCoding best = HTTP_CODING_IDENTITY;
+        int bestQuality = 0;
+
+        for (const HttpContentCoding c : preferred) {
+            if (c == HTTP_CODING_IDENTITY || !codingSupported(c))
+                continue;
+
+            const int q = quality[c] < 0 ? any : quality[c];
+
+            if (q > bestQuality) {
+                best = c;
+                bestQuality = q;
+            }
+        }
+
+        // identity 没有出现时由 "*" 决定，都没有出现时总是可以接受，但优先级最低(RFC 9110 12.5.3)
+        const int identity = quality[HTTP_CODING_IDENTITY] >= 0 ? quality[HTTP_CODING_IDENTITY] : any;
+        const bool identityAcceptable = identity != 0;
+
+        // q 值相同时优先压缩
+        if (best != HTTP_CODING_IDENTITY && bestQuality < identity)
+            best = HTTP_CODING_IDENTITY;
+
+        if (acceptable != nullptr)
+            *acceptable = best != HTTP_CODING_IDENTITY || identityAcceptable;
+
+        return best;
+    }
+
+    Compressor::~Compressor() = default;
+
+    void CompressorReleaser::operator()(Compressor *c) const {
+        std::unique_ptr<Compressor> p(c);
+
+        if (!poolAlive)
+            return;
+
+        auto &free = pool.free[c->coding()];
+
+        if (free.size() < kMaxPooled)
+            free.push_back(std::move(p));
+    }
+
+    CompressorPtr acquireCompressor(HttpContentCoding coding, int level, int64_t sizeHint) {
+        std::unique_ptr<Compressor> c;
+
+        if (coding < kCodingCount && !pool.free[coding].empty()) {
+            c = std::move(pool.free[coding].back());
+            pool.free[coding].pop_back();
+        } else {
+            c = createCompressor(coding);
+        }
+
+        // reset 失败(比如压缩级别无效)时，c 直接析构
+        c->reset(level, sizeHint);
+
+        return CompressorPtr(c.release());
+    }
+
+    int defaultLevel(HttpContentCoding coding) {
+        switch (coding) {
+            case HTTP_CODING_BR:
+                return 4;
+            case HTTP_CODING_ZSTD:
+                return 3;
+            default:
+                return 5;
+        }
+    }
+
+    CompressSink::CompressSink(HttpContentCoding coding, BodySinkPtr next, int level)
+            : coding_(coding),
+              level_(level < 0 ? defaultLevel(coding) : level),
+              next_(std::move(next)),
+              compressor_(acquireCompressor(coding, level_)) {
+        HAPPY_ASSERT(next_);
+    }
+
+    CompressSink::~CompressSink() = default;
+
+    void CompressSink::begin(int64_t contentLength) {
+        compressor_->reset(level_, contentLength);
+        out_.clear();
+        next_->begin(-1);
+    }
+
+    bool CompressSink::write(const char *data, size_t size) {
+        out_.clear();
+        compressor_->update(std::string_view(data, size), &out_);
+
+        return out_.empty() || next_->write(out_.data(), out_.size());
+    }
+
+    bool CompressSink::finish() {
+        out_.clear();
+        compressor_->finish(&out_);
+
+        if (!out_.empty() && !next_->write(out_.data(), out_.size()))
+            return false;
+
+        return next_->finish();
+    }
+
+    HttpContentCoding compressResponse(const HttpRequestMsg &req,
+                                       HttpResponseMsg *resp,
+                                       const CompressOptions &options) {
+        const uint32_t status = resp->status();
+        const std::string &body = resp->body();
+
+        if (status < 200 || status == 204 || status == 206 || status == 304
+            || body.size() < options.minSize
+            || !resp->header(HTTP_MRESF_CONTENT_ENCODING).empty()
+            || icontains(resp->header(HTTP_MCOMF_CACHE_CONTROL), "no-transform"))
+            return HTTP_CODING_IDENTITY;
+
+        std::string_view type(resp->header(HTTP_MCOMF_CONTENT_TYPE));
+        type = type.empty() ? hcmime::fromUri(req.url()) : trimOws(type.substr(0, type.find(';')));
+
+        if (!mimeAllowed(options, type))
+            return HTTP_CODING_IDENTITY;
+
+        // 响应的内容取决于 Accept-Encoding，缓存需要区分
+        const std::string_view vary(resp->header(HTTP_MRESF_VARY));
+
+        if (vary.empty())
+            resp->setField(HTTP_MRESF_VARY, "Accept-Encoding");
+        else if (vary != "*" && !icontains(vary, "accept-encoding"))
+            resp->setField(HTTP_MRESF_VARY, std::string(vary) + ", Accept-Encoding");
+
+        const HttpContentCoding coding = negotiateEncoding(req.header(HTTP_MREQF_ACCEPT_ENCODING),
+                                                           options.codings);
+
+        if (coding == HTTP_CODING_IDENTITY)
+            return HTTP_CODING_IDENTITY;
+
+        CompressorPtr c(acquireCompressor(coding, levelFor(options, coding),
+                                          static_cast<int64_t>(body.size())));
+        std::string out;
+        out.reserve(body.size() / 2);
+        c->update(body, &out);
+        c->finish(&out);
+
+        if (out.size() >= body.size())
+            return HTTP_CODING_IDENTITY;
+
+        resp->setBody(std::move(out));
+        resp->setField(HTTP_MRESF_CONTENT_ENCODING, toName(coding));
+
+        if (!resp->header(HTTP_MCOMF_CONTENT_LENGTH).empty())
+            resp->setField(HTTP_MCOMF_CONTENT_LENGTH, std::to_string(resp->body().size()));
+
+        // 压缩后的字节不同，强 ETag 不再成立
+        const std::string_view etag(resp->header(HTTP_MRESF_ETAG));
+
+        if (!etag.empty() && etag.substr(0, 2) != "W/")
+            resp->setField(HTTP_MRESF_ETAG, "W/" + std::string(etag));
+
+        return coding;
+    }
+
+} /* namespace happycpp */
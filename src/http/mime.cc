@@ -0,0 +1,443 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/http/mime.h"
+#include "happycpp/exception.h"
+#include "text.h"
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace happycpp::hchttp::hcmime {
+
+    namespace {
+
+        using hchttp::detail::asciiLower;
+        using hchttp::detail::iequals;
+
+        struct MimeEntry {
+            std::string_view ext;
+            std::string_view type;
+        };
+
+        // nginx mime.types，按扩展名排序，扩展名均为小写
+        constexpr MimeEntry kBuiltin[] = {
+                {"3gp",     "video/3gpp"},
+                {"3gpp",    "video/3gpp"},
+                {"7z",      "application/x-7z-compressed"},
+                {"ai",      "application/postscript"},
+                {"asf",     "video/x-ms-asf"},
+                {"asx",     "video/x-ms-asf"},
+                {"atom",    "application/atom+xml"},
+                {"avi",     "video/x-msvideo"},
+                {"avif",    "image/avif"},
+                {"bin",     "application/octet-stream"},
+                {"bmp",     "image/x-ms-bmp"},
+                {"cco",     "application/x-cocoa"},
+                {"crt",     "application/x-x509-ca-cert"},
+                {"css",     "text/css"},
+                {"deb",     "application/octet-stream"},
+                {"der",     "application/x-x509-ca-cert"},
+                {"dll",     "application/octet-stream"},
+                {"dmg",     "application/octet-stream"},
+                {"doc",     "application/msword"},
+                {"docx",    "application/vnd.openxmlformats-officedocument.wordprocessingml.document"},
+                {"ear",     "application/java-archive"},
+                {"eot",     "application/vnd.ms-fontobject"},
+                {"eps",     "application/postscript"},
+                {"exe",     "application/octet-stream"},
+                {"flv",     "video/x-flv"},
+                {"gif",     "image/gif"},
+                {"hqx",     "application/mac-binhex40"},
+                {"htc",     "text/x-component"},
+                {"htm",     "text/html"},
+                {"html",    "text/html"},
+                {"ico",     "image/x-icon"},
+                {"img",     "application/octet-stream"},
+                {"iso",     "application/octet-stream"},
+                {"jad",     "text/vnd.sun.j2me.app-descriptor"},
+                {"jar",     "application/java-archive"},
+                {"jardiff", "application/x-java-archive-diff"},
+                {"jng",     "image/x-jng"},
+                {"jnlp",    "application/x-java-jnlp-file"},
+                {"jpeg",    "image/jpeg"},
+                {"jpg",     "image/jpeg"},
+                {"js",      "application/javascript"},
+                {"json",    "application/json"},
+                {"kar",     "audio/midi"},
+                {"kml",     "application/vnd.google-earth.kml+xml"},
+                {"kmz",     "application/vnd.google-earth.kmz"},
+                {"m3u8",    "application/vnd.apple.mpegurl"},
+                {"m4a",     "audio/x-m4a"},
+                {"m4v",     "video/x-m4v"},
+                {"mid",     "audio/midi"},
+                {"midi",    "audio/midi"},
+                {"mjs",     "application/javascript"},
+                {"mml",     "text/mathml"},
+                {"mng",     "video/x-mng"},
+                {"mov",     "video/quicktime"},
+                {"mp3",     "audio/mpeg"},
+                {"mp4",     "video/mp4"},
+                {"mpeg",    "video/mpeg"},
+                {"mpg",     "video/mpeg"},
+                {"msi",     "application/octet-stream"},
+                {"msm",     "application/octet-stream"},
+                {"msp",     "application/octet-stream"},
+                {"odg",     "application/vnd.oasis.opendocument.graphics"},
+                {"odp",     "application/vnd.oasis.opendocument.presentation"},
+                {"ods",     "application/vnd.oasis.opendocument.spreadsheet"},
+                {"odt",     "application/vnd.oasis.opendocument.text"},
+                {"ogg",     "audio/ogg"},
+                {"pdb",     "application/x-pilot"},
+                {"pdf",     "application/pdf"},
+                {"pem",     "application/x-x509-ca-cert"},
+                {"pl",      "application/x-perl"},
+                {"pm",      "application/x-perl"},
+                {"png",     "image/png"},
+                {"ppt",     "application/vnd.ms-powerpoint"},
+                {"pptx",    "application/vnd.openxmlformats-officedocument.presentationml.presentation"},
+                {"prc",     "application/x-pilot"},
+                {"ps",      "application/postscript"},
+                {"ra",      "audio/x-realaudio"},
+                {"rar",     "application/x-rar-compressed"},
+                {"rpm",     "application/x-redhat-package-manager"},
+                {"rss",     "application/rss+xml"},
+                {"rtf",     "application/rtf"},
+                {"run",     "application/x-makeself"},
+                {"sea",     "application/x-sea"},
+                {"shtml",   "text/html"},
+                {"sit",     "application/x-stuffit"},
+                {"svg",     "image/svg+xml"},
+                {"svgz",    "image/svg+xml"},
+                {"swf",     "application/x-shockwave-flash"},
+                {"tcl",     "application/x-tcl"},
+                {"text",    "text/plain"},
+                {"tif",     "image/tiff"},
+                {"tiff",    "image/tiff"},
+                {"tk",      "application/x-tcl"},
+                {"ts",      "video/mp2t"},
+                {"txt",     "text/plain"},
+                {"war",     "application/java-archive"},
+                {"wasm",    "application/wasm"},
+                {"wbmp",    "image/vnd.wap.wbmp"},
+                {"webm",    "video/webm"},
+                {"webp",    "image/webp"},
+                {"wml",     "text/vnd.wap.wml"},
+                {"wmlc",    "application/vnd.wap.wmlc"},
+                {"wmv",     "video/x-ms-wmv"},
+                {"woff",    "font/woff"},
+                {"woff2",   "font/woff2"},
+                {"xhtml",   "application/xhtml+xml"},
+                {"xls",     "application/vnd.ms-excel"},
+                {"xlsx",    "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet"},
+                {"xml",     "text/xml"},
+                {"xpi",     "application/x-xpinstall"},
+                {"xspf",    "application/xspf+xml"},
+                {"zip",     "application/zip"},
+        };
+
+        constexpr bool builtinSorted() {
+            for (size_t i = 1; i < std::size(kBuiltin); ++i) {
+                if (!(kBuiltin[i - 1].ext < kBuiltin[i].ext))
+                    return false;
+            }
+
+            return true;
+        }
+
+        static_assert(builtinSorted(), "kBuiltin must be sorted by extension");
+
+        // 以扩展名第一个字节为下标，记录 kBuiltin 中对应的区间 [begin, end)
+        struct FirstByteIndex {
+            uint8_t begin[256];
+            uint8_t end[256];
+        };
+
+        constexpr FirstByteIndex buildFirstByteIndex() {
+            FirstByteIndex idx{};
+
+            for (size_t i = 0; i < std::size(kBuiltin); ++i) {
+                const auto c = static_cast<uint8_t>(kBuiltin[i].ext[0]);
+
+                if (idx.end[c] == 0)
+                    idx.begin[c] = static_cast<uint8_t>(i);
+
+                idx.end[c] = static_cast<uint8_t>(i + 1);
+            }
+
+            return idx;
+        }
+
+        static_assert(std::size(kBuiltin) < 256, "FirstByteIndex uses uint8_t");
+
+        constexpr FirstByteIndex kFirstByteIndex = buildFirstByteIndex();
+
+        // 与 nginx charset_types 的默认值一致
+        constexpr std::string_view kCharsetTypes[] = {
+                "text/html",
+                "text/xml",
+                "text/plain",
+                "text/vnd.wap.wml",
+                "application/javascript",
+                "application/rss+xml",
+        };
+
+        constexpr std::string_view kCommonCharsets[] = {
+                "utf-8",
+                "iso-8859-1",
+                "gbk",
+                "gb2312",
+                "gb18030",
+                "big5",
+        };
+
+        constexpr size_t kCharsetTypeCount = std::size(kCharsetTypes);
+        constexpr size_t kCommonCharsetCount = std::size(kCommonCharsets);
+
+        // 超过该长度的扩展名视为未知扩展名
+        constexpr size_t kMaxExtSize = 32;
+
+        size_t indexOf(const std::string_view *first, size_t n, std::string_view s, bool icase) {
+            for (size_t i = 0; i < n; ++i) {
+                if (icase ? iequals(first[i], s) : first[i] == s)
+                    return i;
+            }
+
+            return n;
+        }
+
+        struct CustomEntry {
+            std::string ext;
+            std::string type;
+        };
+
+        // 附加了不常用 charset 的 MIME 类型
+        struct InternedType {
+            std::string type;
+            std::string charset;
+            std::string full;
+        };
+
+        struct MimeRegistry {
+            std::vector<CustomEntry> custom; /*! load 加载的内容，按扩展名排序 */
+            std::vector<std::string> customText; /*! load 加载的 text/ 类型，已排序，没有重复 */
+            /*! kCharsetTypes 和 kCommonCharsets 的所有组合，构造后不再修改 */
+            std::vector<std::string> common;
+
+            std::mutex mutex;
+            std::deque<InternedType> interned; /*! deque 保证已有元素的地址不变 */
+
+            MimeRegistry() {
+                common.reserve(kCharsetTypeCount * kCommonCharsetCount);
+
+                for (const auto type : kCharsetTypes) {
+                    for (const auto charset : kCommonCharsets)
+                        common.push_back(std::string(type) + "; charset=" + std::string(charset));
+                }
+            }
+        };
+
+        MimeRegistry &registry() {
+            static MimeRegistry r;
+            return r;
+        }
+
+        // 同一个首字节的扩展名最多只有几个，顺序比较即可
+        std::string_view lookupBuiltin(std::string_view ext) {
+            const auto c = static_cast<uint8_t>(ext[0]);
+
+            for (size_t i = kFirstByteIndex.begin[c]; i < kFirstByteIndex.end[c]; ++i) {
+                if (kBuiltin[i].ext == ext)
+                    return kBuiltin[i].type;
+            }
+
+            return kDefaultMimeType;
+        }
+
+    } /* namespace */
+
+    std::string_view fromExtension(std::string_view ext) {
+        if (ext.empty() || ext.size() > kMaxExtSize)
+            return kDefaultMimeType;
+
+        char buf[kMaxExtSize];
+        std::transform(ext.begin(), ext.end(), buf, asciiLower);
+        const std::string_view key(buf, ext.size());
+
+        const MimeRegistry &r = registry();
+
+        if (!r.custom.empty()) {
+            const auto it = std::lower_bound(
+                    r.custom.begin(), r.custom.end(), key,
+                    [](const CustomEntry &e, std::string_view k) { return e.ext < k; });
+
+            if (it != r.custom.end() && it->ext == key)
+                return it->type;
+        }
+
+        return lookupBuiltin(key);
+    }
+
+    std::string_view fromUri(std::string_view uri) {
+        for (size_t i = 0; i < uri.size(); ++i) {
+            if (uri[i] == '?' || uri[i] == '#') {
+                uri = uri.substr(0, i);
+                break;
+            }
+        }
+
+        // 例如：http://www.foo.com/image/logo.gif，取最后的扩展名 gif
+        const size_t dot = uri.rfind('.');
+
+        if (dot == std::string_view::npos)
+            return kDefaultMimeType;
+
+        const size_t slash = uri.rfind('/');
+
+        if (slash != std::string_view::npos && slash > dot)
+            return kDefaultMimeType;
+
+        return fromExtension(uri.substr(dot + 1));
+    }
+
+    bool isText(std::string_view mimeType) {
+        if (indexOf(kCharsetTypes, kCharsetTypeCount, mimeType, false) != kCharsetTypeCount)
+            return true;
+
+        const std::vector<std::string> &text = registry().customText;
+        return mimeType.substr(0, 5) == "text/" && std::binary_search(text.begin(), text.end(), mimeType);
+    }
+
+    std::string_view fromUri(std::string_view uri, std::string_view charset) {
+        const std::string_view type(fromUri(uri));
+        const size_t t = indexOf(kCharsetTypes, kCharsetTypeCount, type, false);
+
+        if (t == kCharsetTypeCount && !isText(type))
+            return type;
+
+        if (charset.empty())
+            charset = kDefaultCharset;
+
+        MimeRegistry &r = registry();
+        const size_t c = indexOf(kCommonCharsets, kCommonCharsetCount, charset, true);
+
+        if (t != kCharsetTypeCount && c != kCommonCharsetCount)
+            return r.common[t * kCommonCharsetCount + c];
+
+        std::lock_guard<std::mutex> lock(r.mutex);
+
+        for (const auto &it : r.interned) {
+            if (it.type == type && it.charset == charset)
+                return it.full;
+        }
+
+        r.interned.push_back(InternedType{std::string(type), std::string(charset),
+                                          std::string(type) + "; charset=" + std::string(charset)});
+        return r.interned.back().full;
+    }
+
+    size_t load(const std::string &path) {
+        std::ifstream in(path);
+
+        if (!in)
+            ThrowHappyException("Cannot open mime.types: " + path);
+
+        std::stringstream ss;
+        ss << in.rdbuf();
+        std::string content(ss.str());
+
+        // 去掉注释
+        for (size_t pos = 0; (pos = content.find('#', pos)) != std::string::npos;) {
+            const size_t eol = content.find('\n', pos);
+            content.erase(pos, eol == std::string::npos ? std::string::npos : eol - pos);
+        }
+
+        // nginx 格式以 ";" 结束一项，一项可以跨行；Apache 格式每行一项
+        const bool nginx = content.find('{') != std::string::npos;
+        const char terminator = nginx ? ';' : '\n';
+
+        std::replace(content.begin(), content.end(), '{', ' ');
+        std::replace(content.begin(), content.end(), '}', ' ');
+
+        std::map<std::string, std::string> entries;
+        std::stringstream statements(content);
+        std::string statement;
+
+        while (std::getline(statements, statement, terminator)) {
+            std::stringstream tokens(statement);
+            std::string type;
+            std::string ext;
+
+            tokens >> type;
+
+            if (type == "types")
+                tokens >> type;
+
+            if (type.find('/') == std::string::npos)
+                continue;
+
+            while (tokens >> ext) {
+                if (ext.size() > kMaxExtSize)
+                    continue;
+
+                std::transform(ext.begin(), ext.end(), ext.begin(), asciiLower);
+                entries[ext] = type;
+            }
+        }
+
+        MimeRegistry &r = registry();
+        std::map<std::string, std::string> merged;
+
+        for (auto &it : r.custom)
+            merged[std::move(it.ext)] = std::move(it.type);
+
+        for (auto &it : entries)
+            merged[it.first] = std::move(it.second);
+
+        r.custom.clear();
+        r.custom.reserve(merged.size());
+
+        for (auto &it : merged)
+            r.custom.push_back(CustomEntry{it.first, std::move(it.second)});
+
+        r.customText.clear();
+
+        for (const auto &it : r.custom) {
+            if (it.type.compare(0, 5, "text/") == 0)
+                r.customText.push_back(it.type);
+        }
+
+        std::sort(r.customText.begin(), r.customText.end());
+        r.customText.erase(std::unique(r.customText.begin(), r.customText.end()), r.customText.end());
+        return entries.size();
+    }
+
+    void reset() {
+        registry().custom.clear();
+        registry().customText.clear();
+    }
+
+} /* namespace happycpp */
@@ -0,0 +1,520 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/http/parser.h"
+#include "text.h"
+#include <algorithm>
+#include <cstring>
+
+namespace happycpp::hchttp {
+
+    namespace {
+
+        using detail::iequals;
+        using detail::trimOws;
+
+        const std::string_view HTTP_FLAG("HTTP/");
+
+        // 在以逗号分隔的列表中，查找指定的元素(不区分大小写)
+        bool hasToken(std::string_view list, std::string_view token) {
+            while (!list.empty()) {
+                const size_t comma = list.find(',');
+                const std::string_view item(trimOws(list.substr(0, comma)));
+
+                if (iequals(item, token))
+                    return true;
+
+                if (comma == std::string_view::npos)
+                    break;
+
+                list.remove_prefix(comma + 1);
+            }
+
+            return false;
+        }
+
+        // 以逗号分隔的列表中的最后一个元素
+        std::string_view lastToken(std::string_view list) {
+            const size_t comma = list.rfind(',');
+
+            if (comma == std::string_view::npos)
+                return trimOws(list);
+
+            return trimOws(list.substr(comma + 1));
+        }
+
+        int hexValue(char c) {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            if (c >= 'a' && c <= 'f')
+                return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F')
+                return c - 'A' + 10;
+
+            return -1;
+        }
+
+    } /* namespace */
+
+    HttpParserHandler::~HttpParserHandler() = default;
+
+    HttpParser::HttpParser(HttpParserHandler *handler, HttpMsgType type)
+            : handler_(handler),
+              fixedType_(type),
+              maxLineSize_(kDefaultMaxLineSize) {
+        reset();
+    }
+
+    HttpParser::~HttpParser() = default;
+
+    void HttpParser::reset() {
+        type_ = fixedType_;
+        state_ = S_START;
+        error_ = HTTP_PARSE_OK;
+        paused_ = false;
+        startMessage();
+    }
+
+    void HttpParser::startMessage() {
+        httpMajor_ = 0;
+        httpMinor_ = 0;
+        status_ = 0;
+        chunked_ = false;
+        unknownEncoding_ = false;
+        connectionClose_ = false;
+        connectionKeepAlive_ = false;
+        contentLength_ = -1;
+        remaining_ = 0;
+    }
+
+    void HttpParser::completeMessage() {
+        state_ = S_START;
+        handler_->onMessageComplete();
+    }
+
+    void HttpParser::setError(HttpParseError e) {
+        error_ = e;
+        state_ = S_ERROR;
+    }
+
+    size_t HttpParser::execute(std::string_view data) {
+        return execute(data.data(), data.size());
+    }
+
+    size_t HttpParser::execute(const char *data, size_t size) {
+        const char *p = data;
+        const char *end = data + size;
+
+        while (p < end && !paused_ && state_ != S_ERROR) {
+            // 消息体数据不需要按行处理，有多少回调多少
+            if (state_ == S_BODY_LENGTH || state_ == S_CHUNK_DATA) {
+                const size_t avail = static_cast<size_t>(end - p);
+                const size_t n = remaining_ < avail ? static_cast<size_t>(remaining_) : avail;
+
+                handler_->onBody(std::string_view(p, n));
+                p += n;
+                remaining_ -= n;
+
+                if (remaining_ == 0) {
+                    if (state_ == S_CHUNK_DATA)
+                        state_ = S_CHUNK_DATA_END;
+                    else
+                        completeMessage();
+                }
+
+                continue;
+            }
+
+            if (state_ == S_BODY_EOF) {
+                handler_->onBody(std::string_view(p, static_cast<size_t>(end - p)));
+                p = end;
+                break;
+            }
+
+            // 消息之间的空行，直接跳过
+            if (state_ == S_START) {
+                if (*p == '\r' || *p == '\n') {
+                    ++p;
+                    continue;
+                }
+
+                startMessage();
+
+                if (fixedType_ == INVALID_HTTP_MSG_TYPE) {
+                    // 数据不足以判断消息类型时，等待更多数据
+                    const size_t avail = static_cast<size_t>(end - p);
+                    const size_t n = std::min(avail, HTTP_FLAG.size());
+
+                    if (std::string_view(p, n) != HTTP_FLAG.substr(0, n))
+                        type_ = HTTP_MSG_REQUEST;
+                    else if (n == HTTP_FLAG.size())
+                        type_ = HTTP_MSG_RESPONSE;
+                    else
+                        break;
+                }
+
+                state_ = S_START_LINE;
+                handler_->onMessageBegin();
+                continue;
+            }
+
+            // 其余状态都是按行处理，不完整的行留给下一次 execute
+            const auto *lf = static_cast<const char *>(
+                    memchr(p, '\n', static_cast<size_t>(end - p)));
+
+            if (lf == nullptr) {
+                if (static_cast<size_t>(end - p) > maxLineSize_)
+                    setError(HTTP_PARSE_LINE_TOO_LONG);
+
+                break;
+            }
+
+            std::string_view line(p, static_cast<size_t>(lf - p));
+
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+
+            if (line.size() > maxLineSize_) {
+                setError(HTTP_PARSE_LINE_TOO_LONG);
+                break;
+            }
+
+            p = lf + 1;
+
+            switch (state_) {
+                case S_START_LINE:
+                    if (parseStartLine(line))
+                        state_ = S_HEADER;
+                    break;
+                case S_HEADER:
+                    if (line.empty())
+                        headersComplete();
+                    else
+                        parseHeaderLine(line);
+                    break;
+                case S_CHUNK_SIZE:
+                    parseChunkSize(line);
+                    break;
+                case S_CHUNK_DATA_END:
+                    if (line.empty())
+                        state_ = S_CHUNK_SIZE;
+                    else
+                        setError(HTTP_PARSE_INVALID_CHUNK);
+                    break;
+                case S_CHUNK_TRAILER:
+                    // 忽略 trailer 字段，空行表示消息结束
+                    if (line.empty())
+                        completeMessage();
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        return static_cast<size_t>(p - data);
+    }
+
+    bool HttpParser::finish() {
+        if (state_ == S_BODY_EOF) {
+            completeMessage();
+            return true;
+        }
+
+        if (state_ == S_START)
+            return true;
+
+        if (state_ != S_ERROR)
+            setError(HTTP_PARSE_UNEXPECTED_EOF);
+
+        return false;
+    }
+
+    void HttpParser::pause() {
+        paused_ = true;
+    }
+
+    void HttpParser::resume() {
+        paused_ = false;
+    }
+
+    bool HttpParser::paused() const {
+        return paused_;
+    }
+
+    HttpParseError HttpParser::error() const {
+        return error_;
+    }
+
+    HttpMsgType HttpParser::type() const {
+        return type_;
+    }
+
+    uint16_t HttpParser::httpMajor() const {
+        return httpMajor_;
+    }
+
+    uint16_t HttpParser::httpMinor() const {
+        return httpMinor_;
+    }
+
+    bool HttpParser::chunked() const {
+        return chunked_;
+    }
+
+    int64_t HttpParser::contentLength() const {
+        return contentLength_;
+    }
+
+    bool HttpParser::keepAlive() const {
+        if (httpMajor_ == 1 && httpMinor_ == 0)
+            return connectionKeepAlive_ && !connectionClose_;
+
+        return !connectionClose_;
+    }
+
+    void HttpParser::setMaxLineSize(size_t size) {
+        maxLineSize_ = size;
+    }
+
+    // HTTP-version = "HTTP/" DIGIT "." DIGIT
+    // 另外兼容 libcurl 输出的 HTTP/2、HTTP/3 响应状态行，此时次版本号为 0
+    bool HttpParser::parseVersion(std::string_view v) {
+        const auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+
+        const bool valid = v.substr(0, HTTP_FLAG.size()) == HTTP_FLAG
+                           && ((v.size() == 8 && isDigit(v[5]) && v[6] == '.' && isDigit(v[7]))
+                               || (v.size() == 6 && isDigit(v[5])));
+
+        if (!valid) {
+            setError(HTTP_PARSE_INVALID_VERSION);
+            return false;
+        }
+
+        httpMajor_ = static_cast<uint16_t>(v[5] - '0');
+        httpMinor_ = v.size() == 8 ? static_cast<uint16_t>(v[7] - '0') : 0;
+        return true;
+    }
+
+    bool HttpParser::parseStartLine(std::string_view line) {
+        const size_t sp1 = line.find(' ');
+
+        if (sp1 == std::string_view::npos || sp1 == 0) {
+            setError(HTTP_PARSE_INVALID_START_LINE);
+            return false;
+        }
+
+        if (type_ == HTTP_MSG_REQUEST) {
+            // Request-Line = Method SP Request-URI SP HTTP-Version
+            const size_t sp2 = line.find(' ', sp1 + 1);
+
+            if (sp2 == std::string_view::npos || sp2 == sp1 + 1) {
+                setError(HTTP_PARSE_INVALID_START_LINE);
+                return false;
+            }
+
+            const std::string_view version(line.substr(sp2 + 1));
+
+            if (!parseVersion(version))
+                return false;
+
+            handler_->onRequestLine(line.substr(0, sp1),
+                                    line.substr(sp1 + 1, sp2 - sp1 - 1),
+                                    version);
+            return true;
+        }
+
+        // Status-Line = HTTP-Version SP Status-Code SP Reason-Phrase
+        const std::string_view version(line.substr(0, sp1));
+
+        if (!parseVersion(version))
+            return false;
+
+        const std::string_view rest(line.substr(sp1 + 1));
+
+        if (rest.size() < 3 || (rest.size() > 3 && rest[3] != ' ')) {
+            setError(HTTP_PARSE_INVALID_START_LINE);
+            return false;
+        }
+
+        uint32_t status = 0;
+
+        for (size_t i = 0; i < 3; ++i) {
+            if (rest[i] < '0' || rest[i] > '9') {
+                setError(HTTP_PARSE_INVALID_START_LINE);
+                return false;
+            }
+
+            status = status * 10 + static_cast<uint32_t>(rest[i] - '0');
+        }
+
+        status_ = status;
+        handler_->onStatusLine(version, status,
+                               rest.size() > 4 ? rest.substr(4) : std::string_view());
+        return true;
+    }
+
+    bool HttpParser::parseHeaderLine(std::string_view line) {
+        // 不支持已经废弃的多行字段(obs-fold)
+        if (line.front() == ' ' || line.front() == '\t') {
+            setError(HTTP_PARSE_INVALID_HEADER);
+            return false;
+        }
+
+        const size_t colon = line.find(':');
+
+        if (colon == std::string_view::npos || colon == 0) {
+            setError(HTTP_PARSE_INVALID_HEADER);
+            return false;
+        }
+
+        const std::string_view name(line.substr(0, colon));
+
+        // 字段名和冒号之间不允许有空白
+        if (name.back() == ' ' || name.back() == '\t') {
+            setError(HTTP_PARSE_INVALID_HEADER);
+            return false;
+        }
+
+        const std::string_view value(trimOws(line.substr(colon + 1)));
+
+        if (iequals(name, "Content-Length")) {
+            if (value.empty() || value.size() > 18) {
+                setError(HTTP_PARSE_INVALID_CONTENT_LENGTH);
+                return false;
+            }
+
+            int64_t length = 0;
+
+            for (const char c : value) {
+                if (c < '0' || c > '9') {
+                    setError(HTTP_PARSE_INVALID_CONTENT_LENGTH);
+                    return false;
+                }
+
+                length = length * 10 + (c - '0');
+            }
+
+            if (contentLength_ != -1 && contentLength_ != length) {
+                setError(HTTP_PARSE_INVALID_CONTENT_LENGTH);
+                return false;
+            }
+
+            contentLength_ = length;
+        } else if (iequals(name, "Transfer-Encoding")) {
+            // 只有最后一个编码是 chunked 时，才按 chunked 处理
+            chunked_ = iequals(lastToken(value), "chunked");
+            unknownEncoding_ = !chunked_;
+        } else if (iequals(name, "Connection")) {
+            if (hasToken(value, "close"))
+                connectionClose_ = true;
+            if (hasToken(value, "keep-alive"))
+                connectionKeepAlive_ = true;
+        }
+
+        handler_->onHeader(name, value);
+        return true;
+    }
+
+    // https://tools.ietf.org/html/rfc7230#section-3.3.3
+    bool HttpParser::headersComplete() {
+        bool skip_body = handler_->onHeadersComplete();
+
+        if (state_ == S_ERROR)
+            return false;
+
+        // 1xx、204、304 响应没有消息体
+        if (type_ == HTTP_MSG_RESPONSE
+            && ((status_ >= 100 && status_ < 200) || status_ == 204 || status_ == 304))
+            skip_body = true;
+
+        if (skip_body) {
+            completeMessage();
+            return true;
+        }
+
+        // 同时存在 Transfer-Encoding 和 Content-Length 时，忽略 Content-Length
+        if (chunked_) {
+            state_ = S_CHUNK_SIZE;
+            return true;
+        }
+
+        if (unknownEncoding_) {
+            if (type_ == HTTP_MSG_REQUEST) {
+                setError(HTTP_PARSE_INVALID_TRANSFER_ENCODING);
+                return false;
+            }
+
+            state_ = S_BODY_EOF;
+            return true;
+        }
+
+        if (contentLength_ > 0) {
+            remaining_ = static_cast<uint64_t>(contentLength_);
+            state_ = S_BODY_LENGTH;
+            return true;
+        }
+
+        // 请求没有长度信息时，表示没有消息体；响应则读到连接关闭为止
+        if (contentLength_ == -1 && type_ == HTTP_MSG_RESPONSE) {
+            state_ = S_BODY_EOF;
+            return true;
+        }
+
+        completeMessage();
+        return true;
+    }
+
+    // chunk-size [ chunk-ext ] CRLF
+    bool HttpParser::parseChunkSize(std::string_view line) {
+        uint64_t size = 0;
+        size_t i = 0;
+
+        for (; i < line.size(); ++i) {
+            const int v = hexValue(line[i]);
+
+            if (v < 0)
+                break;
+
+            // 防止溢出
+            if (size > (UINT64_MAX >> 4)) {
+                setError(HTTP_PARSE_INVALID_CHUNK);
+                return false;
+            }
+
+            size = (size << 4) | static_cast<uint64_t>(v);
+        }
+
+        // 至少一个十六进制字符，后面只能是 chunk-ext 或者空白
+        if (i == 0 || (i < line.size() && line[i] != ';' && line[i] != ' ' && line[i] != '\t')) {
+            setError(HTTP_PARSE_INVALID_CHUNK);
+            return false;
+        }
+
+        if (size == 0) {
+            state_ = S_CHUNK_TRAILER;
+        } else {
+            remaining_ = size;
+            state_ = S_CHUNK_DATA;
+        }
+
+        return true;
+    }
+
+} /* namespace happycpp */
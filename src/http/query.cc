@@ -0,0 +1,242 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/http/query.h"
+#include "happycpp/http.h"
+
+namespace happycpp::hchttp {
+
+    QueryArgs::const_iterator::const_iterator(std::string_view query)
+            : rest_(query),
+              done_(false) {
+        ++*this;
+    }
+
+    QueryArgs::const_iterator &QueryArgs::const_iterator::operator++() {
+        while (!rest_.empty()) {
+            const size_t amp = rest_.find('&');
+            const std::string_view item(rest_.substr(0, amp));
+
+            rest_.remove_prefix(amp == std::string_view::npos ? rest_.size() : amp + 1);
+
+            if (item.empty())
+                continue;
+
+            const size_t eq = item.find('=');
+
+            arg_.key = item.substr(0, eq);
+            arg_.value = eq == std::string_view::npos ? std::string_view() : item.substr(eq + 1);
+            return *this;
+        }
+
+        done_ = true;
+        return *this;
+    }
+
+    QueryArgs::const_iterator QueryArgs::const_iterator::operator++(int) {
+        const_iterator tmp(*this);
+        ++*this;
+        return tmp;
+    }
+
+    QueryArgs::QueryArgs(std::string_view query) : query_(query) {
+    }
+
+    QueryArgs::QueryArgs(const QueryArgs &other) : query_(other.query_) {
+    }
+
+    QueryArgs &QueryArgs::operator=(const QueryArgs &other) {
+        if (this != &other)
+            *this = QueryArgs(other.query_);
+
+        return *this;
+    }
+
+    // 移动 std::deque 不会改变元素地址，索引中的视图仍然有效
+    QueryArgs::QueryArgs(QueryArgs &&other) noexcept
+            : query_(other.query_),
+              indexed_(other.indexed_),
+              entries_(std::move(other.entries_)),
+              index_(std::move(other.index_)),
+              decodedKeys_(std::move(other.decodedKeys_)) {
+        other.indexed_ = false;
+    }
+
+    QueryArgs &QueryArgs::operator=(QueryArgs &&other) noexcept {
+        if (this != &other) {
+            query_ = other.query_;
+            indexed_ = other.indexed_;
+            entries_ = std::move(other.entries_);
+            index_ = std::move(other.index_);
+            decodedKeys_ = std::move(other.decodedKeys_);
+            other.indexed_ = false;
+            other.entries_.clear();
+            other.index_.clear();
+        }
+
+        return *this;
+    }
+
+    QueryArgs QueryArgs::fromTarget(std::string_view target) {
+        const size_t hash = target.find('#');
+
+        if (hash != std::string_view::npos)
+            target = target.substr(0, hash);
+
+        const size_t question = target.find('?');
+
+        if (question == std::string_view::npos)
+            return QueryArgs();
+
+        return QueryArgs(target.substr(question + 1));
+    }
+
+    QueryArgs::const_iterator QueryArgs::begin() const {
+        return const_iterator(query_);
+    }
+
+    QueryArgs::const_iterator QueryArgs::end() const {
+        return const_iterator();
+    }
+
+    std::string_view QueryArgs::query() const {
+        return query_;
+    }
+
+    bool QueryArgs::empty() const {
+        return begin() == end();
+    }
+
+    size_t QueryArgs::size() const {
+        buildIndex();
+        return entries_.size();
+    }
+
+    void QueryArgs::buildIndex() const {
+        if (indexed_)
+            return;
+
+        indexed_ = true;
+        entries_.clear();
+        index_.clear();
+        decodedKeys_.clear();
+
+        for (const auto &arg : *this) {
+            std::string_view key(arg.key);
+
+            // 名称很少需要解码，需要时才保存解码后的副本
+            if (key.find_first_of("%+") != std::string_view::npos) {
+                decodedKeys_.push_back(hcurl::decode(key));
+                key = decodedKeys_.back();
+            }
+
+            entries_.push_back(Entry{key, arg.value, kNoEntry});
+        }
+
+        // 从后往前建立链表，每个名称在链表头部的是第一次出现的参数
+        if (entries_.size() > kLinearScanMax) {
+            index_.reserve(entries_.size());
+
+            for (size_t i = entries_.size(); i-- > 0;) {
+                const auto ret = index_.emplace(entries_[i].key, static_cast<uint32_t>(i));
+
+                if (!ret.second) {
+                    entries_[i].next = ret.first->second;
+                    ret.first->second = static_cast<uint32_t>(i);
+                }
+            }
+        } else {
+            for (size_t i = entries_.size(); i-- > 0;) {
+                for (size_t j = i + 1; j < entries_.size(); ++j) {
+                    if (entries_[j].key == entries_[i].key) {
+                        entries_[i].next = static_cast<uint32_t>(j);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    uint32_t QueryArgs::find(std::string_view key) const {
+        buildIndex();
+
+        if (entries_.size() > kLinearScanMax) {
+            const auto it = index_.find(key);
+            return it == index_.end() ? kNoEntry : it->second;
+        }
+
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            if (entries_[i].key == key)
+                return static_cast<uint32_t>(i);
+        }
+
+        return kNoEntry;
+    }
+
+    bool QueryArgs::has(std::string_view key) const {
+        return find(key) != kNoEntry;
+    }
+
+    size_t QueryArgs::count(std::string_view key) const {
+        size_t n = 0;
+
+        for (uint32_t i = find(key); i != kNoEntry; i = entries_[i].next)
+            ++n;
+
+        return n;
+    }
+
+    std::optional<std::string_view> QueryArgs::raw(std::string_view key) const {
+        const uint32_t i = find(key);
+
+        if (i == kNoEntry)
+            return std::nullopt;
+
+        return entries_[i].value;
+    }
+
+    std::optional<std::string> QueryArgs::get(std::string_view key) const {
+        const uint32_t i = find(key);
+
+        if (i == kNoEntry)
+            return std::nullopt;
+
+        return hcurl::decode(entries_[i].value);
+    }
+
+    std::string QueryArgs::get(std::string_view key, std::string_view def) const {
+        const uint32_t i = find(key);
+
+        if (i == kNoEntry)
+            return std::string(def);
+
+        return hcurl::decode(entries_[i].value);
+    }
+
+    std::vector<std::string> QueryArgs::getAll(std::string_view key) const {
+        std::vector<std::string> values;
+
+        for (uint32_t i = find(key); i != kNoEntry; i = entries_[i].next)
+            values.push_back(hcurl::decode(entries_[i].value));
+
+        return values;
+    }
+
+} /* namespace happycpp */
@@ -0,0 +1,348 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/http/serializer.h"
+#include "happycpp/exception.h"
+#include <algorithm>
+#include <charconv>
+#include <ctime>
+
+namespace happycpp::hchttp {
+
+    namespace {
+
+        const std::string_view kHttp10("HTTP/1.0");
+        const std::string_view kHttp11("HTTP/1.1");
+        const std::string_view kSp(" ");
+        const std::string_view kColon(": ");
+        const std::string_view kCrlf("\r\n");
+
+        struct StatusEntry {
+            uint32_t status;
+            std::string_view reason;
+            std::string_view line11; /*! 完整的 HTTP/1.1 状态行，包括 CRLF */
+            std::string_view line10; /*! 完整的 HTTP/1.0 状态行，包括 CRLF */
+        };
+
+#define HC_STATUS(code, reason) \
+        {code, reason, "HTTP/1.1 " #code " " reason "\r\n", "HTTP/1.0 " #code " " reason "\r\n"}
+
+        constexpr StatusEntry kStatus[] = {
+                HC_STATUS(100, "Continue"),
+                HC_STATUS(101, "Switching Protocols"),
+                HC_STATUS(200, "OK"),
+                HC_STATUS(201, "Created"),
+                HC_STATUS(202, "Accepted"),
+                HC_STATUS(203, "Non-Authoritative Information"),
+                HC_STATUS(204, "No Content"),
+                HC_STATUS(205, "Reset Content"),
+                HC_STATUS(206, "Partial Content"),
+                HC_STATUS(300, "Multiple Choices"),
+                HC_STATUS(301, "Moved Permanently"),
+                HC_STATUS(302, "Found"),
+                HC_STATUS(303, "See Other"),
+                HC_STATUS(304, "Not Modified"),
+                HC_STATUS(307, "Temporary Redirect"),
+                HC_STATUS(308, "Permanent Redirect"),
+                HC_STATUS(400, "Bad Request"),
+                HC_STATUS(401, "Unauthorized"),
+                HC_STATUS(402, "Payment Required"),
+                HC_STATUS(403, "Forbidden"),
+                HC_STATUS(404, "Not Found"),
+                HC_STATUS(405, "Method Not Allowed"),
+                HC_STATUS(406, "Not Acceptable"),
+                HC_STATUS(407, "Proxy Authentication Required"),
+                HC_STATUS(408, "Request Timeout"),
+                HC_STATUS(409, "Conflict"),
+                HC_STATUS(410, "Gone"),
+                HC_STATUS(411, "Length Required"),
+                HC_STATUS(412, "Precondition Failed"),
+                HC_STATUS(413, "Payload Too Large"),
+                HC_STATUS(414, "URI Too Long"),
+                HC_STATUS(415, "Unsupported Media Type"),
+                HC_STATUS(416, "Range Not Satisfiable"),
+                HC_STATUS(417, "Expectation Failed"),
+                HC_STATUS(426, "Upgrade Required"),
+                HC_STATUS(428, "Precondition Required"),
+                HC_STATUS(429, "Too Many Requests"),
+                HC_STATUS(431, "Request Header Fields Too Large"),
+                HC_STATUS(500, "Internal Server Error"),
+                HC_STATUS(501, "Not Implemented"),
+                HC_STATUS(502, "Bad Gateway"),
+                HC_STATUS(503, "Service Unavailable"),
+                HC_STATUS(504, "Gateway Timeout"),
+                HC_STATUS(505, "HTTP Version Not Supported"),
+        };
+
+#undef HC_STATUS
+
+        constexpr uint32_t kMaxStatus = 600;
+
+        // 状态码 -> kStatus 下标 + 1，0 表示不存在
+        struct StatusIndex {
+            uint8_t v[kMaxStatus];
+        };
+
+        constexpr StatusIndex buildStatusIndex() {
+            StatusIndex idx{};
+
+            for (size_t i = 0; i < std::size(kStatus); ++i)
+                idx.v[kStatus[i].status] = static_cast<uint8_t>(i + 1);
+
+            return idx;
+        }
+
+        constexpr StatusIndex kStatusIndex = buildStatusIndex();
+
+        const StatusEntry *findStatus(uint32_t status) {
+            if (status >= kMaxStatus || kStatusIndex.v[status] == 0)
+                return nullptr;
+
+            return &kStatus[kStatusIndex.v[status] - 1];
+        }
+
+        // IMF-fixdate 固定为 29 个字符
+        constexpr size_t kHttpDateSize = 29;
+
+        struct DateCache {
+            time_t sec = -1;
+            char buf[kHttpDateSize];
+        };
+
+        thread_local DateCache dateCache;
+
+        // 不使用 strftime，星期和月份名称与 locale 无关
+        void writeHttpDate(time_t t, char *buf) {
+            static const char kDays[][4] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+            static const char kMonths[][4] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                              "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+            struct tm tm{};
+
+#ifdef PLATFORM_WIN32
+            gmtime_s(&tm, &t);
+#else
+            gmtime_r(&t, &tm);
+#endif
+
+            const auto put2 = [](char *p, int v) {
+                p[0] = static_cast<char>('0' + v / 10);
+                p[1] = static_cast<char>('0' + v % 10);
+            };
+            const int year = tm.tm_year + 1900;
+
+            // "Sun, 06 Nov 1994 08:49:37 GMT"
+            std::copy_n(kDays[tm.tm_wday], 3, buf);
+            std::copy_n(", ", 2, buf + 3);
+            put2(buf + 5, tm.tm_mday);
+            buf[7] = ' ';
+            std::copy_n(kMonths[tm.tm_mon], 3, buf + 8);
+            buf[11] = ' ';
+            put2(buf + 12, year / 100 % 100);
+            put2(buf + 14, year % 100);
+            buf[16] = ' ';
+            put2(buf + 17, tm.tm_hour);
+            buf[19] = ':';
+            put2(buf + 20, tm.tm_min);
+            buf[22] = ':';
+            put2(buf + 23, tm.tm_sec);
+            std::copy_n(" GMT", 4, buf + 25);
+        }
+
+    } /* namespace */
+
+    std::string_view reasonPhrase(uint32_t status) {
+        const StatusEntry *e = findStatus(status);
+        return e == nullptr ? std::string_view() : e->reason;
+    }
+
+    std::string_view httpDate() {
+        const time_t now = time(nullptr);
+
+        // 长度固定，同一个线程中之前返回的视图在刷新之后仍然有效
+        if (now != dateCache.sec) {
+            writeHttpDate(now, dateCache.buf);
+            dateCache.sec = now;
+        }
+
+        return std::string_view(dateCache.buf, kHttpDateSize);
+    }
+
+    std::string formatHttpDate(time_t t) {
+        std::string s(kHttpDateSize, '\0');
+        writeHttpDate(t, &s[0]);
+        return s;
+    }
+
+    HttpWireMsg::HttpWireMsg()
+            : scratch_(kScratchSize),
+              scratchUsed_(0),
+              bytes_(0) {
+        iov_.reserve(32);
+    }
+
+    HttpWireMsg::HttpWireMsg(HttpWireMsg &&other)
+            : HttpWireMsg() {
+        *this = std::move(other);
+    }
+
+    HttpWireMsg &HttpWireMsg::operator=(HttpWireMsg &&other) noexcept {
+        if (this == &other)
+            return *this;
+
+        // 交换而不是移走缓冲区，iovec 仍然指向原来的 scratch_，源对象也一直有可用的 scratch_
+        iov_.swap(other.iov_);
+        scratch_.swap(other.scratch_);
+        scratchUsed_ = other.scratchUsed_;
+        bytes_ = other.bytes_;
+        other.clear();
+        return *this;
+    }
+
+    const struct iovec *HttpWireMsg::iov() const {
+        return iov_.data();
+    }
+
+    size_t HttpWireMsg::iovCount() const {
+        return iov_.size();
+    }
+
+    size_t HttpWireMsg::bytes() const {
+        return bytes_;
+    }
+
+    std::string HttpWireMsg::toString() const {
+        std::string s;
+        s.reserve(bytes_);
+
+        for (const auto &v : iov_)
+            s.append(static_cast<const char *>(v.iov_base), v.iov_len);
+
+        return s;
+    }
+
+    void HttpWireMsg::clear() {
+        iov_.clear();
+        scratchUsed_ = 0;
+        bytes_ = 0;
+    }
+
+    void HttpWireMsg::append(std::string_view s) {
+        if (s.empty())
+            return;
+
+        iov_.push_back(iovec{const_cast<char *>(s.data()), s.size()});
+        bytes_ += s.size();
+    }
+
+    void HttpWireMsg::appendCopy(std::string_view s) {
+        HAPPY_ASSERT(scratchUsed_ + s.size() <= kScratchSize);
+
+        char *p = scratch_.data() + scratchUsed_;
+        std::copy(s.begin(), s.end(), p);
+        scratchUsed_ += s.size();
+        append(std::string_view(p, s.size()));
+    }
+
+    void serialize(const HttpMessage &hm, HttpWireMsg *out) {
+        out->clear();
+
+        const std::string_view version(hm.version().empty() ? kHttp11 : hm.version());
+        char digits[24];
+        bool hasBody = !hm.body().empty();
+
+        if (hm.type() == HTTP_MSG_RESPONSE) {
+            const auto &resp = static_cast<const HttpResponseMsg &>(hm);
+            const uint32_t status = resp.status();
+            const StatusEntry *e = findStatus(status);
+            const std::string_view reason(resp.reasonPhrase());
+
+            if (e != nullptr && (reason.empty() || reason == e->reason)
+                && (version == kHttp11 || version == kHttp10)) {
+                out->append(version == kHttp11 ? e->line11 : e->line10);
+            } else {
+                const auto ret = std::to_chars(digits, digits + sizeof(digits), status);
+
+                out->append(version);
+                out->append(kSp);
+                out->appendCopy(std::string_view(digits, static_cast<size_t>(ret.ptr - digits)));
+                out->append(kSp);
+                out->append(reason.empty() && e != nullptr ? e->reason : reason);
+                out->append(kCrlf);
+            }
+
+            // 这些响应不能包含消息体
+            if (status < 200 || status == 204 || status == 304)
+                hasBody = false;
+            else
+                hasBody = true;
+        } else if (hm.type() == HTTP_MSG_REQUEST) {
+            const auto &req = static_cast<const HttpRequestMsg &>(hm);
+            const std::string_view method(HttpMessage::toName(req.method()));
+
+            if (method.empty())
+                ThrowHappyException("Invalid http method.");
+
+            out->append(method);
+            out->append(kSp);
+            out->append(req.requestUrl().empty() ? std::string_view("/") : req.requestUrl());
+            out->append(kSp);
+            out->append(version);
+            out->append(kCrlf);
+        } else {
+            ThrowHappyException("Invalid http message type.");
+        }
+
+        hm.forEachField([out](std::string_view name, std::string_view value) {
+            out->append(name);
+            out->append(kColon);
+            out->append(value);
+            out->append(kCrlf);
+        });
+
+        if (hm.type() == HTTP_MSG_RESPONSE && hm.header(HTTP_MCOMF_DATE).empty()) {
+            out->append(HttpMessage::toName(HTTP_MCOMF_DATE));
+            out->append(kColon);
+            out->append(httpDate());
+            out->append(kCrlf);
+        }
+
+        if (hasBody && hm.header(HTTP_MCOMF_CONTENT_LENGTH).empty()
+            && hm.header(HTTP_MRESF_TRANSFER_ENCODING).empty()) {
+            const auto ret = std::to_chars(digits, digits + sizeof(digits), hm.body().size());
+
+            out->append(HttpMessage::toName(HTTP_MCOMF_CONTENT_LENGTH));
+            out->append(kColon);
+            out->appendCopy(std::string_view(digits, static_cast<size_t>(ret.ptr - digits)));
+            out->append(kCrlf);
+        }
+
+        out->append(kCrlf);
+
+        if (hasBody)
+            out->append(hm.body());
+    }
+
+    HttpWireMsg serialize(const HttpMessage &hm) {
+        HttpWireMsg out;
+        serialize(hm, &out);
+        return out;
+    }
+
+} /* namespace happycpp */
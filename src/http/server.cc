@@ -0,0 +1,1067 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/http/server.h"
+#include "happycpp/http/parser.h"
+#include "happycpp/http/serializer.h"
+#include "happycpp/http/static.h"
+#include "happycpp/exception.h"
+#include "happycpp/filesys.h"
+#include "happycpp/hcerrno.h"
+#include "happycpp/log.h"
+#include "text.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using happycpp::hcerrno::errorToStr;
+
+namespace happycpp::hchttp {
+
+    namespace {
+
+        const int kMaxEvents = 256;
+        const int kSweepIntervalMs = 1000;
+        const int64_t kLingerMs = 5000;
+        const size_t kMaxIov = 1024; // IOV_MAX
+        const size_t kMaxFreeBuffers = 256;
+        const size_t kMinReadBufferSize = 1024;
+
+        int64_t nowMs() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        void closeFd(int fd) {
+            if (fd >= 0)
+                close(fd);
+        }
+
+        //! 路由。root 不为空时为静态文件目录，否则调用 handler
+        struct Route {
+            std::string prefix;
+            HttpHandler handler;
+            std::string root;
+        };
+
+        typedef std::vector<Route> RouteList;
+
+        int hexValue(char c) {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+
+            c = static_cast<char>(c | 0x20);
+            return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        }
+
+        //! 把请求路径映射到 root 下的文件
+        /*!
+         路径中的 "+" 不是空格，只解码 "%XX"。格式错误、包含 NUL 或者 ".." 时返回 false，
+         不允许访问 root 之外的文件。以 "/" 结尾时映射到该目录下的 index.html。
+         */
+        bool mapPath(const Route &route, const std::string &url, std::string *path) {
+            std::string rel;
+            rel.reserve(url.size() - route.prefix.size());
+
+            for (size_t i = route.prefix.size(); i < url.size(); ++i) {
+                char c = url[i];
+
+                if (c == '%') {
+                    const int hi = i + 2 < url.size() ? hexValue(url[i + 1]) : -1;
+                    const int lo = hi < 0 ? -1 : hexValue(url[i + 2]);
+
+                    if (lo < 0)
+                        return false;
+
+                    c = static_cast<char>(hi << 4 | lo);
+                    i += 2;
+                }
+
+                if (c == '\0')
+                    return false;
+
+                rel.push_back(c);
+            }
+
+            for (size_t begin = 0; begin <= rel.size();) {
+                size_t end = rel.find('/', begin);
+
+                if (end == std::string::npos)
+                    end = rel.size();
+
+                if (rel.compare(begin, end - begin, "..") == 0)
+                    return false;
+
+                begin = end + 1;
+            }
+
+            path->assign(route.root);
+
+            if (rel.empty() || rel.front() != '/')
+                path->push_back('/');
+
+            path->append(rel);
+
+            if (path->back() == '/')
+                path->append("index.html");
+
+            return true;
+        }
+
+        //! 读缓冲区池，每个事件循环一个，不需要加锁
+        class BufferPool {
+        public:
+            explicit BufferPool(size_t size) : size_(size) {}
+
+            std::unique_ptr<char[]> acquire() {
+                if (free_.empty())
+                    return std::unique_ptr<char[]>(new char[size_]);
+
+                std::unique_ptr<char[]> buf(std::move(free_.back()));
+                free_.pop_back();
+                return buf;
+            }
+
+            void release(std::unique_ptr<char[]> buf) {
+                if (buf && free_.size() < kMaxFreeBuffers)
+                    free_.push_back(std::move(buf));
+            }
+
+            [[nodiscard]] size_t size() const {
+                return size_;
+            }
+
+        private:
+            const size_t size_;
+            std::vector<std::unique_ptr<char[]> > free_;
+        };
+
+        //! 等待发送的响应。wire 指向 resp，所以放在 deque 中，地址不会改变
+        struct PendingResponse {
+            HttpResponseMsg resp;
+            HttpWireMsg wire;
+            size_t sent = 0; /*! wire 已经发送的字节数 */
+
+            // 静态文件：wire 发送完之后，通过 sendFileParts 发送 parts
+            int fileFd = -1;
+            std::vector<BodyPart> parts;
+            size_t partIndex = 0;
+            uint64_t partSent = 0;
+
+            PendingResponse() = default;
+
+            PendingResponse(const PendingResponse &) = delete;
+
+            PendingResponse &operator=(const PendingResponse &) = delete;
+
+            ~PendingResponse() {
+                closeFd(fileFd);
+            }
+        };
+
+        class Reactor;
+
+        //! 单个连接。HttpParser 的回调把请求填充到 HttpRequestMsg，每个完整的请求立刻处理
+        class Connection : public HttpParserHandler {
+        public:
+            Connection(Reactor *reactor, int fd, size_t maxLineSize)
+                    : fd(fd),
+                      events(0),
+                      used(0),
+                      closing(false),
+                      peerClosed(false),
+                      lingering(false),
+                      lastActive(nowMs()),
+                      parser(this, HTTP_MSG_REQUEST),
+                      reactor_(reactor) {
+                parser.setMaxLineSize(maxLineSize);
+            }
+
+            ~Connection() override {
+                closeFd(fd);
+            }
+
+            void onMessageBegin() override;
+
+            void onRequestLine(std::string_view method, std::string_view target,
+                               std::string_view version) override {
+                HttpMsgCtx::parseRequestLine(method, target, version, req_);
+            }
+
+            void onHeader(std::string_view name, std::string_view value) override {
+                req_->addField(name, value);
+            }
+
+            bool onHeadersComplete() override;
+
+            void onBody(std::string_view data) override;
+
+            void onMessageComplete() override;
+
+            //! 返回错误响应，发送完之后关闭连接
+            void reject(uint32_t status);
+
+            const int fd;
+            uint32_t events; /*! 当前在 epoll 中注册的事件 */
+            std::unique_ptr<char[]> buf; /*! 读缓冲区，空闲时归还给 BufferPool */
+            size_t used; /*! buf 中尚未解析的数据长度 */
+            bool closing; /*! 不再处理新的请求，响应发送完之后关闭 */
+            bool peerClosed; /*! 对端已经关闭写 */
+            bool lingering; /*! 已经关闭写，丢弃收到的数据，直到对端关闭或者超时 */
+            int64_t lastActive;
+            HttpParser parser;
+            std::deque<PendingResponse> out;
+
+        private:
+            Reactor *const reactor_;
+            HttpRequestMsgPtr req_;
+            std::string body_;
+            bool rejected_ = false;
+
+            PendingResponse &push(const std::string &version, uint32_t status);
+        };
+
+        //! 事件循环，每个线程一个
+        class Reactor {
+        public:
+            Reactor(const HttpServerOptions &options, const RouteList &routes, int listenFd)
+                    : options_(options),
+                      routes_(routes),
+                      listenFd_(listenFd),
+                      epollFd_(-1),
+                      wakeFd_(-1),
+                      pool_(options.readBufferSize),
+                      hlog_(happycpp::log::HappyLog::instance()) {
+                epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+                wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+                if (epollFd_ < 0 || wakeFd_ < 0) {
+                    const std::string error(errorToStr());
+                    closeFd(epollFd_);
+                    closeFd(wakeFd_);
+                    ThrowHappyException(error);
+                }
+
+                // 连接的 data.ptr 指向 Connection，监听套接字和 wakeFd_ 指向对应的成员变量
+                addFd(listenFd_, &listenFd_);
+                addFd(wakeFd_, &wakeFd_);
+            }
+
+            ~Reactor() {
+                conns_.clear();
+                closeFd(listenFd_);
+                closeFd(wakeFd_);
+                closeFd(epollFd_);
+            }
+
+            void run(const std::atomic<bool> &running);
+
+            void wakeup() {
+                const uint64_t one = 1;
+                [[maybe_unused]] const ssize_t ret = write(wakeFd_, &one, sizeof(one));
+            }
+
+            [[nodiscard]] const HttpServerOptions &options() const {
+                return options_;
+            }
+
+            //! 路由并处理请求，结果保存在 p 中
+            void handle(const HttpRequestMsg &req, PendingResponse *p);
+
+        private:
+            const HttpServerOptions &options_;
+            const RouteList &routes_;
+            const int listenFd_;
+            int epollFd_;
+            int wakeFd_;
+            BufferPool pool_;
+            std::unordered_map<int, std::unique_ptr<Connection> > conns_;
+            happycpp::log::HappyLog &hlog_;
+
+            void addFd(int fd, const void *tag) {
+                struct epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.ptr = const_cast<void *>(tag);
+                epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
+            }
+
+            void accept();
+
+            void sweep();
+
+            //! 处理静态文件请求，只设置消息头，文件内容在 flush 中通过 sendfile 发送
+            void serveFile(const Route &route, const HttpRequestMsg &req, PendingResponse *p);
+
+            void closeConnection(Connection *c);
+
+            //! 根据连接状态更新 epoll 事件
+            void updateEvents(Connection *c);
+
+            void onReadable(Connection *c);
+
+            void onWritable(Connection *c);
+
+            //! 关闭写，等待对端关闭
+            /*!
+             接收缓冲区中还有数据时直接 close 会发送 RST，对端可能来不及读取最后的响应。
+             */
+            void linger(Connection *c);
+
+            void drain(Connection *c);
+
+            //! 读写之后，关闭已经结束的连接，或者更新 epoll 事件
+            void settle(Connection *c);
+
+            //! 解析缓冲区中的请求。连接被关闭时返回 false
+            bool process(Connection *c);
+
+            //! 尽可能发送所有响应。连接被关闭时返回 false
+            bool flush(Connection *c);
+        };
+
+        void Connection::onMessageBegin() {
+            req_ = std::make_shared<HttpRequestMsg>();
+            body_.clear();
+        }
+
+        bool Connection::onHeadersComplete() {
+            if (parser.contentLength() > static_cast<int64_t>(reactor_->options().maxBodySize)) {
+                reject(413);
+                return false;
+            }
+
+            // 请求体由 curl 等客户端在收到 100 Continue 之后才发送，没有请求体时不需要回复。
+            // 只支持 100-continue，其它期望回复 417。HTTP/1.0 的 Expect 直接忽略
+            const std::string_view expect(detail::trimOws(req_->header(HTTP_MREQF_EXPECT)));
+
+            if (!expect.empty() && parser.httpMajor() == 1 && parser.httpMinor() >= 1) {
+                if (!detail::iequals(expect, "100-continue")) {
+                    reject(417);
+                    return false;
+                }
+
+                if (parser.contentLength() > 0 || parser.chunked())
+                    push(req_->version(), 100);
+            }
+
+            if (parser.contentLength() > 0)
+                body_.reserve(static_cast<size_t>(parser.contentLength()));
+
+            return false;
+        }
+
+        void Connection::onBody(std::string_view data) {
+            if (rejected_)
+                return;
+
+            if (body_.size() + data.size() > reactor_->options().maxBodySize) {
+                reject(413);
+                return;
+            }
+
+            body_.append(data);
+        }
+
+        void Connection::onMessageComplete() {
+            if (rejected_)
+                return;
+
+            req_->setBody(std::move(body_));
+            body_.clear();
+
+            PendingResponse &p = push(req_->version(), 200);
+            HttpResponseMsg &resp = p.resp;
+
+            reactor_->handle(*req_, &p);
+
+            if (!parser.keepAlive() || resp.header(HTTP_MCOMF_CONNECTION) == "close") {
+                closing = true;
+                parser.pause();
+            }
+
+            if (closing)
+                resp.setField(HTTP_MCOMF_CONNECTION, "close");
+            else if (parser.httpMinor() == 0 && resp.header(HTTP_MCOMF_CONNECTION).empty())
+                resp.setField(HTTP_MCOMF_CONNECTION, "keep-alive");
+
+            // HEAD 的响应保留 Content-Length，不发送消息体
+            if (req_->method() == HTTP_METHOD_HEAD && !resp.body().empty()) {
+                if (resp.header(HTTP_MCOMF_CONTENT_LENGTH).empty()
+                    && resp.header(HTTP_MRESF_TRANSFER_ENCODING).empty())
+                    resp.setField(HTTP_MCOMF_CONTENT_LENGTH, std::to_string(resp.body().size()));
+
+                resp.setBody(std::string());
+            }
+
+            serialize(resp, &p.wire);
+            req_.reset();
+
+            // 太多响应没有发送，暂停解析，由 Reactor::process 先发送
+            if (out.size() >= reactor_->options().maxPipeline)
+                parser.pause();
+        }
+
+        void Connection::reject(uint32_t status) {
+            PendingResponse &p = push(req_ ? req_->version() : std::string(), status);
+
+            p.resp.setField(HTTP_MCOMF_CONNECTION, "close");
+            serialize(p.resp, &p.wire);
+
+            rejected_ = true;
+            closing = true;
+            parser.pause();
+        }
+
+        PendingResponse &Connection::push(const std::string &version, uint32_t status) {
+            PendingResponse &p = out.emplace_back();
+
+            p.resp.setVersion(version == "HTTP/1.0" ? version : "HTTP/1.1");
+            p.resp.setStatus(status);
+
+            if (status == 100)
+                serialize(p.resp, &p.wire);
+
+            return p;
+        }
+
+        void Reactor::handle(const HttpRequestMsg &req, PendingResponse *p) {
+            HttpResponseMsg *resp = &p->resp;
+
+            if (req.method() == INVALID_HTTP_METHOD) {
+                resp->setStatus(501);
+                return;
+            }
+
+            const std::string &url = req.url();
+
+            // routes_ 按前缀长度降序排列，第一个匹配的就是最长前缀。
+            // 按路径段匹配："/api" 匹配 "/api" 和 "/api/x"，不匹配 "/apix"
+            const auto it = std::find_if(routes_.begin(), routes_.end(), [&url](const auto &r) {
+                const size_t n = r.prefix.size();
+                return url.compare(0, n, r.prefix) == 0
+                       && (n == url.size() || n == 0 || r.prefix[n - 1] == '/' || url[n] == '/');
+            });
+
+            if (it == routes_.end()) {
+                resp->setStatus(404);
+                return;
+            }
+
+            if (!it->root.empty()) {
+                serveFile(*it, req, p);
+                return;
+            }
+
+            try {
+                it->handler(req, resp);
+
+                // 压缩器来自当前事件循环线程的池，不会重复初始化
+                if (options_.compress)
+                    compressResponse(req, resp, options_.compressOptions);
+
+                return;
+            } catch (const std::exception &e) {
+                hlog_.error(e);
+            } catch (...) {
+                hlog_.error("HttpServer handler threw an unknown exception.");
+            }
+
+            resp->clearFields();
+            resp->setBody(std::string());
+            resp->setReasonPhrase(std::string());
+            resp->setStatus(500);
+        }
+
+        void Reactor::serveFile(const Route &route, const HttpRequestMsg &req, PendingResponse *p) {
+            HttpResponseMsg *resp = &p->resp;
+
+            if (req.method() != HTTP_METHOD_GET && req.method() != HTTP_METHOD_HEAD) {
+                resp->setStatus(405);
+                resp->setField(HTTP_MRESF_ALLOW, "GET, HEAD");
+                return;
+            }
+
+            std::string path;
+            FileStat fs;
+
+            if (!mapPath(route, req.url(), &path) || !hcfilesys::getFileStat(path, &fs) || fs.type != kFile) {
+                resp->setStatus(404);
+                return;
+            }
+
+            prepareFileResponse(req, fs, resp, &p->parts);
+
+            if (p->parts.empty())
+                return;
+
+            p->fileFd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if (p->fileFd < 0) {
+                p->parts.clear();
+                resp->clearFields();
+                resp->setStatus(errno == EACCES ? 403 : 404);
+            }
+        }
+
+        void Reactor::run(const std::atomic<bool> &running) {
+            // sendfile 不支持 MSG_NOSIGNAL，对端关闭时产生的 SIGPIPE 留在本线程中，不会终止进程
+            sigset_t mask;
+            sigemptyset(&mask);
+            sigaddset(&mask, SIGPIPE);
+            pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+            struct epoll_event events[kMaxEvents];
+            int64_t lastSweep = nowMs();
+
+            while (running.load(std::memory_order_acquire)) {
+                const int n = epoll_wait(epollFd_, events, kMaxEvents, kSweepIntervalMs);
+
+                for (int i = 0; i < n; ++i) {
+                    void *tag = events[i].data.ptr;
+                    auto *c = static_cast<Connection *>(tag);
+
+                    if (tag == &listenFd_) {
+                        accept();
+                    } else if (tag == &wakeFd_) {
+                        uint64_t v;
+                        [[maybe_unused]] const ssize_t ret = read(wakeFd_, &v, sizeof(v));
+                    } else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                        closeConnection(c);
+                    } else if (c->lingering) {
+                        drain(c);
+                    } else {
+                        // 先写后读，onReadable 可能关闭连接
+                        if (events[i].events & EPOLLOUT)
+                            onWritable(c);
+                        else if (events[i].events & EPOLLIN)
+                            onReadable(c);
+                    }
+                }
+
+                const int64_t now = nowMs();
+
+                if (now - lastSweep >= kSweepIntervalMs) {
+                    lastSweep = now;
+                    sweep();
+                }
+            }
+        }
+
+        void Reactor::accept() {
+            for (;;) {
+                const int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+                if (fd < 0) {
+                    if (errno == EINTR)
+                        continue;
+
+                    // EAGAIN 表示没有新连接，其它错误(比如 EMFILE)等下次再试
+                    return;
+                }
+
+                const int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+                auto c = std::make_unique<Connection>(this, fd, pool_.size());
+                struct epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.ptr = c.get();
+
+                if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) != 0)
+                    continue;
+
+                c->events = EPOLLIN;
+                conns_.emplace(fd, std::move(c));
+            }
+        }
+
+        void Reactor::sweep() {
+            const int64_t now = nowMs();
+            std::vector<Connection *> expired;
+
+            for (const auto &it : conns_) {
+                const Connection *c = it.second.get();
+
+                if (c->lingering) {
+                    if (now - c->lastActive > kLingerMs)
+                        expired.push_back(it.second.get());
+                } else if (options_.keepAliveTimeoutMs != 0
+                           && now - c->lastActive > options_.keepAliveTimeoutMs) {
+                    expired.push_back(it.second.get());
+                }
+            }
+
+            for (Connection *c : expired)
+                closeConnection(c);
+        }
+
+        void Reactor::closeConnection(Connection *c) {
+            epoll_ctl(epollFd_, EPOLL_CTL_DEL, c->fd, nullptr);
+            pool_.release(std::move(c->buf));
+            conns_.erase(c->fd);
+        }
+
+        void Reactor::updateEvents(Connection *c) {
+            const bool blocked = c->parser.paused() && c->out.size() >= options_.maxPipeline;
+            uint32_t events = 0;
+
+            if (!c->closing && !c->peerClosed && !blocked && c->used < pool_.size())
+                events |= EPOLLIN;
+
+            if (!c->out.empty())
+                events |= EPOLLOUT;
+
+            if (events == c->events)
+                return;
+
+            struct epoll_event ev{};
+            ev.events = events;
+            ev.data.ptr = c;
+            epoll_ctl(epollFd_, EPOLL_CTL_MOD, c->fd, &ev);
+            c->events = events;
+        }
+
+        void Reactor::onReadable(Connection *c) {
+            if (!c->buf)
+                c->buf = pool_.acquire();
+
+            const ssize_t n = read(c->fd, c->buf.get() + c->used, pool_.size() - c->used);
+
+            if (n < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    closeConnection(c);
+
+                return;
+            }
+
+            c->lastActive = nowMs();
+
+            if (n == 0)
+                c->peerClosed = true;
+            else
+                c->used += static_cast<size_t>(n);
+
+            if (process(c))
+                settle(c);
+        }
+
+        void Reactor::onWritable(Connection *c) {
+            // 发送之后，继续解析因为 pipelining 暂停的请求
+            if (flush(c) && process(c))
+                settle(c);
+        }
+
+        void Reactor::settle(Connection *c) {
+            if (c->peerClosed && c->out.empty()) {
+                closeConnection(c);
+                return;
+            }
+
+            // 没有未解析的数据时归还缓冲区，空闲的 keep-alive 连接不占用读缓冲区
+            if (c->used == 0)
+                pool_.release(std::move(c->buf));
+
+            updateEvents(c);
+        }
+
+        bool Reactor::process(Connection *c) {
+            while (!c->closing) {
+                if (c->parser.paused()) {
+                    if (c->out.size() >= options_.maxPipeline)
+                        break;
+
+                    c->parser.resume();
+                }
+
+                if (c->used == 0)
+                    break;
+
+                const size_t n = c->parser.execute(c->buf.get(), c->used);
+
+                if (n > 0) {
+                    c->used -= n;
+                    memmove(c->buf.get(), c->buf.get() + n, c->used);
+                }
+
+                if (c->parser.error() != HTTP_PARSE_OK) {
+                    c->reject(c->parser.error() == HTTP_PARSE_LINE_TOO_LONG ? 431 : 400);
+                    break;
+                }
+
+                if (!c->parser.paused()) {
+                    // 缓冲区已满，仍然不是完整的一行
+                    if (c->used == pool_.size())
+                        c->reject(431);
+
+                    break;
+                }
+
+                if (!flush(c))
+                    return false;
+            }
+
+            return flush(c);
+        }
+
+        bool Reactor::flush(Connection *c) {
+            struct iovec iov[kMaxIov];
+
+            while (!c->out.empty()) {
+                PendingResponse &front = c->out.front();
+
+                if (!front.parts.empty() && front.sent == front.wire.bytes()) {
+                    const int ret = sendFileParts(c->fd, front.fileFd, front.parts,
+                                                  &front.partIndex, &front.partSent);
+
+                    if (ret < 0) {
+                        closeConnection(c);
+                        return false;
+                    }
+
+                    c->lastActive = nowMs();
+
+                    if (ret == 0)
+                        return true;
+
+                    c->out.pop_front();
+                    continue;
+                }
+
+                size_t count = 0;
+                bool more = false;
+
+                for (auto it = c->out.begin(); it != c->out.end() && count < kMaxIov; ++it) {
+                    const struct iovec *v = it->wire.iov();
+                    size_t skip = it->sent;
+
+                    for (size_t i = 0; i < it->wire.iovCount() && count < kMaxIov; ++i) {
+                        if (skip >= v[i].iov_len) {
+                            skip -= v[i].iov_len;
+                            continue;
+                        }
+
+                        iov[count].iov_base = static_cast<char *>(v[i].iov_base) + skip;
+                        iov[count].iov_len = v[i].iov_len - skip;
+                        skip = 0;
+                        ++count;
+                    }
+
+                    // 文件内容不在 iov 中，先发送到该响应的消息头为止，MSG_MORE 让消息头和文件内容合并
+                    if (!it->parts.empty()) {
+                        more = true;
+                        break;
+                    }
+                }
+
+                struct msghdr msg{};
+                msg.msg_iov = iov;
+                msg.msg_iovlen = count;
+
+                // MSG_NOSIGNAL: 对端关闭时不产生 SIGPIPE
+                const ssize_t n = sendmsg(c->fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+
+                if (n < 0) {
+                    if (errno == EINTR)
+                        continue;
+
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                        return true;
+
+                    closeConnection(c);
+                    return false;
+                }
+
+                c->lastActive = nowMs();
+
+                for (auto left = static_cast<size_t>(n); left > 0;) {
+                    PendingResponse &p = c->out.front();
+                    const size_t remain = p.wire.bytes() - p.sent;
+
+                    if (left < remain) {
+                        p.sent += left;
+                        break;
+                    }
+
+                    left -= remain;
+                    p.sent += remain;
+
+                    // 还有文件内容，下一轮循环发送
+                    if (!p.parts.empty())
+                        break;
+
+                    c->out.pop_front();
+                }
+            }
+
+            if (c->closing) {
+                if (c->peerClosed)
+                    closeConnection(c);
+                else
+                    linger(c);
+
+                return false;
+            }
+
+            return true;
+        }
+
+        void Reactor::linger(Connection *c) {
+            shutdown(c->fd, SHUT_WR);
+            c->lingering = true;
+            c->used = 0;
+            c->lastActive = nowMs();
+            pool_.release(std::move(c->buf));
+
+            struct epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.ptr = c;
+            epoll_ctl(epollFd_, EPOLL_CTL_MOD, c->fd, &ev);
+            c->events = EPOLLIN;
+        }
+
+        void Reactor::drain(Connection *c) {
+            char buf[4096];
+            const ssize_t n = read(c->fd, buf, sizeof(buf));
+
+            // 不更新 lastActive，最多等待 kLingerMs
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                closeConnection(c);
+        }
+
+        int listenOn(const std::string &host, uint16_t port, int backlog) {
+            struct sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+
+            if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1)
+                ThrowHappyException("Invalid listen address: " + host);
+
+            const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+            if (fd < 0)
+                ThrowHappyException(errorToStr());
+
+            const int one = 1;
+
+            if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0
+                || setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0
+                || bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0
+                || listen(fd, backlog) != 0) {
+                const std::string error(errorToStr());
+                closeFd(fd);
+                ThrowHappyException(error);
+            }
+
+            return fd;
+        }
+
+        uint16_t localPort(int fd) {
+            struct sockaddr_in addr{};
+            socklen_t len = sizeof(addr);
+
+            if (getsockname(fd, reinterpret_cast<struct sockaddr *>(&addr), &len) != 0)
+                ThrowHappyException(errorToStr());
+
+            return ntohs(addr.sin_port);
+        }
+
+    } /* namespace */
+
+    class HttpServerImpl {
+    public:
+        explicit HttpServerImpl(const HttpServerOptions &options);
+
+        ~HttpServerImpl();
+
+        void route(const std::string &prefix, HttpHandler handler);
+
+        void serveDirectory(const std::string &prefix, const std::string &root);
+
+        void start();
+
+        void stop();
+
+        [[nodiscard]] bool running() const;
+
+        [[nodiscard]] uint16_t port() const;
+
+    private:
+        HttpServerOptions options_;
+        RouteList routes_;
+        std::atomic<bool> running_;
+        uint16_t port_;
+        std::vector<std::unique_ptr<Reactor> > reactors_;
+        std::vector<std::thread> threads_;
+
+        void addRoute(Route r);
+    };
+
+    HttpServerImpl::HttpServerImpl(const HttpServerOptions &options)
+            : options_(options),
+              running_(false),
+              port_(0) {
+        if (options_.threads == 0)
+            options_.threads = std::max(1u, std::thread::hardware_concurrency());
+
+        options_.readBufferSize = std::max(options_.readBufferSize, kMinReadBufferSize);
+        options_.maxPipeline = std::max<size_t>(options_.maxPipeline, 1);
+    }
+
+    HttpServerImpl::~HttpServerImpl() {
+        stop();
+    }
+
+    void HttpServerImpl::route(const std::string &prefix, HttpHandler handler) {
+        addRoute(Route{prefix, std::move(handler), std::string()});
+    }
+
+    void HttpServerImpl::serveDirectory(const std::string &prefix, const std::string &root) {
+        if (root.empty())
+            ThrowHappyException("Static root directory cannot be empty.");
+
+        // 去掉末尾的 "/"，mapPath 拼接的相对路径总是以 "/" 开头
+        std::string dir(root);
+
+        while (dir.size() > 1 && dir.back() == '/')
+            dir.pop_back();
+
+        addRoute(Route{prefix, HttpHandler(), dir});
+    }
+
+    void HttpServerImpl::addRoute(Route r) {
+        if (running_)
+            ThrowHappyException("Cannot add routes while HttpServer is running.");
+
+        const auto it = std::find_if(routes_.begin(), routes_.end(), [&r](const auto &x) {
+            return x.prefix == r.prefix;
+        });
+
+        if (it != routes_.end()) {
+            *it = std::move(r);
+            return;
+        }
+
+        routes_.push_back(std::move(r));
+
+        // 最长前缀优先
+        std::stable_sort(routes_.begin(), routes_.end(), [](const auto &a, const auto &b) {
+            return a.prefix.size() > b.prefix.size();
+        });
+    }
+
+    void HttpServerImpl::start() {
+        if (running_)
+            return;
+
+        std::vector<std::unique_ptr<Reactor> > reactors;
+        uint16_t port = options_.port;
+
+        // 端口为 0 时，由第一个套接字决定实际端口，其它套接字通过 SO_REUSEPORT 绑定同一个端口
+        for (size_t i = 0; i < options_.threads; ++i) {
+            const int fd = listenOn(options_.host, port, options_.backlog);
+
+            try {
+                if (port == 0)
+                    port = localPort(fd);
+
+                reactors.push_back(std::make_unique<Reactor>(options_, routes_, fd));
+            } catch (...) {
+                closeFd(fd);
+                throw;
+            }
+        }
+
+        reactors_ = std::move(reactors);
+        port_ = port;
+        running_ = true;
+
+        for (const auto &r : reactors_)
+            threads_.emplace_back(&Reactor::run, r.get(), std::cref(running_));
+    }
+
+    void HttpServerImpl::stop() {
+        if (!running_.exchange(false))
+            return;
+
+        for (const auto &r : reactors_)
+            r->wakeup();
+
+        for (auto &t : threads_)
+            t.join();
+
+        threads_.clear();
+        reactors_.clear();
+    }
+
+    bool HttpServerImpl::running() const {
+        return running_;
+    }
+
+    uint16_t HttpServerImpl::port() const {
+        return port_;
+    }
+
+    HttpServer::HttpServer(const HttpServerOptions &options)
+            : impl_(new HttpServerImpl(options)) {
+    }
+
+    HttpServer::~HttpServer() = default;
+
+    void HttpServer::route(const std::string &prefix, HttpHandler handler) {
+        impl_->route(prefix, std::move(handler));
+    }
+
+    void HttpServer::serveDirectory(const std::string &prefix, const std::string &root) {
+        impl_->serveDirectory(prefix, root);
+    }
+
+    void HttpServer::start() {
+        impl_->start();
+    }
+
+    void HttpServer::stop() {
+        impl_->stop();
+    }
+
+    bool HttpServer::running() const {
+        return impl_->running();
+    }
+
+    uint16_t HttpServer::port() const {
+        return impl_->port();
+    }
+
+} /* namespace happycpp */
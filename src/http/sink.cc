@@ -0,0 +1,358 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/http/sink.h"
+#include "happycpp/exception.h"
+#include "happycpp/hcerrno.h"
+#include <openssl/evp.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef PLATFORM_WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using happycpp::hcerrno::errorToStr;
+
+namespace happycpp::hchttp {
+
+    BodySink::~BodySink() = default;
+
+    StringSink::StringSink(size_t maxReserve) : maxReserve_(maxReserve) {
+    }
+
+    StringSink::~StringSink() = default;
+
+    void StringSink::begin(int64_t contentLength) {
+        if (contentLength > 0)
+            data_.reserve(std::min(static_cast<uint64_t>(contentLength),
+                                   static_cast<uint64_t>(maxReserve_)));
+    }
+
+    bool StringSink::write(const char *data, size_t size) {
+        data_.append(data, size);
+        return true;
+    }
+
+    const std::string &StringSink::data() const {
+        return data_;
+    }
+
+    std::string StringSink::take() {
+        return std::move(data_);
+    }
+
+#ifndef PLATFORM_WIN32
+
+    namespace {
+
+        // O_DIRECT 要求缓冲区地址、长度和文件偏移都按块对齐
+        constexpr size_t kDirectAlign = 4096;
+
+    } /* namespace */
+
+    FileSink::FileSink(const std::string &path, bool direct)
+            : fd_(-1),
+              direct_(false),
+              offset_(0),
+              buf_(nullptr),
+              bufSize_(0) {
+        const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+        if (direct) {
+            fd_ = open(path.c_str(), flags | O_DIRECT, 0644);
+
+            if (fd_ != -1) {
+                void *p = nullptr;
+
+                if (posix_memalign(&p, kDirectAlign, kDirectBufferSize) == 0) {
+                    buf_ = static_cast<char *>(p);
+                    direct_ = true;
+                } else {
+                    // 无法分配对齐的缓冲区，改用普通方式
+                    fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+                }
+            }
+        }
+
+        if (fd_ == -1)
+            fd_ = open(path.c_str(), flags, 0644);
+
+        if (fd_ == -1)
+            ThrowHappyException(errorToStr());
+    }
+
+    FileSink::~FileSink() {
+        free(buf_);
+
+        if (fd_ != -1) {
+            // 传输中止时 finish 没有执行，去掉预先分配的部分，文件只保留已经写入的数据
+            [[maybe_unused]] const int ret = ftruncate(fd_, static_cast<off_t>(offset_));
+
+            close(fd_);
+        }
+    }
+
+    void FileSink::begin(int64_t contentLength) {
+        // 预先分配空间，减少碎片。失败时(比如文件系统不支持)不影响写入
+        if (contentLength > 0)
+            posix_fallocate(fd_, 0, static_cast<off_t>(contentLength));
+    }
+
+    bool FileSink::writeAt(const char *data, size_t size, uint64_t offset) {
+        while (size > 0) {
+            const ssize_t n = pwrite(fd_, data, size, static_cast<off_t>(offset));
+
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+
+                return false;
+            }
+
+            data += n;
+            size -= static_cast<size_t>(n);
+            offset += static_cast<uint64_t>(n);
+        }
+
+        return true;
+    }
+
+    bool FileSink::disableDirect() {
+        if (fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT) == -1)
+            return false;
+
+        direct_ = false;
+        return true;
+    }
+
+    bool FileSink::flushBuffer() {
+        size_t done = 0;
+        bool ok = true;
+
+        while (done < bufSize_) {
+            const ssize_t n = pwrite(fd_, buf_ + done, bufSize_ - done, static_cast<off_t>(offset_));
+
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+
+                ok = false;
+                break;
+            }
+
+            done += static_cast<size_t>(n);
+            offset_ += static_cast<uint64_t>(n);
+
+            // 短写之后文件偏移不再按块对齐，之后的 O_DIRECT 写入都会失败(EINVAL)。
+            // 这个文件剩余的部分改用普通方式写入
+            if (done < bufSize_ && direct_ && !disableDirect()) {
+                ok = false;
+                break;
+            }
+        }
+
+        // 没有写入的部分留在缓冲区中，下一次从 offset_ 继续写入
+        memmove(buf_, buf_ + done, bufSize_ - done);
+        bufSize_ -= done;
+        return ok;
+    }
+
+    bool FileSink::write(const char *data, size_t size) {
+        if (!direct_) {
+            // 关闭 O_DIRECT 之前缓冲区中剩余的数据先写入
+            if (bufSize_ > 0 && !flushBuffer())
+                return false;
+
+            if (!writeAt(data, size, offset_))
+                return false;
+
+            offset_ += size;
+            return true;
+        }
+
+        while (size > 0) {
+            const size_t n = std::min(size, kDirectBufferSize - bufSize_);
+            memcpy(buf_ + bufSize_, data, n);
+            bufSize_ += n;
+            data += n;
+            size -= n;
+
+            if (bufSize_ == kDirectBufferSize && !flushBuffer())
+                return false;
+
+            // 短写之后已经关闭 O_DIRECT，剩余的数据直接写入
+            if (!direct_)
+                return write(data, size);
+        }
+
+        return true;
+    }
+
+    bool FileSink::finish() {
+        // 最后不足一个缓冲区的数据长度不一定对齐，关闭 O_DIRECT 之后再写入
+        if (direct_ && bufSize_ > 0 && !disableDirect())
+            return false;
+
+        if (bufSize_ > 0 && !flushBuffer())
+            return false;
+
+        // 实际长度可能小于预先分配的长度
+        return ftruncate(fd_, static_cast<off_t>(offset_)) == 0;
+    }
+
+    bool FileSink::direct() const {
+        return direct_;
+    }
+
+    uint64_t FileSink::size() const {
+        return offset_ + bufSize_;
+    }
+
+#endif  // PLATFORM_WIN32
+
+    RingBufferSink::RingBufferSink(size_t capacity, Consumer consumer)
+            : buf_(std::max<size_t>(capacity, 1)),
+              head_(0),
+              count_(0),
+              consumer_(std::move(consumer)) {
+    }
+
+    RingBufferSink::~RingBufferSink() = default;
+
+    void RingBufferSink::drain() {
+        const size_t cap = buf_.size();
+
+        while (count_ > 0) {
+            const size_t contiguous = std::min(count_, cap - head_);
+            const size_t used = std::min(
+                    consumer_(std::string_view(buf_.data() + head_, contiguous)), contiguous);
+
+            head_ = (head_ + used) % cap;
+            count_ -= used;
+
+            if (used == 0 && contiguous < count_) {
+                // 数据跨越了缓冲区末尾，而 consumer 需要连续的数据。
+                // 移动到缓冲区开头之后再试一次
+                std::rotate(buf_.begin(), buf_.begin() + static_cast<ptrdiff_t>(head_), buf_.end());
+                head_ = 0;
+                continue;
+            }
+
+            // consumer 需要更多数据
+            if (used < contiguous)
+                break;
+        }
+
+        if (count_ == 0)
+            head_ = 0;
+    }
+
+    bool RingBufferSink::write(const char *data, size_t size) {
+        const size_t cap = buf_.size();
+
+        while (size > 0) {
+            if (count_ == cap) {
+                drain();
+
+                if (count_ == cap)
+                    return false;
+            }
+
+            const size_t tail = (head_ + count_) % cap;
+            const size_t n = std::min(size, std::min(cap - count_, cap - tail));
+
+            memcpy(buf_.data() + tail, data, n);
+            count_ += n;
+            data += n;
+            size -= n;
+        }
+
+        return true;
+    }
+
+    bool RingBufferSink::finish() {
+        drain();
+        return count_ == 0;
+    }
+
+    size_t RingBufferSink::capacity() const {
+        return buf_.size();
+    }
+
+    HashSink::HashSink(const std::string &algorithm, BodySinkPtr next)
+            : ctx_(nullptr),
+              next_(std::move(next)) {
+        const EVP_MD *md = EVP_get_digestbyname(algorithm.c_str());
+
+        if (md == nullptr)
+            ThrowHappyException("Unsupported digest algorithm: " + algorithm);
+
+        ctx_ = EVP_MD_CTX_new();
+        HAPPY_ASSERT(ctx_);
+
+        if (EVP_DigestInit_ex(ctx_, md, nullptr) != 1) {
+            EVP_MD_CTX_free(ctx_);
+            ThrowHappyException("Cannot initialize digest: " + algorithm);
+        }
+    }
+
+    HashSink::~HashSink() {
+        EVP_MD_CTX_free(ctx_);
+    }
+
+    void HashSink::begin(int64_t contentLength) {
+        if (next_)
+            next_->begin(contentLength);
+    }
+
+    bool HashSink::write(const char *data, size_t size) {
+        if (EVP_DigestUpdate(ctx_, data, size) != 1)
+            return false;
+
+        return !next_ || next_->write(data, size);
+    }
+
+    bool HashSink::finish() {
+        unsigned char md[EVP_MAX_MD_SIZE];
+        unsigned int len = 0;
+
+        if (EVP_DigestFinal_ex(ctx_, md, &len) != 1)
+            return false;
+
+        static const char kHex[] = "0123456789abcdef";
+        hexDigest_.resize(len * 2);
+
+        for (unsigned int i = 0; i < len; ++i) {
+            hexDigest_[i * 2] = kHex[md[i] >> 4];
+            hexDigest_[i * 2 + 1] = kHex[md[i] & 0x0F];
+        }
+
+        return !next_ || next_->finish();
+    }
+
+    const std::string &HashSink::hexDigest() const {
+        return hexDigest_;
+    }
+
+} /* namespace happycpp */
@@ -0,0 +1,556 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/http/static.h"
+#include "happycpp/http/mime.h"
+#include "happycpp/http/serializer.h"
+#include "text.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <random>
+
+#ifndef PLATFORM_WIN32
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#endif
+
+namespace happycpp::hchttp {
+
+    namespace {
+
+        using detail::iequals;
+        using detail::trimOws;
+
+        //! 单次 sendfile 的最大长度，避免一个大文件长时间占用发送循环
+        const uint64_t kMaxSendfileChunk = 1024 * 1024;
+
+        void appendHex(uint64_t v, std::string *s) {
+            char buf[16];
+            const auto r = std::to_chars(buf, buf + sizeof(buf), v, 16);
+            s->append(buf, r.ptr);
+        }
+
+        void appendDec(uint64_t v, std::string *s) {
+            char buf[20];
+            const auto r = std::to_chars(buf, buf + sizeof(buf), v);
+            s->append(buf, r.ptr);
+        }
+
+        //! 解析 HTTP-date 的游标
+        struct DateCursor {
+            std::string_view s;
+            size_t pos = 0;
+
+            bool lit(char c) {
+                if (pos >= s.size() || s[pos] != c)
+                    return false;
+
+                ++pos;
+                return true;
+            }
+
+            bool lit(std::string_view t) {
+                if (s.substr(pos, t.size()) != t)
+                    return false;
+
+                pos += t.size();
+                return true;
+            }
+
+            bool digits(size_t n, int *v) {
+                if (pos + n > s.size())
+                    return false;
+
+                *v = 0;
+
+                for (size_t i = 0; i < n; ++i) {
+                    const char c = s[pos + i];
+
+                    if (c < '0' || c > '9')
+                        return false;
+
+                    *v = *v * 10 + (c - '0');
+                }
+
+                pos += n;
+                return true;
+            }
+
+            bool month(int *m) {
+                static const char kMonths[][4] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                                  "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+                for (int i = 0; i < 12; ++i) {
+                    if (lit(std::string_view(kMonths[i], 3))) {
+                        *m = i + 1;
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            // HH:MM:SS
+            bool timeOfDay(int *h, int *mi, int *sec) {
+                return digits(2, h) && lit(':') && digits(2, mi) && lit(':') && digits(2, sec);
+            }
+
+            [[nodiscard]] bool end() const {
+                return pos == s.size();
+            }
+        };
+
+        // 公历日期到 1970-01-01 的天数
+        // http://howardhinnant.github.io/date_algorithms.html#days_from_civil
+        int64_t daysFromCivil(int64_t y, int m, int d) {
+            y -= m <= 2;
+            const int64_t era = (y >= 0 ? y : y - 399) / 400;
+            const int64_t yoe = y - era * 400;
+            const int64_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+            const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+            return era * 146097 + doe - 719468;
+        }
+
+        //! ETag 列表中的一项
+        struct EntityTag {
+            bool weak;
+            std::string_view opaque; /*! 包括双引号 */
+        };
+
+        bool parseEntityTag(std::string_view s, EntityTag *tag) {
+            tag->weak = s.substr(0, 2) == "W/";
+
+            if (tag->weak)
+                s.remove_prefix(2);
+
+            if (s.size() < 2 || s.front() != '"' || s.back() != '"')
+                return false;
+
+            tag->opaque = s;
+            return true;
+        }
+
+        //! 判断 If-Match/If-None-Match 列表是否包含 etag，列表为 * 时总是匹配
+        /*!
+         * @param strong 强比较：双方都不能是弱 ETag
+         */
+        bool matchETag(std::string_view list, std::string_view etag, bool strong) {
+            EntityTag ours{};
+
+            if (!parseEntityTag(etag, &ours))
+                return false;
+
+            while (!list.empty()) {
+                const size_t comma = list.find(',');
+                const std::string_view item = trimOws(list.substr(0, comma));
+                list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+
+                if (item == "*")
+                    return true;
+
+                EntityTag theirs{};
+
+                if (!parseEntityTag(item, &theirs) || theirs.opaque != ours.opaque)
+                    continue;
+
+                if (!strong || (!theirs.weak && !ours.weak))
+                    return true;
+            }
+
+            return false;
+        }
+
+        //! If-Range 是否成立：ETag 强比较，或者日期和 Last-Modified 完全相同
+        bool matchIfRange(std::string_view ifRange, std::string_view etag, time_t mtime) {
+            if (ifRange.empty())
+                return true;
+
+            if (ifRange.front() == '"' || ifRange.substr(0, 2) == "W/") {
+                EntityTag theirs{};
+                EntityTag ours{};
+                return parseEntityTag(ifRange, &theirs) && parseEntityTag(etag, &ours)
+                       && !theirs.weak && !ours.weak && theirs.opaque == ours.opaque;
+            }
+
+            time_t t = 0;
+            return parseHttpDate(ifRange, &t) && t == mtime;
+        }
+
+        bool parseUint(std::string_view s, uint64_t *v) {
+            if (s.empty())
+                return false;
+
+            const auto r = std::from_chars(s.data(), s.data() + s.size(), *v);
+            return r.ec == std::errc() && r.ptr == s.data() + s.size();
+        }
+
+        std::string makeBoundary() {
+            thread_local std::mt19937_64 rng(std::random_device{}());
+            std::string boundary;
+            appendHex(rng(), &boundary);
+            appendHex(rng(), &boundary);
+            return boundary;
+        }
+
+        void appendContentRange(const ByteRange &r, uint64_t size, std::string *s) {
+            s->append("bytes ");
+            appendDec(r.offset, s);
+            s->push_back('-');
+            appendDec(r.offset + r.length - 1, s);
+            s->push_back('/');
+            appendDec(size, s);
+        }
+
+    } /* namespace */
+
+    std::string makeETag(const FileStat &fs, bool weak) {
+        std::string etag;
+        etag.reserve(56);
+
+        if (weak)
+            etag.append("W/");
+
+        etag.push_back('"');
+        appendHex(fs.ino, &etag);
+        etag.push_back('-');
+        appendHex(fs.bytes, &etag);
+        etag.push_back('-');
+        appendHex(static_cast<uint64_t>(fs.mtime) * 1000000000ULL + static_cast<uint64_t>(fs.mtime_nsec),
+                  &etag);
+        etag.push_back('"');
+        return etag;
+    }
+
+    bool parseHttpDate(std::string_view s, time_t *t) {
+        DateCursor c{s};
+        int year = 0;
+        int month = 0;
+        int day = 0;
+        int hour = 0;
+        int minute = 0;
+        int second = 0;
+        const size_t comma = s.find(',');
+
+        if (comma == 3) {
+            // IMF-fixdate: Sun, 06 Nov 1994 08:49:37 GMT
+            c.pos = comma + 1;
+
+            if (!(c.lit(' ') && c.digits(2, &day) && c.lit(' ') && c.month(&month) && c.lit(' ')
+                  && c.digits(4, &year) && c.lit(' ') && c.timeOfDay(&hour, &minute, &second)
+                  && c.lit(" GMT") && c.end()))
+                return false;
+        } else if (comma != std::string_view::npos) {
+            // RFC 850: Sunday, 06-Nov-94 08:49:37 GMT
+            c.pos = comma + 1;
+
+            if (!(c.lit(' ') && c.digits(2, &day) && c.lit('-') && c.month(&month) && c.lit('-')
+                  && c.digits(2, &year) && c.lit(' ') && c.timeOfDay(&hour, &minute, &second)
+                  && c.lit(" GMT") && c.end()))
+                return false;
+
+            // RFC 7231 7.1.1.1: 两位年份看起来在 50 年以后的，当作过去的年份
+            year += year < 70 ? 2000 : 1900;
+        } else {
+            // asctime: Sun Nov  6 08:49:37 1994
+            c.pos = 3;
+
+            if (!(c.lit(' ') && c.month(&month) && c.lit(' ')))
+                return false;
+
+            if (c.lit(' ')) {
+                if (!c.digits(1, &day))
+                    return false;
+            } else if (!c.digits(2, &day)) {
+                return false;
+            }
+
+            if (!(c.lit(' ') && c.timeOfDay(&hour, &minute, &second) && c.lit(' ')
+                  && c.digits(4, &year) && c.end()))
+                return false;
+        }
+
+        if (day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+            return false;
+
+        *t = static_cast<time_t>(daysFromCivil(year, month, day) * 86400
+                                 + hour * 3600 + minute * 60 + second);
+        return true;
+    }
+
+    HttpRangeResult parseRange(std::string_view range, uint64_t size,
+                               std::vector<ByteRange> *ranges, size_t maxRanges) {
+        ranges->clear();
+        range = trimOws(range);
+        const size_t eq = range.find('=');
+
+        if (eq == std::string_view::npos || !iequals(trimOws(range.substr(0, eq)), "bytes"))
+            return HTTP_RANGE_NONE;
+
+        range.remove_prefix(eq + 1);
+        size_t count = 0;
+
+        while (!range.empty()) {
+            const size_t comma = range.find(',');
+            const std::string_view spec = trimOws(range.substr(0, comma));
+            range = comma == std::string_view::npos ? std::string_view() : range.substr(comma + 1);
+
+            // 允许空元素，比如 "bytes=0-1,,5-6"
+            if (spec.empty())
+                continue;
+
+            if (++count > maxRanges) {
+                ranges->clear();
+                return HTTP_RANGE_NONE;
+            }
+
+            const size_t dash = spec.find('-');
+
+            if (dash == std::string_view::npos) {
+                ranges->clear();
+                return HTTP_RANGE_NONE;
+            }
+
+            const std::string_view first = trimOws(spec.substr(0, dash));
+            const std::string_view last = trimOws(spec.substr(dash + 1));
+            uint64_t begin = 0;
+            uint64_t end = 0;
+
+            if (first.empty()) {
+                // 最后 N 个字节
+                uint64_t suffix = 0;
+
+                if (!parseUint(last, &suffix)) {
+                    ranges->clear();
+                    return HTTP_RANGE_NONE;
+                }
+
+                if (suffix == 0 || size == 0)
+                    continue;
+
+                begin = size - std::min(suffix, size);
+                end = size - 1;
+            } else {
+                if (!parseUint(first, &begin) || (!last.empty() && (!parseUint(last, &end) || end < begin))) {
+                    ranges->clear();
+                    return HTTP_RANGE_NONE;
+                }
+
+                if (begin >= size)
+                    continue;
+
+                end = last.empty() ? size - 1 : std::min(end, size - 1);
+            }
+
+            ranges->push_back({begin, end - begin + 1});
+        }
+
+        if (count == 0)
+            return HTTP_RANGE_NONE;
+
+        if (ranges->empty())
+            return HTTP_RANGE_UNSATISFIABLE;
+
+        std::sort(ranges->begin(), ranges->end(), [](const ByteRange &a, const ByteRange &b) {
+            return a.offset < b.offset;
+        });
+
+        // 合并重叠或者相邻的范围
+        size_t n = 0;
+
+        for (size_t i = 1; i < ranges->size(); ++i) {
+            ByteRange &prev = (*ranges)[n];
+            const ByteRange &cur = (*ranges)[i];
+
+            if (cur.offset <= prev.offset + prev.length)
+                prev.length = std::max(prev.offset + prev.length, cur.offset + cur.length) - prev.offset;
+            else
+                (*ranges)[++n] = cur;
+        }
+
+        ranges->resize(n + 1);
+        return HTTP_RANGE_SATISFIABLE;
+    }
+
+    void prepareFileResponse(const HttpRequestMsg &req,
+                             const FileStat &fs,
+                             HttpResponseMsg *resp,
+                             std::vector<BodyPart> *parts,
+                             const FileResponseOptions &options) {
+        parts->clear();
+
+        const uint64_t size = fs.bytes;
+        const std::string etag = makeETag(fs, options.weakETag);
+        const bool getOrHead = req.method() == HTTP_METHOD_GET || req.method() == HTTP_METHOD_HEAD;
+
+        resp->setField(HTTP_MRESF_ETAG, etag);
+        resp->setField(HTTP_MRESF_LAST_MODIFIED, formatHttpDate(fs.mtime));
+        resp->setField(HTTP_MRESF_ACCEPT_RANGES, "bytes");
+
+        // RFC 7232 6: 依次判断各个前提条件
+        const std::string_view ifMatch = req.header(HTTP_MREQF_IF_MATCH);
+        const std::string_view ifNoneMatch = req.header(HTTP_MREQF_IF_NONE_MATCH);
+        time_t t = 0;
+
+        if (!ifMatch.empty()) {
+            if (!matchETag(ifMatch, etag, true)) {
+                resp->setStatus(412);
+                return;
+            }
+        } else if (parseHttpDate(req.header(HTTP_MREQF_IF_UNMODIFIED_SINCE), &t) && fs.mtime > t) {
+            resp->setStatus(412);
+            return;
+        }
+
+        if (!ifNoneMatch.empty()) {
+            if (matchETag(ifNoneMatch, etag, false)) {
+                resp->setStatus(getOrHead ? 304 : 412);
+                return;
+            }
+        } else if (getOrHead && parseHttpDate(req.header(HTTP_MREQF_IF_MODIFIED_SINCE), &t) && fs.mtime <= t) {
+            resp->setStatus(304);
+            return;
+        }
+
+        const std::string_view contentType = hcmime::fromUri(fs.name, options.charset);
+        std::vector<ByteRange> ranges;
+        HttpRangeResult rangeResult = HTTP_RANGE_NONE;
+
+        // 只有 GET 请求处理 Range。If-Range 不成立时返回整个文件
+        if (req.method() == HTTP_METHOD_GET && matchIfRange(req.header(HTTP_MREQF_IF_RANGE), etag, fs.mtime))
+            rangeResult = parseRange(req.header(HTTP_MREQF_RANGE), size, &ranges, options.maxRanges);
+
+        std::string value;
+
+        if (rangeResult == HTTP_RANGE_UNSATISFIABLE) {
+            value.append("bytes */");
+            appendDec(size, &value);
+            resp->setStatus(416);
+            resp->setField(HTTP_MRESF_CONTENT_RANGE, value);
+            return;
+        }
+
+        if (rangeResult == HTTP_RANGE_NONE) {
+            resp->setStatus(200);
+            resp->setField(HTTP_MCOMF_CONTENT_TYPE, contentType);
+
+            if (size > 0) {
+                BodyPart part;
+                part.length = size;
+                parts->push_back(std::move(part));
+            }
+        } else if (ranges.size() == 1) {
+            appendContentRange(ranges[0], size, &value);
+            resp->setStatus(206);
+            resp->setField(HTTP_MCOMF_CONTENT_TYPE, contentType);
+            resp->setField(HTTP_MRESF_CONTENT_RANGE, value);
+
+            BodyPart part;
+            part.offset = ranges[0].offset;
+            part.length = ranges[0].length;
+            parts->push_back(std::move(part));
+        } else {
+            // multipart/byteranges: 每个范围之前是分隔行和该部分的消息头
+            const std::string boundary = makeBoundary();
+
+            for (const ByteRange &r : ranges) {
+                BodyPart head;
+                head.data.append("\r\n--").append(boundary).append("\r\nContent-Type: ");
+                head.data.append(contentType).append("\r\nContent-Range: ");
+                appendContentRange(r, size, &head.data);
+                head.data.append("\r\n\r\n");
+                parts->push_back(std::move(head));
+
+                BodyPart part;
+                part.offset = r.offset;
+                part.length = r.length;
+                parts->push_back(std::move(part));
+            }
+
+            BodyPart tail;
+            tail.data.append("\r\n--").append(boundary).append("--\r\n");
+            parts->push_back(std::move(tail));
+
+            value.append("multipart/byteranges; boundary=").append(boundary);
+            resp->setStatus(206);
+            resp->setField(HTTP_MCOMF_CONTENT_TYPE, value);
+        }
+
+        uint64_t length = 0;
+
+        for (const BodyPart &p : *parts)
+            length += p.size();
+
+        value.clear();
+        appendDec(length, &value);
+        resp->setField(HTTP_MCOMF_CONTENT_LENGTH, value);
+
+        // HEAD 请求只需要消息头
+        if (req.method() == HTTP_METHOD_HEAD)
+            parts->clear();
+    }
+
+#ifndef PLATFORM_WIN32
+
+    int sendFileParts(int sock, int fd, const std::vector<BodyPart> &parts,
+                      size_t *index, uint64_t *sent) {
+        while (*index < parts.size()) {
+            const BodyPart &p = parts[*index];
+            const uint64_t size = p.size();
+
+            if (*sent >= size) {
+                ++*index;
+                *sent = 0;
+                continue;
+            }
+
+            ssize_t n;
+
+            if (!p.data.empty()) {
+                // 后面还有数据时，让内核等待合并，避免分隔行单独成为一个小包
+                const int flags = MSG_NOSIGNAL | (*index + 1 < parts.size() ? MSG_MORE : 0);
+                n = send(sock, p.data.data() + *sent, size - *sent, flags);
+            } else {
+                off_t offset = static_cast<off_t>(p.offset + *sent);
+                n = sendfile(sock, fd, &offset, std::min(size - *sent, kMaxSendfileChunk));
+
+                // 文件在发送过程中被截断，已经发出的 Content-Length 无法兑现
+                if (n == 0) {
+                    errno = EIO;
+                    return -1;
+                }
+            }
+
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+
+                return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+            }
+
+            *sent += static_cast<uint64_t>(n);
+        }
+
+        return 1;
+    }
+
+#endif  // PLATFORM_WIN32
+
+} /* namespace happycpp */
@@ -0,0 +1,92 @@
+﻿// -*- C++ -*-
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// HTTP 模块内部共用的 ASCII 字符串函数，不安装
+
+#ifndef SRC_HTTP_TEXT_H_
+#define SRC_HTTP_TEXT_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace happycpp::hchttp::detail {
+
+    constexpr char asciiLower(char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    //! 8 个字节同时转换为小写
+    inline uint64_t asciiLower8(uint64_t x) {
+        const uint64_t H = 0x8080808080808080ULL;
+        const uint64_t heptets = x & ~H;
+        const uint64_t ge_a = heptets + 0x3f3f3f3f3f3f3f3fULL;  // >= 'A'
+        const uint64_t gt_z = heptets + 0x2525252525252525ULL;  // >  'Z'
+        const uint64_t is_upper = ~x & (ge_a ^ gt_z) & H;
+
+        return x | (is_upper >> 2U);
+    }
+
+    inline uint64_t load8(const char *p) {
+        uint64_t x;
+        memcpy(&x, p, sizeof(x));
+        return x;
+    }
+
+    //! 不区分大小写比较(只转换 ASCII 字母)
+    inline bool iequals(std::string_view a, std::string_view b) {
+        const size_t n = a.size();
+
+        if (n != b.size())
+            return false;
+
+        if (n < 8) {
+            for (size_t i = 0; i < n; ++i) {
+                if (asciiLower(a[i]) != asciiLower(b[i]))
+                    return false;
+            }
+
+            return true;
+        }
+
+        // 每次比较 8 个字节，最后 8 个字节与前面的块可能重叠
+        for (size_t i = 0; i + 8 < n; i += 8) {
+            if (asciiLower8(load8(a.data() + i)) != asciiLower8(load8(b.data() + i)))
+                return false;
+        }
+
+        return asciiLower8(load8(a.data() + n - 8)) == asciiLower8(load8(b.data() + n - 8));
+    }
+
+    //! 去除首尾的 OWS(空格和水平制表符)
+    inline std::string_view trimOws(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+            s.remove_prefix(1);
+
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+            s.remove_suffix(1);
+
+        return s;
+    }
+
+} /* namespace happycpp */
+
+#endif  // SRC_HTTP_TEXT_H_
@@ -0,0 +1,278 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/http.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace happycpp::hchttp::hcurl {
+
+    namespace {
+
+        struct ByteTable {
+            uint8_t v[256];
+        };
+
+        // 不需要编码的字节：ALPHA / DIGIT / "-" / "." / "_" / "~"
+        constexpr ByteTable buildUnreserved() {
+            ByteTable t{};
+
+            for (int32_t c = 0; c < 256; ++c) {
+                t.v[c] = static_cast<uint8_t>((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z')
+                                              || (c >= 'a' && c <= 'z') || c == '-' || c == '.'
+                                              || c == '_' || c == '~');
+            }
+
+            return t;
+        }
+
+        // 十六进制字符对应的值，其它字符为 0xFF
+        constexpr ByteTable buildHexValue() {
+            ByteTable t{};
+
+            for (int32_t c = 0; c < 256; ++c) {
+                if (c >= '0' && c <= '9')
+                    t.v[c] = static_cast<uint8_t>(c - '0');
+                else if (c >= 'a' && c <= 'f')
+                    t.v[c] = static_cast<uint8_t>(c - 'a' + 10);
+                else if (c >= 'A' && c <= 'F')
+                    t.v[c] = static_cast<uint8_t>(c - 'A' + 10);
+                else
+                    t.v[c] = 0xFF;
+            }
+
+            return t;
+        }
+
+        constexpr ByteTable kUnreserved = buildUnreserved();
+        constexpr ByteTable kHexValue = buildHexValue();
+        constexpr char kHexDigits[] = "0123456789ABCDEF";
+
+        inline char *encodeByte(uint8_t c, char *out) {
+            if (kUnreserved.v[c]) {
+                *out = static_cast<char>(c);
+                return out + 1;
+            }
+
+            if (c == ' ') {
+                *out = '+';
+                return out + 1;
+            }
+
+            out[0] = '%';
+            out[1] = kHexDigits[c >> 4];
+            out[2] = kHexDigits[c & 0x0F];
+            return out + 3;
+        }
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#define HC_URL_SIMD 1
+
+        // 以下函数处理 p 开始的 kBlock 字节，返回的掩码中每一位对应一个字节。
+        // 有符号比较时，>= 0x80 的字节为负数，不会落在任何 ASCII 区间内
+#if defined(__AVX2__)
+        typedef __m256i Vec;
+        constexpr size_t kBlock = 32;
+        constexpr uint32_t kFullMask = 0xFFFFFFFF;
+
+        inline Vec load(const char *p) {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        }
+
+        inline void store(char *out, Vec v) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), v);
+        }
+
+        inline Vec set1(char c) { return _mm256_set1_epi8(c); }
+
+        inline Vec cmpeq(Vec a, Vec b) { return _mm256_cmpeq_epi8(a, b); }
+
+        inline Vec cmpgt(Vec a, Vec b) { return _mm256_cmpgt_epi8(a, b); }
+
+        inline Vec vand(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+
+        inline Vec vor(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+
+        inline uint32_t movemask(Vec v) { return static_cast<uint32_t>(_mm256_movemask_epi8(v)); }
+#else
+        typedef __m128i Vec;
+        constexpr size_t kBlock = 16;
+        constexpr uint32_t kFullMask = 0xFFFF;
+
+        inline Vec load(const char *p) {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        }
+
+        inline void store(char *out, Vec v) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out), v);
+        }
+
+        inline Vec set1(char c) { return _mm_set1_epi8(c); }
+
+        inline Vec cmpeq(Vec a, Vec b) { return _mm_cmpeq_epi8(a, b); }
+
+        inline Vec cmpgt(Vec a, Vec b) { return _mm_cmpgt_epi8(a, b); }
+
+        inline Vec vand(Vec a, Vec b) { return _mm_and_si128(a, b); }
+
+        inline Vec vor(Vec a, Vec b) { return _mm_or_si128(a, b); }
+
+        inline uint32_t movemask(Vec v) { return static_cast<uint32_t>(_mm_movemask_epi8(v)); }
+#endif
+
+        // lo <= v <= hi
+        inline Vec inRange(Vec v, char lo, char hi) {
+            return vand(cmpgt(v, set1(static_cast<char>(lo - 1))),
+                        cmpgt(set1(static_cast<char>(hi + 1)), v));
+        }
+
+        // 不需要编码的字节
+        inline uint32_t unreservedMask(Vec v) {
+            // 转为小写之后只需要比较一次字母区间，'@'、'[' 等转换后也不在区间内
+            const Vec lower = vor(v, set1(0x20));
+            const Vec m = vor(vor(inRange(lower, 'a', 'z'), inRange(v, '0', '9')),
+                              vor(inRange(v, '-', '.'),
+                                  vor(cmpeq(v, set1('_')), cmpeq(v, set1('~')))));
+            return movemask(m);
+        }
+
+        // 需要解码的字节："%" 和 "+"
+        inline uint32_t escapeMask(Vec v) {
+            return movemask(vor(cmpeq(v, set1('%')), cmpeq(v, set1('+'))));
+        }
+#endif
+
+        // kLenient 为 true 时，格式错误的 "%" 原样输出
+        template<bool kLenient>
+        bool decodeTo(std::string_view s, char *out, size_t *size) {
+            const char *p = s.data();
+            const char *end = p + s.size();
+            char *o = out;
+
+            for (;;) {
+#ifdef HC_URL_SIMD
+                // 输出不会比输入长，整块写入不会越界。先写入整块，再按实际长度前进
+                while (static_cast<size_t>(end - p) >= kBlock) {
+                    const Vec v = load(p);
+                    const uint32_t mask = escapeMask(v);
+                    store(o, v);
+
+                    if (mask == 0) {
+                        p += kBlock;
+                        o += kBlock;
+                        continue;
+                    }
+
+                    const auto n = static_cast<size_t>(__builtin_ctz(mask));
+                    p += n;
+                    o += n;
+                    break;
+                }
+#endif
+
+                while (p < end && *p != '%' && *p != '+')
+                    *o++ = *p++;
+
+                if (p == end)
+                    break;
+
+                if (*p == '+') {
+                    *o++ = ' ';
+                    ++p;
+                    continue;
+                }
+
+                const uint8_t hi = end - p >= 3 ? kHexValue.v[static_cast<uint8_t>(p[1])] : 0xFF;
+                const uint8_t lo = end - p >= 3 ? kHexValue.v[static_cast<uint8_t>(p[2])] : 0xFF;
+
+                if ((hi | lo) & 0xF0) {
+                    if (!kLenient) {
+                        *size = static_cast<size_t>(o - out);
+                        return false;
+                    }
+
+                    *o++ = *p++;
+                    continue;
+                }
+
+                *o++ = static_cast<char>(hi << 4 | lo);
+                p += 3;
+            }
+
+            *size = static_cast<size_t>(o - out);
+            return true;
+        }
+
+    } /* namespace */
+
+    size_t encode(std::string_view s, char *out) {
+        const char *p = s.data();
+        const char *end = p + s.size();
+        char *o = out;
+
+#ifdef HC_URL_SIMD
+        // 输出缓冲区为输入的 3 倍，整块写入不会越界。先写入整块，再按实际长度前进
+        while (static_cast<size_t>(end - p) >= kBlock) {
+            const Vec v = load(p);
+            const uint32_t mask = unreservedMask(v);
+            store(o, v);
+
+            if (mask == kFullMask) {
+                p += kBlock;
+                o += kBlock;
+                continue;
+            }
+
+            const auto n = static_cast<size_t>(__builtin_ctz(~mask));
+            p += n;
+            o = encodeByte(static_cast<uint8_t>(*p), o + n);
+            ++p;
+        }
+#endif
+
+        while (p < end)
+            o = encodeByte(static_cast<uint8_t>(*p++), o);
+
+        return static_cast<size_t>(o - out);
+    }
+
+    bool decode(std::string_view s, char *out, size_t *size) {
+        return decodeTo<false>(s, out, size);
+    }
+
+    std::string encode(std::string_view s) {
+        std::string val(encodedMaxSize(s.size()), '\0');
+        val.resize(encode(s, val.data()));
+        return val;
+    }
+
+    std::string decode(std::string_view s) {
+        std::string val(s.size(), '\0');
+        size_t size = 0;
+        decodeTo<true>(s, val.data(), &size);
+        val.resize(size);
+        return val;
+    }
+
+} /* namespace happycpp */
@@ -44,8 +44,6 @@ namespace happycpp::hciconv {
     }
 
     HAPPYCPP_SHARED_LIB_API string iconvConvert(StandardCharsets fromCode, StandardCharsets toCode, const string &s) {
-        happycpp::log::HappyLogPtr hlog = happycpp::log::HappyLog::getInstance();
-
         size_t inSize = s.length();
         char inStr[inSize];
         memcpy(inStr, s.c_str(), inSize);
@@ -59,13 +57,13 @@ namespace happycpp::hciconv {
         iconv_t conv = iconv_open(getCodeName(toCode, true).c_str(), getCodeName(fromCode).c_str());
 
         if (conv == (iconv_t) -1) {
-            hlog->error("iconv_open函数执行时出错：" + string(strerror(errno)));
+            happycpp::log::HappyLog::instance().error("iconv_open函数执行时出错：" + string(strerror(errno)));
             return "";
         }
 
         if (iconv(conv, &inStrPtr, &inSize, &outStrPtr, &outSize) == (size_t) -1) {
             iconv_close(conv);
-            hlog->error("iconv函数执行时出错：" + string(strerror(errno)));
+            happycpp::log::HappyLog::instance().error("iconv函数执行时出错：" + string(strerror(errno)));
             return "";
         }
 
@@ -25,6 +25,9 @@
 #include <pwd.h>
 #include <grp.h>
 #include <happycpp/linux.h>
+#include <happycpp/linux/metrics.h>
+#include <happycpp/linux/netlink.h>
+#include <happycpp/linux/procfs.h>
 #include <happycpp/filesys.h>
 #include <happycpp/algorithm/hctime.h>
 #include <happycpp/exception.h>
@@ -32,11 +35,19 @@
 #include <arpa/inet.h>
 #include <dirent.h>
 #include <net/if.h>
-#include <resolv.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <linux/rtnetlink.h>
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 
 using happycpp::hcalgorithm::hcarray::exists;
 using happycpp::hcalgorithm::hcdouble::round;
@@ -44,11 +55,20 @@ using happycpp::hcalgorithm::hcstring::find;
 using happycpp::hcalgorithm::hcstring::replace;
 using happycpp::hcalgorithm::hcstring::split;
 using happycpp::hcalgorithm::hcstring::toLower;
+using happycpp::hcalgorithm::hcstring::toUpper;
 using happycpp::hcalgorithm::hcstring::trim;
 using happycpp::hcalgorithm::hctime::happySleep;
 using happycpp::hccmd::getExitStatusOfCmd;
 using happycpp::hccmd::getOutputOfCmd;
 
+using happycpp::hclinux::hcmetrics::MetricsSampler;
+using happycpp::hclinux::hcmetrics::MetricsSnapshot;
+using happycpp::hclinux::hcprocfs::CpuInfo;
+using happycpp::hclinux::hcprocfs::CpuStat;
+using happycpp::hclinux::hcprocfs::MemInfo;
+using happycpp::hclinux::hcprocfs::ProcFile;
+using happycpp::hclinux::hcprocfs::TaskStat;
+
 using std::ifstream;
 using std::to_string;
 
@@ -102,362 +122,382 @@ namespace happycpp::hclinux {
 
         Iface::Iface() = default;
 
-        /*获取网卡信息，并将信息填充到IfaceList*/
-        class IfaceFiller {
-        public:
-            explicit IfaceFiller(IfaceList *ifaceList);
+        namespace {
+
+            // IfaceList 中的 IPv4 信息，对应 SIOCGIFCONF 返回的一项
+            bool isIpv4(const hcnetlink::AddrInfo &addr) {
+                return addr.address.family == AF_INET;
+            }
+
+            // 主路由表中 metric 最小的 IPv4 默认网关，没有时为 0.0.0.0
+            std::string defaultGateway(const hcnetlink::NetlinkDump &dump) {
+                const hcnetlink::RouteInfo *best = nullptr;
+
+                for (const hcnetlink::RouteInfo &route : dump.routes) {
+                    if (route.family != AF_INET || route.dstLen != 0 || route.table != RT_TABLE_MAIN ||
+                        route.type != RTN_UNICAST || route.gateway.family != AF_INET)
+                        continue;
+
+                    if (best == nullptr || route.priority < best->priority)
+                        best = &route;
+                }
+
+                return best ? best->gateway.toString() : std::string("0.0.0.0");
+            }
+
+            // /etc/resolv.conf 中的前两个 IPv4 nameserver，见 parseResolvConf。文件没有变化时使用缓存
+            void getDns(std::string *dns1, std::string *dns2) {
+                static std::mutex dns_mutex;
+                static struct stat cached_st{};
+                static std::string cached_dns1;
+                static std::string cached_dns2;
+                const char *resolv_conf = "/etc/resolv.conf";
+                struct stat st{};
+
+                std::lock_guard<std::mutex> lock(dns_mutex);
+
+                if (stat(resolv_conf, &st) != 0) {
+                    cached_st = st;
+                    cached_dns1.clear();
+                    cached_dns2.clear();
+                } else if (st.st_ino != cached_st.st_ino || st.st_size != cached_st.st_size ||
+                           st.st_mtim.tv_sec != cached_st.st_mtim.tv_sec ||
+                           st.st_mtim.tv_nsec != cached_st.st_mtim.tv_nsec) {
+                    ifstream in(resolv_conf);
+                    const std::string content((std::istreambuf_iterator<char>(in)),
+                                              std::istreambuf_iterator<char>());
+
+                    cached_st = st;
+                    parseResolvConf(content, &cached_dns1, &cached_dns2);
+                }
 
-            ~IfaceFiller() = default;
+                *dns1 = cached_dns1;
+                *dns2 = cached_dns2;
+            }
 
-        private:
-            void getIfaceNum();
+        } /* namespace */
 
-            static void createSocket(int32_t *sock);
+        HAPPYCPP_SHARED_LIB_API void parseResolvConf(std::string_view content, std::string *dns1, std::string *dns2) {
+            std::vector<std::string> servers;
 
-            static int32_t getIfaceList(struct ifconf *ifconf);
+            while (servers.size() < 2 && !content.empty()) {
+                const size_t eol = content.find('\n');
+                std::string_view line(content.substr(0, eol));
+                content.remove_prefix(eol == std::string_view::npos ? content.size() : eol + 1);
 
-            static std::string formatMac(unsigned char *mac_p);
+                // 去掉注释和行尾的 \r
+                line = line.substr(0, line.find_first_of("#;\r"));
 
-            static std::string getMac(char *name);
+                // 按空白分割，连续的空白视为一个分隔符
+                std::string_view cols[2];
+                size_t n = 0;
 
-            static std::string getGateway();
+                for (size_t pos = 0; n < 2;) {
+                    pos = line.find_first_not_of(" \t", pos);
 
-            static std::string getNetmask(char *name);
+                    if (pos == std::string_view::npos)
+                        break;
 
-            static std::string getIpAddr(const ifreq &i);
+                    const size_t end = std::min(line.find_first_of(" \t", pos), line.size());
+                    cols[n++] = line.substr(pos, end - pos);
+                    pos = end;
+                }
 
-            static void getDns(Iface *iface);
+                if (n < 2 || cols[0] != "nameserver")
+                    continue;
 
-            void fill(IfaceList *ifaceList);
+                const std::string server(cols[1]);
+                struct in_addr addr{};
 
-        private:
-            int32_t ifaces_num_{};
-            static int32_t kLoopIfaces_;
-            static size_t kMacSize_;
-            struct ifreq ifreqs_[20]{};
-            struct ifconf ifconf_{};
-        };
+                if (inet_pton(AF_INET, server.c_str(), &addr) == 1)
+                    servers.push_back(server);
+            }
 
-        int32_t IfaceFiller::kLoopIfaces_ = 1;
-        size_t IfaceFiller::kMacSize_ = 6;
+            *dns1 = servers.empty() ? std::string() : servers[0];
+            *dns2 = servers.size() < 2 ? std::string() : servers[1];
 
-        IfaceFiller::IfaceFiller(IfaceList *ifaceList) {
-            fill(ifaceList);
+            /* 没有设置dns时，不使用本机地址 */
+            if (*dns1 == "0.0.0.0" || *dns1 == "127.0.0.0" || *dns1 == "127.0.0.1")
+                dns1->clear();
         }
 
+        HAPPYCPP_SHARED_LIB_API void fillIfaceList(const hcnetlink::NetlinkDump &dump,
+                                                   IfaceList *ifaceList) {
+            std::unordered_map<int32_t, const hcnetlink::LinkInfo *> links;
+            std::unordered_map<int32_t, size_t> first_iface;
+            std::unordered_set<std::string> used_names;
+            const std::string gateway(defaultGateway(dump));
 
-        void IfaceFiller::fill(IfaceList *ifaceList) {
-            Iface iface;
+            links.reserve(dump.links.size());
 
-            memset(&ifconf_, 0, sizeof(ifconf));
-            ifconf_.ifc_buf = reinterpret_cast<char *>(ifreqs_);
-            ifconf_.ifc_len = sizeof(ifreqs_);
-            getIfaceList(&ifconf_);
-            getIfaceNum();
+            for (const hcnetlink::LinkInfo &link : dump.links) {
+                links[link.index] = &link;
+                used_names.insert(link.name);
+            }
 
-            const std::string gateway = getGateway();
-            getDns(&iface);
+            for (const hcnetlink::AddrInfo &addr : dump.addrs) {
+                if (isIpv4(addr) && !addr.label.empty())
+                    used_names.insert(addr.label);
+            }
 
-            // 临时保存网卡名称列表
-            std::vector<std::string> tmp_names;
+            // 临时保存已经使用的网卡名称
+            std::unordered_set<std::string> tmp_names;
 
-            /*loopIfaces数量为1，所以循环起点为1*/
-            const int32_t startIndex = kLoopIfaces_;
-            for (int32_t i = startIndex; i <= ifaces_num_; i++) {
-                iface.name_ = ifreqs_[i].ifr_name;
+            for (const hcnetlink::AddrInfo &addr : dump.addrs) {
+                const auto link_it = links.find(addr.index);
+
+                if (!isIpv4(addr) || link_it == links.end() ||
+                    (link_it->second->flags & IFF_LOOPBACK))
+                    continue;
 
-                // 网卡已经存在，则使用网卡别名，比如eth0:0
-                if (exists(tmp_names, iface.name_))
-                    iface.name_ = newAliasForIfaceX(iface.name_);
+                const hcnetlink::LinkInfo &link = *link_it->second;
+                Iface iface;
+                iface.index_ = link.index;
+                iface.name_ = addr.label.empty() ? link.name : addr.label;
 
-                iface.ip_addr_ = getIpAddr(ifreqs_[i]);
-                iface.netmask_ = getNetmask(ifreqs_[i].ifr_name);
-                iface.mac_ = getMac(ifreqs_[i].ifr_name);
+                // 没有标签的多个地址，使用网卡别名，比如eth0:0
+                if (tmp_names.count(iface.name_)) {
+                    const std::string base(iface.name_);
+
+                    for (uint32_t n = 0;; ++n) {
+                        iface.name_ = base + ":" + to_string(n);
+
+                        if (!used_names.count(iface.name_))
+                            break;
+                    }
+
+                    used_names.insert(iface.name_);
+                }
+
+                iface.ip_addr_ = addr.address.toString();
+                iface.netmask_ = hcnetlink::prefixToNetmask(addr.prefixLen);
+                iface.mac_ = link.mac;
                 iface.gateway_ = gateway;
 
                 // 名称、IP地址以及掩码不能为空，mac和网关可以为空
                 if (iface.verify()) {
+                    first_iface.emplace(link.index, ifaceList->size());
                     ifaceList->push_back(iface);
-                    tmp_names.push_back(iface.name_);
+                    tmp_names.insert(iface.name_);
                 }
             }
-        }
 
-        void IfaceFiller::getIfaceNum() {
-            /*网卡数量不记录本地loop设备*/
-            ifaces_num_ = (ifconf_.ifc_len / sizeof(struct ifreq)) - kLoopIfaces_;
-        }
+            // IPv6 地址放在对应网卡的第一个 Iface 中
+            for (const hcnetlink::AddrInfo &addr : dump.addrs) {
+                const auto it = first_iface.find(addr.index);
 
-        void IfaceFiller::createSocket(int32_t *sock) {
-            /*只处理IPv4，忽略其它*/
-            *sock = socket(AF_INET, SOCK_DGRAM, 0);
-
-            HAPPY_ASSERT(*sock >= 0);
+                if (addr.address.family == AF_INET6 && it != first_iface.end())
+                    (*ifaceList)[it->second].ip6_addrs_.push_back(addr.address.toString());
+            }
         }
 
-        int32_t IfaceFiller::getIfaceList(struct ifconf *ifconf) {
-            int32_t sock, rval;
+        IfaceFinder::IfaceFinder() {
+            hcnetlink::NetlinkDump dump;
 
-            createSocket(&sock);
-            rval = ioctl(sock, SIOCGIFCONF, reinterpret_cast<char *>(ifconf));
+            if (!hcnetlink::dumpAll(&dump))
+                ThrowHappySysError("Cannot get network interfaces from netlink");
 
-            HAPPY_ASSERT(rval >= 0);
-            close(sock);
+            fill(dump);
+        }
 
-            return rval;
+        IfaceFinder::IfaceFinder(const hcnetlink::NetlinkDump &dump) {
+            fill(dump);
         }
 
-        std::string IfaceFiller::formatMac(unsigned char *mac_p) {
-            char macBlock[10];
-            std::string mac;
-            const size_t hex_num_size = sizeof(char) * 2 + 1;
+        void IfaceFinder::fill(const hcnetlink::NetlinkDump &dump) {
+            fillIfaceList(dump, &ifaceList);
 
-            for (size_t blockIndex = 0; blockIndex < kMacSize_; blockIndex++) {
-                snprintf(macBlock, hex_num_size, "%.2X", mac_p[blockIndex]);
+            std::string dns1;
+            std::string dns2;
+            getDns(&dns1, &dns2);
 
-                if (blockIndex < (kMacSize_ - 1))
-                    mac += std::string(macBlock) + ":";
-                else
-                    mac += std::string(macBlock);
+            for (Iface &iface : ifaceList) {
+                iface.dns1_ = dns1;
+                iface.dns2_ = dns2;
             }
 
-            return mac;
+            buildIndex(dump);
         }
 
-        std::string IfaceFiller::getMac(char *name) {
-            struct ifreq ifr{};
-            int32_t sock;
-            unsigned char mac[kMacSize_];
+        IfaceFinder::Prefix IfaceFinder::makePrefix(const hcnetlink::IpAddr &addr, uint8_t prefixLen) {
+            Prefix prefix{0, 0};
+            const size_t size = addr.size();
 
-            createSocket(&sock);
-
-            ifr.ifr_addr.sa_family = AF_INET;
-            strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
-            const int32_t rval = ioctl(sock, SIOCGIFHWADDR, &ifr);
+            for (size_t i = 0; i < size; ++i) {
+                if (size == 4 || i >= 8)
+                    prefix.lo = (prefix.lo << 8) | addr.bytes[i];
+                else
+                    prefix.hi = (prefix.hi << 8) | addr.bytes[i];
+            }
 
-            HAPPY_ASSERT(rval >= 0);
-            memcpy(mac, ifr.ifr_hwaddr.sa_data, kMacSize_);
+            const unsigned bits = static_cast<unsigned>(size * 8);
+            const unsigned len = std::min<unsigned>(prefixLen, bits);
+
+            // 只保留高 len 位
+            if (bits == 32) {
+                prefix.lo &= len == 0 ? 0 : (0xFFFFFFFFULL << (32 - len)) & 0xFFFFFFFFULL;
+            } else if (len <= 64) {
+                prefix.hi &= len == 0 ? 0 : ~0ULL << (64 - len);
+                prefix.lo = 0;
+            } else {
+                prefix.lo &= ~0ULL << (128 - len);
+            }
 
-            close(sock);
-            return (formatMac(mac));
+            return prefix;
         }
 
-        std::string IfaceFiller::getIpAddr(const ifreq &i) {
-            auto *sin = (struct sockaddr_in *) &i.ifr_addr;
-            char *ret = inet_ntoa(sin->sin_addr);
-            std::string ip;
-
-            if (ret == nullptr)
-                return ip;
-
-            ip = std::string(ret);
-            return ip;
-        }
+        void IfaceFinder::buildIndex(const hcnetlink::NetlinkDump &dump) {
+            byName_.reserve(ifaceList.size());
+            byIp_.reserve(ifaceList.size());
+            byMac_.reserve(ifaceList.size());
 
-        std::string IfaceFiller::getNetmask(char *name) {
-            struct ifreq ifr{};
-            int32_t sock;
-            std::string netmask;
+            for (size_t pos = 0; pos < ifaceList.size(); ++pos) {
+                const Iface &iface = ifaceList[pos];
 
-            createSocket(&sock);
+                // 重复的键保留第一个，与原来顺序查找的结果一致
+                byName_.emplace(iface.name_, pos);
+                byIp_.emplace(iface.ip_addr_, pos);
 
-            ifr.ifr_addr.sa_family = AF_INET;
-            strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
+                for (const std::string &ip6 : iface.ip6_addrs_)
+                    byIp_.emplace(ip6, pos);
 
-            const int32_t rval = ioctl(sock, SIOCGIFNETMASK, &ifr);
+                if (!iface.mac_.empty())
+                    byMac_.emplace(iface.mac_, pos);
 
-            HAPPY_ASSERT(rval >= 0);
+                hcnetlink::IpAddr addr{};
+                hcnetlink::IpAddr mask{};
 
-            struct sockaddr_in sin{};
-            memcpy(&sin, &ifr.ifr_addr, sizeof(struct sockaddr));
-            char *ret = inet_ntoa(sin.sin_addr);
+                if (hcnetlink::parseIpAddr(iface.ip_addr_, &addr) &&
+                    hcnetlink::parseIpAddr(iface.netmask_, &mask)) {
+                    uint32_t m;
+                    std::memcpy(&m, mask.bytes, sizeof(m));
+                    const auto len = static_cast<uint8_t>(__builtin_popcount(m));
+                    byIndex_[iface.index_].push_back(LinkNet{pos, len, makePrefix(addr, len)});
+                }
+            }
 
-            HAPPY_ASSERT(ret != nullptr);
+            std::unordered_map<uint16_t, size_t> tables;
 
-            netmask = std::string(ret);
-            return netmask;
-        }
+            for (const hcnetlink::RouteInfo &route : dump.routes) {
+                if (route.table != RT_TABLE_MAIN || route.type != RTN_UNICAST || route.oif <= 0)
+                    continue;
 
-        std::string IfaceFiller::getGateway() {
-            ifstream ihcfilesys;
-            ihcfilesys.open("/proc/net/route", ifstream::binary);
-            char gateway[16] = "0.0.0.0";
-            std::string line;
+                const uint16_t key = static_cast<uint16_t>(route.family << 8 | route.dstLen);
+                auto it = tables.find(key);
 
-            if (ihcfilesys.is_open()) {
-                while (getline(ihcfilesys, line)) {
-                    uint64_t hex_dest = 0;
-                    uint64_t hex_flag = 0;
-                    uint64_t hex_gateway = 0;
+                if (it == tables.end()) {
+                    it = tables.emplace(key, routeTables_.size()).first;
+                    routeTables_.push_back(RouteTable{route.family, route.dstLen, {}});
+                }
 
-                    sscanf(line.c_str(), "%*s%lx%lx%lx", &hex_dest, &hex_gateway, &hex_flag); // NOLINT
+                // 默认路由没有目的地址，使用全 0 地址
+                hcnetlink::IpAddr dst = route.dst;
+                dst.family = route.family;
 
-                    if (hex_flag == 3 && hex_dest == 0 && hex_gateway != 0) {
-                        const char *ret = inet_ntop(AF_INET, &hex_gateway, gateway, 16);
+                const auto value = std::make_pair(route.priority, route.oif);
+                const auto inserted = routeTables_[it->second].routes.emplace(makePrefix(dst, route.dstLen), value);
 
-                        HAPPY_ASSERT(ret != nullptr);
-                        break;
-                    }
-                }
+                if (!inserted.second && value.first < inserted.first->second.first)
+                    inserted.first->second = value;
             }
 
-            return std::string(gateway);
+            std::sort(routeTables_.begin(), routeTables_.end(), [](const RouteTable &a, const RouteTable &b) {
+                return a.prefixLen > b.prefixLen;
+            });
         }
 
-        void IfaceFiller::getDns(Iface *iface) {
-            const int32_t ret_v = res_init();
-            if (ret_v != 0)
-                return;
+        const Iface *IfaceFinder::ifaceByName(const std::string &ifaceName) const {
+            const auto it = byName_.find(ifaceName);
+            return it == byName_.end() ? nullptr : &ifaceList[it->second];
+        }
 
-            const uint32_t count(_res.nscount);
-            for (uint32_t i = 0; i < count; i++) {
-                char *ret = inet_ntoa(_res.nsaddr_list[i].sin_addr);
-                if (ret == nullptr)
-                    continue;
+        const Iface *IfaceFinder::ifaceByIp(const std::string &ip) const {
+            auto it = byIp_.find(ip);
 
-                if (i == 0 && iface->dns1_.empty())
-                    iface->dns1_ = std::string(ret);
-                else if (i == 1 && iface->dns2_.empty())
-                    iface->dns2_ = std::string(ret);
-                else
-                    break;
-            }
+            // IPv6 地址的写法不唯一，转换为 inet_ntop 的格式之后再查找一次
+            if (it == byIp_.end() && ip.find(':') != std::string::npos) {
+                hcnetlink::IpAddr addr{};
 
-            /* 没有设置dns时，系统会返回0.0.0.0，此时设置dns1为空 */
-            if (iface->dns1_ == "0.0.0.0"
-                || iface->dns1_ == "127.0.0.0"
-                || iface->dns1_ == "127.0.0.1") {
-                iface->dns1_.clear();
+                if (hcnetlink::parseIpAddr(ip, &addr))
+                    it = byIp_.find(addr.toString());
             }
-        }
 
-        IfaceFinder::IfaceFinder() {
-            IfaceFiller ifaceFiller(&ifaceList);
+            return it == byIp_.end() ? nullptr : &ifaceList[it->second];
         }
 
-        bool IfaceFinder::getIface(const IfaceListIt &ifaceListIt,
-                                   const IFACE_FIELD &findField,
-                                   const std::string &keyword,
-                                   Iface *iface) {
-            std::string value;
-
-            switch (findField) {
-                case IFACE_GATEWAY:
-                    value = (*ifaceListIt).gateway_;
-                    break;
-                case IFACE_IPADDR:
-                    value = (*ifaceListIt).ip_addr_;
-                    break;
-                case IFACE_MAC:
-                    value = (*ifaceListIt).mac_;
-                    break;
-                case IFACE_NAME:
-                    value = (*ifaceListIt).name_;
-                    break;
-                case IFACE_NETMASK:
-                    value = (*ifaceListIt).netmask_;
-                    break;
-                default:
-                    break;
-            }
+        const Iface *IfaceFinder::ifaceByMac(const std::string &mac) const {
+            auto it = byMac_.find(mac);
 
-            if (value == keyword) {
-                *iface = (*ifaceListIt);
-                return true;
-            }
+            if (it == byMac_.end())
+                it = byMac_.find(toUpper(mac));
 
-            return false;
+            return it == byMac_.end() ? nullptr : &ifaceList[it->second];
         }
 
-        std::string IfaceFinder::getIfaceFieldValue(const IFACE_FIELD &field,
-                                                    const Iface &iface) {
-            std::string value;
-
-            switch (field) {
-                case IFACE_GATEWAY:
-                    value = iface.gateway_;
-                    break;
-                case IFACE_IPADDR:
-                    value = iface.ip_addr_;
-                    break;
-                case IFACE_MAC:
-                    value = iface.mac_;
-                    break;
-                case IFACE_NAME:
-                    value = iface.name_;
-                    break;
-                case IFACE_NETMASK:
-                    value = iface.netmask_;
-                    break;
-                default: HAPPY_ASSERT(false);
-            }
-
-            return value;
+        const Iface *IfaceFinder::routeIface(const std::string &ip) const {
+            hcnetlink::IpAddr addr{};
+            return hcnetlink::parseIpAddr(ip, &addr) ? routeIface(addr) : nullptr;
         }
 
-        std::string IfaceFinder::findByName(const std::string &ifaceName) {
-            Iface iface;
-            IfaceListIt it;
+        const Iface *IfaceFinder::routeIface(const hcnetlink::IpAddr &ip) const {
+            for (const RouteTable &table : routeTables_) {
+                if (table.family != ip.family)
+                    continue;
 
-            for (it = ifaceList.begin(); it < ifaceList.end(); it++) {
-                if (it->name_ == ifaceName) {
-                    iface = (*it);
-                    break;
-                }
-            }
+                const auto route = table.routes.find(makePrefix(ip, table.prefixLen));
 
-            return getIfaceFieldValue(IFACE_IPADDR, iface);
-        }
+                if (route == table.routes.end())
+                    continue;
+
+                const auto link = byIndex_.find(route->second.second);
 
-        std::string IfaceFinder::find(const IFACE_FIELD &findField,
-                                      const IFACE_FIELD &field,
-                                      const std::string &keyword) {
-            Iface iface;
-            IfaceListIt it;
+                if (link == byIndex_.end())
+                    return nullptr;
 
-            for (it = ifaceList.begin(); it < ifaceList.end(); it++) {
-                if (getIface(it, findField, keyword, &iface)) {
-                    break;
+                if (ip.family == AF_INET) {
+                    for (const LinkNet &net : link->second) {
+                        if (makePrefix(ip, net.prefixLen) == net.net)
+                            return &ifaceList[net.pos];
+                    }
                 }
+
+                return &ifaceList[link->second.front().pos];
             }
 
-            return getIfaceFieldValue(field, iface);
+            return nullptr;
         }
 
         /*获取指定网卡的第一个IP*/
-        std::string IfaceFinder::getIpAddrByName(const std::string &ifaceName) {
-            return findByName(ifaceName);
+        std::string IfaceFinder::getIpAddrByName(const std::string &ifaceName) const {
+            const Iface *iface = ifaceByName(ifaceName);
+            return iface ? iface->ip_addr_ : std::string();
         }
 
         /*获取匹配ip关键字的第一个ip*/
-        std::string IfaceFinder::getIpAddrByKeyword(const std::string &keyword) {
-            return find(IFACE_IPADDR, IFACE_IPADDR, keyword);
+        std::string IfaceFinder::getIpAddrByKeyword(const std::string &keyword) const {
+            const auto it = byIp_.find(keyword);
+
+            // 只匹配 IPv4 地址
+            if (it == byIp_.end() || ifaceList[it->second].ip_addr_ != keyword)
+                return std::string();
+
+            return keyword;
         }
 
         bool IfaceFinder::getIfaceByName(const std::string &ifaceName,
-                                         Iface *iface) {
-            if (ifaceList.empty()) {
+                                         Iface *iface) const {
+            const Iface *found = ifaceByName(ifaceName);
+
+            if (found == nullptr)
                 return false;
-            }
 
-            std::string value;
-            IfaceListIt it;
-
-            for (it = ifaceList.begin(); it < ifaceList.end(); it++) {
-                if (getIface(it, IFACE_NAME, ifaceName, iface)) {
-                    break;
-                }
-            }
+            *iface = *found;
 
             /*验证*/
-            if (iface->verify()) {
-                return true;
-            }
-
-            return false;
+            return iface->verify();
         }
 
-        bool IfaceFinder::getFrontIface(Iface *iface) {
+        bool IfaceFinder::getFrontIface(Iface *iface) const {
             if (ifaceList.empty())
                 return false;
 
@@ -470,7 +510,7 @@ namespace happycpp::hclinux {
             return false;
         }
 
-        bool IfaceFinder::getBackIface(Iface *iface) {
+        bool IfaceFinder::getBackIface(Iface *iface) const {
             if (ifaceList.empty()) {
                 return false;
             }
@@ -485,7 +525,7 @@ namespace happycpp::hclinux {
             return false;
         }
 
-        void IfaceFinder::getIfaceList(IfaceList *iface_list) {
+        void IfaceFinder::getIfaceList(IfaceList *iface_list) const {
             *iface_list = ifaceList;
         }
 
@@ -495,11 +535,24 @@ namespace happycpp::hclinux {
         //    使用 NetworkManager 单网卡绑定多IP，不会有类似eth0:0 之类的虚拟网卡，
         //    全部是eth0，这种情况无法支持。
         HAPPYCPP_SHARED_LIB_API bool getIfaceNames(std::vector<std::string> *names) {
+            hcnetlink::NetlinkDump dump;
+            std::unordered_set<std::string> seen;
+
             names->clear();
 
-            const std::string cmd("ifconfig -a|grep 'Link encap'|awk '{print $1}'");
-            const std::string devs(getOutputOfCmd(cmd));
-            split(devs, names);
+            if (!hcnetlink::dumpAll(&dump))
+                return false;
+
+            for (const hcnetlink::LinkInfo &link : dump.links) {
+                names->push_back(link.name);
+                seen.insert(link.name);
+            }
+
+            // 网卡别名，比如 eth0:0
+            for (const hcnetlink::AddrInfo &addr : dump.addrs) {
+                if (!addr.label.empty() && seen.insert(addr.label).second)
+                    names->push_back(addr.label);
+            }
 
             return !names->empty();
         }
@@ -871,52 +924,53 @@ namespace happycpp::hclinux {
          Quad-Core AMD Opteron(tm) Processor 2350
          */
         HAPPYCPP_SHARED_LIB_API std::string modelName() {
-            const std::string cmd(
-                    "egrep 'model name' /proc/cpuinfo|awk -F':' '{print $NF}'");
-            return getOutputOfCmd(cmd);
+            CpuInfo info;
+            std::string ret;
+
+            if (!hcprocfs::readCpuInfo(&info))
+                ThrowHappySysError("cannot read /proc/cpuinfo");
+
+            for (const std::string &name : info.modelNames) {
+                if (!ret.empty())
+                    ret += '\n';
+
+                ret += name;
+            }
+
+            return ret;
         }
 
         /* 获取cpu实际核心数，返回uint16_t */
         HAPPYCPP_SHARED_LIB_API uint16_t coreNum() {
-            const std::string cmd("expr `grep 'physical id' /proc/cpuinfo"
-                                  "|awk '{print $4}'"
-                                  "|sort -u"
-                                  "|wc -l` \\* `grep 'cpu cores' /proc/cpuinfo"
-                                  "|awk '{print $4}'"
-                                  "|sort -u`");
-            std::string cpu_num = getOutputOfCmd(cmd);
-
-            uint16_t i_cpu_num = stoi(cpu_num);
-            if (i_cpu_num == 0)
-                i_cpu_num = 1;
-
-            return i_cpu_num;
-        }
+            CpuInfo info;
+            uint32_t cpu_num = 0;
 
-        /* 获取cpu运行时间相关参数，用于计算cpu使用率 */
-        HAPPYCPP_SHARED_LIB_API bool getWorkCpuTime(CpuTime *cpu_time) {
-            std::vector<std::string> cpu_stats;
-            std::vector<std::string>::iterator it;
+            if (hcprocfs::readCpuInfo(&info))
+                cpu_num = info.packages * info.coresPerPackage;
 
-            const std::string cmd(
-                    "cat /proc/stat|egrep '^cpu[ ]+'|sed 's/^cpu[ ]\\+//g'");
-            const std::string proc_stat = getOutputOfCmd(cmd);
+            // 虚拟机或者非 x86 平台的 cpuinfo 可能没有 physical id 和 cpu cores
+            if (cpu_num == 0)
+                cpu_num = hcprocfs::physicalCores();
 
-            /*未获取到文件内容*/
-            if (proc_stat.empty())
-                return false;
+            if (cpu_num == 0)
+                cpu_num = hcprocfs::onlineCpus();
 
-            split(proc_stat, &cpu_stats, " ");
+            if (cpu_num == 0)
+                cpu_num = 1;
 
-            /*文件内容出乎意外，内容至少是6到9列*/
-            if (cpu_stats.size() < 6)
-                return false;
+            return static_cast<uint16_t>(cpu_num);
+        }
 
-            for (it = cpu_stats.begin(); it != cpu_stats.end(); it++) {
-                cpu_time->total += stod(*it);
-            }
+        /* 获取cpu运行时间相关参数，用于计算cpu使用率 */
+        HAPPYCPP_SHARED_LIB_API bool getWorkCpuTime(CpuTime *cpu_time) {
+            CpuStat stat{};
 
-            cpu_time->idle = stod(cpu_stats[3]);
+            if (!hcprocfs::readCpuStat(&stat))
+                return false;
+
+            // guest 和 guest_nice 已经计入 user 和 nice，不能重复累加
+            cpu_time->total = static_cast<double>(stat.total());
+            cpu_time->idle = static_cast<double>(stat.idleAll());
             cpu_time->used = cpu_time->total - cpu_time->idle;
 
             return true;
@@ -928,22 +982,33 @@ namespace happycpp::hclinux {
             CpuTime cpu_time_1{};
             CpuTime cpu_time_2{};
 
+            double cpu_used = 0;
+
             /*为防止失败时，返回空值，所以初始化为0*/
             cpu_util->used = 0;
             cpu_util->idle = 0;
 
-            if (!getWorkCpuTime(&cpu_time_1))
-                return;
+            // 调用者已经启动 MetricsSampler::global()，并且后台采样有两次以上较新的结果时，
+            // 直接使用最近一个采样周期的使用率，不需要等待。不在这里启动后台线程
+            MetricsSnapshot snap;
 
-            happySleep(100);  // 延时100毫秒
+            if (MetricsSampler::globalSnapshot(&snap) && snap.samples >= 2) {
+                cpu_used = snap.cpuUsed.last;
+            } else {
+                if (!getWorkCpuTime(&cpu_time_1))
+                    return;
 
-            if (!getWorkCpuTime(&cpu_time_2))
-                return;
+                happySleep(100);  // 延时100毫秒
 
-            double used_over_period = cpu_time_2.used - cpu_time_1.used;
-            double total_over_period = cpu_time_2.total - cpu_time_1.total;
+                if (!getWorkCpuTime(&cpu_time_2))
+                    return;
+
+                double used_over_period = cpu_time_2.used - cpu_time_1.used;
+                double total_over_period = cpu_time_2.total - cpu_time_1.total;
+
+                cpu_used = used_over_period / total_over_period * 100;
+            }
 
-            double cpu_used = used_over_period / total_over_period * 100;
             cpu_util->used = round(cpu_used, precision);
             snprintf(cpu_util->display_used, sizeof(cpu_util->display_used), "%s%%",
                      to_string(cpu_util->used).c_str());
@@ -954,30 +1019,170 @@ namespace happycpp::hclinux {
                      to_string(cpu_util->idle).c_str());
         }
 
+        namespace {
+
+            // 计数器减小时按 0 处理
+            inline uint64_t counterDelta(uint64_t after, uint64_t before) {
+                return after >= before ? after - before : 0;
+            }
+
+            int64_t steadyNs() {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+
+        } /* namespace */
+
+        HAPPYCPP_SHARED_LIB_API void cpuBreakdown(const CpuStat *before, const CpuStat *after,
+                                                  size_t count, CpuBreakdown *out) {
+            for (size_t i = 0; i < count; ++i) {
+                const CpuStat &a = before[i];
+                const CpuStat &b = after[i];
+
+                // 8 个计数器按照相同的方式处理，没有分支，编译器可以向量化。
+                // 计数器不会超过 2^63，按有符号数计算，转换为 double 只需要一条指令
+                const int64_t raw[8] = {
+                        static_cast<int64_t>(b.user - a.user), static_cast<int64_t>(b.nice - a.nice),
+                        static_cast<int64_t>(b.system - a.system), static_cast<int64_t>(b.idle - a.idle),
+                        static_cast<int64_t>(b.iowait - a.iowait), static_cast<int64_t>(b.irq - a.irq),
+                        static_cast<int64_t>(b.softirq - a.softirq), static_cast<int64_t>(b.steal - a.steal)};
+                double d[8];
+                double total = 0;
+
+                for (size_t k = 0; k < 8; ++k) {
+                    d[k] = static_cast<double>(std::max<int64_t>(raw[k], 0));
+                    total += d[k];
+                }
+
+                const double scale = total == 0 ? 0 : 100.0 / total;
+                CpuBreakdown &o = out[i];
+
+                o.user = d[0] * scale;
+                o.nice = d[1] * scale;
+                o.system = d[2] * scale;
+                o.idle = d[3] * scale;
+                o.iowait = d[4] * scale;
+                o.irq = d[5] * scale;
+                o.softirq = d[6] * scale;
+                o.steal = d[7] * scale;
+                o.busy = (total - d[3] - d[4]) * scale;
+            }
+        }
+
+        CpuAccounting::CpuAccounting()
+                : ticksPerSec_(sysconf(_SC_CLK_TCK) > 0 ? static_cast<double>(sysconf(_SC_CLK_TCK)) : 100),
+                  lastTotal_(),
+                  processes_(),
+                  threads_() {}
+
+        bool CpuAccounting::sampleCores(std::vector<CpuBreakdown> *cores, CpuBreakdown *total) {
+            CpuStat current{};
+
+            if (!hcprocfs::readCpuStat(&current, &cores_))
+                return false;
+
+            // cpu 数量变化时，新增的 cpu 相对于开机计算
+            lastCores_.resize(cores_.size(), CpuStat{});
+            cores->resize(cores_.size());
+            cpuBreakdown(lastCores_.data(), cores_.data(), cores_.size(), cores->data());
+
+            if (total)
+                cpuBreakdown(&lastTotal_, &current, 1, total);
+
+            lastTotal_ = current;
+            lastCores_.swap(cores_);
+            return true;
+        }
+
+        bool CpuAccounting::sampleProcesses(std::vector<TaskUsage> *tasks) {
+            if (!hcprocfs::readProcessStats(&processes_.current))
+                return false;
+
+            account(&processes_, tasks);
+            return true;
+        }
+
+        bool CpuAccounting::sampleThreads(int32_t pid, std::vector<TaskUsage> *tasks) {
+            if (threads_.pid != pid) {
+                threads_.pid = pid;
+                threads_.timestampNs = 0;
+                threads_.previous.clear();
+            }
+
+            if (!hcprocfs::readThreadStats(pid, &threads_.current))
+                return false;
+
+            account(&threads_, tasks);
+            return true;
+        }
+
+        void CpuAccounting::account(TaskHistory *history, std::vector<TaskUsage> *tasks) const {
+            const int64_t now = steadyNs();
+            const double elapsed = history->timestampNs == 0
+                                   ? 0 : static_cast<double>(now - history->timestampNs) / 1e9;
+            const double scale = elapsed > 0 ? 100.0 / (elapsed * ticksPerSec_) : 0;
+            const std::vector<TaskStat> &previous = history->previous;
+            auto prev = previous.begin();
+
+            tasks->resize(history->current.size());
+
+            // current 和 previous 都按照 id 排序，一次合并遍历
+            for (size_t i = 0; i < history->current.size(); ++i) {
+                const TaskStat &cur = history->current[i];
+                TaskUsage &usage = (*tasks)[i];
+
+                while (prev != previous.end() && prev->pid < cur.pid)
+                    ++prev;
+
+                const bool known = prev != previous.end() && prev->pid == cur.pid &&
+                                   prev->startTime == cur.startTime;
+
+                usage.id = cur.pid;
+                usage.processor = cur.processor;
+                usage.state = cur.state;
+                memcpy(usage.comm, cur.comm, sizeof(usage.comm));
+                usage.utime = cur.utime;
+                usage.stime = cur.stime;
+                usage.user = known ? static_cast<double>(counterDelta(cur.utime, prev->utime)) * scale : 0;
+                usage.system = known ? static_cast<double>(counterDelta(cur.stime, prev->stime)) * scale : 0;
+                usage.total = usage.user + usage.system;
+            }
+
+            history->timestampNs = now;
+            history->previous.swap(history->current);
+        }
+
     } /* namespace hccpu */
 
     namespace hcmem {
 
+        namespace {
+
+            MemInfo readMemInfo() {
+                MemInfo info{};
+
+                if (!hcprocfs::readMemInfo(&info))
+                    ThrowHappySysError("cannot read /proc/meminfo");
+
+                return info;
+            }
+
+        } /* namespace */
+
         /* 获取系统总内存，单位MiB */
         HAPPYCPP_SHARED_LIB_API uint32_t totalSysMem() {
-            const std::string cmd("free -m |egrep 'Mem:'|awk '{print $2}'");
-            std::string memory_size = getOutputOfCmd(cmd);
-            return stoi(memory_size);
+            return static_cast<uint32_t>(readMemInfo().memTotal / 1024);
         }
 
-        /* 获取系统空闲内存，单位MiB */
+        /* 获取系统空闲内存(MemAvailable，包括可回收的缓存)，单位MiB */
         HAPPYCPP_SHARED_LIB_API uint32_t freeSysMem() {
-            const std::string cmd("free -m |egrep 'buffers/cache'|awk '{print $NF}'");
-            std::string memory_size = getOutputOfCmd(cmd);
-            return stoi(memory_size);
+            return static_cast<uint32_t>(readMemInfo().memAvailable / 1024);
         }
 
         /* 获取系统使用内存，单位MiB */
         HAPPYCPP_SHARED_LIB_API uint32_t useSysMem() {
-            const std::string cmd(
-                    "free -m |egrep 'buffers/cache'|awk '{print $(NF-1)}'");
-            std::string memory_size = getOutputOfCmd(cmd);
-            return stoi(memory_size);
+            const MemInfo info(readMemInfo());
+            return static_cast<uint32_t>((info.memTotal - info.memAvailable) / 1024);
         }
 
     } /*namespace hcmem*/
@@ -986,23 +1191,18 @@ namespace happycpp::hclinux {
 
         /* 获取系统总虚拟内存，单位MiB */
         HAPPYCPP_SHARED_LIB_API uint32_t totalSysSwap() {
-            const std::string cmd("free -m|sed -n '4p'|awk '{print $2}'");
-            std::string memory_size = getOutputOfCmd(cmd);
-            return stoi(memory_size);
+            return static_cast<uint32_t>(hcmem::readMemInfo().swapTotal / 1024);
         }
 
         /* 获取系统空闲虚拟内存，单位MiB */
         HAPPYCPP_SHARED_LIB_API uint32_t freeSysSwap() {
-            const std::string cmd("free -m|sed -n '4p'|awk '{print $4}'");
-            std::string memory_size = getOutputOfCmd(cmd);
-            return stoi(memory_size);
+            return static_cast<uint32_t>(hcmem::readMemInfo().swapFree / 1024);
         }
 
         /* 获取系统使用虚拟内存，单位MiB */
         HAPPYCPP_SHARED_LIB_API uint32_t useSysSwap() {
-            const std::string cmd("free -m|sed -n '4p'|awk '{print $3}'");
-            std::string memory_size = getOutputOfCmd(cmd);
-            return stoi(memory_size);
+            const MemInfo info(hcmem::readMemInfo());
+            return static_cast<uint32_t>((info.swapTotal - info.swapFree) / 1024);
         }
 
     } /*namespace hcswap*/
@@ -1087,8 +1287,13 @@ namespace happycpp::hclinux {
         }
 
         HAPPYCPP_SHARED_LIB_API std::string currentLoad() {
-            const std::string cmd("awk '{print $1}' /proc/loadavg");
-            return getOutputOfCmd(cmd);
+            thread_local ProcFile file("/proc/loadavg");
+            std::string_view content;
+
+            if (!file.read(&content))
+                ThrowHappySysError("cannot read /proc/loadavg");
+
+            return std::string(content.substr(0, content.find(' ')));
         }
 
         HAPPYCPP_SHARED_LIB_API bool shutdown() {
@@ -0,0 +1,268 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/linux/metrics.h"
+
+#ifndef PLATFORM_WIN32
+
+#include <unistd.h>
+#include <cmath>
+#include <cstring>
+
+namespace happycpp::hclinux::hcmetrics {
+
+    namespace {
+
+        int64_t nowNs() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        //! 计数器的增量，计数器回绕或者被重置时返回 0
+        uint64_t delta(uint64_t current, uint64_t previous) {
+            return current >= previous ? current - previous : 0;
+        }
+
+        //! global() 创建的实例，析构之后为空
+        std::atomic<MetricsSampler *> globalSampler{nullptr};
+
+        double percent(uint64_t part, uint64_t total) {
+            return total == 0 ? 0 : 100.0 * static_cast<double>(part) / static_cast<double>(total);
+        }
+
+        //! 一次采样中所有 EWMA 共用的权重
+        struct EwmaWeights {
+            double alpha[kEwmaWindows];
+
+            EwmaWeights(const MetricsSamplerOptions &options, double dt) {
+                for (size_t i = 0; i < kEwmaWindows; ++i) {
+                    const double window = std::chrono::duration<double>(options.windows[i]).count();
+                    alpha[i] = window > 0 ? 1 - std::exp(-dt / window) : 1;
+                }
+            }
+
+            //! first 为 true 时用 x 初始化移动平均
+            void update(MetricValue *v, double x, bool first) const {
+                v->last = x;
+
+                for (size_t i = 0; i < kEwmaWindows; ++i)
+                    v->ewma[i] = first ? x : v->ewma[i] + alpha[i] * (x - v->ewma[i]);
+            }
+        };
+
+        void updateIface(const EwmaWeights &weights, double dt, const hcprocfs::NetDevStat &stat,
+                         const IfaceMetrics *previous, IfaceMetrics *iface) {
+            if (previous)
+                *iface = *previous;
+            else
+                *iface = IfaceMetrics{};
+
+            std::memcpy(iface->name, stat.name, sizeof(iface->name));
+
+            if (previous && dt > 0) {
+                const bool first = previous->samples == 1;
+                weights.update(&iface->rxBytesRate, delta(stat.rxBytes, previous->rxBytes) / dt, first);
+                weights.update(&iface->txBytesRate, delta(stat.txBytes, previous->txBytes) / dt, first);
+                weights.update(&iface->rxPacketsRate, delta(stat.rxPackets, previous->rxPackets) / dt, first);
+                weights.update(&iface->txPacketsRate, delta(stat.txPackets, previous->txPackets) / dt, first);
+            }
+
+            ++iface->samples;
+            iface->rxBytes = stat.rxBytes;
+            iface->txBytes = stat.txBytes;
+            iface->rxPackets = stat.rxPackets;
+            iface->txPackets = stat.txPackets;
+        }
+
+    } /* namespace */
+
+    const IfaceMetrics *MetricsSnapshot::iface(std::string_view name) const {
+        for (uint32_t i = 0; i < ifaceCount; ++i) {
+            if (name == std::string_view(ifaces[i].name, strnlen(ifaces[i].name, sizeof(ifaces[i].name))))
+                return &ifaces[i];
+        }
+
+        return nullptr;
+    }
+
+    MetricsSampler::MetricsSampler(const MetricsSamplerOptions &options)
+            : options_(options),
+              pid_(getpid()),
+              sequence_(0),
+              current_(),
+              lastCpu_(),
+              stop_(false) {
+        for (auto &word : words_)
+            word.store(0, std::memory_order_relaxed);
+
+        sampleNow();
+        thread_ = std::thread(&MetricsSampler::run, this);
+    }
+
+    MetricsSampler::~MetricsSampler() {
+        MetricsSampler *self = this;
+        globalSampler.compare_exchange_strong(self, nullptr);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_.store(true);
+        }
+
+        cond_.notify_one();
+        thread_.join();
+    }
+
+    bool MetricsSampler::snapshot(MetricsSnapshot *snap) const {
+        uint64_t buf[kWords];
+
+        for (;;) {
+            const uint32_t seq = sequence_.load(std::memory_order_acquire);
+
+            if (seq == 0)
+                return false;
+
+            // 后台线程正在写入
+            if (seq & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            for (size_t i = 0; i < kWords; ++i)
+                buf[i] = words_[i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (sequence_.load(std::memory_order_relaxed) == seq)
+                break;
+        }
+
+        std::memcpy(static_cast<void *>(snap), buf, sizeof(*snap));
+        return true;
+    }
+
+    void MetricsSampler::publish(const MetricsSnapshot &snap) {
+        uint64_t buf[kWords] = {};
+        std::memcpy(buf, &snap, sizeof(snap));
+
+        const uint32_t seq = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < kWords; ++i)
+            words_[i].store(buf[i], std::memory_order_relaxed);
+
+        sequence_.store(seq + 2, std::memory_order_release);
+    }
+
+    bool MetricsSampler::sampleNow() {
+        hcprocfs::CpuStat cpu{};
+        hcprocfs::MemInfo mem{};
+        hcprocfs::LoadAvg load{};
+
+        if (!hcprocfs::readCpuStat(&cpu) || !hcprocfs::readMemInfo(&mem))
+            return false;
+
+        if (!hcprocfs::readLoadAvg(&load))
+            load = hcprocfs::LoadAvg{};
+
+        std::lock_guard<std::mutex> lock(sampleMutex_);
+
+        const int64_t now = nowNs();
+        MetricsSnapshot &snap = current_;
+        const bool hasPrevious = snap.samples > 0;
+        const double dt = hasPrevious ? static_cast<double>(now - snap.timestampNs) / 1e9 : 0;
+        const EwmaWeights weights(options_, dt);
+
+        if (hasPrevious && dt > 0) {
+            const uint64_t total = delta(cpu.total(), lastCpu_.total());
+
+            if (total > 0) {
+                const bool first = snap.samples == 1;
+                // 与 hccpu::CpuBreakdown::busy 相同，iowait 算作空闲
+                const uint64_t idle = delta(cpu.idleAll(), lastCpu_.idleAll());
+                weights.update(&snap.cpuUsed, percent(total - std::min(idle, total), total), first);
+                weights.update(&snap.cpuIowait, percent(delta(cpu.iowait, lastCpu_.iowait), total), first);
+            }
+        }
+
+        weights.update(&snap.memUsed, percent(mem.memTotal - std::min(mem.memAvailable, mem.memTotal),
+                                              mem.memTotal), !hasPrevious);
+        weights.update(&snap.swapUsed, percent(mem.swapTotal - std::min(mem.swapFree, mem.swapTotal),
+                                               mem.swapTotal), !hasPrevious);
+
+        if (options_.netDev && hcprocfs::readNetDev(&netDev_)) {
+            IfaceMetrics ifaces[kMaxIfaces];
+            const uint32_t count = static_cast<uint32_t>(std::min(netDev_.size(), kMaxIfaces));
+
+            for (uint32_t i = 0; i < count; ++i) {
+                const hcprocfs::NetDevStat &stat = netDev_[i];
+                updateIface(weights, dt, stat, snap.iface(stat.name), &ifaces[i]);
+            }
+
+            std::memcpy(static_cast<void *>(snap.ifaces), ifaces, sizeof(IfaceMetrics) * count);
+            snap.ifaceCount = count;
+        }
+
+        snap.mem = mem;
+        snap.load = load;
+        snap.timestampNs = now;
+        ++snap.samples;
+        lastCpu_ = cpu;
+
+        publish(snap);
+        return true;
+    }
+
+    void MetricsSampler::run() {
+        auto next = std::chrono::steady_clock::now();
+
+        for (;;) {
+            next += options_.interval;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+
+                if (cond_.wait_until(lock, next, [this] { return stop_.load(); }))
+                    return;
+            }
+
+            sampleNow();
+        }
+    }
+
+    MetricsSampler &MetricsSampler::global() {
+        static MetricsSampler sampler;
+        globalSampler.store(&sampler, std::memory_order_release);
+        return sampler;
+    }
+
+    bool MetricsSampler::globalSnapshot(MetricsSnapshot *snap) {
+        const MetricsSampler *sampler = globalSampler.load(std::memory_order_acquire);
+
+        if (!sampler || sampler->pid_ != getpid() || !sampler->snapshot(snap))
+            return false;
+
+        const auto maxAge = std::chrono::duration_cast<std::chrono::nanoseconds>(2 * sampler->options_.interval);
+        return nowNs() - snap->timestampNs <= maxAge.count();
+    }
+
+} /* namespace happycpp */
+
+#endif  // PLATFORM_WIN32
@@ -0,0 +1,456 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/linux/netlink.h"
+
+#ifndef PLATFORM_WIN32
+
+#include "happycpp/exception.h"
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace happycpp::hclinux::hcnetlink {
+
+    namespace {
+
+        const size_t kRecvBufSize = 32768;
+        const int kNotifyRcvBuf = 1 << 20;
+        const int kDumpRetries = 5;
+
+        //! 遍历 rtattr 列表，f(type, data, size)
+        template<typename F>
+        void forEachAttr(const void *begin, size_t len, F f) {
+            const char *p = static_cast<const char *>(begin);
+
+            while (len >= sizeof(struct rtattr)) {
+                const auto *rta = reinterpret_cast<const struct rtattr *>(p);
+
+                if (rta->rta_len < sizeof(struct rtattr) || rta->rta_len > len)
+                    break;
+
+                f(rta->rta_type, static_cast<const char *>(RTA_DATA(rta)),
+                  static_cast<size_t>(rta->rta_len) - RTA_LENGTH(0));
+
+                const size_t step = RTA_ALIGN(rta->rta_len);
+
+                if (step >= len)
+                    break;
+
+                p += step;
+                len -= step;
+            }
+        }
+
+        //! 消息头之后的属性起始地址和长度，消息太短时返回 false
+        bool attrs(const nlmsghdr *msg, size_t hdrLen, const void **begin, size_t *len) {
+            if (msg->nlmsg_len < NLMSG_LENGTH(hdrLen))
+                return false;
+
+            *begin = static_cast<const char *>(NLMSG_DATA(msg)) + NLMSG_ALIGN(hdrLen);
+            *len = msg->nlmsg_len - NLMSG_LENGTH(NLMSG_ALIGN(hdrLen));
+            return true;
+        }
+
+        void setAddr(IpAddr *addr, uint8_t family, const char *data, size_t size) {
+            if ((family == AF_INET && size == 4) || (family == AF_INET6 && size == 16)) {
+                addr->family = family;
+                std::memcpy(addr->bytes, data, size);
+            }
+        }
+
+        template<typename T>
+        void readValue(const char *data, size_t size, T *value) {
+            if (size >= sizeof(T))
+                std::memcpy(value, data, sizeof(T));
+        }
+
+        std::string formatMac(const unsigned char *mac, size_t size) {
+            static const char kHex[] = "0123456789ABCDEF";
+            std::string ret;
+
+            for (size_t i = 0; i < size; ++i) {
+                if (i > 0)
+                    ret += ':';
+
+                ret += kHex[mac[i] >> 4];
+                ret += kHex[mac[i] & 0x0f];
+            }
+
+            return ret;
+        }
+
+        size_t dumpHeaderSize(uint16_t type) {
+            switch (type) {
+                case RTM_GETLINK:
+                    return sizeof(struct ifinfomsg);
+                case RTM_GETADDR:
+                    return sizeof(struct ifaddrmsg);
+                default:
+                    return sizeof(struct rtmsg);
+            }
+        }
+
+    } /* namespace */
+
+    size_t IpAddr::size() const {
+        return family == AF_INET ? 4 : (family == AF_INET6 ? 16 : 0);
+    }
+
+    std::string IpAddr::toString() const {
+        char buf[INET6_ADDRSTRLEN];
+
+        if (size() == 0 || inet_ntop(family, bytes, buf, sizeof(buf)) == nullptr)
+            return std::string();
+
+        return std::string(buf);
+    }
+
+    bool IpAddr::operator==(const IpAddr &other) const {
+        return family == other.family && std::memcmp(bytes, other.bytes, size()) == 0;
+    }
+
+    bool parseIpAddr(std::string_view text, IpAddr *addr) {
+        char buf[INET6_ADDRSTRLEN];
+
+        if (text.empty() || text.size() >= sizeof(buf))
+            return false;
+
+        std::memcpy(buf, text.data(), text.size());
+        buf[text.size()] = '\0';
+
+        *addr = IpAddr{};
+        const uint8_t family = text.find(':') == std::string_view::npos ? AF_INET : AF_INET6;
+
+        if (inet_pton(family, buf, addr->bytes) != 1)
+            return false;
+
+        addr->family = family;
+        return true;
+    }
+
+    std::string prefixToNetmask(uint8_t prefixLen) {
+        const uint32_t bits = prefixLen >= 32 ? 32 : prefixLen;
+        const uint32_t mask = bits == 0 ? 0 : htonl(~0u << (32 - bits));
+        char buf[INET_ADDRSTRLEN];
+
+        inet_ntop(AF_INET, &mask, buf, sizeof(buf));
+        return std::string(buf);
+    }
+
+    bool parseLink(const nlmsghdr *msg, LinkInfo *link) {
+        const void *begin;
+        size_t len;
+
+        if ((msg->nlmsg_type != RTM_NEWLINK && msg->nlmsg_type != RTM_DELLINK) ||
+            !attrs(msg, sizeof(struct ifinfomsg), &begin, &len))
+            return false;
+
+        const auto *ifi = static_cast<const struct ifinfomsg *>(NLMSG_DATA(msg));
+        link->index = ifi->ifi_index;
+        link->flags = ifi->ifi_flags;
+        link->mtu = 0;
+        link->name.clear();
+        link->mac.clear();
+
+        forEachAttr(begin, len, [link](uint16_t type, const char *data, size_t size) {
+            switch (type) {
+                case IFLA_IFNAME:
+                    link->name.assign(data, strnlen(data, size));
+                    break;
+                case IFLA_ADDRESS:
+                    link->mac = formatMac(reinterpret_cast<const unsigned char *>(data), size);
+                    break;
+                case IFLA_MTU:
+                    readValue(data, size, &link->mtu);
+                    break;
+                default:
+                    break;
+            }
+        });
+
+        return !link->name.empty();
+    }
+
+    bool parseAddr(const nlmsghdr *msg, AddrInfo *addr) {
+        const void *begin;
+        size_t len;
+
+        if ((msg->nlmsg_type != RTM_NEWADDR && msg->nlmsg_type != RTM_DELADDR) ||
+            !attrs(msg, sizeof(struct ifaddrmsg), &begin, &len))
+            return false;
+
+        const auto *ifa = static_cast<const struct ifaddrmsg *>(NLMSG_DATA(msg));
+        IpAddr address{};
+        IpAddr local{};
+
+        addr->index = static_cast<int32_t>(ifa->ifa_index);
+        addr->prefixLen = ifa->ifa_prefixlen;
+        addr->scope = ifa->ifa_scope;
+        addr->flags = ifa->ifa_flags;
+        addr->label.clear();
+
+        forEachAttr(begin, len, [&](uint16_t type, const char *data, size_t size) {
+            switch (type) {
+                case IFA_ADDRESS:
+                    setAddr(&address, ifa->ifa_family, data, size);
+                    break;
+                case IFA_LOCAL:
+                    setAddr(&local, ifa->ifa_family, data, size);
+                    break;
+                case IFA_LABEL:
+                    addr->label.assign(data, strnlen(data, size));
+                    break;
+                case IFA_FLAGS:
+                    readValue(data, size, &addr->flags);
+                    break;
+                default:
+                    break;
+            }
+        });
+
+        // 点对点网卡的 IFA_ADDRESS 是对端地址，本端地址在 IFA_LOCAL 中
+        addr->address = local.family != AF_UNSPEC ? local : address;
+        return addr->address.family != AF_UNSPEC;
+    }
+
+    bool parseRoute(const nlmsghdr *msg, RouteInfo *route) {
+        const void *begin;
+        size_t len;
+
+        if ((msg->nlmsg_type != RTM_NEWROUTE && msg->nlmsg_type != RTM_DELROUTE) ||
+            !attrs(msg, sizeof(struct rtmsg), &begin, &len))
+            return false;
+
+        const auto *rtm = static_cast<const struct rtmsg *>(NLMSG_DATA(msg));
+
+        *route = RouteInfo{};
+        route->family = rtm->rtm_family;
+        route->dstLen = rtm->rtm_dst_len;
+        route->type = rtm->rtm_type;
+        route->scope = rtm->rtm_scope;
+        route->table = rtm->rtm_table;
+
+        forEachAttr(begin, len, [&](uint16_t type, const char *data, size_t size) {
+            switch (type) {
+                case RTA_DST:
+                    setAddr(&route->dst, rtm->rtm_family, data, size);
+                    break;
+                case RTA_GATEWAY:
+                    setAddr(&route->gateway, rtm->rtm_family, data, size);
+                    break;
+                case RTA_OIF:
+                    readValue(data, size, &route->oif);
+                    break;
+                case RTA_PRIORITY:
+                    readValue(data, size, &route->priority);
+                    break;
+                case RTA_TABLE:
+                    readValue(data, size, &route->table);
+                    break;
+                case RTA_MULTIPATH: {
+                    // 多路径路由只取第一个下一跳
+                    if (route->oif != 0 || size < sizeof(struct rtnexthop))
+                        break;
+
+                    const auto *nh = reinterpret_cast<const struct rtnexthop *>(data);
+                    route->oif = nh->rtnh_ifindex;
+
+                    if (nh->rtnh_len > sizeof(struct rtnexthop) && nh->rtnh_len <= size) {
+                        forEachAttr(data + RTNH_LENGTH(0), nh->rtnh_len - RTNH_LENGTH(0),
+                                    [&](uint16_t nhType, const char *nhData, size_t nhSize) {
+                                        if (nhType == RTA_GATEWAY)
+                                            setAddr(&route->gateway, rtm->rtm_family, nhData, nhSize);
+                                    });
+                    }
+
+                    break;
+                }
+                default:
+                    break;
+            }
+        });
+
+        return route->family == AF_INET || route->family == AF_INET6;
+    }
+
+    NetlinkSocket::NetlinkSocket(uint32_t groups)
+            : fd_(socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE)),
+              portid_(0),
+              seq_(0),
+              buf_(kRecvBufSize) {
+        if (fd_ < 0)
+            ThrowHappySysError("Cannot create netlink socket");
+
+        struct sockaddr_nl addr{};
+        addr.nl_family = AF_NETLINK;
+        addr.nl_groups = groups;
+        socklen_t addrLen = sizeof(addr);
+
+        if (bind(fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0 ||
+            getsockname(fd_, reinterpret_cast<struct sockaddr *>(&addr), &addrLen) < 0) {
+            const int err = errno;
+            close(fd_);
+            errno = err;
+            ThrowHappySysError("Cannot bind netlink socket");
+        }
+
+        portid_ = addr.nl_pid;
+
+        // 批量变化(比如创建上千个 veth)时，通知可能在短时间内大量到达
+        if (groups != 0)
+            setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &kNotifyRcvBuf, sizeof(kNotifyRcvBuf));
+    }
+
+    NetlinkSocket::~NetlinkSocket() {
+        close(fd_);
+    }
+
+    bool NetlinkSocket::dump(uint16_t type, uint8_t family, const Handler &handler) {
+        // ifinfomsg、ifaddrmsg 以及 rtmsg 的第一个字节都是协议族
+        struct {
+            struct nlmsghdr nh;
+            char body[sizeof(struct ifinfomsg) > sizeof(struct rtmsg)
+                      ? sizeof(struct ifinfomsg) : sizeof(struct rtmsg)];
+        } req{};
+        const size_t hdrLen = dumpHeaderSize(type);
+
+        req.nh.nlmsg_len = NLMSG_LENGTH(hdrLen);
+        req.nh.nlmsg_type = type;
+        req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+        req.nh.nlmsg_seq = ++seq_;
+        req.body[0] = static_cast<char>(family);
+
+        struct sockaddr_nl kernel{};
+        kernel.nl_family = AF_NETLINK;
+
+        if (sendto(fd_, &req, req.nh.nlmsg_len, 0,
+                   reinterpret_cast<struct sockaddr *>(&kernel), sizeof(kernel)) < 0)
+            return false;
+
+        bool interrupted = false;
+
+        for (;;) {
+            const ssize_t n = recv(fd_, buf_.data(), buf_.size(), 0);
+
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+
+                return false;
+            }
+
+            auto len = static_cast<uint32_t>(n);
+
+            for (auto *nh = reinterpret_cast<const struct nlmsghdr *>(buf_.data());
+                 NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+                // 订阅了多播组时，其它进程引起的通知也会到达
+                if (nh->nlmsg_pid != portid_ || nh->nlmsg_seq != seq_)
+                    continue;
+
+                if (nh->nlmsg_flags & NLM_F_DUMP_INTR)
+                    interrupted = true;
+
+                if (nh->nlmsg_type == NLMSG_DONE) {
+                    if (interrupted) {
+                        errno = EAGAIN;
+                        return false;
+                    }
+
+                    return true;
+                }
+
+                if (nh->nlmsg_type == NLMSG_ERROR) {
+                    const auto *err = static_cast<const struct nlmsgerr *>(NLMSG_DATA(nh));
+                    errno = err->error < 0 ? -err->error : EPROTO;
+                    return false;
+                }
+
+                handler(nh);
+            }
+        }
+    }
+
+    ssize_t NetlinkSocket::receive(const Handler &handler, bool wait) {
+        ssize_t n;
+
+        do {
+            n = recv(fd_, buf_.data(), buf_.size(), wait ? 0 : MSG_DONTWAIT);
+        } while (n < 0 && errno == EINTR);
+
+        if (n < 0)
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+
+        auto len = static_cast<uint32_t>(n);
+
+        for (auto *nh = reinterpret_cast<const struct nlmsghdr *>(buf_.data());
+             NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+            if (nh->nlmsg_type >= NLMSG_MIN_TYPE)
+                handler(nh);
+        }
+
+        return n;
+    }
+
+    bool dumpAll(NetlinkDump *dump) {
+        NetlinkSocket sock;
+
+        for (int i = 0; i < kDumpRetries; ++i) {
+            dump->links.clear();
+            dump->addrs.clear();
+            dump->routes.clear();
+
+            LinkInfo link;
+            AddrInfo addr;
+            RouteInfo route{};
+
+            const bool ok =
+                    sock.dump(RTM_GETLINK, AF_UNSPEC, [&](const nlmsghdr *msg) {
+                        if (parseLink(msg, &link))
+                            dump->links.push_back(link);
+                    }) &&
+                    sock.dump(RTM_GETADDR, AF_UNSPEC, [&](const nlmsghdr *msg) {
+                        if (parseAddr(msg, &addr))
+                            dump->addrs.push_back(addr);
+                    }) &&
+                    sock.dump(RTM_GETROUTE, AF_UNSPEC, [&](const nlmsghdr *msg) {
+                        if (parseRoute(msg, &route))
+                            dump->routes.push_back(route);
+                    });
+
+            if (ok)
+                return true;
+
+            if (errno != EAGAIN)
+                return false;
+        }
+
+        return false;
+    }
+
+} /* namespace happycpp */
+
+#endif  // PLATFORM_WIN32
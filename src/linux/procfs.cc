@@ -0,0 +1,671 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/linux/procfs.h"
+
+#ifndef PLATFORM_WIN32
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace happycpp::hclinux::hcprocfs {
+
+    namespace {
+
+        const size_t kInitBufSize = 4096;
+
+        //! 取出下一行，不包括换行符
+        std::string_view nextLine(std::string_view *rest) {
+            const size_t pos = rest->find('\n');
+            std::string_view line;
+
+            if (pos == std::string_view::npos) {
+                line = *rest;
+                rest->remove_prefix(rest->size());
+            } else {
+                line = rest->substr(0, pos);
+                rest->remove_prefix(pos + 1);
+            }
+
+            return line;
+        }
+
+        void skipBlank(std::string_view *s) {
+            size_t i = 0;
+
+            while (i < s->size() && ((*s)[i] == ' ' || (*s)[i] == '\t'))
+                ++i;
+
+            s->remove_prefix(i);
+        }
+
+        std::string_view trimBlank(std::string_view s) {
+            skipBlank(&s);
+
+            while (!s.empty() && (s.back() == ' ' || s.back() == '\t' ||
+                                  s.back() == '\r' || s.back() == '\n'))
+                s.remove_suffix(1);
+
+            return s;
+        }
+
+        //! 跳过前导空白，读取一个无符号十进制整数
+        bool parseU64(std::string_view *s, uint64_t *value) {
+            skipBlank(s);
+
+            size_t i = 0;
+            uint64_t v = 0;
+
+            while (i < s->size() && (*s)[i] >= '0' && (*s)[i] <= '9') {
+                v = v * 10 + static_cast<uint64_t>((*s)[i] - '0');
+                ++i;
+            }
+
+            if (i == 0)
+                return false;
+
+            s->remove_prefix(i);
+            *value = v;
+            return true;
+        }
+
+        //! 读取 /proc/loadavg 中 "0.52" 格式的小数
+        bool parseFixed(std::string_view *s, double *value) {
+            uint64_t integer = 0;
+
+            if (!parseU64(s, &integer))
+                return false;
+
+            double v = static_cast<double>(integer);
+
+            if (!s->empty() && s->front() == '.') {
+                s->remove_prefix(1);
+                double scale = 0.1;
+
+                while (!s->empty() && s->front() >= '0' && s->front() <= '9') {
+                    v += (s->front() - '0') * scale;
+                    scale /= 10;
+                    s->remove_prefix(1);
+                }
+            }
+
+            *value = v;
+            return true;
+        }
+
+        //! 跳过前导空白，读取一个可能为负数的十进制整数
+        bool parseI64(std::string_view *s, int64_t *value) {
+            skipBlank(s);
+            const bool negative = !s->empty() && s->front() == '-';
+
+            if (negative)
+                s->remove_prefix(1);
+
+            uint64_t v = 0;
+
+            if (!parseU64(s, &v))
+                return false;
+
+            *value = negative ? -static_cast<int64_t>(v) : static_cast<int64_t>(v);
+            return true;
+        }
+
+        //! 跳过 n 个以空白分隔的字段
+        bool skipFields(std::string_view *s, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                skipBlank(s);
+                const size_t end = s->find_first_of(" \t\n");
+
+                if (s->empty() || end == 0)
+                    return false;
+
+                s->remove_prefix(end == std::string_view::npos ? s->size() : end);
+            }
+
+            return true;
+        }
+
+        //! 用栈上的缓冲区读取一个小文件，比如 /proc/[pid]/stat
+        bool readSmallFile(const char *path, char *buf, size_t size, std::string_view *content) {
+            const int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+            if (fd < 0)
+                return false;
+
+            ssize_t n;
+
+            do {
+                n = ::read(fd, buf, size);
+            } while (n < 0 && errno == EINTR);
+
+            close(fd);
+
+            if (n <= 0)
+                return false;
+
+            *content = std::string_view(buf, static_cast<size_t>(n));
+            return true;
+        }
+
+        bool isNumber(const char *name) {
+            if (*name == '\0')
+                return false;
+
+            for (; *name; ++name) {
+                if (*name < '0' || *name > '9')
+                    return false;
+            }
+
+            return true;
+        }
+
+        //! 读取目录 dir 中所有数字命名的子目录的 stat
+        bool readTaskDir(const char *dir, int32_t pid, std::vector<TaskStat> *stats) {
+            DIR *d = opendir(dir);
+
+            if (d == nullptr)
+                return false;
+
+            stats->clear();
+            struct dirent *entry;
+            TaskStat stat{};
+
+            while ((entry = readdir(d)) != nullptr) {
+                if (!isNumber(entry->d_name))
+                    continue;
+
+                const auto id = static_cast<int32_t>(strtol(entry->d_name, nullptr, 10));
+
+                // 遍历期间退出的任务直接跳过
+                if (readTaskStat(pid > 0 ? pid : id, pid > 0 ? id : 0, &stat))
+                    stats->push_back(stat);
+            }
+
+            closedir(d);
+
+            std::sort(stats->begin(), stats->end(), [](const TaskStat &a, const TaskStat &b) {
+                return a.pid < b.pid;
+            });
+            return true;
+        }
+
+        //! 拆分 /proc/cpuinfo 中 "key\t\t: value" 格式的行
+        bool splitField(std::string_view line, std::string_view *key, std::string_view *value) {
+            const size_t pos = line.find(':');
+
+            if (pos == std::string_view::npos)
+                return false;
+
+            *key = trimBlank(line.substr(0, pos));
+            *value = trimBlank(line.substr(pos + 1));
+            return true;
+        }
+
+    } /* namespace */
+
+    ProcFile::ProcFile(std::string path)
+            : path_(std::move(path)), fd_(-1) {}
+
+    ProcFile::~ProcFile() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    bool ProcFile::read(std::string_view *content) {
+        if (fd_ < 0) {
+            fd_ = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if (fd_ < 0)
+                return false;
+        }
+
+        if (buf_.empty())
+            buf_.resize(kInitBufSize);
+
+        // procfs 文件的大小总是 0，只能读到返回 0 为止
+        size_t used = 0;
+
+        for (;;) {
+            const ssize_t n = pread(fd_, buf_.data() + used, buf_.size() - used,
+                                    static_cast<off_t>(used));
+
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+
+                return false;
+            }
+
+            if (n == 0)
+                break;
+
+            used += static_cast<size_t>(n);
+
+            if (used == buf_.size())
+                buf_.resize(buf_.size() * 2);
+        }
+
+        *content = std::string_view(buf_.data(), used);
+        return true;
+    }
+
+    const std::string &ProcFile::path() const {
+        return path_;
+    }
+
+    bool parseCpuStat(std::string_view content, CpuStat *total,
+                      std::vector<CpuStat> *perCpu) {
+        bool found = false;
+
+        if (perCpu)
+            perCpu->clear();
+
+        while (!content.empty()) {
+            std::string_view line(nextLine(&content));
+
+            // cpu 行都在文件开头，后面的 intr 等行可能很长，不需要扫描
+            if (line.compare(0, 3, "cpu") != 0) {
+                if (found)
+                    break;
+
+                continue;
+            }
+
+            line.remove_prefix(3);
+            CpuStat stat{};
+            CpuStat *dest = nullptr;
+
+            if (!line.empty() && (line.front() == ' ' || line.front() == '\t')) {
+                found = true;
+                dest = total;
+            } else {
+                uint64_t index = 0;
+
+                if (!parseU64(&line, &index))
+                    continue;
+
+                if (perCpu) {
+                    if (perCpu->size() <= index)
+                        perCpu->resize(index + 1, CpuStat{});
+
+                    dest = &(*perCpu)[index];
+                }
+            }
+
+            // 老内核没有 steal、guest 和 guest_nice 列，保持为 0
+            uint64_t *fields[] = {&stat.user, &stat.nice, &stat.system, &stat.idle,
+                                  &stat.iowait, &stat.irq, &stat.softirq, &stat.steal,
+                                  &stat.guest, &stat.guestNice};
+
+            for (uint64_t *field : fields) {
+                if (!parseU64(&line, field))
+                    break;
+            }
+
+            if (dest)
+                *dest = stat;
+        }
+
+        return found;
+    }
+
+    bool parseMemInfo(std::string_view content, MemInfo *info) {
+        bool hasTotal = false;
+        bool hasAvailable = false;
+
+        *info = MemInfo{};
+
+        while (!content.empty()) {
+            std::string_view line(nextLine(&content));
+            const size_t pos = line.find(':');
+
+            if (pos == std::string_view::npos)
+                continue;
+
+            const std::string_view key(line.substr(0, pos));
+            line.remove_prefix(pos + 1);
+            uint64_t *dest = nullptr;
+
+            if (key == "MemTotal") {
+                dest = &info->memTotal;
+                hasTotal = true;
+            } else if (key == "MemFree") {
+                dest = &info->memFree;
+            } else if (key == "MemAvailable") {
+                dest = &info->memAvailable;
+                hasAvailable = true;
+            } else if (key == "Buffers") {
+                dest = &info->buffers;
+            } else if (key == "Cached") {
+                dest = &info->cached;
+            } else if (key == "SwapTotal") {
+                dest = &info->swapTotal;
+            } else if (key == "SwapFree") {
+                dest = &info->swapFree;
+            }
+
+            if (dest)
+                parseU64(&line, dest);
+        }
+
+        if (!hasAvailable)
+            info->memAvailable = info->memFree + info->buffers + info->cached;
+
+        return hasTotal;
+    }
+
+    bool parseLoadAvg(std::string_view content, LoadAvg *load) {
+        uint64_t running = 0;
+        uint64_t total = 0;
+
+        if (!parseFixed(&content, &load->load1) ||
+            !parseFixed(&content, &load->load5) ||
+            !parseFixed(&content, &load->load15) ||
+            !parseU64(&content, &running) ||
+            content.empty() || content.front() != '/')
+            return false;
+
+        content.remove_prefix(1);
+
+        if (!parseU64(&content, &total))
+            return false;
+
+        load->running = static_cast<uint32_t>(running);
+        load->total = static_cast<uint32_t>(total);
+        return true;
+    }
+
+    bool parseCpuInfo(std::string_view content, CpuInfo *info) {
+        std::vector<uint64_t> packages;
+
+        info->modelName.clear();
+        info->modelNames.clear();
+        info->processors = 0;
+        info->packages = 0;
+        info->coresPerPackage = 0;
+
+        while (!content.empty()) {
+            std::string_view key;
+            std::string_view value;
+
+            if (!splitField(nextLine(&content), &key, &value))
+                continue;
+
+            if (key == "processor") {
+                ++info->processors;
+            } else if (key == "model name") {
+                if (info->modelName.empty())
+                    info->modelName.assign(value);
+
+                info->modelNames.emplace_back(value);
+            } else if (key == "physical id") {
+                uint64_t id = 0;
+
+                if (parseU64(&value, &id) &&
+                    std::find(packages.begin(), packages.end(), id) == packages.end())
+                    packages.push_back(id);
+            } else if (key == "cpu cores") {
+                uint64_t cores = 0;
+
+                if (info->coresPerPackage == 0 && parseU64(&value, &cores))
+                    info->coresPerPackage = static_cast<uint32_t>(cores);
+            }
+        }
+
+        info->packages = static_cast<uint32_t>(packages.size());
+        return info->processors > 0;
+    }
+
+    bool parseNetDev(std::string_view content, std::vector<NetDevStat> *stats) {
+        stats->clear();
+
+        while (!content.empty()) {
+            std::string_view line(nextLine(&content));
+            const size_t pos = line.find(':');
+
+            // 表头没有冒号
+            if (pos == std::string_view::npos)
+                continue;
+
+            const std::string_view name(trimBlank(line.substr(0, pos)));
+            line.remove_prefix(pos + 1);
+
+            // 接收 8 列: bytes packets errs drop fifo frame compressed multicast
+            // 发送 8 列: bytes packets errs drop fifo colls carrier compressed
+            uint64_t fields[16];
+            size_t n = 0;
+
+            while (n < 16 && parseU64(&line, &fields[n]))
+                ++n;
+
+            if (n < 16 || name.empty())
+                return false;
+
+            NetDevStat stat{};
+            const size_t len = std::min(name.size(), sizeof(stat.name) - 1);
+            std::memcpy(stat.name, name.data(), len);
+            stat.rxBytes = fields[0];
+            stat.rxPackets = fields[1];
+            stat.rxErrors = fields[2];
+            stat.rxDropped = fields[3];
+            stat.txBytes = fields[8];
+            stat.txPackets = fields[9];
+            stat.txErrors = fields[10];
+            stat.txDropped = fields[11];
+            stats->push_back(stat);
+        }
+
+        return true;
+    }
+
+    bool parseTaskStat(std::string_view content, TaskStat *stat) {
+        // comm 可以包含任意字符，以最后一个 ')' 为准
+        const size_t lparen = content.find('(');
+        const size_t rparen = content.rfind(')');
+        uint64_t pid = 0;
+
+        if (lparen == std::string_view::npos || rparen == std::string_view::npos || rparen < lparen)
+            return false;
+
+        std::string_view head(content.substr(0, lparen));
+
+        if (!parseU64(&head, &pid))
+            return false;
+
+        *stat = TaskStat{};
+        stat->pid = static_cast<int32_t>(pid);
+
+        const std::string_view comm(content.substr(lparen + 1, rparen - lparen - 1));
+        std::memcpy(stat->comm, comm.data(), std::min(comm.size(), sizeof(stat->comm) - 1));
+
+        // 从第 3 个字段 state 开始
+        std::string_view rest(content.substr(rparen + 1));
+        skipBlank(&rest);
+
+        if (rest.empty())
+            return false;
+
+        stat->state = rest.front();
+        rest.remove_prefix(1);
+
+        int64_t ppid = 0;
+        int64_t numThreads = 0;
+        int64_t processor = 0;
+
+        // 4 ppid, 5-13 跳过, 14 utime, 15 stime, 16-19 跳过, 20 num_threads, 21 跳过, 22 starttime
+        if (!parseI64(&rest, &ppid) || !skipFields(&rest, 9) ||
+            !parseU64(&rest, &stat->utime) || !parseU64(&rest, &stat->stime) ||
+            !skipFields(&rest, 4) || !parseI64(&rest, &numThreads) ||
+            !skipFields(&rest, 1) || !parseU64(&rest, &stat->startTime))
+            return false;
+
+        // 39 processor，2.2 之前的内核没有该字段
+        if (skipFields(&rest, 16) && parseI64(&rest, &processor))
+            stat->processor = static_cast<int32_t>(processor);
+        else
+            stat->processor = -1;
+
+        stat->ppid = static_cast<int32_t>(ppid);
+        stat->numThreads = static_cast<int32_t>(numThreads);
+        return true;
+    }
+
+    uint32_t parseCpuList(std::string_view content) {
+        uint32_t count = 0;
+
+        content = trimBlank(content);
+
+        while (!content.empty()) {
+            uint64_t first = 0;
+            uint64_t last = 0;
+
+            if (!parseU64(&content, &first))
+                return 0;
+
+            last = first;
+
+            if (!content.empty() && content.front() == '-') {
+                content.remove_prefix(1);
+
+                if (!parseU64(&content, &last) || last < first)
+                    return 0;
+            }
+
+            count += static_cast<uint32_t>(last - first + 1);
+
+            if (!content.empty()) {
+                if (content.front() != ',')
+                    return 0;
+
+                content.remove_prefix(1);
+            }
+        }
+
+        return count;
+    }
+
+    bool readCpuStat(CpuStat *total, std::vector<CpuStat> *perCpu) {
+        thread_local ProcFile file("/proc/stat");
+        std::string_view content;
+        return file.read(&content) && parseCpuStat(content, total, perCpu);
+    }
+
+    bool readMemInfo(MemInfo *info) {
+        thread_local ProcFile file("/proc/meminfo");
+        std::string_view content;
+        return file.read(&content) && parseMemInfo(content, info);
+    }
+
+    bool readLoadAvg(LoadAvg *load) {
+        thread_local ProcFile file("/proc/loadavg");
+        std::string_view content;
+        return file.read(&content) && parseLoadAvg(content, load);
+    }
+
+    bool readCpuInfo(CpuInfo *info) {
+        thread_local ProcFile file("/proc/cpuinfo");
+        std::string_view content;
+        return file.read(&content) && parseCpuInfo(content, info);
+    }
+
+    bool readNetDev(std::vector<NetDevStat> *stats) {
+        thread_local ProcFile file("/proc/net/dev");
+        std::string_view content;
+        return file.read(&content) && parseNetDev(content, stats);
+    }
+
+    bool readTaskStat(int32_t pid, int32_t tid, TaskStat *stat) {
+        char path[64];
+        char buf[1024];
+        std::string_view content;
+
+        if (tid > 0)
+            snprintf(path, sizeof(path), "/proc/%d/task/%d/stat", pid, tid);
+        else
+            snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+
+        return readSmallFile(path, buf, sizeof(buf), &content) && parseTaskStat(content, stat);
+    }
+
+    bool readProcessStats(std::vector<TaskStat> *stats) {
+        return readTaskDir("/proc", 0, stats);
+    }
+
+    bool readThreadStats(int32_t pid, std::vector<TaskStat> *stats) {
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/%d/task", pid);
+        return readTaskDir(path, pid, stats);
+    }
+
+    uint32_t onlineCpus() {
+        thread_local ProcFile file("/sys/devices/system/cpu/online");
+        std::string_view content;
+        return file.read(&content) ? parseCpuList(content) : 0;
+    }
+
+    uint32_t physicalCores() {
+        const std::string root("/sys/devices/system/cpu/");
+        DIR *dir = opendir(root.c_str());
+
+        if (dir == nullptr)
+            return 0;
+
+        std::vector<std::pair<uint64_t, uint64_t>> cores;
+        struct dirent *entry;
+
+        while ((entry = readdir(dir)) != nullptr) {
+            const std::string_view name(entry->d_name);
+
+            if (name.size() <= 3 || name.compare(0, 3, "cpu") != 0 ||
+                name.find_first_not_of("0123456789", 3) != std::string_view::npos)
+                continue;
+
+            const std::string topology(root + entry->d_name + "/topology/");
+            ProcFile packageFile(topology + "physical_package_id");
+            ProcFile coreFile(topology + "core_id");
+            std::string_view content;
+            uint64_t package = 0;
+            uint64_t core = 0;
+
+            // 离线的 cpu 没有 topology 目录
+            if (!packageFile.read(&content) || !parseU64(&content, &package) ||
+                !coreFile.read(&content) || !parseU64(&content, &core))
+                continue;
+
+            cores.emplace_back(package, core);
+        }
+
+        closedir(dir);
+
+        std::sort(cores.begin(), cores.end());
+        cores.erase(std::unique(cores.begin(), cores.end()), cores.end());
+        return static_cast<uint32_t>(cores.size());
+    }
+
+} /* namespace happycpp */
+
+#endif  // PLATFORM_WIN32
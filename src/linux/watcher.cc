@@ -0,0 +1,393 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/linux/watcher.h"
+
+#ifndef PLATFORM_WIN32
+
+#include "happycpp/exception.h"
+#include "happycpp/hcerrno.h"
+#include "happycpp/log.h"
+#include <linux/rtnetlink.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <exception>
+
+using happycpp::hcerrno::errorToStr;
+
+namespace happycpp::hclinux::hcnet {
+
+    namespace {
+
+        const uint32_t kGroups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR |
+                                 RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE;
+
+        //! poll 或者接收连续失败的次数超过该值时，后台线程退出
+        const int kMaxPollErrors = 10;
+
+        //! poll 或者接收失败之后重试的间隔(毫秒)
+        const int kPollRetryMs = 100;
+
+        bool sameLink(const hcnetlink::LinkInfo &a, const hcnetlink::LinkInfo &b) {
+            return a.index == b.index && a.flags == b.flags && a.mtu == b.mtu &&
+                   a.name == b.name && a.mac == b.mac;
+        }
+
+        //! 同一个网卡上的同一个地址
+        bool sameAddrKey(const hcnetlink::AddrInfo &a, const hcnetlink::AddrInfo &b) {
+            return a.index == b.index && a.prefixLen == b.prefixLen && a.address == b.address;
+        }
+
+        bool sameAddr(const hcnetlink::AddrInfo &a, const hcnetlink::AddrInfo &b) {
+            return sameAddrKey(a, b) && a.scope == b.scope && a.flags == b.flags && a.label == b.label;
+        }
+
+        bool sameRoute(const hcnetlink::RouteInfo &a, const hcnetlink::RouteInfo &b) {
+            return a.family == b.family && a.dstLen == b.dstLen && a.type == b.type &&
+                   a.scope == b.scope && a.table == b.table && a.priority == b.priority &&
+                   a.oif == b.oif && a.dst == b.dst && a.gateway == b.gateway;
+        }
+
+        //! 内核区分路由的字段：协议族、路由表、目的地址、前缀长度以及 metric
+        std::string routeKey(const hcnetlink::RouteInfo &route) {
+            std::string key;
+            key.reserve(10 + route.dst.size());
+            key.push_back(static_cast<char>(route.family));
+            key.append(reinterpret_cast<const char *>(&route.table), sizeof(route.table));
+            key.push_back(static_cast<char>(route.dstLen));
+            key.append(reinterpret_cast<const char *>(&route.priority), sizeof(route.priority));
+            key.append(reinterpret_cast<const char *>(route.dst.bytes), route.dst.size());
+            return key;
+        }
+
+    } /* namespace */
+
+    IfaceSnapshot::IfaceSnapshot(uint64_t version, hcnetlink::NetlinkDump dump)
+            : version(version), dump(std::move(dump)), finder(this->dump) {
+    }
+
+    IfaceWatcher::IfaceWatcher()
+            : sock_(kGroups), eventFd_(-1), version_(0), failed_(false) {
+        if (!resync())
+            ThrowHappySysError("Cannot get network interfaces from netlink");
+
+        publish();
+
+        eventFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+        if (eventFd_ < 0)
+            ThrowHappySysError("Cannot create eventfd");
+
+        thread_ = std::thread(&IfaceWatcher::run, this);
+    }
+
+    IfaceWatcher::~IfaceWatcher() {
+        const uint64_t one = 1;
+
+        if (write(eventFd_, &one, sizeof(one)) < 0) {
+            // 计数器不可能溢出，写入不会失败
+        }
+
+        thread_.join();
+        close(eventFd_);
+    }
+
+    IfaceWatcher::Snapshot IfaceWatcher::snapshot() const {
+        return std::atomic_load(&snapshot_);
+    }
+
+    uint64_t IfaceWatcher::version() const {
+        return version_.load(std::memory_order_acquire);
+    }
+
+    bool IfaceWatcher::failed() const {
+        return failed_.load();
+    }
+
+    void IfaceWatcher::addCallback(Callback callback) {
+        std::lock_guard<std::mutex> lock(callbackMutex_);
+        callbacks_.push_back(std::move(callback));
+    }
+
+    bool IfaceWatcher::resync() {
+        hcnetlink::NetlinkDump dump;
+
+        if (!hcnetlink::dumpAll(&dump))
+            return false;
+
+        links_.clear();
+        addrs_.clear();
+        routes_.clear();
+
+        for (hcnetlink::LinkInfo &link : dump.links)
+            links_[link.index] = std::move(link);
+
+        // 内核返回的地址已经是主地址在前
+        for (hcnetlink::AddrInfo &addr : dump.addrs)
+            addrs_[addr.index].push_back(std::move(addr));
+
+        for (const hcnetlink::RouteInfo &route : dump.routes)
+            routes_[routeKey(route)] = route;
+
+        return true;
+    }
+
+    bool IfaceWatcher::apply(const nlmsghdr *msg) {
+        switch (msg->nlmsg_type) {
+            case RTM_NEWLINK: {
+                hcnetlink::LinkInfo link;
+
+                if (!hcnetlink::parseLink(msg, &link))
+                    return false;
+
+                const auto it = links_.find(link.index);
+
+                if (it != links_.end() && sameLink(it->second, link))
+                    return false;
+
+                links_[link.index] = std::move(link);
+                return true;
+            }
+            case RTM_DELLINK: {
+                hcnetlink::LinkInfo link;
+
+                if (!hcnetlink::parseLink(msg, &link) || !links_.erase(link.index))
+                    return false;
+
+                // 内核不一定为删除的网卡逐个发送 RTM_DELADDR 和 RTM_DELROUTE
+                addrs_.erase(link.index);
+
+                for (auto it = routes_.begin(); it != routes_.end();) {
+                    if (it->second.oif == link.index)
+                        it = routes_.erase(it);
+                    else
+                        ++it;
+                }
+
+                return true;
+            }
+            case RTM_NEWADDR:
+            case RTM_DELADDR: {
+                hcnetlink::AddrInfo addr;
+                return hcnetlink::parseAddr(msg, &addr) && applyAddr(addr, msg->nlmsg_type == RTM_NEWADDR);
+            }
+            case RTM_NEWROUTE:
+            case RTM_DELROUTE: {
+                hcnetlink::RouteInfo route{};
+                return hcnetlink::parseRoute(msg, &route) && applyRoute(route, msg->nlmsg_type == RTM_NEWROUTE);
+            }
+            default:
+                return false;
+        }
+    }
+
+    bool IfaceWatcher::applyAddr(const hcnetlink::AddrInfo &addr, bool add) {
+        std::vector<hcnetlink::AddrInfo> &addrs = addrs_[addr.index];
+        const auto it = std::find_if(addrs.begin(), addrs.end(), [&addr](const hcnetlink::AddrInfo &a) {
+            return sameAddrKey(a, addr);
+        });
+
+        if (!add) {
+            if (it == addrs.end()) {
+                if (addrs.empty())
+                    addrs_.erase(addr.index);
+
+                return false;
+            }
+
+            addrs.erase(it);
+
+            if (addrs.empty())
+                addrs_.erase(addr.index);
+
+            return true;
+        }
+
+        if (it != addrs.end()) {
+            if (sameAddr(*it, addr))
+                return false;
+
+            // 删除主地址之后，内核可能把从地址提升为主地址，位置保持不变
+            *it = addr;
+            return true;
+        }
+
+        // 主地址放在同一协议族的第一个从地址之前，与内核的顺序一致
+        auto pos = addrs.end();
+
+        if (!(addr.flags & IFA_F_SECONDARY)) {
+            pos = std::find_if(addrs.begin(), addrs.end(), [&addr](const hcnetlink::AddrInfo &a) {
+                return a.address.family == addr.address.family && (a.flags & IFA_F_SECONDARY);
+            });
+        }
+
+        addrs.insert(pos, addr);
+        return true;
+    }
+
+    bool IfaceWatcher::applyRoute(const hcnetlink::RouteInfo &route, bool add) {
+        const std::string key(routeKey(route));
+
+        if (!add)
+            return routes_.erase(key) > 0;
+
+        const auto it = routes_.find(key);
+
+        if (it != routes_.end() && sameRoute(it->second, route))
+            return false;
+
+        routes_[key] = route;
+        return true;
+    }
+
+    void IfaceWatcher::publish() {
+        hcnetlink::NetlinkDump dump;
+        dump.links.reserve(links_.size());
+        dump.routes.reserve(routes_.size());
+
+        for (const auto &link : links_)
+            dump.links.push_back(link.second);
+
+        for (const auto &addrs : addrs_)
+            dump.addrs.insert(dump.addrs.end(), addrs.second.begin(), addrs.second.end());
+
+        for (const auto &route : routes_)
+            dump.routes.push_back(route.second);
+
+        const uint64_t version = version_.load(std::memory_order_relaxed) + 1;
+        std::atomic_store(&snapshot_, Snapshot(std::make_shared<const IfaceSnapshot>(version, std::move(dump))));
+        version_.store(version, std::memory_order_release);
+    }
+
+    void IfaceWatcher::run() {
+        pollfd fds[2] = {{sock_.fd(), POLLIN, 0}, {eventFd_, POLLIN, 0}};
+        bool changed = false;
+        bool stale = false;
+        const hcnetlink::NetlinkSocket::Handler handler = [this, &changed](const nlmsghdr *msg) {
+            changed = apply(msg) || changed;
+        };
+
+        happycpp::log::HappyLog &hlog = happycpp::log::HappyLog::instance();
+        int pollErrors = 0;
+
+        for (;;) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR)
+                    continue;
+
+                hlog.error("IfaceWatcher poll failed: " + errorToStr());
+
+                if (++pollErrors >= kMaxPollErrors)
+                    break;
+
+                // 等待一段时间再重试，期间仍然响应析构
+                if (poll(&fds[1], 1, kPollRetryMs) > 0)
+                    return;
+
+                continue;
+            }
+
+            if (fds[1].revents)
+                return;
+
+            // 套接字已经失效，之后不可能再收到通知
+            if (fds[0].revents & POLLNVAL)
+                break;
+
+            changed = false;
+            bool receiveFailed = false;
+
+            // 一次读完所有待处理的消息，合并为一个快照
+            for (;;) {
+                const ssize_t n = sock_.receive(handler, false);
+
+                if (n > 0 || (n < 0 && errno == EINTR))
+                    continue;
+
+                if (n < 0 && errno == ENOBUFS) {
+                    stale = true;
+                    continue;
+                }
+
+                if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    hlog.error("IfaceWatcher receive failed: " + errorToStr());
+                    receiveFailed = true;
+                }
+
+                break;
+            }
+
+            // 套接字持续出错时 POLLERR 不会被清除，poll 立即返回。与 poll 失败一样计数，等待一段时间再重试
+            if (receiveFailed) {
+                if (++pollErrors >= kMaxPollErrors)
+                    break;
+
+                if (poll(&fds[1], 1, kPollRetryMs) > 0)
+                    return;
+            } else {
+                pollErrors = 0;
+            }
+
+            // 丢失了通知，无法确定当前状态，重新获取全部信息。失败时在下一次通知时重试
+            if (stale) {
+                try {
+                    stale = !resync();
+                } catch (const std::exception &e) {
+                    hlog.error(e);
+                }
+
+                changed = changed || !stale;
+            }
+
+            if (!changed)
+                continue;
+
+            publish();
+
+            const Snapshot snap(snapshot());
+            std::vector<Callback> callbacks;
+
+            {
+                std::lock_guard<std::mutex> lock(callbackMutex_);
+                callbacks = callbacks_;
+            }
+
+            // 一个回调抛出异常时，不影响其它回调以及后台线程
+            for (const Callback &callback : callbacks) {
+                try {
+                    callback(snap);
+                } catch (const std::exception &e) {
+                    hlog.error(e);
+                } catch (...) {
+                    hlog.error("IfaceWatcher callback threw an unknown exception.");
+                }
+            }
+        }
+
+        hlog.error("IfaceWatcher stopped, snapshots are no longer updated.");
+        failed_.store(true);
+    }
+
+} /* namespace happycpp */
+
+#endif  // PLATFORM_WIN32
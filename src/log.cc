@@ -20,12 +20,15 @@
 
 #include "happycpp/log.h"
 #include <log4cplus/configurator.h>
+#include <log4cplus/helpers/property.h>
 #include <log4cplus/helpers/loglog.h>
 #include <log4cplus/consoleappender.h>
 #include <log4cplus/helpers/fileinfo.h>
 #include <log4cplus/initializer.h>
-
-#define _LOGGER(loggerName) loggerName == "root" ? _logger : Logger::getInstance(loggerName)
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <unordered_map>
 
 using namespace std;
 using namespace log4cplus;
@@ -33,8 +36,51 @@ using namespace log4cplus::helpers;
 
 namespace happycpp::log {
     HappyLogPtr HappyLog::_instance = nullptr;
+    std::atomic<HappyLog *> HappyLog::_ptr(nullptr);
+    std::once_flag HappyLog::_once;
+    std::atomic<LogLevel> HappyLog::_threshold(TRACE_LOG_LEVEL);
+
+    namespace {
+
+        std::string vformatLog(const char *fmt, va_list args) {
+            char buf[512];
+            va_list copy;
+
+            va_copy(copy, args);
+            const int n = vsnprintf(buf, sizeof(buf), fmt, copy);
+            va_end(copy);
+
+            if (n < 0)
+                return std::string();
+
+            if (static_cast<size_t>(n) < sizeof(buf))
+                return std::string(buf, static_cast<size_t>(n));
+
+            // 栈上的缓冲区不够，按实际长度再格式化一次
+            std::string s(static_cast<size_t>(n), '\0');
+            vsnprintf(&s[0], s.size() + 1, fmt, args);
+            return s;
+        }
 
-    HappyLog::HappyLog(log4cplus::LogLevel level, const std::string &logPrefix) {
+    } /* namespace */
+
+    std::string formatLog(const char *fmt, ...) {
+        va_list args;
+        va_start(args, fmt);
+        std::string s(vformatLog(fmt, args));
+        va_end(args);
+        return s;
+    }
+
+    std::string formatLogUnchecked(const char *fmt, ...) {
+        va_list args;
+        va_start(args, fmt);
+        std::string s(vformatLog(fmt, args));
+        va_end(args);
+        return s;
+    }
+
+    HappyLog::HappyLog(log4cplus::LogLevel level, const std::string &logPrefix) : _asyncDropped(0) {
         log4cplus::SharedAppenderPtr defaultAppend(new log4cplus::ConsoleAppender(false, true));
 
         defaultAppend->setName(LOG4CPLUS_TEXT("Console"));
@@ -46,35 +92,49 @@ namespace happycpp::log {
 
         _logger = Logger::getRoot();
         setLogPrefix(logPrefix);
+        updateThreshold();
 
         info("HappyLog->未启用日志配置文件，加载默认设置。当前运行在【控制台输出】模式下......");
     }
 
-    HappyLog::HappyLog(const string &profile, const std::string &logPrefix) {
+    HappyLog::HappyLog(const string &profile, const std::string &logPrefix) : _asyncDropped(0) {
         PropertyConfigurator::doConfigure(LOG4CPLUS_TEXT(profile));
+        loadLogLimits(Properties(LOG4CPLUS_TEXT(profile)));
         _logger = Logger::getRoot();
         setLogPrefix(logPrefix);
+        updateThreshold();
 
         info("HappyLog->日志配置文件 '" + profile + "' 加载成功......");
     }
 
-    HappyLogPtr HappyLog::getInstance(log4cplus::LogLevel level, const std::string &logPrefix) {
-        if (_instance == nullptr) {
-            shared_ptr<HappyLog> tmpInstance(new HappyLog(level, logPrefix));
+    template<typename F>
+    HappyLog &HappyLog::create(F f) {
+        // 构造函数抛出异常时，call_once 允许下一个调用者重试
+        std::call_once(_once, [&f]() {
+            _instance.reset(f());
+            _ptr.store(_instance.get(), std::memory_order_release);
+        });
 
-            _instance = tmpInstance;
-        }
+        return *_ptr.load(std::memory_order_acquire);
+    }
 
-        return _instance;
+    HappyLog &HappyLog::instance(log4cplus::LogLevel level, const std::string &logPrefix) {
+        HappyLog *p = _ptr.load(std::memory_order_acquire);
+        return p != nullptr ? *p : create([&]() { return new HappyLog(level, logPrefix); });
     }
 
-    HappyLogPtr HappyLog::getInstance(const string &profile, const std::string &logPrefix) {
-        if (_instance == nullptr) {
-            shared_ptr<HappyLog> tmpInstance(new HappyLog(profile, logPrefix));
+    HappyLog &HappyLog::instance(const string &profile, const std::string &logPrefix) {
+        HappyLog *p = _ptr.load(std::memory_order_acquire);
+        return p != nullptr ? *p : create([&]() { return new HappyLog(profile, logPrefix); });
+    }
 
-            _instance = tmpInstance;
-        }
+    HappyLogPtr HappyLog::getInstance(log4cplus::LogLevel level, const std::string &logPrefix) {
+        instance(level, logPrefix);
+        return _instance;
+    }
 
+    HappyLogPtr HappyLog::getInstance(const string &profile, const std::string &logPrefix) {
+        instance(profile, logPrefix);
         return _instance;
     }
 
@@ -83,38 +143,144 @@ namespace happycpp::log {
     }
 
     void HappyLog::enterFunc(const std::string &funcName, const string &loggerName) {
-        LOG4CPLUS_TRACE(_LOGGER(loggerName), LOG4CPLUS_TEXT(_logPrefix + "Enter function: ") << funcName);
+        if (_async)
+            writeAsync(TRACE_LOG_LEVEL, "Enter function: " + funcName, loggerName);
+        else
+            LOG4CPLUS_TRACE(logger(loggerName), LOG4CPLUS_TEXT(_logPrefix + "Enter function: ") << funcName);
     }
 
     void HappyLog::exitFunc(const std::string &funcName, const string &loggerName) {
-        LOG4CPLUS_TRACE(_LOGGER(loggerName), LOG4CPLUS_TEXT(_logPrefix + "Exit function: ") << funcName);
+        if (_async)
+            writeAsync(TRACE_LOG_LEVEL, "Exit function: " + funcName, loggerName);
+        else
+            LOG4CPLUS_TRACE(logger(loggerName), LOG4CPLUS_TEXT(_logPrefix + "Exit function: ") << funcName);
+    }
+
+    void HappyLog::write(LogLevel level, const string &s, const string &loggerName) {
+        if (writeAsync(level, s, loggerName))
+            return;
+
+        const Logger &l = logger(loggerName);
+
+        if (level >= ERROR_LOG_LEVEL)
+            LOG4CPLUS_ERROR(l, LOG4CPLUS_TEXT(_logPrefix + s));
+        else if (level >= WARN_LOG_LEVEL)
+            LOG4CPLUS_WARN(l, LOG4CPLUS_TEXT(_logPrefix + s));
+        else if (level >= INFO_LOG_LEVEL)
+            LOG4CPLUS_INFO(l, LOG4CPLUS_TEXT(_logPrefix + s));
+        else if (level >= DEBUG_LOG_LEVEL)
+            LOG4CPLUS_DEBUG(l, LOG4CPLUS_TEXT(_logPrefix + s));
+        else
+            LOG4CPLUS_TRACE(l, LOG4CPLUS_TEXT(_logPrefix + s));
+    }
+
+    bool HappyLog::suppressed(LogLevel level, const string &loggerName) {
+        if (!LogLimiter::enabled())
+            return false;
+
+        // 未启用的级别不计入限流
+        return logger(loggerName).isEnabledFor(level) && !loggerLimiter(loggerName, level).allow(level);
     }
 
     void HappyLog::error(const string &s, const string &loggerName) {
-        LOG4CPLUS_ERROR(_LOGGER(loggerName), LOG4CPLUS_TEXT(_logPrefix + s));
+        if (!suppressed(ERROR_LOG_LEVEL, loggerName))
+            write(ERROR_LOG_LEVEL, s, loggerName);
     }
 
     void HappyLog::warn(const string &s, const string &loggerName) {
-        LOG4CPLUS_WARN(_LOGGER(loggerName), LOG4CPLUS_TEXT(_logPrefix + s));
+        if (!suppressed(WARN_LOG_LEVEL, loggerName))
+            write(WARN_LOG_LEVEL, s, loggerName);
     }
 
     void HappyLog::info(const string &s, const string &loggerName) {
-        LOG4CPLUS_INFO(_LOGGER(loggerName), LOG4CPLUS_TEXT(_logPrefix + s));
+        if (!suppressed(INFO_LOG_LEVEL, loggerName))
+            write(INFO_LOG_LEVEL, s, loggerName);
     }
 
     void HappyLog::debug(const string &s, const string &loggerName) {
-        LOG4CPLUS_DEBUG(_LOGGER(loggerName), LOG4CPLUS_TEXT(_logPrefix + s));
+        if (!suppressed(DEBUG_LOG_LEVEL, loggerName))
+            write(DEBUG_LOG_LEVEL, s, loggerName);
     }
 
     void HappyLog::trace(const string &s, const string &loggerName) {
-        LOG4CPLUS_TRACE(_LOGGER(loggerName), LOG4CPLUS_TEXT(_logPrefix + s));
+        if (!suppressed(TRACE_LOG_LEVEL, loggerName))
+            write(TRACE_LOG_LEVEL, s, loggerName);
     }
 
     void HappyLog::error(const exception &e, const string &loggerName) {
-        LOG4CPLUS_ERROR(_LOGGER(loggerName), LOG4CPLUS_TEXT(_logPrefix + "Exception Error->" << e.what()));
+        if (!suppressed(ERROR_LOG_LEVEL, loggerName))
+            write(ERROR_LOG_LEVEL, string("Exception Error->") + e.what(), loggerName);
     }
 
     void HappyLog::setLogPrefix(const string &logPrefix) {
         _logPrefix = logPrefix.empty() ? logPrefix : logPrefix + " ";
     }
+
+    void HappyLog::setLogLevel(LogLevel level, const string &loggerName) {
+        Logger l = logger(loggerName);
+        l.setLogLevel(level);
+        updateThreshold();
+    }
+
+    const Logger &HappyLog::logger(const string &loggerName) {
+        if (loggerName == "root")
+            return _logger;
+
+        thread_local std::unordered_map<std::string, Logger> loggers;
+        auto it = loggers.find(loggerName);
+
+        if (it == loggers.end())
+            it = loggers.emplace(loggerName, Logger::getInstance(loggerName)).first;
+
+        return it->second;
+    }
+
+    void HappyLog::updateThreshold() {
+        LogLevel level = Logger::getRoot().getChainedLogLevel();
+
+        for (const Logger &logger : Logger::getCurrentLoggers())
+            level = std::min(level, logger.getChainedLogLevel());
+
+        _threshold.store(level, std::memory_order_relaxed);
+    }
+
+    bool HappyLog::writeAsync(LogLevel level, const string &s, const string &loggerName) {
+        if (!_async)
+            return false;
+
+        const Logger &l = logger(loggerName);
+
+        if (l.isEnabledFor(level))
+            _async->push(level, l.getName(), _logPrefix, s);
+
+        return true;
+    }
+
+    void HappyLog::enableAsync(const AsyncLogOptions &options) {
+        disableAsync();
+
+        // 被抑制的记录数由后台线程空闲时汇报
+        AsyncLogOptions o(options);
+        o.reportSuppressed = true;
+        _async.reset(new AsyncLogWriter(o));
+    }
+
+    void HappyLog::disableAsync() {
+        if (!_async)
+            return;
+
+        _asyncDropped += _async->dropped();
+        _async.reset();
+    }
+
+    void HappyLog::flush() {
+        flushLogSummaries();
+
+        if (_async)
+            _async->flush();
+    }
+
+    uint64_t HappyLog::droppedRecords() const {
+        return _asyncDropped + (_async ? _async->dropped() : 0);
+    }
 } /* namespace happycpp */
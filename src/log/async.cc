@@ -0,0 +1,566 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/log/async.h"
+#include "happycpp/log/binary.h"
+#include "happycpp/log/limit.h"
+#include "happycpp/exception.h"
+#include "happycpp/hcerrno.h"
+#include <fcntl.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#ifdef PLATFORM_WIN32
+#include <io.h>
+#include <process.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+using happycpp::hcerrno::errorToStr;
+
+namespace happycpp::log {
+
+    struct AsyncLogWriter::Slot {
+        std::atomic<uint64_t> seq; /*! 等于下标时可写，等于下标 + 1 时可读 */
+        std::string data;
+    };
+
+    namespace {
+
+        //! 每批最多合并的记录数，加上调用点定义不超过 IOV_MAX
+        const size_t kMaxBatch = 1023;
+
+        //! LOG_OVERFLOW_BLOCK 等待时，先让出 CPU 的次数，之后每次睡眠
+        const int kYieldSpins = 64;
+
+        const auto kBlockSleep = std::chrono::microseconds(50);
+
+        size_t roundUpPow2(size_t n) {
+            size_t v = 2;
+
+            while (v < n)
+                v <<= 1;
+
+            return v;
+        }
+
+        // 与 log4cplus %-5p 的输出相同
+        std::string_view levelName(log4cplus::LogLevel level) {
+            if (level >= log4cplus::FATAL_LOG_LEVEL)
+                return "FATAL";
+
+            if (level >= log4cplus::ERROR_LOG_LEVEL)
+                return "ERROR";
+
+            if (level >= log4cplus::WARN_LOG_LEVEL)
+                return "WARN ";
+
+            if (level >= log4cplus::INFO_LOG_LEVEL)
+                return "INFO ";
+
+            if (level >= log4cplus::DEBUG_LOG_LEVEL)
+                return "DEBUG";
+
+            return "TRACE";
+        }
+
+        //! 本地时间 "YYYY-MM-DD HH:MM:SS"，每个线程每秒只格式化一次
+        struct TimeCache {
+            time_t sec = -1;
+            char buf[20];
+        };
+
+        thread_local TimeCache timeCache;
+
+        void appendTimestamp(std::string *s) {
+            const auto now = std::chrono::system_clock::now();
+            const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+            const time_t sec = static_cast<time_t>(ms / 1000);
+
+            if (sec != timeCache.sec) {
+                struct tm tm{};
+#ifdef PLATFORM_WIN32
+                localtime_s(&tm, &sec);
+#else
+                localtime_r(&sec, &tm);
+#endif
+                strftime(timeCache.buf, sizeof(timeCache.buf), "%Y-%m-%d %H:%M:%S", &tm);
+                timeCache.sec = sec;
+            }
+
+            const int frac = static_cast<int>(ms % 1000);
+            s->append(timeCache.buf, 19);
+            s->push_back('.');
+            s->push_back(static_cast<char>('0' + frac / 100));
+            s->push_back(static_cast<char>('0' + frac / 10 % 10));
+            s->push_back(static_cast<char>('0' + frac % 10));
+        }
+
+        void appendU32(uint32_t v, std::string *s) {
+            s->append(reinterpret_cast<const char *>(&v), sizeof(v));
+        }
+
+        void appendU64(uint64_t v, std::string *s) {
+            s->append(reinterpret_cast<const char *>(&v), sizeof(v));
+        }
+
+        //! LOG_ENTRY_RECORD 条目头，长度在 finishRecord 中填写
+        void beginRecord(uint32_t site, std::string *s) {
+            appendU32(0, s);
+            s->push_back(static_cast<char>(LOG_ENTRY_RECORD));
+            appendU32(site, s);
+            appendU64(logTimestamp(), s);
+        }
+
+        void finishRecord(std::string *s) {
+            const auto n = static_cast<uint32_t>(s->size());
+            memcpy(s->data(), &n, sizeof(n));
+        }
+
+        void appendStringArg(std::string_view v, std::string *s) {
+            appendU32(static_cast<uint32_t>(v.size()), s);
+            s->append(v);
+        }
+
+        // 左对齐，宽度至少为 5
+        void appendPid(long pid, std::string *s) {
+            const std::string v(std::to_string(pid));
+            s->append(v);
+
+            if (v.size() < 5)
+                s->append(5 - v.size(), ' ');
+        }
+
+    } /* namespace */
+
+    AsyncLogWriter::AsyncLogWriter(const AsyncLogOptions &options)
+            : options_(options),
+              mask_(roundUpPow2(options.capacity) - 1),
+              slots_(new Slot[mask_ + 1]),
+              fd_(-1),
+              ownFd_(false),
+#ifdef PLATFORM_WIN32
+              pid_(_getpid()),
+#else
+              pid_(getpid()),
+#endif
+              enqueuePos_(0),
+              dequeuePos_(0),
+              dropped_(0),
+              stop_(false),
+              sleeping_(false),
+              sitesWritten_(0) {
+        for (size_t i = 0; i <= mask_; ++i)
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+
+        if (options_.file.empty()) {
+#ifdef PLATFORM_WIN32
+            fd_ = _fileno(stdout);
+#else
+            fd_ = STDOUT_FILENO;
+#endif
+        } else {
+#ifdef PLATFORM_WIN32
+            fd_ = _open(options_.file.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, 0644);
+#else
+            fd_ = open(options_.file.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+
+            if (fd_ < 0)
+                ThrowHappyException("Failed to open log file '" + options_.file + "': " + errorToStr());
+
+            ownFd_ = true;
+        }
+
+        if (binary())
+            writeHeader();
+
+        thread_ = std::thread(&AsyncLogWriter::run, this);
+    }
+
+    AsyncLogWriter::~AsyncLogWriter() {
+        stop_.store(true);
+        wakeup();
+        thread_.join();
+
+        if (ownFd_) {
+#ifdef PLATFORM_WIN32
+            _close(fd_);
+#else
+            close(fd_);
+#endif
+        }
+    }
+
+    AsyncLogWriter::Slot *AsyncLogWriter::tryAcquire(uint64_t *pos) {
+        uint64_t p = enqueuePos_.load(std::memory_order_relaxed);
+
+        for (;;) {
+            Slot *slot = &slots_[p & mask_];
+            const uint64_t seq = slot->seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<int64_t>(seq - p);
+
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(p, p + 1, std::memory_order_relaxed)) {
+                    *pos = p;
+                    return slot;
+                }
+            } else if (diff < 0) {
+                // 后台线程还没有写完这一圈之前的记录
+                return nullptr;
+            } else {
+                p = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    AsyncLogWriter::Slot *AsyncLogWriter::acquire(log4cplus::LogLevel level, uint64_t *pos) {
+        const bool low = level < log4cplus::INFO_LOG_LEVEL;
+
+        if (options_.overflow == LOG_OVERFLOW_DROP_DEBUG_FIRST && low) {
+            // 先读 dequeuePos_：两次读取之间后台线程只会增加它，不会大于之后读到的 enqueuePos_
+            const uint64_t dequeued = dequeuePos_.load(std::memory_order_acquire);
+            const uint64_t used = enqueuePos_.load(std::memory_order_acquire) - dequeued;
+
+            if (used >= (mask_ + 1) / 4 * 3) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        }
+
+        Slot *slot = tryAcquire(pos);
+
+        for (int spins = 0; slot == nullptr; ++spins) {
+            // 后台线程自己写入(比如汇报被抑制的记录数)时不能等待自己
+            if (options_.overflow == LOG_OVERFLOW_DROP_NEWEST || std::this_thread::get_id() == thread_.get_id()) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            wakeup();
+
+            if (spins < kYieldSpins)
+                std::this_thread::yield();
+            else
+                std::this_thread::sleep_for(kBlockSleep);
+
+            slot = tryAcquire(pos);
+        }
+
+        return slot;
+    }
+
+    void AsyncLogWriter::commit(Slot *slot, uint64_t pos) {
+        slot->seq.store(pos + 1, std::memory_order_release);
+
+        // 后台线程每 idleWaitMs 醒来一次，队列超过一半时才提前唤醒。
+        // 每条记录都唤醒的话，后台线程每次只能取到一条记录，还会抢占写日志的线程。
+        // 只有一个生产者负责唤醒，后台线程被调度之前，其它生产者不再加锁。
+        // 后台线程可能已经取走了这条记录，dequeuePos_ 大于 pos 时不唤醒
+        const uint64_t dequeued = dequeuePos_.load(std::memory_order_relaxed);
+
+        if (pos >= dequeued && pos - dequeued >= (mask_ + 1) / 2
+            && sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false))
+            wakeup();
+    }
+
+    bool AsyncLogWriter::push(log4cplus::LogLevel level, std::string_view logger,
+                              std::string_view prefix, std::string_view msg) {
+        uint64_t pos = 0;
+        Slot *slot = acquire(level, &pos);
+
+        if (slot == nullptr)
+            return false;
+
+        // 复用槽位中字符串的容量
+        std::string &s = slot->data;
+        s.clear();
+
+        if (binary()) {
+            beginRecord(textLogSite(level), &s);
+            appendStringArg(logger, &s);
+            appendStringArg(prefix, &s);
+            appendStringArg(msg, &s);
+            finishRecord(&s);
+        } else {
+            appendTimestamp(&s);
+            s.push_back(' ');
+            appendPid(pid_, &s);
+            s.push_back(' ');
+            s.append(levelName(level));
+            s.push_back(' ');
+            s.append(logger);
+            s.append(" --- ");
+            s.append(prefix);
+            s.append(msg);
+            s.append(EOL);
+        }
+
+        commit(slot, pos);
+        return true;
+    }
+
+    bool AsyncLogWriter::pushBinary(log4cplus::LogLevel level, uint32_t site, std::string_view args) {
+        if (!binary())
+            return false;
+
+        uint64_t pos = 0;
+        Slot *slot = acquire(level, &pos);
+
+        if (slot == nullptr)
+            return false;
+
+        std::string &s = slot->data;
+        s.clear();
+        beginRecord(site, &s);
+        s.append(args);
+        finishRecord(&s);
+
+        commit(slot, pos);
+        return true;
+    }
+
+    void AsyncLogWriter::flush() {
+        const uint64_t target = enqueuePos_.load(std::memory_order_acquire);
+
+        while (dequeuePos_.load(std::memory_order_acquire) < target) {
+            wakeup();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    uint64_t AsyncLogWriter::dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t AsyncLogWriter::written() const {
+        return dequeuePos_.load(std::memory_order_acquire);
+    }
+
+    void AsyncLogWriter::wakeup() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cond_.notify_one();
+    }
+
+    void AsyncLogWriter::run() {
+        for (;;) {
+            if (drain() > 0)
+                continue;
+
+            // 先退出标志，后检查队列：stop_ 之前提交的记录一定会被写入
+            if (stop_.load()) {
+                if (dequeuePos_.load() == enqueuePos_.load())
+                    break;
+
+                // 有槽位已经被占用但还没有填充完，稍后再取
+                std::this_thread::yield();
+                continue;
+            }
+
+            // 空闲时顺便汇报被抑制的记录数，不再输出日志的调用点也能按时汇报。
+            // 汇报直接写入自己的队列：HappyLog 可能正在另一个线程中替换或者销毁这个对象
+            if (options_.reportSuppressed) {
+                bool reported = false;
+
+                flushLogSummaries(false, [this, &reported](const char *logger, const std::string &msg) {
+                    reported |= push(log4cplus::WARN_LOG_LEVEL, logger, std::string_view(), msg);
+                });
+
+                if (reported)
+                    continue;
+            }
+
+            // 错过唤醒的代价只是多等待 idleWaitMs
+            std::unique_lock<std::mutex> lock(mutex_);
+            sleeping_.store(true);
+
+            if (!stop_.load())
+                cond_.wait_for(lock, std::chrono::milliseconds(options_.idleWaitMs));
+
+            sleeping_.store(false);
+        }
+    }
+
+    size_t AsyncLogWriter::drain() {
+        const uint64_t begin = dequeuePos_.load(std::memory_order_relaxed);
+        const size_t maxBatch = std::clamp<size_t>(options_.maxBatch, 1, kMaxBatch);
+        size_t count = 0;
+
+        while (count < maxBatch) {
+            const uint64_t pos = begin + count;
+
+            if (slots_[pos & mask_].seq.load(std::memory_order_acquire) != pos + 1)
+                break;
+
+            ++count;
+        }
+
+        if (count == 0)
+            return 0;
+
+        writeBatch(begin, count);
+
+        // 写完之后才释放槽位，writeBatch 直接引用槽位中的字符串
+        for (size_t i = 0; i < count; ++i) {
+            const uint64_t pos = begin + i;
+            slots_[pos & mask_].seq.store(pos + mask_ + 1, std::memory_order_release);
+        }
+
+        dequeuePos_.store(begin + count, std::memory_order_release);
+        return count;
+    }
+
+    void AsyncLogWriter::writeHeader() {
+        const auto mono = logTimestamp();
+        const auto real = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+        std::string s(kBinaryLogMagic, sizeof(kBinaryLogMagic));
+        appendU64(real, &s);
+        appendU64(mono, &s);
+
+#ifdef PLATFORM_WIN32
+        const bool ok = _write(fd_, s.data(), static_cast<unsigned int>(s.size())) == static_cast<int>(s.size());
+#else
+        const bool ok = write(fd_, s.data(), s.size()) == static_cast<ssize_t>(s.size());
+#endif
+
+        if (!ok)
+            ThrowHappyException("Failed to write log header: " + errorToStr());
+    }
+
+    void AsyncLogWriter::writeBatch(uint64_t begin, size_t count) {
+        // 先写入上一批部分写入的条目剩余的字节，二进制格式下再写入这一批记录用到的新调用点的定义
+        siteBuf_.swap(pending_);
+        pending_.clear();
+
+        if (binary()) {
+            uint32_t maxSite = 0;
+
+            for (size_t i = 0; i < count; ++i) {
+                const std::string &s = slots_[(begin + i) & mask_].data;
+                uint32_t site = 0;
+                memcpy(&site, s.data() + 5, sizeof(site));
+                maxSite = std::max(maxSite, site);
+            }
+
+            for (; sitesWritten_ <= maxSite; ++sitesWritten_)
+                encodeLogSite(logSite(sitesWritten_), &siteBuf_);
+        }
+
+#ifdef PLATFORM_WIN32
+        if (!siteBuf_.empty()) {
+            const int n = _write(fd_, siteBuf_.data(), static_cast<unsigned int>(siteBuf_.size()));
+
+            // 没有写完的部分下一批重新写入，这一批的记录可能引用其中的调用点，全部丢弃
+            if (n != static_cast<int>(siteBuf_.size())) {
+                pending_.assign(siteBuf_, n > 0 ? static_cast<size_t>(n) : 0, std::string::npos);
+                dropped_.fetch_add(count, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            const std::string &s = slots_[(begin + i) & mask_].data;
+            const int n = _write(fd_, s.data(), static_cast<unsigned int>(s.size()));
+
+            if (n == static_cast<int>(s.size()))
+                continue;
+
+            if (n > 0) {
+                pending_.assign(s, static_cast<size_t>(n), std::string::npos);
+                dropped_.fetch_add(count - i - 1, std::memory_order_relaxed);
+            } else {
+                dropped_.fetch_add(count - i, std::memory_order_relaxed);
+            }
+
+            return;
+        }
+#else
+        struct iovec iov[kMaxBatch + 1];
+        struct iovec *v = iov;
+
+        if (!siteBuf_.empty()) {
+            iov[0].iov_base = siteBuf_.data();
+            iov[0].iov_len = siteBuf_.size();
+            ++v;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            const std::string &s = slots_[(begin + i) & mask_].data;
+            v[i].iov_base = const_cast<char *>(s.data());
+            v[i].iov_len = s.size();
+        }
+
+        const bool hasSites = v != iov;
+        count += static_cast<size_t>(v - iov);
+        v = iov;
+
+        // v 指向的条目是否已经写入了一部分
+        bool partial = false;
+
+        // 处理部分写入。写入失败时丢弃这一批剩余的记录，不能让日志阻塞程序
+        while (count > 0) {
+            const ssize_t n = writev(fd_, v, static_cast<int>(count));
+
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+
+                // 调用点的定义没有写完，或者一个条目只写入了一部分时，剩余的字节留到下一批最先写入。
+                // 不能从头重写，否则文件中已经写入的字节之后出现重复的内容，二进制格式无法解码
+                const bool keep = partial || (hasSites && v == iov);
+
+                if (keep)
+                    pending_.assign(static_cast<const char *>(v->iov_base), v->iov_len);
+
+                dropped_.fetch_add(count - (keep ? 1 : 0), std::memory_order_relaxed);
+                return;
+            }
+
+            for (auto left = static_cast<size_t>(n); left > 0 && count > 0;) {
+                if (left < v->iov_len) {
+                    v->iov_base = static_cast<char *>(v->iov_base) + left;
+                    v->iov_len -= left;
+                    partial = true;
+                    break;
+                }
+
+                left -= v->iov_len;
+                ++v;
+                --count;
+                partial = false;
+            }
+
+            // 跳过空记录
+            while (count > 0 && v->iov_len == 0) {
+                ++v;
+                --count;
+            }
+        }
+#endif
+    }
+
+} /* namespace happycpp */
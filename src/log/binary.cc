@@ -0,0 +1,441 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/log/binary.h"
+#include "happycpp/exception.h"
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#ifndef PLATFORM_WIN32
+#include <time.h>
+#endif
+
+namespace happycpp::log {
+
+    namespace {
+
+        //! 单个条目的最大长度，超过时认为文件已经损坏
+        const uint32_t kMaxEntrySize = 16 * 1024 * 1024;
+
+        //! 调用点注册表，只增加不删除
+        std::mutex siteMutex;
+        std::deque<LogSite> sites;
+
+        void appendU16(uint16_t v, std::string *s) {
+            s->append(reinterpret_cast<const char *>(&v), sizeof(v));
+        }
+
+        void appendU32(uint32_t v, std::string *s) {
+            s->append(reinterpret_cast<const char *>(&v), sizeof(v));
+        }
+
+        // 与 AsyncLogWriter 文本格式的级别名称相同
+        const char *levelName(log4cplus::LogLevel level) {
+            if (level >= log4cplus::FATAL_LOG_LEVEL)
+                return "FATAL";
+
+            if (level >= log4cplus::ERROR_LOG_LEVEL)
+                return "ERROR";
+
+            if (level >= log4cplus::WARN_LOG_LEVEL)
+                return "WARN ";
+
+            if (level >= log4cplus::INFO_LOG_LEVEL)
+                return "INFO ";
+
+            if (level >= log4cplus::DEBUG_LOG_LEVEL)
+                return "DEBUG";
+
+            return "TRACE";
+        }
+
+        //! 顺序读取条目中的字段，越界时抛出 HappyException
+        class Reader {
+        public:
+            Reader(const char *data, size_t size) : p_(data), end_(data + size) {
+            }
+
+            template<typename T>
+            T read() {
+                T v;
+                need(sizeof(v));
+                memcpy(&v, p_, sizeof(v));
+                p_ += sizeof(v);
+                return v;
+            }
+
+            std::string readString(size_t n) {
+                need(n);
+                std::string s(p_, n);
+                p_ += n;
+                return s;
+            }
+
+        private:
+            const char *p_;
+            const char *end_;
+
+            void need(size_t n) const {
+                if (static_cast<size_t>(end_ - p_) < n)
+                    ThrowHappyException("Truncated binary log entry.");
+            }
+        };
+
+        //! 按照 snprintf 格式化一个值，追加到 out
+        template<typename T>
+        void appendFormat(std::string *out, const std::string &spec, const std::vector<int> &stars, T v) {
+            char buf[256];
+            int n;
+
+            if (stars.empty())
+                n = snprintf(buf, sizeof(buf), spec.c_str(), v);
+            else if (stars.size() == 1)
+                n = snprintf(buf, sizeof(buf), spec.c_str(), stars[0], v);
+            else
+                n = snprintf(buf, sizeof(buf), spec.c_str(), stars[0], stars[1], v);
+
+            if (n < 0)
+                return;
+
+            if (static_cast<size_t>(n) < sizeof(buf)) {
+                out->append(buf, static_cast<size_t>(n));
+                return;
+            }
+
+            std::string s(static_cast<size_t>(n), '\0');
+
+            if (stars.empty())
+                snprintf(&s[0], s.size() + 1, spec.c_str(), v);
+            else if (stars.size() == 1)
+                snprintf(&s[0], s.size() + 1, spec.c_str(), stars[0], v);
+            else
+                snprintf(&s[0], s.size() + 1, spec.c_str(), stars[0], stars[1], v);
+
+            out->append(s);
+        }
+
+        //! 转换字符与记录的参数类型是否匹配
+        bool convMatches(LogArgType type, char conv) {
+            switch (type) {
+                case LOG_ARG_INT:
+                case LOG_ARG_UINT:
+                    return conv != '\0' && strchr("diouxXc", conv) != nullptr;
+                case LOG_ARG_DOUBLE:
+                    return conv != '\0' && strchr("eEfFgGaA", conv) != nullptr;
+                case LOG_ARG_STRING:
+                    return conv == 's';
+                case LOG_ARG_POINTER:
+                    return conv == 'p';
+                default:
+                    return false;
+            }
+        }
+
+        //! 按照调用点的格式和参数类型还原消息
+        /*!
+         参数在编码时已经统一为 64 位，所以整数转换的长度修饰符(h、l、z 等)
+         都替换为 ll，浮点数去掉 L。
+         */
+        std::string formatRecord(const LogSite &site, Reader *reader) {
+            const std::string &fmt = site.format;
+            std::string out;
+            size_t arg = 0;
+
+            for (size_t i = 0; i < fmt.size(); ++i) {
+                if (fmt[i] != '%') {
+                    out.push_back(fmt[i]);
+                    continue;
+                }
+
+                if (i + 1 < fmt.size() && fmt[i + 1] == '%') {
+                    out.push_back('%');
+                    ++i;
+                    continue;
+                }
+
+                std::string spec("%");
+                std::vector<int> stars;
+                size_t j = i + 1;
+
+                // 标志、宽度和精度，* 各自消耗一个 int 参数
+                for (; j < fmt.size() && strchr("-+ #0123456789.*", fmt[j]) != nullptr; ++j) {
+                    if (fmt[j] == '*') {
+                        if (arg >= site.argTypes.size() || stars.size() == 2)
+                            ThrowHappyException("Invalid binary log format: " + fmt);
+
+                        const auto starType = static_cast<LogArgType>(site.argTypes[arg++]);
+
+                        if (starType == LOG_ARG_INT)
+                            stars.push_back(static_cast<int>(reader->read<int64_t>()));
+                        else if (starType == LOG_ARG_UINT)
+                            stars.push_back(static_cast<int>(reader->read<uint64_t>()));
+                        else
+                            ThrowHappyException("Invalid binary log format: " + fmt);
+                    }
+
+                    spec.push_back(fmt[j]);
+                }
+
+                // 长度修饰符
+                while (j < fmt.size() && strchr("hljztLq", fmt[j]) != nullptr)
+                    ++j;
+
+                if (j >= fmt.size() || arg >= site.argTypes.size())
+                    ThrowHappyException("Invalid binary log format: " + fmt);
+
+                const char conv = fmt[j];
+                const auto type = static_cast<LogArgType>(site.argTypes[arg++]);
+                i = j;
+
+                // 格式和类型都来自日志文件，不匹配时交给 printf 可能写内存(%n)或者崩溃
+                if (!convMatches(type, conv))
+                    ThrowHappyException("Invalid binary log format: " + fmt);
+
+                switch (type) {
+                    case LOG_ARG_INT: {
+                        const auto v = reader->read<int64_t>();
+
+                        if (conv == 'c')
+                            appendFormat(&out, spec + "c", stars, static_cast<int>(v));
+                        else
+                            appendFormat(&out, spec + "ll" + conv, stars, static_cast<long long>(v));
+
+                        break;
+                    }
+                    case LOG_ARG_UINT: {
+                        const auto v = reader->read<uint64_t>();
+
+                        if (conv == 'c')
+                            appendFormat(&out, spec + "c", stars, static_cast<int>(v));
+                        else
+                            appendFormat(&out, spec + "ll" + conv, stars, static_cast<unsigned long long>(v));
+
+                        break;
+                    }
+                    case LOG_ARG_DOUBLE:
+                        appendFormat(&out, spec + conv, stars, reader->read<double>());
+                        break;
+                    case LOG_ARG_STRING: {
+                        const std::string v(reader->readString(reader->read<uint32_t>()));
+                        appendFormat(&out, spec + "s", stars, v.c_str());
+                        break;
+                    }
+                    case LOG_ARG_POINTER: {
+                        const auto v = static_cast<uintptr_t>(reader->read<uint64_t>());
+                        appendFormat(&out, spec + "p", stars, reinterpret_cast<const void *>(v));
+                        break;
+                    }
+                    default:
+                        ThrowHappyException("Invalid binary log argument type.");
+                }
+            }
+
+            return out;
+        }
+
+        //! 本地时间，纳秒精度
+        std::string formatTime(uint64_t ns) {
+            const auto sec = static_cast<time_t>(ns / 1000000000);
+            struct tm tm{};
+#ifdef PLATFORM_WIN32
+            localtime_s(&tm, &sec);
+#else
+            localtime_r(&sec, &tm);
+#endif
+            char buf[64];
+            const size_t n = strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+            snprintf(buf + n, sizeof(buf) - n, ".%09u", static_cast<unsigned>(ns % 1000000000));
+            return buf;
+        }
+
+    } /* namespace */
+
+    uint32_t addLogSite(LogSite site) {
+        std::lock_guard<std::mutex> lock(siteMutex);
+        site.id = static_cast<uint32_t>(sites.size());
+        sites.push_back(std::move(site));
+        return sites.back().id;
+    }
+
+    size_t logSiteCount() {
+        std::lock_guard<std::mutex> lock(siteMutex);
+        return sites.size();
+    }
+
+    LogSite logSite(uint32_t id) {
+        std::lock_guard<std::mutex> lock(siteMutex);
+
+        if (id >= sites.size())
+            ThrowHappyException("Unknown log site: " + std::to_string(id));
+
+        return sites[id];
+    }
+
+    uint32_t textLogSite(log4cplus::LogLevel level) {
+        static const log4cplus::LogLevel levels[] = {
+                log4cplus::TRACE_LOG_LEVEL, log4cplus::DEBUG_LOG_LEVEL, log4cplus::INFO_LOG_LEVEL,
+                log4cplus::WARN_LOG_LEVEL, log4cplus::ERROR_LOG_LEVEL, log4cplus::FATAL_LOG_LEVEL};
+        static const auto ids = []() {
+            std::vector<uint32_t> v;
+            const char types[] = {LOG_ARG_STRING, LOG_ARG_STRING, LOG_ARG_STRING};
+
+            for (const auto l : levels)
+                v.push_back(addLogSite(LogSite{0, l, "", 0, "%s --- %s%s", std::string(types, sizeof(types))}));
+
+            return v;
+        }();
+
+        size_t i = 0;
+
+        while (i + 1 < ids.size() && level >= levels[i + 1])
+            ++i;
+
+        return ids[i];
+    }
+
+    uint64_t logTimestamp() {
+#ifdef PLATFORM_WIN32
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+#else
+        struct timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+    }
+
+    void encodeLogSite(const LogSite &site, std::string *out) {
+        const size_t begin = out->size();
+
+        appendU32(0, out);
+        out->push_back(static_cast<char>(LOG_ENTRY_SITE));
+        appendU32(site.id, out);
+        appendU32(static_cast<uint32_t>(site.level), out);
+        appendU32(site.line, out);
+        appendU16(static_cast<uint16_t>(site.file.size()), out);
+        out->append(site.file, 0, static_cast<uint16_t>(site.file.size()));
+        appendU16(static_cast<uint16_t>(site.format.size()), out);
+        out->append(site.format, 0, static_cast<uint16_t>(site.format.size()));
+        out->push_back(static_cast<char>(site.argTypes.size()));
+        out->append(site.argTypes);
+
+        const auto n = static_cast<uint32_t>(out->size() - begin);
+        memcpy(&(*out)[begin], &n, sizeof(n));
+    }
+
+    uint64_t decodeBinaryLog(std::istream &in, std::ostream &out) {
+        //! 解码时的调用点表，格式字符串可以为空，是否已经定义单独记录
+        struct SiteEntry {
+            LogSite site;
+            bool defined = false;
+        };
+
+        std::vector<SiteEntry> table;
+        std::string entry;
+        uint64_t realBase = 0;
+        uint64_t monoBase = 0;
+        uint64_t records = 0;
+        bool header = false;
+        char head[kBinaryLogHeaderSize];
+
+        for (;;) {
+            if (!in.read(head, 4)) {
+                if (in.gcount() != 0)
+                    ThrowHappyException("Truncated binary log entry.");
+
+                break;
+            }
+
+            // 追加写入时，每个进程都会写一个文件头，之后的调用点 id 重新编号
+            if (memcmp(head, kBinaryLogMagic, 4) == 0) {
+                if (!in.read(head + 4, kBinaryLogHeaderSize - 4)
+                    || memcmp(head, kBinaryLogMagic, sizeof(kBinaryLogMagic)) != 0)
+                    ThrowHappyException("Invalid binary log header.");
+
+                memcpy(&realBase, head + 8, sizeof(realBase));
+                memcpy(&monoBase, head + 16, sizeof(monoBase));
+                table.clear();
+                header = true;
+                continue;
+            }
+
+            if (!header)
+                ThrowHappyException("Not a binary log file.");
+
+            uint32_t size = 0;
+            memcpy(&size, head, sizeof(size));
+
+            if (size < 5 || size > kMaxEntrySize)
+                ThrowHappyException("Invalid binary log entry size: " + std::to_string(size));
+
+            entry.resize(size - 4);
+
+            if (!in.read(&entry[0], static_cast<std::streamsize>(entry.size())))
+                ThrowHappyException("Truncated binary log entry.");
+
+            Reader reader(entry.data(), entry.size());
+            const auto type = reader.read<uint8_t>();
+
+            if (type == LOG_ENTRY_SITE) {
+                LogSite site;
+                site.id = reader.read<uint32_t>();
+                site.level = static_cast<log4cplus::LogLevel>(reader.read<int32_t>());
+                site.line = reader.read<uint32_t>();
+                site.file = reader.readString(reader.read<uint16_t>());
+                site.format = reader.readString(reader.read<uint16_t>());
+                site.argTypes = reader.readString(reader.read<uint8_t>());
+
+                const uint32_t id = site.id;
+
+                if (id >= table.size())
+                    table.resize(id + 1);
+
+                table[id].site = std::move(site);
+                table[id].defined = true;
+            } else if (type == LOG_ENTRY_RECORD) {
+                const auto id = reader.read<uint32_t>();
+                const auto ts = reader.read<uint64_t>();
+
+                if (id >= table.size() || !table[id].defined)
+                    ThrowHappyException("Undefined log site: " + std::to_string(id));
+
+                const LogSite &site = table[id].site;
+                out << formatTime(realBase + (ts - monoBase)) << ' ' << levelName(site.level) << ' ';
+
+                if (!site.file.empty())
+                    out << site.file << ':' << site.line << " --- ";
+
+                out << formatRecord(site, &reader) << '\n';
+                ++records;
+            } else {
+                ThrowHappyException("Unknown binary log entry type: " + std::to_string(type));
+            }
+        }
+
+        return records;
+    }
+
+} /* namespace happycpp */
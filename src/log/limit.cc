@@ -0,0 +1,311 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "happycpp/log/limit.h"
+#include "happycpp/log.h"
+#include "log4cplus/helpers/property.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace happycpp::log {
+
+    std::atomic<bool> LogLimiter::_enabled(false);
+    std::atomic<uint32_t> LogLimiter::_generation(1);
+
+    namespace {
+
+        const int64_t kNsPerSec = 1000000000;
+
+        const char kLimitPrefix[] = "happycpp.limit.";
+
+        //! 保护 limits 和调用点链表，持有时不能写日志
+        std::mutex limitMutex;
+        std::unordered_map<std::string, LogLimitConfig> limits;
+        LogLimiter *limiters = nullptr;
+        std::atomic<int64_t> summaryIntervalNs(10 * kNsPerSec);
+
+        int64_t nowNs() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        //! 查找 logger 或者最近的上级 logger 的参数，调用者持有 limitMutex
+        LogLimitConfig lookup(std::string logger) {
+            for (;;) {
+                const auto it = limits.find(logger);
+
+                if (it != limits.end())
+                    return it->second;
+
+                if (logger.empty())
+                    return LogLimitConfig();
+
+                const size_t pos = logger.rfind('.');
+                logger = pos == std::string::npos ? std::string() : logger.substr(0, pos);
+            }
+        }
+
+        bool parseNumber(const std::string &s, double *v) {
+            char *end = nullptr;
+            *v = strtod(s.c_str(), &end);
+            return !s.empty() && *end == '\0' && std::isfinite(*v) && *v >= 0;
+        }
+
+        const char *const kLevelNames[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR"};
+
+        const size_t kLevelCount = sizeof(kLevelNames) / sizeof(kLevelNames[0]);
+
+        //! 级别在 kLevelNames 中的下标
+        size_t levelIndex(log4cplus::LogLevel level) {
+            if (level >= log4cplus::ERROR_LOG_LEVEL)
+                return 4;
+
+            if (level >= log4cplus::WARN_LOG_LEVEL)
+                return 3;
+
+            if (level >= log4cplus::INFO_LOG_LEVEL)
+                return 2;
+
+            if (level >= log4cplus::DEBUG_LOG_LEVEL)
+                return 1;
+
+            return 0;
+        }
+
+    } /* namespace */
+
+    void setLogLimit(const std::string &logger, const LogLimitConfig &config) {
+        std::lock_guard<std::mutex> lock(limitMutex);
+        limits[logger] = config;
+        LogLimiter::changed(!limits.empty());
+    }
+
+    void clearLogLimits() {
+        std::lock_guard<std::mutex> lock(limitMutex);
+        limits.clear();
+        LogLimiter::changed(!limits.empty());
+    }
+
+    void setLogSummaryInterval(uint32_t seconds) {
+        summaryIntervalNs.store(static_cast<int64_t>(seconds) * kNsPerSec, std::memory_order_relaxed);
+    }
+
+    void loadLogLimits(const log4cplus::helpers::Properties &props) {
+        const log4cplus::helpers::Properties subset = props.getPropertySubset(kLimitPrefix);
+        std::unordered_map<std::string, LogLimitConfig> loaded;
+
+        // 键为 "字段" 或者 "字段.logger"，无效的值被忽略
+        for (const auto &name : subset.propertyNames()) {
+            const size_t dot = name.find('.');
+            const std::string field(name.substr(0, dot));
+            const std::string logger(dot == std::string::npos ? std::string() : name.substr(dot + 1));
+            double v = 0;
+
+            if (!parseNumber(subset.getProperty(name), &v))
+                continue;
+
+            if (field == "summaryInterval" && logger.empty()) {
+                setLogSummaryInterval(static_cast<uint32_t>(v));
+                continue;
+            }
+
+            if (field == "rate")
+                loaded[logger].rate = v;
+            else if (field == "burst")
+                loaded[logger].burst = v;
+            else if (field == "sample")
+                loaded[logger].sample = std::max<uint32_t>(1, static_cast<uint32_t>(v));
+        }
+
+        std::lock_guard<std::mutex> lock(limitMutex);
+
+        for (const auto &item : loaded)
+            limits[item.first] = item.second;
+
+        LogLimiter::changed(!limits.empty());
+    }
+
+    void flushLogSummaries(bool force, const LogSummarySink &sink) {
+        if (!force && !LogLimiter::enabled())
+            return;
+
+        LogLimiter *head = nullptr;
+
+        // 链表只在头部插入，取得头部之后不需要持有锁，汇报时也不能持有锁
+        {
+            std::lock_guard<std::mutex> lock(limitMutex);
+            head = limiters;
+        }
+
+        const int64_t now = nowNs();
+
+        for (LogLimiter *l = head; l != nullptr; l = l->next_)
+            l->summarize(now, force, sink);
+    }
+
+    void LogLimiter::changed(bool enabled) {
+        _generation.fetch_add(1, std::memory_order_release);
+        _enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void LogLimiter::reload(int64_t now) {
+        const uint32_t generation = _generation.load(std::memory_order_acquire);
+
+        if (generation_.load(std::memory_order_relaxed) == generation)
+            return;
+
+        const LogLimitConfig config = lookup(logger_);
+        int64_t interval = 0;
+        int64_t tolerance = 0;
+
+        if (config.rate > 0) {
+            const double burst = std::max(1.0, config.burst > 0 ? config.burst : config.rate);
+            interval = std::max<int64_t>(1, static_cast<int64_t>(static_cast<double>(kNsPerSec) / config.rate));
+            tolerance = static_cast<int64_t>((burst - 1) * static_cast<double>(interval));
+        }
+
+        intervalNs_.store(interval, std::memory_order_relaxed);
+        toleranceNs_.store(tolerance, std::memory_order_relaxed);
+        sample_.store(std::max<uint32_t>(1, config.sample), std::memory_order_relaxed);
+
+        // 第一次使用时加入链表
+        if (generation_.load(std::memory_order_relaxed) == 0) {
+            next_ = limiters;
+            limiters = this;
+            lastSummary_.store(now, std::memory_order_relaxed);
+        }
+
+        generation_.store(generation, std::memory_order_release);
+    }
+
+    bool LogLimiter::check(log4cplus::LogLevel level) {
+        const int64_t now = nowNs();
+
+        if (generation_.load(std::memory_order_acquire) != _generation.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(limitMutex);
+            reload(now);
+        }
+
+        bool ok = true;
+        const uint32_t sample = sample_.load(std::memory_order_relaxed);
+
+        // WARN 及以上的记录不采样，只限流
+        if (sample > 1 && level < log4cplus::WARN_LOG_LEVEL)
+            ok = count_.fetch_add(1, std::memory_order_relaxed) % sample == 0;
+
+        const int64_t interval = intervalNs_.load(std::memory_order_relaxed);
+
+        if (ok && interval > 0) {
+            const int64_t tolerance = toleranceNs_.load(std::memory_order_relaxed);
+            int64_t tat = tat_.load(std::memory_order_relaxed);
+
+            for (;;) {
+                const int64_t base = std::max(tat, now);
+
+                if (base - now > tolerance) {
+                    ok = false;
+                    break;
+                }
+
+                if (tat_.compare_exchange_weak(tat, base + interval, std::memory_order_relaxed))
+                    break;
+            }
+        }
+
+        if (!ok)
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+
+        if (suppressed_.load(std::memory_order_relaxed) > 0)
+            summarize(now, false, nullptr);
+
+        return ok;
+    }
+
+    void LogLimiter::summarize(int64_t now, bool force, const LogSummarySink &sink) {
+        int64_t last = lastSummary_.load(std::memory_order_relaxed);
+
+        // 只有一个线程负责汇报
+        if (!force && now - last < summaryIntervalNs.load(std::memory_order_relaxed))
+            return;
+
+        if (!lastSummary_.compare_exchange_strong(last, now, std::memory_order_relaxed))
+            return;
+
+        const uint64_t n = suppressed_.exchange(0, std::memory_order_relaxed);
+
+        if (n == 0)
+            return;
+
+        const double seconds = static_cast<double>(now - last) / static_cast<double>(kNsPerSec);
+        std::string s;
+
+        if (line_ == 0)
+            s = formatLog("Suppressed %llu %s records of logger '%s' in the last %.1f seconds",
+                          static_cast<unsigned long long>(n), file_, logger_, seconds);
+        else
+            s = formatLog("Suppressed %llu log records at %s:%u in the last %.1f seconds",
+                          static_cast<unsigned long long>(n), file_, line_, seconds);
+
+        if (sink)
+            sink(logger_, s);
+        else
+            HappyLog::instance().write(log4cplus::WARN_LOG_LEVEL, s, logger_);
+    }
+
+    LogLimiter &loggerLimiter(const std::string &logger, log4cplus::LogLevel level) {
+        struct Entry {
+            const std::string logger;
+            LogLimiter limiter;
+
+            Entry(const std::string &name, log4cplus::LogLevel level)
+                    : logger(name), limiter(kLevelNames[levelIndex(level)], 0, logger.c_str()) {
+            }
+        };
+
+        // 级别按照 kLevelNames 归类，同一个类别共用一个 LogLimiter。
+        // 以 logger 名称为键、类别为下标，查找缓存时不需要构造新的字符串
+        typedef std::array<LogLimiter *, kLevelCount> Slots;
+        const size_t index = levelIndex(level);
+
+        thread_local std::unordered_map<std::string, Slots> cache;
+        const auto it = cache.find(logger);
+
+        if (it != cache.end() && it->second[index] != nullptr)
+            return *it->second[index];
+
+        static std::mutex mutex;
+        static std::unordered_map<std::string, std::array<std::unique_ptr<Entry>, kLevelCount> > entries;
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unique_ptr<Entry> &entry = entries[logger][index];
+
+        if (!entry)
+            entry.reset(new Entry(logger, level));
+
+        cache[logger][index] = &entry->limiter;
+        return entry->limiter;
+    }
+
+} /* namespace happycpp */
@@ -21,6 +21,7 @@
 #include "happycpp/proc.h"
 #include "happycpp/filesys.h"
 #include "happycpp/exception.h"
+#include "happycpp/log.h"
 
 #ifdef PLATFORM_WIN32
 #include <comdef.h>
@@ -118,6 +119,7 @@ namespace happycpp::hcproc {
         try {
             hcfilesys::writeFile(pid_file, to_string(pid));
         } catch (HappyException &e) {
+            log::HappyLog::instance().error(e);
             return false;
         }
 
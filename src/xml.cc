@@ -128,7 +128,7 @@ namespace happycpp::hcxml {
         std::string v(node.text().as_string());
 
         if (mode == VM_STRICT && v.empty())
-            ThrowHappyException("Can not get the value of xml node.");
+            ThrowHappyError(ENOENT, "Can not get the value of xml node.");
 
         return v;
     }
@@ -20,17 +20,69 @@
 
 #include <gtest/gtest.h>
 #include "happycpp/exception.h"
+#include <cerrno>
+#include <cstring>
+#include <string>
 
 TEST(HAPPYCPP_UNITTEST, HappyException) { // NOLINT
     EXPECT_THROW(ThrowHappyException("test message."), happycpp::HappyException);
 
     try {
         ThrowHappyException("test message.");
+        FAIL() << "no exception thrown";
     } catch (happycpp::HappyException &e) {
         EXPECT_STREQ("test message.", e.what());
     }
 }
 
+TEST(HAPPYCPP_UNITTEST, HappyError) { // NOLINT
+    try {
+        ThrowHappyError(EINVAL, "static message.");
+        FAIL() << "no exception thrown";
+    } catch (const happycpp::HappyException &e) {
+        EXPECT_STREQ("static message.", e.what());
+        EXPECT_EQ(EINVAL, e.code());
+    }
+
+    try {
+        ThrowHappyException(std::string("dynamic ") + "message.");
+        FAIL() << "no exception thrown";
+    } catch (const happycpp::HappyException &e) {
+        EXPECT_STREQ("dynamic message.", e.what());
+        EXPECT_EQ(0, e.code());
+    }
+}
+
+TEST(HAPPYCPP_UNITTEST, HappySysError) { // NOLINT
+    const std::string expected = std::string("Cannot open: ") + strerror(ENOENT) + "(errno: "
+                                 + std::to_string(ENOENT) + ")";
+
+    try {
+        errno = ENOENT;
+        ThrowHappySysError("Cannot open");
+        FAIL() << "no exception thrown";
+    } catch (const happycpp::HappyException &e) {
+        errno = 0;
+        EXPECT_EQ(ENOENT, e.code());
+
+        // 复制之前和之后都可以格式化
+        const happycpp::HappyException copy(e);
+        EXPECT_EQ(expected, e.what());
+        EXPECT_EQ(expected, e.what());
+        EXPECT_EQ(expected, copy.what());
+
+        // 格式化之后复制，副本共享同一份文本
+        const happycpp::HappyException formatted(e);
+        EXPECT_EQ(e.what(), formatted.what());
+    }
+
+    // 副本比原异常活得更久
+    const happycpp::HappyException *dynamic = new happycpp::HappyException("dynamic message.");
+    const happycpp::HappyException copy(*dynamic);
+    delete dynamic;
+    EXPECT_STREQ("dynamic message.", copy.what());
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
 
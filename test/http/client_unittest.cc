@@ -0,0 +1,197 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/http/client.h"
+#include "happycpp/exception.h"
+#include <atomic>
+#include <future>
+#include <vector>
+
+namespace hhhttp = happycpp::hchttp;
+
+// 需要先运行 test/misc/simple_http_server.py
+const std::string kUrl("http://127.0.0.1:8887/");
+
+TEST(HCHTTP_CLIENT_UNITTEST, HeadFuture) { // NOLINT
+    hhhttp::HttpClient client;
+    const hhhttp::HttpResponseMsgPtr resp(client.head(kUrl).get());
+
+    ASSERT_TRUE(resp);
+    EXPECT_EQ(200u, resp->status());
+    EXPECT_EQ("HTTP/1.0", resp->version());
+    EXPECT_EQ("text/plain", resp->header(hhhttp::HTTP_MCOMF_CONTENT_TYPE));
+    EXPECT_EQ("100", resp->header(hhhttp::HTTP_MCOMF_CONTENT_LENGTH));
+    EXPECT_EQ("\"57999a2b-2\"", resp->header(hhhttp::HTTP_MRESF_ETAG));
+    EXPECT_TRUE(resp->body().empty());
+    EXPECT_EQ(0u, client.pending());
+}
+
+TEST(HCHTTP_CLIENT_UNITTEST, HeadCallback) { // NOLINT
+    hhhttp::HttpClient client;
+    std::promise<uint32_t> done;
+
+    client.head(kUrl, [&done](const hhhttp::HttpResponseMsgPtr &resp,
+                              const std::string &error) {
+        done.set_value(error.empty() ? resp->status() : 0);
+    });
+
+    EXPECT_EQ(200u, done.get_future().get());
+}
+
+TEST(HCHTTP_CLIENT_UNITTEST, Concurrent) { // NOLINT
+    // simple_http_server.py 是单线程的，并且会保持连接，同一时间只能服务一个连接。
+    // 所有请求在一个连接上排队执行
+    hhhttp::HttpClientOptions options;
+    options.maxHostConnections = 1;
+
+    hhhttp::HttpClient client(options);
+    std::vector<std::future<hhhttp::HttpResponseMsgPtr>> futures;
+
+    for (int32_t i = 0; i < 32; ++i)
+        futures.push_back(client.head(kUrl));
+
+    for (auto &f : futures)
+        EXPECT_EQ(200u, f.get()->status());
+
+    EXPECT_EQ(0u, client.pending());
+}
+
+TEST(HCHTTP_CLIENT_UNITTEST, Get) { // NOLINT
+    hhhttp::HttpClient client;
+    // simple_http_server.py 只支持 HEAD
+    const hhhttp::HttpResponseMsgPtr resp(client.get(kUrl).get());
+
+    ASSERT_TRUE(resp);
+    EXPECT_EQ(501u, resp->status());
+    EXPECT_FALSE(resp->body().empty());
+    EXPECT_EQ(std::to_string(resp->body().size()),
+              resp->header(hhhttp::HTTP_MCOMF_CONTENT_LENGTH));
+}
+
+TEST(HCHTTP_CLIENT_UNITTEST, Sink) { // NOLINT
+    auto str = std::make_shared<hhhttp::StringSink>();
+    auto hash = std::make_shared<hhhttp::HashSink>("sha1", str);
+
+    hhhttp::HttpClient client;
+    hhhttp::HttpClientRequest req;
+    req.url = kUrl;
+    req.sink = hash;
+
+    const hhhttp::HttpResponseMsgPtr resp(client.request(req).get());
+
+    ASSERT_TRUE(resp);
+    EXPECT_EQ(501u, resp->status());
+    // 消息体只输出到 sink
+    EXPECT_TRUE(resp->body().empty());
+    EXPECT_EQ(std::to_string(str->data().size()),
+              resp->header(hhhttp::HTTP_MCOMF_CONTENT_LENGTH));
+    EXPECT_EQ(40u, hash->hexDigest().size());
+
+    // sink 中止传输
+    hhhttp::HttpClientRequest abort;
+    abort.url = kUrl;
+    abort.sink = std::make_shared<hhhttp::RingBufferSink>(4, [](std::string_view) -> size_t {
+        return 0;
+    });
+
+    EXPECT_THROW(client.request(abort).get(), happycpp::HappyException);
+}
+
+TEST(HCHTTP_CLIENT_UNITTEST, Error) { // NOLINT
+    hhhttp::HttpClientOptions options;
+    options.maxHostConnections = 1;
+
+    hhhttp::HttpClient client(options);
+
+    // 端口 1 一般没有服务监听
+    EXPECT_THROW(client.head("http://127.0.0.1:1/").get(), happycpp::HappyException);
+
+    hhhttp::HttpClientRequest req;
+    req.method = hhhttp::INVALID_HTTP_METHOD;
+    req.url = kUrl;
+    EXPECT_THROW(client.request(req).get(), happycpp::HappyException);
+
+    // 回调抛出的异常不影响后续请求
+    std::atomic<int32_t> calls(0);
+    client.head(kUrl, [&calls](const hhhttp::HttpResponseMsgPtr &, const std::string &) {
+        ++calls;
+        throw std::runtime_error("callback error");
+    });
+
+    EXPECT_EQ(200u, client.head(kUrl).get()->status());
+    EXPECT_EQ(1, calls);
+}
+
+TEST(HCHTTP_CLIENT_UNITTEST, Destroy) { // NOLINT
+    std::future<hhhttp::HttpResponseMsgPtr> f;
+
+    {
+        hhhttp::HttpClient client;
+        // 10.255.255.1 不可达，请求不会在析构之前结束
+        f = client.head("http://10.255.255.1/");
+    }
+
+    EXPECT_THROW(f.get(), happycpp::HappyException);
+}
+
+TEST(HCHTTP_CLIENT_UNITTEST, ProbeUrls) { // NOLINT
+    std::vector<std::string> urls(20, kUrl);
+    urls[7] = "http://127.0.0.1:1/";
+
+    std::vector<hhhttp::ProbeResult> results;
+    hhhttp::ProbeOptions options;
+    options.concurrency = 4;
+    // simple_http_server.py 同一时间只能服务一个连接
+    options.maxHostConnections = 1;
+    options.callback = [&results](const hhhttp::ProbeResult &r) {
+        results.push_back(r);
+    };
+
+    EXPECT_EQ(19u, hhhttp::probeUrls(urls, options));
+    ASSERT_EQ(20u, results.size());
+
+    std::vector<bool> seen(urls.size(), false);
+
+    for (const auto &r : results) {
+        ASSERT_LT(r.index, urls.size());
+        EXPECT_FALSE(seen[r.index]);
+        seen[r.index] = true;
+
+        if (r.index == 7) {
+            EXPECT_FALSE(r.resp);
+            EXPECT_FALSE(r.error.empty());
+        } else {
+            ASSERT_TRUE(r.resp);
+            EXPECT_TRUE(r.error.empty());
+            EXPECT_EQ(200u, r.resp->status());
+            EXPECT_EQ(0, r.timing.tlsUs);
+            EXPECT_GT(r.timing.totalUs, 0);
+            EXPECT_GE(r.timing.totalUs, r.timing.dnsUs + r.timing.connectUs + r.timing.firstByteUs);
+        }
+    }
+
+    EXPECT_EQ(0u, hhhttp::probeUrls(std::vector<std::string>(), options));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
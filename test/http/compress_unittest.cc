@@ -0,0 +1,322 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/http/compress.h"
+#include <zlib.h>
+#include <string>
+#include <vector>
+
+#ifdef HAPPYCPP_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef HAPPYCPP_HAVE_BROTLI
+#include <brotli/decode.h>
+#endif
+
+namespace hhhttp = happycpp::hchttp;
+
+namespace {
+
+    const std::vector<hhhttp::HttpContentCoding> kCodings = {
+            hhhttp::HTTP_CODING_ZSTD, hhhttp::HTTP_CODING_BR,
+            hhhttp::HTTP_CODING_GZIP, hhhttp::HTTP_CODING_DEFLATE};
+
+    std::string sampleText(size_t size) {
+        std::string s;
+
+        for (size_t i = 0; s.size() < size; ++i)
+            s += "<li class=\"item\">happycpp item " + std::to_string(i % 97) + "</li>\n";
+
+        s.resize(size);
+        return s;
+    }
+
+    std::string decompress(hhhttp::HttpContentCoding coding, const std::string &data) {
+        std::string out;
+
+        if (coding == hhhttp::HTTP_CODING_GZIP || coding == hhhttp::HTTP_CODING_DEFLATE) {
+            z_stream zs{};
+            // 自动识别 gzip 和 zlib 格式
+            EXPECT_EQ(Z_OK, inflateInit2(&zs, MAX_WBITS + 32));
+            zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+            zs.avail_in = static_cast<uInt>(data.size());
+            char buf[4096];
+            int ret;
+
+            do {
+                zs.next_out = reinterpret_cast<Bytef *>(buf);
+                zs.avail_out = sizeof(buf);
+                ret = inflate(&zs, Z_NO_FLUSH);
+                out.append(buf, sizeof(buf) - zs.avail_out);
+            } while (ret == Z_OK);
+
+            EXPECT_EQ(Z_STREAM_END, ret);
+            inflateEnd(&zs);
+        }
+
+#ifdef HAPPYCPP_HAVE_ZSTD
+        if (coding == hhhttp::HTTP_CODING_ZSTD) {
+            out.resize(16 * 1024 * 1024);
+            const size_t n = ZSTD_decompress(&out[0], out.size(), data.data(), data.size());
+            EXPECT_FALSE(ZSTD_isError(n));
+            out.resize(ZSTD_isError(n) ? 0 : n);
+        }
+#endif
+
+#ifdef HAPPYCPP_HAVE_BROTLI
+        if (coding == hhhttp::HTTP_CODING_BR) {
+            out.resize(16 * 1024 * 1024);
+            size_t n = out.size();
+            EXPECT_EQ(BROTLI_DECODER_RESULT_SUCCESS,
+                      BrotliDecoderDecompress(data.size(), reinterpret_cast<const uint8_t *>(data.data()),
+                                              &n, reinterpret_cast<uint8_t *>(&out[0])));
+            out.resize(n);
+        }
+#endif
+
+        return out;
+    }
+
+    class BufferSink : public hhhttp::BodySink {
+    public:
+        void begin(int64_t contentLength) override {
+            contentLength_ = contentLength;
+        }
+
+        bool write(const char *data, size_t size) override {
+            data_.append(data, size);
+            return true;
+        }
+
+        bool finish() override {
+            finished_ = true;
+            return true;
+        }
+
+        int64_t contentLength_ = 0;
+        bool finished_ = false;
+        std::string data_;
+    };
+
+} /* namespace */
+
+TEST(HCHTTP_COMPRESS_UNITTEST, Negotiate) { // NOLINT
+    using hhhttp::negotiateEncoding;
+    const std::vector<hhhttp::HttpContentCoding> zlibOnly = {hhhttp::HTTP_CODING_GZIP,
+                                                             hhhttp::HTTP_CODING_DEFLATE};
+
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, negotiateEncoding("", zlibOnly));
+    EXPECT_EQ(hhhttp::HTTP_CODING_GZIP, negotiateEncoding("gzip, deflate", zlibOnly));
+    EXPECT_EQ(hhhttp::HTTP_CODING_GZIP, negotiateEncoding("deflate, GZIP", zlibOnly));
+    EXPECT_EQ(hhhttp::HTTP_CODING_DEFLATE, negotiateEncoding("gzip;q=0.5, deflate", zlibOnly));
+    EXPECT_EQ(hhhttp::HTTP_CODING_DEFLATE, negotiateEncoding("gzip; q=0.5 ,deflate;q=0.501", zlibOnly));
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, negotiateEncoding("gzip;q=0", zlibOnly));
+    EXPECT_EQ(hhhttp::HTTP_CODING_GZIP, negotiateEncoding("x-gzip", zlibOnly));
+    EXPECT_EQ(hhhttp::HTTP_CODING_GZIP, negotiateEncoding("*", zlibOnly));
+    EXPECT_EQ(hhhttp::HTTP_CODING_DEFLATE, negotiateEncoding("gzip;q=0, *;q=0.1", zlibOnly));
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, negotiateEncoding("compress, identity", zlibOnly));
+    // q 值格式错误的项被忽略
+    EXPECT_EQ(hhhttp::HTTP_CODING_DEFLATE, negotiateEncoding("gzip;q=2, deflate;q=0.1", zlibOnly));
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, negotiateEncoding("gzip", {}));
+
+    // identity 的 q 值更高时不压缩
+    bool acceptable = false;
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, negotiateEncoding("gzip;q=0.1, identity", zlibOnly, &acceptable));
+    EXPECT_TRUE(acceptable);
+    EXPECT_EQ(hhhttp::HTTP_CODING_GZIP, negotiateEncoding("gzip, identity;q=0.5", zlibOnly, &acceptable));
+    EXPECT_TRUE(acceptable);
+    EXPECT_EQ(hhhttp::HTTP_CODING_GZIP, negotiateEncoding("gzip, identity", zlibOnly, &acceptable));
+    EXPECT_TRUE(acceptable);
+
+    // 没有可以接受的编码，应该返回 406
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, negotiateEncoding("identity;q=0, gzip;q=0", zlibOnly, &acceptable));
+    EXPECT_FALSE(acceptable);
+    negotiateEncoding("br, identity;q=0", zlibOnly, &acceptable);
+    EXPECT_FALSE(acceptable);
+    negotiateEncoding("*;q=0", zlibOnly, &acceptable);
+    EXPECT_FALSE(acceptable);
+    EXPECT_EQ(hhhttp::HTTP_CODING_GZIP, negotiateEncoding("gzip, identity;q=0", zlibOnly, &acceptable));
+    EXPECT_TRUE(acceptable);
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, negotiateEncoding("identity, *;q=0", zlibOnly, &acceptable));
+    EXPECT_TRUE(acceptable);
+    negotiateEncoding("br", zlibOnly, &acceptable);
+    EXPECT_TRUE(acceptable);
+
+    // 按服务端的优先级
+    const hhhttp::HttpContentCoding best = negotiateEncoding("gzip, deflate, br, zstd", kCodings);
+
+    if (hhhttp::codingSupported(hhhttp::HTTP_CODING_ZSTD))
+        EXPECT_EQ(hhhttp::HTTP_CODING_ZSTD, best);
+    else if (hhhttp::codingSupported(hhhttp::HTTP_CODING_BR))
+        EXPECT_EQ(hhhttp::HTTP_CODING_BR, best);
+    else
+        EXPECT_EQ(hhhttp::HTTP_CODING_GZIP, best);
+
+    EXPECT_EQ("gzip", hhhttp::toName(hhhttp::HTTP_CODING_GZIP));
+    EXPECT_EQ("br", hhhttp::toName(hhhttp::HTTP_CODING_BR));
+}
+
+TEST(HCHTTP_COMPRESS_UNITTEST, RoundTrip) { // NOLINT
+    const std::string text(sampleText(300 * 1024));
+
+    for (const auto coding : kCodings) {
+        if (!hhhttp::codingSupported(coding)) {
+            EXPECT_ANY_THROW(hhhttp::acquireCompressor(coding, 1));
+            continue;
+        }
+
+        // 同一个压缩器连续压缩两次，第二次使用池中复用的状态
+        for (int round = 0; round < 2; ++round) {
+            hhhttp::CompressorPtr c(hhhttp::acquireCompressor(coding, hhhttp::defaultLevel(coding)));
+            EXPECT_EQ(coding, c->coding());
+
+            std::string out;
+
+            for (size_t pos = 0; pos < text.size(); pos += 7777)
+                c->update(std::string_view(text).substr(pos, 7777), &out);
+
+            c->finish(&out);
+
+            EXPECT_LT(out.size(), text.size() / 4) << hhhttp::toName(coding);
+            EXPECT_EQ(text, decompress(coding, out)) << hhhttp::toName(coding);
+        }
+
+        // 空数据流
+        hhhttp::CompressorPtr c(hhhttp::acquireCompressor(coding, 1, 0));
+        std::string out;
+        c->finish(&out);
+        EXPECT_FALSE(out.empty());
+        EXPECT_TRUE(decompress(coding, out).empty());
+    }
+}
+
+TEST(HCHTTP_COMPRESS_UNITTEST, Pool) { // NOLINT
+    hhhttp::Compressor *raw;
+
+    {
+        hhhttp::CompressorPtr c(hhhttp::acquireCompressor(hhhttp::HTTP_CODING_GZIP, 6));
+        raw = c.get();
+    }
+
+    hhhttp::CompressorPtr a(hhhttp::acquireCompressor(hhhttp::HTTP_CODING_GZIP, 1));
+    hhhttp::CompressorPtr b(hhhttp::acquireCompressor(hhhttp::HTTP_CODING_GZIP, 1));
+    EXPECT_EQ(raw, a.get());
+    EXPECT_NE(raw, b.get());
+
+    EXPECT_ANY_THROW(hhhttp::acquireCompressor(hhhttp::HTTP_CODING_GZIP, 100));
+    EXPECT_ANY_THROW(hhhttp::acquireCompressor(hhhttp::HTTP_CODING_IDENTITY, 1));
+}
+
+TEST(HCHTTP_COMPRESS_UNITTEST, CompressSink) { // NOLINT
+    const std::string text(sampleText(100 * 1024));
+    auto buffer = std::make_shared<BufferSink>();
+    hhhttp::CompressSink sink(hhhttp::HTTP_CODING_GZIP, buffer);
+
+    sink.begin(static_cast<int64_t>(text.size()));
+
+    for (size_t pos = 0; pos < text.size(); pos += 1000)
+        ASSERT_TRUE(sink.write(text.data() + pos, std::min<size_t>(1000, text.size() - pos)));
+
+    ASSERT_TRUE(sink.finish());
+    EXPECT_EQ(-1, buffer->contentLength_);
+    EXPECT_TRUE(buffer->finished_);
+    EXPECT_EQ(text, decompress(hhhttp::HTTP_CODING_GZIP, buffer->data_));
+}
+
+TEST(HCHTTP_COMPRESS_UNITTEST, CompressResponse) { // NOLINT
+    const std::string text(sampleText(8192));
+    hhhttp::CompressOptions options;
+    options.codings = {hhhttp::HTTP_CODING_GZIP};
+
+    hhhttp::HttpRequestMsg req;
+    req.setMethod(hhhttp::HTTP_METHOD_GET);
+    req.setUrl("/static/app.js");
+    req.addField(hhhttp::HTTP_MREQF_ACCEPT_ENCODING, "gzip, deflate");
+
+    // MIME 类型根据扩展名确定
+    hhhttp::HttpResponseMsg resp;
+    resp.setStatus(200);
+    resp.setBody(text);
+    resp.addField(hhhttp::HTTP_MCOMF_CONTENT_LENGTH, std::to_string(text.size()));
+    resp.addField(hhhttp::HTTP_MRESF_ETAG, "\"abc\"");
+    resp.addField(hhhttp::HTTP_MRESF_VARY, "Origin");
+
+    EXPECT_EQ(hhhttp::HTTP_CODING_GZIP, hhhttp::compressResponse(req, &resp, options));
+    EXPECT_EQ("gzip", resp.header(hhhttp::HTTP_MRESF_CONTENT_ENCODING));
+    EXPECT_EQ(std::to_string(resp.body().size()), resp.header(hhhttp::HTTP_MCOMF_CONTENT_LENGTH));
+    EXPECT_EQ("W/\"abc\"", resp.header(hhhttp::HTTP_MRESF_ETAG));
+    EXPECT_EQ("Origin, Accept-Encoding", resp.header(hhhttp::HTTP_MRESF_VARY));
+    EXPECT_EQ(text, decompress(hhhttp::HTTP_CODING_GZIP, resp.body()));
+
+    // 已经压缩过
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, hhhttp::compressResponse(req, &resp, options));
+
+    const auto check = [&](uint32_t status, const std::string &type, const std::string &body,
+                           const std::string &cacheControl) {
+        hhhttp::HttpResponseMsg r;
+        r.setStatus(status);
+        r.setBody(body);
+
+        if (!type.empty())
+            r.addField(hhhttp::HTTP_MCOMF_CONTENT_TYPE, type);
+
+        if (!cacheControl.empty())
+            r.addField(hhhttp::HTTP_MCOMF_CACHE_CONTROL, cacheControl);
+
+        return hhhttp::compressResponse(req, &r, options);
+    };
+
+    EXPECT_EQ(hhhttp::HTTP_CODING_GZIP, check(200, "text/html; charset=utf-8", text, ""));
+    EXPECT_EQ(hhhttp::HTTP_CODING_GZIP, check(404, "application/json", text, ""));
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, check(200, "image/png", text, ""));
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, check(200, "text", text, ""));
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, check(200, "text/html", text.substr(0, 100), ""));
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, check(206, "text/html", text, ""));
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, check(304, "text/html", text, ""));
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, check(200, "text/html", text, "public, No-Transform"));
+
+    // 不可压缩的数据保持原样
+    std::string random(4096, '\0');
+    uint32_t x = 1;
+
+    for (auto &ch : random) {
+        x = x * 1103515245 + 12345;
+        ch = static_cast<char>(x >> 24);
+    }
+
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, check(200, "text/plain", random, ""));
+
+    // 客户端不支持压缩时，也需要 Vary
+    hhhttp::HttpRequestMsg plain;
+    plain.setUrl("/index.html");
+    hhhttp::HttpResponseMsg r;
+    r.setStatus(200);
+    r.setBody(text);
+    EXPECT_EQ(hhhttp::HTTP_CODING_IDENTITY, hhhttp::compressResponse(plain, &r, options));
+    EXPECT_EQ("Accept-Encoding", r.header(hhhttp::HTTP_MRESF_VARY));
+    EXPECT_EQ(text, r.body());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
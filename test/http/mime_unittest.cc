@@ -0,0 +1,129 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/http.h"
+#include "happycpp/http/mime.h"
+#include "happycpp/exception.h"
+#include <fstream>
+#include <string>
+
+namespace hhhttp = happycpp::hchttp;
+namespace hhmime = happycpp::hchttp::hcmime;
+
+TEST(HCHTTP_MIME_UNITTEST, FromExtension) { // NOLINT
+    EXPECT_EQ("text/html", hhmime::fromExtension("html"));
+    EXPECT_EQ("text/html", hhmime::fromExtension("HTM"));
+    EXPECT_EQ("image/jpeg", hhmime::fromExtension("JpG"));
+    EXPECT_EQ("video/3gpp", hhmime::fromExtension("3gp"));
+    EXPECT_EQ("application/vnd.openxmlformats-officedocument.wordprocessingml.document",
+              hhmime::fromExtension("docx"));
+    EXPECT_EQ("video/x-msvideo", hhmime::fromExtension("avi"));
+    EXPECT_EQ(hhmime::kDefaultMimeType, hhmime::fromExtension(""));
+    EXPECT_EQ(hhmime::kDefaultMimeType, hhmime::fromExtension("unknown"));
+    EXPECT_EQ(hhmime::kDefaultMimeType, hhmime::fromExtension(std::string(100, 'a')));
+}
+
+TEST(HCHTTP_MIME_UNITTEST, FromUri) { // NOLINT
+    EXPECT_EQ("image/gif", hhmime::fromUri("http://www.foo.com/image/logo.gif"));
+    EXPECT_EQ("image/png", hhmime::fromUri("/a/b.PNG?v=1.2#top"));
+    EXPECT_EQ(hhmime::kDefaultMimeType, hhmime::fromUri("/a.dir/file"));
+    EXPECT_EQ(hhmime::kDefaultMimeType, hhmime::fromUri("/file"));
+    EXPECT_EQ(hhmime::kDefaultMimeType, hhmime::fromUri("/file.?a.png"));
+
+    EXPECT_EQ("text/html; charset=utf-8", hhmime::fromUri("/index.html", ""));
+    EXPECT_EQ("text/plain; charset=gbk", hhmime::fromUri("/a.txt", "GBK"));
+    EXPECT_EQ("application/javascript; charset=utf-8", hhmime::fromUri("/a.js", "utf-8"));
+    EXPECT_EQ("text/css", hhmime::fromUri("/a.css", "utf-8"));
+    EXPECT_EQ("image/png", hhmime::fromUri("/a.png", "utf-8"));
+
+    // 预先生成的字符串，多次调用返回同一个地址
+    EXPECT_EQ(hhmime::fromUri("/a.html", "").data(), hhmime::fromUri("/b.htm", "utf-8").data());
+
+    // 不常用的 charset 第一次使用时生成
+    const std::string_view koi(hhmime::fromUri("/a.xml", "koi8-r"));
+    EXPECT_EQ("text/xml; charset=koi8-r", koi);
+    EXPECT_EQ(koi.data(), hhmime::fromUri("/b.xml", "koi8-r").data());
+
+    EXPECT_TRUE(hhmime::isText("text/plain"));
+    EXPECT_FALSE(hhmime::isText("text/css"));
+
+    EXPECT_EQ("text/html; charset=utf-8", hhhttp::getMimeType("index.html", ""));
+    EXPECT_EQ("image/jpeg", hhhttp::getMimeType("a.jpeg", "utf-8"));
+}
+
+TEST(HCHTTP_MIME_UNITTEST, Load) { // NOLINT
+    const std::string nginx(std::string(_BINARY_DIR_) + "/mime_unittest_nginx.types");
+    const std::string apache(std::string(_BINARY_DIR_) + "/mime_unittest_apache.types");
+
+    {
+        std::ofstream out(nginx);
+        out << "# custom types\n"
+               "types {\n"
+               "    application/x-custom   cust CUS2;  # comment\n"
+               "    application/vnd.multi-line\n"
+               "                           mline;\n"
+               "    text/plain             log;\n"
+               "    text/x-foo             foo;\n"
+               "}\n";
+    }
+
+    {
+        std::ofstream out(apache);
+        out << "# type ext...\n"
+               "application/x-apache  apc\n"
+               "image/x-override  png\n"
+               "\n"
+               "application/no-ext\n";
+    }
+
+    EXPECT_FALSE(hhmime::isText("text/x-foo"));
+    EXPECT_EQ(5u, hhmime::load(nginx));
+    EXPECT_EQ("application/x-custom", hhmime::fromExtension("cust"));
+    EXPECT_EQ("application/x-custom", hhmime::fromExtension("cus2"));
+    EXPECT_EQ("application/vnd.multi-line", hhmime::fromExtension("mline"));
+    EXPECT_EQ("text/plain; charset=utf-8", hhmime::fromUri("/app.log", ""));
+
+    // 加载的 text/ 类型同样附加 charset
+    EXPECT_TRUE(hhmime::isText("text/x-foo"));
+    EXPECT_EQ("text/x-foo; charset=utf-8", hhmime::fromUri("/a.foo", ""));
+    EXPECT_EQ("text/x-foo; charset=gbk", hhmime::fromUri("/a.foo?x=1", "gbk"));
+    EXPECT_EQ("text/x-foo; charset=gbk", hhmime::fromUri("/b.foo", "gbk"));
+    EXPECT_FALSE(hhmime::isText("application/x-custom"));
+
+    // 多次加载的内容合并，后加载的覆盖内置表
+    EXPECT_EQ(2u, hhmime::load(apache));
+    EXPECT_EQ("application/x-apache", hhmime::fromExtension("apc"));
+    EXPECT_EQ("application/x-custom", hhmime::fromExtension("cust"));
+    EXPECT_EQ("image/x-override", hhmime::fromExtension("png"));
+    EXPECT_EQ("image/gif", hhmime::fromExtension("gif"));
+
+    hhmime::reset();
+    EXPECT_FALSE(hhmime::isText("text/x-foo"));
+    EXPECT_EQ(hhmime::kDefaultMimeType, hhmime::fromExtension("cust"));
+    EXPECT_EQ("image/png", hhmime::fromExtension("png"));
+
+    EXPECT_THROW(hhmime::load("/nonexistent/mime.types"), happycpp::HappyException);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,295 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/http/parser.h"
+#include <string>
+#include <vector>
+
+namespace hhhttp = happycpp::hchttp;
+
+// 记录所有回调，方便验证
+class RecordHandler : public hhhttp::HttpParserHandler {
+public:
+    std::string startLine;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    std::vector<std::string> bodies;
+    int32_t messages = 0;
+    bool skipBody = false;
+
+    void onRequestLine(std::string_view method, std::string_view target,
+                       std::string_view version) override {
+        startLine = std::string(method) + "|" + std::string(target) + "|" + std::string(version);
+        headers.clear();
+        body.clear();
+    }
+
+    void onStatusLine(std::string_view version, uint32_t status,
+                      std::string_view reason) override {
+        startLine = std::string(version) + "|" + std::to_string(status) + "|" + std::string(reason);
+        headers.clear();
+        body.clear();
+    }
+
+    void onHeader(std::string_view name, std::string_view value) override {
+        headers.emplace_back(name, value);
+    }
+
+    bool onHeadersComplete() override {
+        return skipBody;
+    }
+
+    void onBody(std::string_view data) override {
+        body.append(data);
+    }
+
+    void onMessageComplete() override {
+        ++messages;
+        bodies.push_back(body);
+    }
+};
+
+// 每次只输入一个字节，模拟网络分包
+static size_t feedByteByByte(hhhttp::HttpParser *parser, const std::string &http) {
+    std::string buf;
+    size_t consumed = 0;
+
+    for (const char c : http) {
+        buf.push_back(c);
+        const size_t n = parser->execute(buf);
+        buf.erase(0, n);
+        consumed += n;
+    }
+
+    return consumed;
+}
+
+TEST(HCHTTP_PARSER_UNITTEST, Request) { // NOLINT
+    const std::string http("POST /index?arg=test HTTP/1.1\r\n"
+                           "Host: www.example.com\r\n"
+                           "Content-Length:   12  \r\n"
+                           "\r\n"
+                           "hello world\n");
+
+    RecordHandler handler;
+    hhhttp::HttpParser parser(&handler);
+
+    EXPECT_EQ(http.size(), parser.execute(http));
+    EXPECT_EQ(hhhttp::HTTP_PARSE_OK, parser.error());
+    EXPECT_EQ(hhhttp::HTTP_MSG_REQUEST, parser.type());
+    EXPECT_EQ(1, handler.messages);
+    EXPECT_EQ("POST|/index?arg=test|HTTP/1.1", handler.startLine);
+    ASSERT_EQ(2U, handler.headers.size());
+    EXPECT_EQ("Host", handler.headers[0].first);
+    EXPECT_EQ("www.example.com", handler.headers[0].second);
+    EXPECT_EQ("12", handler.headers[1].second);
+    EXPECT_EQ(12, parser.contentLength());
+    EXPECT_EQ("hello world\n", handler.body);
+    EXPECT_TRUE(parser.keepAlive());
+}
+
+TEST(HCHTTP_PARSER_UNITTEST, ByteByByte) { // NOLINT
+    const std::string http("HTTP/1.0 200 OK\r\n"
+                           "Connection: Keep-Alive\r\n"
+                           "Content-Length: 5\r\n"
+                           "\r\n"
+                           "abcde");
+
+    RecordHandler handler;
+    hhhttp::HttpParser parser(&handler);
+
+    EXPECT_EQ(http.size(), feedByteByByte(&parser, http));
+    EXPECT_EQ(hhhttp::HTTP_PARSE_OK, parser.error());
+    EXPECT_EQ(hhhttp::HTTP_MSG_RESPONSE, parser.type());
+    EXPECT_EQ(1, handler.messages);
+    EXPECT_EQ("HTTP/1.0|200|OK", handler.startLine);
+    EXPECT_EQ("abcde", handler.body);
+    EXPECT_TRUE(parser.keepAlive());
+}
+
+TEST(HCHTTP_PARSER_UNITTEST, Chunked) { // NOLINT
+    const std::string http("HTTP/1.1 200 OK\r\n"
+                           "Transfer-Encoding: gzip, Chunked\r\n"
+                           "Content-Length: 100\r\n"
+                           "\r\n"
+                           "5;ext=1\r\n"
+                           "hello\r\n"
+                           "6\r\n"
+                           " world\r\n"
+                           "0\r\n"
+                           "Expires: never\r\n"
+                           "\r\n");
+
+    RecordHandler handler;
+    hhhttp::HttpParser parser(&handler);
+
+    EXPECT_EQ(http.size(), feedByteByByte(&parser, http));
+    EXPECT_EQ(hhhttp::HTTP_PARSE_OK, parser.error());
+    EXPECT_TRUE(parser.chunked());
+    EXPECT_EQ(1, handler.messages);
+    EXPECT_EQ("hello world", handler.body);
+}
+
+TEST(HCHTTP_PARSER_UNITTEST, Pipelined) { // NOLINT
+    const std::string http("GET /a HTTP/1.1\r\n"
+                           "Host: a\r\n"
+                           "\r\n"
+                           "POST /b HTTP/1.1\r\n"
+                           "Content-Length: 3\r\n"
+                           "\r\n"
+                           "xyz"
+                           "\r\n"
+                           "GET /c HTTP/1.1\r\n"
+                           "Connection: close\r\n"
+                           "\r\n");
+
+    RecordHandler handler;
+    hhhttp::HttpParser parser(&handler);
+
+    EXPECT_EQ(http.size(), parser.execute(http));
+    EXPECT_EQ(hhhttp::HTTP_PARSE_OK, parser.error());
+    ASSERT_EQ(3, handler.messages);
+    EXPECT_EQ("", handler.bodies[0]);
+    EXPECT_EQ("xyz", handler.bodies[1]);
+    EXPECT_EQ("GET|/c|HTTP/1.1", handler.startLine);
+    EXPECT_FALSE(parser.keepAlive());
+}
+
+TEST(HCHTTP_PARSER_UNITTEST, ResponseUntilEof) { // NOLINT
+    const std::string http("HTTP/1.1 200 OK\r\n"
+                           "Server: test\r\n"
+                           "\r\n"
+                           "all of the rest");
+
+    RecordHandler handler;
+    hhhttp::HttpParser parser(&handler);
+
+    EXPECT_EQ(http.size(), parser.execute(http));
+    EXPECT_EQ(0, handler.messages);
+    EXPECT_TRUE(parser.finish());
+    EXPECT_EQ(1, handler.messages);
+    EXPECT_EQ("all of the rest", handler.body);
+}
+
+TEST(HCHTTP_PARSER_UNITTEST, SkipBody) { // NOLINT
+    const std::string http("HTTP/1.1 200 OK\r\n"
+                           "Content-Length: 100\r\n"
+                           "\r\n"
+                           "HTTP/1.1 304 Not Modified\r\n"
+                           "Content-Length: 100\r\n"
+                           "\r\n");
+
+    RecordHandler handler;
+    handler.skipBody = true;
+    hhhttp::HttpParser parser(&handler);
+
+    EXPECT_EQ(http.size(), parser.execute(http));
+    EXPECT_EQ(hhhttp::HTTP_PARSE_OK, parser.error());
+    EXPECT_EQ(2, handler.messages);
+    EXPECT_EQ("HTTP/1.1|304|Not Modified", handler.startLine);
+}
+
+TEST(HCHTTP_PARSER_UNITTEST, Http2StatusLine) { // NOLINT
+    // libcurl 输出的 HTTP/2 响应头，版本号没有次版本号
+    const std::string http("HTTP/2 204 \r\n"
+                           "\r\n");
+
+    RecordHandler handler;
+    hhhttp::HttpParser parser(&handler, hhhttp::HTTP_MSG_RESPONSE);
+
+    EXPECT_EQ(http.size(), parser.execute(http));
+    EXPECT_EQ(hhhttp::HTTP_PARSE_OK, parser.error());
+    EXPECT_EQ(1, handler.messages);
+    EXPECT_EQ(2, parser.httpMajor());
+    EXPECT_EQ(0, parser.httpMinor());
+    EXPECT_EQ("HTTP/2|204|", handler.startLine);
+}
+
+TEST(HCHTTP_PARSER_UNITTEST, Pause) { // NOLINT
+    class PauseHandler : public RecordHandler {
+    public:
+        hhhttp::HttpParser *parser = nullptr;
+
+        bool onHeadersComplete() override {
+            parser->pause();
+            return false;
+        }
+    };
+
+    const std::string head("PUT /x HTTP/1.1\r\n"
+                           "Content-Length: 4\r\n"
+                           "\r\n");
+    const std::string http(head + "body");
+
+    PauseHandler handler;
+    hhhttp::HttpParser parser(&handler);
+    handler.parser = &parser;
+
+    EXPECT_EQ(head.size(), parser.execute(http));
+    EXPECT_TRUE(parser.paused());
+    EXPECT_EQ(0U, parser.execute(http.substr(head.size())));
+
+    parser.resume();
+    EXPECT_EQ(4U, parser.execute(http.substr(head.size())));
+    EXPECT_EQ("body", handler.body);
+    EXPECT_EQ(1, handler.messages);
+}
+
+TEST(HCHTTP_PARSER_UNITTEST, Errors) { // NOLINT
+    RecordHandler handler;
+    hhhttp::HttpParser parser(&handler);
+
+    parser.execute(std::string("GET / HTTP/x.1\r\n\r\n"));
+    EXPECT_EQ(hhhttp::HTTP_PARSE_INVALID_VERSION, parser.error());
+
+    parser.reset();
+    parser.execute(std::string("GET / HTTP/1.1\r\nHost : a\r\n\r\n"));
+    EXPECT_EQ(hhhttp::HTTP_PARSE_INVALID_HEADER, parser.error());
+
+    parser.reset();
+    parser.execute(std::string("GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n"));
+    EXPECT_EQ(hhhttp::HTTP_PARSE_INVALID_CONTENT_LENGTH, parser.error());
+
+    parser.reset();
+    parser.execute(std::string("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n"));
+    EXPECT_EQ(hhhttp::HTTP_PARSE_INVALID_CHUNK, parser.error());
+
+    parser.reset();
+    parser.execute(std::string("POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n"));
+    EXPECT_EQ(hhhttp::HTTP_PARSE_INVALID_TRANSFER_ENCODING, parser.error());
+
+    parser.reset();
+    parser.setMaxLineSize(16);
+    parser.execute(std::string("GET /a/very/long/path"));
+    EXPECT_EQ(hhhttp::HTTP_PARSE_LINE_TOO_LONG, parser.error());
+
+    parser.reset();
+    parser.setMaxLineSize(hhhttp::HttpParser::kDefaultMaxLineSize);
+    parser.execute(std::string("POST / HTTP/1.1\r\nContent-Length: 10\r\n\r\nabc"));
+    EXPECT_FALSE(parser.finish());
+    EXPECT_EQ(hhhttp::HTTP_PARSE_UNEXPECTED_EOF, parser.error());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
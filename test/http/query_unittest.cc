@@ -0,0 +1,130 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/http.h"
+#include <string>
+#include <vector>
+
+namespace hhhttp = happycpp::hchttp;
+
+TEST(HCHTTP_QUERY_UNITTEST, Iterate) { // NOLINT
+    const hhhttp::QueryArgs args("a=1&&b=x%20y&flag&=empty&c=");
+    std::vector<std::string> items;
+
+    for (const auto &arg : args)
+        items.push_back(std::string(arg.key) + "|" + std::string(arg.value));
+
+    // 遍历时不解码，跳过空参数
+    EXPECT_EQ((std::vector<std::string>{"a|1", "b|x%20y", "flag|", "|empty", "c|"}), items);
+    EXPECT_EQ(5u, args.size());
+    EXPECT_FALSE(args.empty());
+
+    EXPECT_TRUE(hhhttp::QueryArgs().empty());
+    EXPECT_TRUE(hhhttp::QueryArgs("&&").empty());
+    EXPECT_EQ(0u, hhhttp::QueryArgs("&&").size());
+}
+
+TEST(HCHTTP_QUERY_UNITTEST, Get) { // NOLINT
+    const hhhttp::QueryArgs args("q=happy+cpp&tag=a&x%20y=%E4%B8%AD&tag=b&flag&tag=c%26d");
+
+    EXPECT_EQ("happy cpp", args.get("q").value());
+    EXPECT_EQ("happy+cpp", args.raw("q").value());
+    EXPECT_EQ("\xE4\xB8\xAD", args.get("x y").value());
+    EXPECT_FALSE(args.get("x%20y"));
+    EXPECT_TRUE(args.has("flag"));
+    EXPECT_EQ("", args.get("flag").value());
+    EXPECT_FALSE(args.has("missing"));
+    EXPECT_FALSE(args.get("missing"));
+    EXPECT_EQ("def", args.get("missing", "def"));
+
+    // 同名参数
+    EXPECT_EQ("a", args.get("tag").value());
+    EXPECT_EQ(3u, args.count("tag"));
+    EXPECT_EQ((std::vector<std::string>{"a", "b", "c&d"}), args.getAll("tag"));
+    EXPECT_TRUE(args.getAll("missing").empty());
+}
+
+TEST(HCHTTP_QUERY_UNITTEST, Index) { // NOLINT
+    // 参数较多时使用哈希索引
+    std::string query;
+
+    for (int32_t i = 0; i < 100; ++i)
+        query += "k" + std::to_string(i % 40) + "=" + std::to_string(i) + "&";
+
+    query += "a%2Bb=plus";
+
+    hhhttp::QueryArgs args(query);
+    EXPECT_EQ(101u, args.size());
+    EXPECT_EQ("5", args.get("k5").value());
+    EXPECT_EQ((std::vector<std::string>{"5", "45", "85"}), args.getAll("k5"));
+    EXPECT_EQ(2u, args.count("k39"));
+    EXPECT_EQ("plus", args.get("a+b").value());
+
+    // 复制和移动之后，索引仍然正确
+    hhhttp::QueryArgs copied(args);
+    EXPECT_EQ("plus", copied.get("a+b").value());
+
+    hhhttp::QueryArgs moved(std::move(copied));
+    EXPECT_EQ("plus", moved.get("a+b").value());
+    EXPECT_EQ(3u, moved.count("k0"));
+
+    copied = moved;
+    EXPECT_EQ(3u, copied.count("k0"));
+}
+
+TEST(HCHTTP_QUERY_UNITTEST, FromRequest) { // NOLINT
+    EXPECT_EQ("a=1&b=2", hhhttp::QueryArgs::fromTarget("/index?a=1&b=2#top").query());
+    EXPECT_TRUE(hhhttp::QueryArgs::fromTarget("/index#a=1").empty());
+    EXPECT_TRUE(hhhttp::QueryArgs::fromTarget("/index").empty());
+
+    const std::string http("GET /search?q=happy+cpp&page=2 HTTP/1.1\r\n"
+                           "Host: www.example.com\r\n"
+                           "User-Agent: happycpp/1.0\r\n"
+                           "\r\n");
+
+    hhhttp::HttpMsgCtx ctx;
+    const auto req = std::dynamic_pointer_cast<hhhttp::HttpRequestMsg>(ctx.parse(http));
+    ASSERT_TRUE(req);
+
+    const hhhttp::QueryArgs args(req->queryArgs());
+    EXPECT_EQ("happy cpp", args.get("q").value());
+    EXPECT_EQ("2", args.get("page").value());
+
+    // 解析时只保存原始路径，args() 第一次调用时解码
+    EXPECT_EQ("/search", req->url());
+    EXPECT_EQ("q=happy cpp&page=2", req->args());
+
+    req->setRequestUrl("/other?x=%41");
+    EXPECT_EQ("x=A", req->args());
+
+    req->setArgs("explicit=1");
+    req->setRequestUrl("/no-query");
+    EXPECT_EQ("explicit=1", req->args());
+
+    hhhttp::HttpRequestMsg empty;
+    empty.setRequestUrl("/index");
+    EXPECT_EQ("", empty.args());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
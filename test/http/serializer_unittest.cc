@@ -0,0 +1,200 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/http/serializer.h"
+#include <regex>
+#include <string>
+#include <utility>
+
+namespace hhhttp = happycpp::hchttp;
+
+TEST(HCHTTP_SERIALIZER_UNITTEST, Request) { // NOLINT
+    hhhttp::HttpRequestMsg req;
+    req.setMethod(hhhttp::HTTP_METHOD_GET);
+    req.setRequestUrl("/index?arg=test");
+    req.setVersion("HTTP/1.1");
+    req.addField(hhhttp::HTTP_MREQF_HOST, "example.com");
+    req.addField("X-Custom", "1");
+
+    const hhhttp::HttpWireMsg wire(hhhttp::serialize(req));
+    const std::string s(wire.toString());
+
+    // 消息体为空的请求不添加 Content-Length
+    EXPECT_EQ("GET /index?arg=test HTTP/1.1\r\n"
+              "Host: example.com\r\n"
+              "X-Custom: 1\r\n"
+              "\r\n", s);
+    EXPECT_EQ(s.size(), wire.bytes());
+
+    // 字段值直接指向原消息，没有复制
+    const std::string_view host(req.header(hhhttp::HTTP_MREQF_HOST));
+    bool found = false;
+
+    for (size_t i = 0; i < wire.iovCount(); ++i)
+        found |= wire.iov()[i].iov_base == host.data();
+
+    EXPECT_TRUE(found);
+}
+
+TEST(HCHTTP_SERIALIZER_UNITTEST, RequestDefaults) { // NOLINT
+    hhhttp::HttpRequestMsg req;
+    req.setMethod(hhhttp::HTTP_METHOD_POST);
+    req.setBody("a=1");
+
+    EXPECT_EQ("POST / HTTP/1.1\r\n"
+              "Content-Length: 3\r\n"
+              "\r\n"
+              "a=1", hhhttp::serialize(req).toString());
+
+    hhhttp::HttpRequestMsg invalid;
+    EXPECT_ANY_THROW(hhhttp::serialize(invalid));
+}
+
+TEST(HCHTTP_SERIALIZER_UNITTEST, Response) { // NOLINT
+    hhhttp::HttpResponseMsg resp;
+    resp.setVersion("HTTP/1.1");
+    resp.setStatus(200);
+    resp.addField(hhhttp::HTTP_MCOMF_DATE, "Sun, 06 Nov 1994 08:49:37 GMT");
+    resp.addField(hhhttp::HTTP_MCOMF_CONTENT_TYPE, "text/plain");
+    resp.setBody("hello");
+
+    const hhhttp::HttpWireMsg wire(hhhttp::serialize(resp));
+
+    EXPECT_EQ("HTTP/1.1 200 OK\r\n"
+              "Content-Type: text/plain\r\n"
+              "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+              "Content-Length: 5\r\n"
+              "\r\n"
+              "hello", wire.toString());
+
+    // 状态行为一个 iovec，消息体为最后一个 iovec
+    EXPECT_EQ(17u, wire.iov()[0].iov_len);
+    EXPECT_EQ(resp.body().data(), wire.iov()[wire.iovCount() - 1].iov_base);
+}
+
+TEST(HCHTTP_SERIALIZER_UNITTEST, StatusLine) { // NOLINT
+    hhhttp::HttpResponseMsg resp;
+    resp.setVersion("HTTP/1.0");
+    resp.setStatus(404);
+    resp.addField(hhhttp::HTTP_MCOMF_DATE, "x");
+    EXPECT_EQ("HTTP/1.0 404 Not Found\r\n", hhhttp::serialize(resp).toString().substr(0, 24));
+
+    resp.setReasonPhrase("Nothing Here");
+    EXPECT_EQ("HTTP/1.0 404 Nothing Here\r\n", hhhttp::serialize(resp).toString().substr(0, 27));
+
+    resp.setReasonPhrase("");
+    resp.setStatus(599);
+    EXPECT_EQ("HTTP/1.0 599 \r\n", hhhttp::serialize(resp).toString().substr(0, 15));
+
+    EXPECT_EQ("Too Many Requests", hhhttp::reasonPhrase(429));
+    EXPECT_TRUE(hhhttp::reasonPhrase(599).empty());
+    EXPECT_TRUE(hhhttp::reasonPhrase(100000).empty());
+}
+
+TEST(HCHTTP_SERIALIZER_UNITTEST, NoBody) { // NOLINT
+    for (const uint32_t status : {100u, 204u, 304u}) {
+        hhhttp::HttpResponseMsg resp;
+        resp.setStatus(status);
+        resp.addField(hhhttp::HTTP_MCOMF_DATE, "x");
+        resp.setBody("ignored");
+
+        const std::string s(hhhttp::serialize(resp).toString());
+        EXPECT_EQ(std::string::npos, s.find("Content-Length")) << status;
+        EXPECT_EQ(std::string::npos, s.find("ignored")) << status;
+    }
+
+    // 已经存在 Transfer-Encoding 时不添加 Content-Length
+    hhhttp::HttpResponseMsg chunked;
+    chunked.setStatus(200);
+    chunked.addField(hhhttp::HTTP_MCOMF_DATE, "x");
+    chunked.addField(hhhttp::HTTP_MRESF_TRANSFER_ENCODING, "chunked");
+    EXPECT_EQ(std::string::npos, hhhttp::serialize(chunked).toString().find("Content-Length"));
+
+    // 响应的消息体为空时也添加 Content-Length
+    hhhttp::HttpResponseMsg empty;
+    empty.setStatus(200);
+    empty.addField(hhhttp::HTTP_MCOMF_DATE, "x");
+    EXPECT_NE(std::string::npos, hhhttp::serialize(empty).toString().find("Content-Length: 0\r\n"));
+}
+
+TEST(HCHTTP_SERIALIZER_UNITTEST, Date) { // NOLINT
+    const std::string_view date(hhhttp::httpDate());
+    const std::regex re("[A-Z][a-z]{2}, \\d{2} [A-Z][a-z]{2} \\d{4} \\d{2}:\\d{2}:\\d{2} GMT");
+    EXPECT_TRUE(std::regex_match(std::string(date), re)) << date;
+
+    hhhttp::HttpResponseMsg resp;
+    resp.setStatus(200);
+    const std::string s(hhhttp::serialize(resp).toString());
+    EXPECT_NE(std::string::npos, s.find("\r\nDate: "));
+}
+
+TEST(HCHTTP_SERIALIZER_UNITTEST, Reuse) { // NOLINT
+    hhhttp::HttpResponseMsg resp;
+    resp.setStatus(500);
+    resp.setReasonPhrase("Oops");
+    resp.addField(hhhttp::HTTP_MCOMF_DATE, "x");
+    resp.setBody("0123456789");
+
+    hhhttp::HttpWireMsg wire;
+    hhhttp::serialize(resp, &wire);
+    const std::string expected(wire.toString());
+    hhhttp::serialize(resp, &wire);
+    EXPECT_EQ(expected, wire.toString());
+
+    // 移动之后，指向内部缓冲区的 iovec 仍然有效
+    const hhhttp::HttpWireMsg moved(std::move(wire));
+    EXPECT_EQ(expected, moved.toString());
+    EXPECT_EQ("HTTP/1.1 500 Oops\r\nDate: x\r\nContent-Length: 10\r\n\r\n0123456789", expected);
+}
+
+TEST(HCHTTP_SERIALIZER_UNITTEST, MovedFrom) { // NOLINT
+    hhhttp::HttpResponseMsg resp;
+    resp.setStatus(200);
+    resp.addField(hhhttp::HTTP_MCOMF_DATE, "x");
+    resp.setBody("0123456789");
+
+    const std::string expected("HTTP/1.1 200 OK\r\nDate: x\r\nContent-Length: 10\r\n\r\n0123456789");
+
+    // 被移动的对象是空的，再次序列化时使用新的缓冲区
+    hhhttp::HttpWireMsg wire(hhhttp::serialize(resp));
+    hhhttp::HttpWireMsg moved(std::move(wire));
+    EXPECT_EQ(0U, wire.iovCount()); // NOLINT
+    EXPECT_EQ(0U, wire.bytes()); // NOLINT
+
+    hhhttp::serialize(resp, &wire); // NOLINT
+    EXPECT_EQ(expected, wire.toString());
+    EXPECT_EQ(expected, moved.toString());
+
+    // 移动赋值之后，两个对象都可以继续使用
+    hhhttp::HttpWireMsg assigned;
+    assigned = std::move(moved);
+    EXPECT_EQ(expected, assigned.toString());
+    EXPECT_EQ(0U, moved.iovCount()); // NOLINT
+
+    hhhttp::serialize(resp, &moved); // NOLINT
+    EXPECT_EQ(expected, moved.toString());
+    EXPECT_EQ(expected, assigned.toString());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,537 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/filesys.h"
+#include "happycpp/http/client.h"
+#include "happycpp/http/parser.h"
+#include "happycpp/http/server.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace hhhttp = happycpp::hchttp;
+
+namespace {
+
+    // 把原始数据解析为 HttpResponseMsg
+    class ResponseCollector : public hhhttp::HttpParserHandler {
+    public:
+        explicit ResponseCollector(std::deque<bool> heads)
+                : heads_(std::move(heads)), parser_(this, hhhttp::HTTP_MSG_RESPONSE) {}
+
+        void onStatusLine(std::string_view version, uint32_t status,
+                          std::string_view reason) override {
+            resp_ = std::make_shared<hhhttp::HttpResponseMsg>();
+            resp_->setVersion(std::string(version));
+            resp_->setStatus(status);
+            resp_->setReasonPhrase(std::string(reason));
+        }
+
+        void onHeader(std::string_view name, std::string_view value) override {
+            resp_->addField(name, value);
+        }
+
+        bool onHeadersComplete() override {
+            if (resp_->status() == 100)
+                return true;
+
+            const bool head = !heads_.empty() && heads_.front();
+
+            if (!heads_.empty())
+                heads_.pop_front();
+
+            return head;
+        }
+
+        void onBody(std::string_view data) override {
+            body_.append(data);
+        }
+
+        void onMessageComplete() override {
+            resp_->setBody(std::move(body_));
+            body_.clear();
+
+            if (resp_->status() != 100)
+                responses.push_back(resp_);
+            else
+                ++continues;
+        }
+
+        // 读取 count 个响应，或者直到连接关闭
+        bool read(int fd, size_t count, bool *closed) {
+            char buf[4096];
+            *closed = false;
+
+            while (responses.size() < count) {
+                const ssize_t n = ::read(fd, buf, sizeof(buf));
+
+                if (n <= 0) {
+                    *closed = true;
+                    parser_.finish();
+                    break;
+                }
+
+                data_.append(buf, static_cast<size_t>(n));
+                data_.erase(0, parser_.execute(data_));
+
+                if (parser_.error() != hhhttp::HTTP_PARSE_OK)
+                    return false;
+            }
+
+            return responses.size() >= count;
+        }
+
+        std::vector<hhhttp::HttpResponseMsgPtr> responses;
+        size_t continues = 0; /*! 收到的 100 Continue 数量 */
+
+    private:
+        std::deque<bool> heads_;
+        hhhttp::HttpParser parser_;
+        hhhttp::HttpResponseMsgPtr resp_;
+        std::string body_;
+        std::string data_;
+    };
+
+    int connectTo(uint16_t port) {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+        if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0)
+            throw std::runtime_error("connect failed");
+
+        return fd;
+    }
+
+    void sendAll(int fd, const std::string &data) {
+        for (size_t sent = 0; sent < data.size();) {
+            const ssize_t n = write(fd, data.data() + sent, data.size() - sent);
+
+            if (n <= 0)
+                throw std::runtime_error("write failed");
+
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+    // 发送原始数据，返回收到的响应
+    std::vector<hhhttp::HttpResponseMsgPtr> exchange(uint16_t port,
+                                                     const std::string &data,
+                                                     size_t count,
+                                                     bool *closed = nullptr,
+                                                     std::deque<bool> heads = std::deque<bool>()) {
+        const int fd = connectTo(port);
+        ResponseCollector collector(std::move(heads));
+        bool _closed;
+
+        sendAll(fd, data);
+        collector.read(fd, count, closed ? closed : &_closed);
+
+        // 检查服务端是否关闭连接
+        if (closed && !*closed) {
+            char c;
+            struct timeval tv{0, 200000};
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            *closed = ::read(fd, &c, 1) == 0;
+        }
+
+        close(fd);
+        return collector.responses;
+    }
+
+    void echoUrl(const hhhttp::HttpRequestMsg &req, hhhttp::HttpResponseMsg *resp) {
+        resp->setField(hhhttp::HTTP_MCOMF_CONTENT_TYPE, "text/plain");
+        resp->setBody(req.requestUrl());
+    }
+
+} /* namespace */
+
+TEST(HCHTTP_SERVER_UNITTEST, Route) { // NOLINT
+    hhhttp::HttpServer server;
+    server.route("/", [](const hhhttp::HttpRequestMsg &, hhhttp::HttpResponseMsg *resp) {
+        resp->setBody("root");
+    });
+    server.route("/api", [](const hhhttp::HttpRequestMsg &, hhhttp::HttpResponseMsg *resp) {
+        resp->setBody("api");
+    });
+    server.route("/api/v2", [](const hhhttp::HttpRequestMsg &, hhhttp::HttpResponseMsg *resp) {
+        resp->setBody("v2");
+    });
+    server.start();
+    ASSERT_TRUE(server.running());
+    ASSERT_NE(0, server.port());
+
+    EXPECT_ANY_THROW(server.route("/late", echoUrl));
+
+    const auto r = exchange(server.port(),
+                            "GET /api/v2/x?a=1 HTTP/1.1\r\nHost: t\r\n\r\n"
+                            "GET /api/x HTTP/1.1\r\nHost: t\r\n\r\n"
+                            "GET /other HTTP/1.1\r\nHost: t\r\n\r\n"
+                            "GET /api HTTP/1.1\r\nHost: t\r\n\r\n"
+                            "GET /apix HTTP/1.1\r\nHost: t\r\n\r\n"
+                            "GET /api/v2x HTTP/1.1\r\nHost: t\r\n\r\n", 6);
+    ASSERT_EQ(6u, r.size());
+    EXPECT_EQ("v2", r[0]->body());
+    EXPECT_EQ("api", r[1]->body());
+    EXPECT_EQ("root", r[2]->body());
+    // 前缀按路径段匹配
+    EXPECT_EQ("api", r[3]->body());
+    EXPECT_EQ("root", r[4]->body());
+    EXPECT_EQ("api", r[5]->body());
+    EXPECT_EQ(200u, r[0]->status());
+    EXPECT_EQ("2", r[0]->header(hhhttp::HTTP_MCOMF_CONTENT_LENGTH));
+    EXPECT_FALSE(r[0]->header(hhhttp::HTTP_MCOMF_DATE).empty());
+
+    server.stop();
+    EXPECT_FALSE(server.running());
+    server.stop();
+}
+
+TEST(HCHTTP_SERVER_UNITTEST, NotFound) { // NOLINT
+    hhhttp::HttpServer server;
+    server.route("/a", echoUrl);
+    server.start();
+
+    const auto r = exchange(server.port(),
+                            "GET /b HTTP/1.1\r\nHost: t\r\n\r\n"
+                            "GET /ab HTTP/1.1\r\nHost: t\r\n\r\n", 2);
+    ASSERT_EQ(2u, r.size());
+    EXPECT_EQ(404u, r[0]->status());
+    EXPECT_EQ("Not Found", r[0]->reasonPhrase());
+    EXPECT_EQ(404u, r[1]->status());
+}
+
+TEST(HCHTTP_SERVER_UNITTEST, Pipelining) { // NOLINT
+    hhhttp::HttpServerOptions options;
+    options.threads = 2;
+    options.maxPipeline = 4;
+    hhhttp::HttpServer server(options);
+    server.route("/", echoUrl);
+    server.start();
+
+    // 请求数量超过 maxPipeline 时，暂停解析，响应仍然按顺序返回
+    std::string data;
+    const size_t count = 50;
+
+    for (size_t i = 0; i < count; ++i)
+        data += "GET /" + std::to_string(i) + " HTTP/1.1\r\nHost: t\r\n\r\n";
+
+    bool closed = false;
+    const auto r = exchange(server.port(), data, count, &closed);
+    ASSERT_EQ(count, r.size());
+
+    for (size_t i = 0; i < count; ++i)
+        EXPECT_EQ("/" + std::to_string(i), r[i]->body());
+
+    EXPECT_FALSE(closed);
+}
+
+TEST(HCHTTP_SERVER_UNITTEST, Connection) { // NOLINT
+    hhhttp::HttpServer server;
+    server.route("/", echoUrl);
+    server.start();
+
+    bool closed = false;
+    auto r = exchange(server.port(), "GET /a HTTP/1.0\r\n\r\nGET /b HTTP/1.0\r\n\r\n", 2, &closed);
+    ASSERT_EQ(1u, r.size());
+    EXPECT_EQ("HTTP/1.0", r[0]->version());
+    EXPECT_EQ("close", r[0]->header(hhhttp::HTTP_MCOMF_CONNECTION));
+    EXPECT_TRUE(closed);
+
+    r = exchange(server.port(), "GET /a HTTP/1.0\r\nConnection: keep-alive\r\n\r\n", 1, &closed);
+    ASSERT_EQ(1u, r.size());
+    EXPECT_EQ("keep-alive", r[0]->header(hhhttp::HTTP_MCOMF_CONNECTION));
+    EXPECT_FALSE(closed);
+
+    r = exchange(server.port(), "GET /a HTTP/1.1\r\nConnection: close\r\n\r\n", 1, &closed);
+    ASSERT_EQ(1u, r.size());
+    EXPECT_TRUE(closed);
+}
+
+TEST(HCHTTP_SERVER_UNITTEST, Head) { // NOLINT
+    hhhttp::HttpServer server;
+    server.route("/", echoUrl);
+    server.start();
+
+    const auto r = exchange(server.port(),
+                            "HEAD /hello HTTP/1.1\r\n\r\nGET /x HTTP/1.1\r\n\r\n", 2,
+                            nullptr, {true, false});
+    ASSERT_EQ(2u, r.size());
+    EXPECT_EQ("6", r[0]->header(hhhttp::HTTP_MCOMF_CONTENT_LENGTH));
+    EXPECT_TRUE(r[0]->body().empty());
+    EXPECT_EQ("/x", r[1]->body());
+}
+
+TEST(HCHTTP_SERVER_UNITTEST, Errors) { // NOLINT
+    hhhttp::HttpServerOptions options;
+    options.maxBodySize = 16;
+    options.readBufferSize = 1024;
+    hhhttp::HttpServer server(options);
+    server.route("/", echoUrl);
+    server.route("/throw", [](const hhhttp::HttpRequestMsg &, hhhttp::HttpResponseMsg *resp) {
+        resp->setBody("partial");
+        throw std::runtime_error("handler failed");
+    });
+    server.start();
+
+    bool closed = false;
+    auto r = exchange(server.port(), "GET /throw HTTP/1.1\r\n\r\n", 1, &closed);
+    ASSERT_EQ(1u, r.size());
+    EXPECT_EQ(500u, r[0]->status());
+    EXPECT_TRUE(r[0]->body().empty());
+    EXPECT_FALSE(closed);
+
+    r = exchange(server.port(), "POST / HTTP/1.1\r\nContent-Length: 17\r\n\r\n", 1, &closed);
+    ASSERT_EQ(1u, r.size());
+    EXPECT_EQ(413u, r[0]->status());
+    EXPECT_TRUE(closed);
+
+    r = exchange(server.port(),
+                 "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n20\r\n"
+                 + std::string(32, 'x') + "\r\n0\r\n\r\n", 1, &closed);
+    ASSERT_EQ(1u, r.size());
+    EXPECT_EQ(413u, r[0]->status());
+    EXPECT_TRUE(closed);
+
+    r = exchange(server.port(), "GARBAGE\r\n\r\n", 1, &closed);
+    ASSERT_EQ(1u, r.size());
+    EXPECT_EQ(400u, r[0]->status());
+    EXPECT_TRUE(closed);
+
+    r = exchange(server.port(), "GET /" + std::string(2048, 'a') + " HTTP/1.1\r\n\r\n", 1, &closed);
+    ASSERT_EQ(1u, r.size());
+    EXPECT_EQ(431u, r[0]->status());
+    EXPECT_TRUE(closed);
+
+    r = exchange(server.port(), "BREW /pot HTTP/1.1\r\n\r\n", 1, &closed);
+    ASSERT_EQ(1u, r.size());
+    EXPECT_EQ(501u, r[0]->status());
+}
+
+TEST(HCHTTP_SERVER_UNITTEST, Expect) { // NOLINT
+    hhhttp::HttpServer server;
+    server.route("/", [](const hhhttp::HttpRequestMsg &req, hhhttp::HttpResponseMsg *resp) {
+        resp->setBody(req.body());
+    });
+    server.start();
+
+    // 没有请求体时不发送 100 Continue；有请求体时先发送 100 Continue，值不区分大小写
+    const int fd = connectTo(server.port());
+    ResponseCollector collector({});
+    bool closed = false;
+
+    sendAll(fd, "GET / HTTP/1.1\r\nExpect: 100-continue\r\n\r\n");
+    ASSERT_TRUE(collector.read(fd, 1, &closed));
+    EXPECT_EQ(0u, collector.continues);
+    EXPECT_EQ(200u, collector.responses[0]->status());
+
+    sendAll(fd, "POST / HTTP/1.1\r\nExpect: 100-Continue\r\nContent-Length: 4\r\n\r\nbody");
+    ASSERT_TRUE(collector.read(fd, 2, &closed));
+    EXPECT_EQ(1u, collector.continues);
+    EXPECT_EQ("body", collector.responses[1]->body());
+
+    sendAll(fd, "POST / HTTP/1.1\r\nExpect: 100-continue\r\nTransfer-Encoding: chunked\r\n\r\n"
+                "4\r\nbody\r\n0\r\n\r\n");
+    ASSERT_TRUE(collector.read(fd, 3, &closed));
+    EXPECT_EQ(2u, collector.continues);
+    EXPECT_EQ("body", collector.responses[2]->body());
+    close(fd);
+
+    // 不支持的期望回复 417，并关闭连接
+    const auto r = exchange(server.port(),
+                            "POST / HTTP/1.1\r\nExpect: 200-ok\r\nContent-Length: 4\r\n\r\nbody", 1,
+                            &closed);
+    ASSERT_EQ(1u, r.size());
+    EXPECT_EQ(417u, r[0]->status());
+    EXPECT_TRUE(closed);
+}
+
+TEST(HCHTTP_SERVER_UNITTEST, HttpClient) { // NOLINT
+    hhhttp::HttpServerOptions options;
+    options.threads = 4;
+    hhhttp::HttpServer server(options);
+    server.route("/echo", [](const hhhttp::HttpRequestMsg &req, hhhttp::HttpResponseMsg *resp) {
+        resp->setField(hhhttp::HTTP_MCOMF_CONTENT_TYPE,
+                       std::string(req.header(hhhttp::HTTP_MCOMF_CONTENT_TYPE)));
+        resp->setBody(req.body());
+    });
+    server.start();
+
+    const std::string url("http://127.0.0.1:" + std::to_string(server.port()) + "/echo");
+    hhhttp::HttpClient client;
+
+    // 超过 1KB 时 curl 发送 Expect: 100-continue
+    const std::string body(64 * 1024, 'b');
+    const auto resp = client.post(url, body, "text/plain").get();
+    ASSERT_TRUE(resp);
+    EXPECT_EQ(200u, resp->status());
+    EXPECT_EQ(body, resp->body());
+
+    std::vector<std::future<hhhttp::HttpResponseMsgPtr> > futures;
+
+    for (int i = 0; i < 200; ++i)
+        futures.push_back(client.post(url, std::to_string(i), "text/plain"));
+
+    for (int i = 0; i < 200; ++i)
+        EXPECT_EQ(std::to_string(i), futures[i].get()->body());
+}
+
+TEST(HCHTTP_SERVER_UNITTEST, Compress) { // NOLINT
+    hhhttp::HttpServerOptions options;
+    options.compress = true;
+    options.compressOptions.codings = {hhhttp::HTTP_CODING_GZIP};
+    hhhttp::HttpServer server(options);
+    const std::string text(64 * 1024, 'x');
+    server.route("/", [&text](const hhhttp::HttpRequestMsg &, hhhttp::HttpResponseMsg *resp) {
+        resp->setBody(text);
+    });
+    server.start();
+
+    // MIME 类型根据扩展名确定，流水线上的两个请求分别协商
+    const auto r = exchange(server.port(),
+                            "GET /a.txt HTTP/1.1\r\nAccept-Encoding: gzip\r\n\r\n"
+                            "GET /a.txt HTTP/1.1\r\n\r\n"
+                            "GET /a.png HTTP/1.1\r\nAccept-Encoding: gzip\r\n\r\n", 3);
+    ASSERT_EQ(3u, r.size());
+    EXPECT_EQ("gzip", r[0]->header(hhhttp::HTTP_MRESF_CONTENT_ENCODING));
+    EXPECT_EQ("Accept-Encoding", r[0]->header(hhhttp::HTTP_MRESF_VARY));
+    EXPECT_LT(r[0]->body().size(), 1024u);
+    EXPECT_TRUE(r[1]->header(hhhttp::HTTP_MRESF_CONTENT_ENCODING).empty());
+    EXPECT_EQ(text, r[1]->body());
+    EXPECT_TRUE(r[2]->header(hhhttp::HTTP_MRESF_CONTENT_ENCODING).empty());
+    EXPECT_EQ(text, r[2]->body());
+}
+
+TEST(HCHTTP_SERVER_UNITTEST, KeepAliveTimeout) { // NOLINT
+    hhhttp::HttpServerOptions options;
+    options.keepAliveTimeoutMs = 100;
+    hhhttp::HttpServer server(options);
+    server.route("/", echoUrl);
+    server.start();
+
+    const int fd = connectTo(server.port());
+    char c;
+    struct timeval tv{5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    // 每秒检查一次空闲连接
+    EXPECT_EQ(0, ::read(fd, &c, 1));
+    close(fd);
+}
+
+TEST(HCHTTP_SERVER_UNITTEST, ServeDirectory) { // NOLINT
+    char tmpl[] = "/tmp/hc_static_XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(tmpl));
+    const std::string root(tmpl);
+
+    // 大文件需要多次 sendfile
+    std::string big(3 * 1024 * 1024 + 17, '\0');
+
+    for (size_t i = 0; i < big.size(); ++i)
+        big[i] = static_cast<char>('a' + i % 26);
+
+    ASSERT_TRUE(happycpp::hcfilesys::writeFile(root + "/big.txt", big));
+    ASSERT_TRUE(happycpp::hcfilesys::writeFile(root + "/index.html", "<html></html>"));
+    ASSERT_TRUE(happycpp::hcfilesys::writeFile(root + "/a b+c.css", "body{}"));
+
+    hhhttp::HttpServer server;
+    server.serveDirectory("/static/", root + "/");
+    server.route("/", echoUrl);
+    server.start();
+
+    auto r = exchange(server.port(),
+                      "GET /static/big.txt HTTP/1.1\r\nHost: t\r\n\r\n"
+                      "GET /static/ HTTP/1.1\r\nHost: t\r\n\r\n"
+                      "GET /static/a%20b+c.css HTTP/1.1\r\nHost: t\r\n\r\n"
+                      "HEAD /static/big.txt HTTP/1.1\r\nHost: t\r\n\r\n"
+                      "GET /static/none HTTP/1.1\r\nHost: t\r\n\r\n"
+                      "GET /static/../etc/passwd HTTP/1.1\r\nHost: t\r\n\r\n"
+                      "GET /static/%2e%2e/x HTTP/1.1\r\nHost: t\r\n\r\n"
+                      "POST /static/index.html HTTP/1.1\r\nHost: t\r\nContent-Length: 0\r\n\r\n"
+                      "GET /x HTTP/1.1\r\nHost: t\r\n\r\n", 9, nullptr,
+                      {false, false, false, true});
+    ASSERT_EQ(9u, r.size());
+    EXPECT_EQ(200u, r[0]->status());
+    EXPECT_TRUE(r[0]->body() == big);
+    EXPECT_EQ("bytes", r[0]->header(hhhttp::HTTP_MRESF_ACCEPT_RANGES));
+    EXPECT_EQ("text/plain; charset=utf-8", r[0]->header(hhhttp::HTTP_MCOMF_CONTENT_TYPE));
+    EXPECT_EQ("<html></html>", r[1]->body());
+    EXPECT_EQ("text/html; charset=utf-8", r[1]->header(hhhttp::HTTP_MCOMF_CONTENT_TYPE));
+    EXPECT_EQ("body{}", r[2]->body());
+    EXPECT_EQ(200u, r[3]->status());
+    EXPECT_EQ(std::to_string(big.size()), r[3]->header(hhhttp::HTTP_MCOMF_CONTENT_LENGTH));
+    EXPECT_TRUE(r[3]->body().empty());
+    EXPECT_EQ(404u, r[4]->status());
+    EXPECT_EQ(404u, r[5]->status());
+    EXPECT_EQ(404u, r[6]->status());
+    EXPECT_EQ(405u, r[7]->status());
+    EXPECT_EQ("GET, HEAD", r[7]->header(hhhttp::HTTP_MRESF_ALLOW));
+    EXPECT_EQ("/x", r[8]->body());
+
+    // 条件请求和范围请求
+    const std::string etag(r[0]->header(hhhttp::HTTP_MRESF_ETAG));
+    const std::string lastModified(r[0]->header(hhhttp::HTTP_MRESF_LAST_MODIFIED));
+    ASSERT_FALSE(etag.empty());
+
+    r = exchange(server.port(),
+                 "GET /static/big.txt HTTP/1.1\r\nHost: t\r\nIf-None-Match: " + etag + "\r\n\r\n"
+                 "GET /static/big.txt HTTP/1.1\r\nHost: t\r\nIf-Modified-Since: " + lastModified + "\r\n\r\n"
+                 "GET /static/big.txt HTTP/1.1\r\nHost: t\r\nRange: bytes=10-19\r\n\r\n"
+                 "GET /static/big.txt HTTP/1.1\r\nHost: t\r\nRange: bytes=0-1,-2\r\n\r\n"
+                 "GET /static/big.txt HTTP/1.1\r\nHost: t\r\nRange: bytes=99999999-\r\n\r\n"
+                 "GET /static/big.txt HTTP/1.1\r\nHost: t\r\nRange: bytes=0-0\r\nIf-Range: \"x\"\r\n\r\n"
+                 "GET /static/index.html HTTP/1.1\r\nHost: t\r\n\r\n", 7);
+    ASSERT_EQ(7u, r.size());
+    EXPECT_EQ(304u, r[0]->status());
+    EXPECT_EQ(etag, r[0]->header(hhhttp::HTTP_MRESF_ETAG));
+    EXPECT_TRUE(r[0]->body().empty());
+    EXPECT_EQ(304u, r[1]->status());
+    EXPECT_EQ(206u, r[2]->status());
+    EXPECT_EQ(big.substr(10, 10), r[2]->body());
+    EXPECT_EQ("bytes 10-19/" + std::to_string(big.size()), r[2]->header(hhhttp::HTTP_MRESF_CONTENT_RANGE));
+    EXPECT_EQ(206u, r[3]->status());
+    EXPECT_EQ(0u, r[3]->header(hhhttp::HTTP_MCOMF_CONTENT_TYPE).find("multipart/byteranges; boundary="));
+    EXPECT_NE(std::string::npos, r[3]->body().find("\r\n\r\nab\r\n--"));
+    EXPECT_NE(std::string::npos, r[3]->body().find("\r\n\r\n" + big.substr(big.size() - 2) + "\r\n--"));
+    EXPECT_EQ(416u, r[4]->status());
+    EXPECT_EQ("bytes */" + std::to_string(big.size()), r[4]->header(hhhttp::HTTP_MRESF_CONTENT_RANGE));
+    EXPECT_EQ(200u, r[5]->status());
+    EXPECT_EQ(big.size(), r[5]->body().size());
+    EXPECT_EQ("<html></html>", r[6]->body());
+
+    server.stop();
+    std::filesystem::remove_all(root);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,197 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/http/sink.h"
+#include "happycpp/exception.h"
+#include <sys/resource.h>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace hhhttp = happycpp::hchttp;
+
+std::string readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// 生成 size 字节的测试数据
+std::string makeData(size_t size) {
+    std::string data(size, '\0');
+
+    for (size_t i = 0; i < size; ++i)
+        data[i] = static_cast<char>('a' + i % 26);
+
+    return data;
+}
+
+TEST(HCHTTP_SINK_UNITTEST, StringSink) { // NOLINT
+    hhhttp::StringSink sink(1024);
+    sink.begin(100);
+    EXPECT_GE(sink.data().capacity(), 100u);
+
+    EXPECT_TRUE(sink.write("hello ", 6));
+    EXPECT_TRUE(sink.write("world", 5));
+    EXPECT_TRUE(sink.finish());
+    EXPECT_EQ("hello world", sink.take());
+    EXPECT_TRUE(sink.data().empty());
+
+    // 预分配不超过上限
+    hhhttp::StringSink limited(16);
+    limited.begin(1LL << 40);
+    EXPECT_LT(limited.data().capacity(), 1024u);
+}
+
+TEST(HCHTTP_SINK_UNITTEST, FileSink) { // NOLINT
+    const std::string path(std::string(_BINARY_DIR_) + "/sink_unittest.dat");
+    // 超过 O_DIRECT 缓冲区大小，并且不对齐
+    const std::string data(makeData(hhhttp::FileSink::kDirectBufferSize * 2 + 12345));
+
+    for (const bool direct : {false, true}) {
+        {
+            hhhttp::FileSink sink(path, direct);
+            // 预分配的长度大于实际长度，finish 时截断
+            sink.begin(static_cast<int64_t>(data.size() + 4096));
+
+            for (size_t pos = 0; pos < data.size(); pos += 1000)
+                EXPECT_TRUE(sink.write(data.data() + pos, std::min<size_t>(1000, data.size() - pos)));
+
+            EXPECT_EQ(data.size(), sink.size());
+            EXPECT_TRUE(sink.finish());
+        }
+
+        EXPECT_EQ(data, readFile(path));
+    }
+
+    // 没有调用 finish(传输中止)，析构时同样截断预分配的部分
+    {
+        hhhttp::FileSink sink(path);
+        sink.begin(static_cast<int64_t>(data.size()));
+        EXPECT_TRUE(sink.write(data.data(), 1000));
+    }
+
+    EXPECT_EQ(data.substr(0, 1000), readFile(path));
+
+    EXPECT_THROW(hhhttp::FileSink("/nonexistent/dir/file"), happycpp::HappyException);
+}
+
+TEST(HCHTTP_SINK_UNITTEST, FileSinkShortWrite) { // NOLINT
+    const std::string path(std::string(_BINARY_DIR_) + "/sink_short_unittest.dat");
+    const size_t bufSize = hhhttp::FileSink::kDirectBufferSize;
+    const std::string data(makeData(bufSize * 3 + 77));
+
+    struct rlimit old{};
+    ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &old));
+    const auto oldHandler = signal(SIGXFSZ, SIG_IGN);
+
+    {
+        hhhttp::FileSink sink(path, true);
+
+        if (!sink.direct()) {
+            signal(SIGXFSZ, oldHandler);
+            GTEST_SKIP() << "O_DIRECT is not supported";
+        }
+
+        // 限制文件大小，写入缓冲区时只能写入一部分，然后失败(EFBIG)
+        struct rlimit limit = old;
+        limit.rlim_cur = bufSize / 2 + 4096;
+        ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+        EXPECT_FALSE(sink.write(data.data(), bufSize));
+        setrlimit(RLIMIT_FSIZE, &old);
+
+        // 短写之后改用普通方式，从中断的位置继续写入
+        EXPECT_FALSE(sink.direct());
+        EXPECT_EQ(bufSize, sink.size());
+        EXPECT_TRUE(sink.write(data.data() + bufSize, data.size() - bufSize));
+        EXPECT_TRUE(sink.finish());
+    }
+
+    signal(SIGXFSZ, oldHandler);
+    EXPECT_EQ(data, readFile(path));
+    remove(path.c_str());
+}
+
+TEST(HCHTTP_SINK_UNITTEST, RingBufferSink) { // NOLINT
+    // 按行处理，不完整的行留在缓冲区中
+    std::vector<std::string> lines;
+    size_t calls = 0;
+
+    hhhttp::RingBufferSink sink(16, [&lines, &calls](std::string_view data) {
+        ++calls;
+        size_t used = 0;
+
+        for (size_t lf; (lf = data.find('\n', used)) != std::string_view::npos; used = lf + 1)
+            lines.emplace_back(data.substr(used, lf - used));
+
+        return used;
+    });
+
+    const std::string text("first\nsecond line\nthird\nx\nlast one\n");
+
+    // 逐字节写入，行会跨越缓冲区末尾
+    for (char c : text)
+        EXPECT_TRUE(sink.write(&c, 1));
+
+    EXPECT_TRUE(sink.finish());
+    EXPECT_EQ((std::vector<std::string>{"first", "second line", "third", "x", "last one"}), lines);
+    EXPECT_LT(calls, text.size());
+
+    // 单行超过缓冲区大小，中止
+    hhhttp::RingBufferSink small(4, [](std::string_view data) -> size_t {
+        return data.find('\n') == std::string_view::npos ? 0 : data.size();
+    });
+
+    EXPECT_FALSE(small.write("0123456789", 10));
+
+    // 剩余数据无法处理
+    hhhttp::RingBufferSink partial(8, [](std::string_view) -> size_t { return 0; });
+    EXPECT_TRUE(partial.write("abc", 3));
+    EXPECT_FALSE(partial.finish());
+}
+
+TEST(HCHTTP_SINK_UNITTEST, HashSink) { // NOLINT
+    auto str = std::make_shared<hhhttp::StringSink>();
+    hhhttp::HashSink sink("sha256", str);
+
+    sink.begin(3);
+    EXPECT_TRUE(sink.write("a", 1));
+    EXPECT_TRUE(sink.write("bc", 2));
+    EXPECT_TRUE(sink.hexDigest().empty());
+    EXPECT_TRUE(sink.finish());
+
+    EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", sink.hexDigest());
+    EXPECT_EQ("abc", str->data());
+
+    hhhttp::HashSink md5("md5");
+    EXPECT_TRUE(md5.finish());
+    EXPECT_EQ("d41d8cd98f00b204e9800998ecf8427e", md5.hexDigest());
+
+    EXPECT_THROW(hhhttp::HashSink("no-such-digest"), happycpp::HappyException);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,284 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/http/static.h"
+#include "happycpp/http/serializer.h"
+#include <string>
+#include <vector>
+
+namespace hhhttp = happycpp::hchttp;
+
+namespace {
+
+    FileStat makeStat() {
+        FileStat fs;
+        fs.type = kFile;
+        fs.name = "a.txt";
+        fs.path = "/srv/a.txt";
+        fs.ext = ".txt";
+        fs.bytes = 1000;
+        fs.atime = 0;
+        fs.ctime = 0;
+        fs.mtime = 784111777;  // Sun, 06 Nov 1994 08:49:37 GMT
+        fs.mtime_nsec = 5;
+        fs.ino = 0x1234;
+        return fs;
+    }
+
+    hhhttp::HttpRequestMsg makeRequest(hhhttp::HttpMethodType method,
+                                       hhhttp::HttpMsgField field = hhhttp::INVALID_HTTP_MSG_FIELD,
+                                       const std::string &value = std::string()) {
+        hhhttp::HttpRequestMsg req;
+        req.setMethod(method);
+        req.setVersion("HTTP/1.1");
+
+        if (field != hhhttp::INVALID_HTTP_MSG_FIELD)
+            req.setField(field, value);
+
+        return req;
+    }
+
+    uint32_t prepare(const hhhttp::HttpRequestMsg &req,
+                     hhhttp::HttpResponseMsg *resp,
+                     std::vector<hhhttp::BodyPart> *parts) {
+        *resp = hhhttp::HttpResponseMsg();
+        hhhttp::prepareFileResponse(req, makeStat(), resp, parts);
+        return resp->status();
+    }
+
+} /* namespace */
+
+TEST(HCHTTP_STATIC_UNITTEST, ETag) { // NOLINT
+    FileStat fs = makeStat();
+    const std::string etag = hhhttp::makeETag(fs);
+    EXPECT_EQ("\"1234-3e8-ae1b981bc490a05\"", etag);
+    EXPECT_EQ("W/" + etag, hhhttp::makeETag(fs, true));
+
+    // 同一秒内修改也会改变 ETag
+    fs.mtime_nsec = 6;
+    EXPECT_NE(etag, hhhttp::makeETag(fs));
+
+    fs = makeStat();
+    fs.bytes = 1001;
+    EXPECT_NE(etag, hhhttp::makeETag(fs));
+}
+
+TEST(HCHTTP_STATIC_UNITTEST, ParseHttpDate) { // NOLINT
+    time_t t = 0;
+    EXPECT_TRUE(hhhttp::parseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT", &t));
+    EXPECT_EQ(784111777, t);
+    t = 0;
+    EXPECT_TRUE(hhhttp::parseHttpDate("Sunday, 06-Nov-94 08:49:37 GMT", &t));
+    EXPECT_EQ(784111777, t);
+    t = 0;
+    EXPECT_TRUE(hhhttp::parseHttpDate("Sun Nov  6 08:49:37 1994", &t));
+    EXPECT_EQ(784111777, t);
+
+    EXPECT_TRUE(hhhttp::parseHttpDate("Thu, 01 Jan 1970 00:00:00 GMT", &t));
+    EXPECT_EQ(0, t);
+    EXPECT_TRUE(hhhttp::parseHttpDate("Tuesday, 29-Feb-00 12:00:00 GMT", &t));
+    EXPECT_EQ(951825600, t);
+    EXPECT_TRUE(hhhttp::parseHttpDate(hhhttp::formatHttpDate(1700000000), &t));
+    EXPECT_EQ(1700000000, t);
+
+    EXPECT_FALSE(hhhttp::parseHttpDate("", &t));
+    EXPECT_FALSE(hhhttp::parseHttpDate("Sun, 06 Nov 1994 08:49:37", &t));
+    EXPECT_FALSE(hhhttp::parseHttpDate("Sun, 06 Xyz 1994 08:49:37 GMT", &t));
+    EXPECT_FALSE(hhhttp::parseHttpDate("Sun, 06 Nov 1994 25:49:37 GMT", &t));
+    EXPECT_FALSE(hhhttp::parseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT ", &t));
+    EXPECT_FALSE(hhhttp::parseHttpDate("\"1234-3e8\"", &t));
+}
+
+TEST(HCHTTP_STATIC_UNITTEST, ParseRange) { // NOLINT
+    std::vector<hhhttp::ByteRange> r;
+
+    EXPECT_EQ(hhhttp::HTTP_RANGE_SATISFIABLE, hhhttp::parseRange("bytes=0-99", 1000, &r));
+    ASSERT_EQ(1u, r.size());
+    EXPECT_EQ(0u, r[0].offset);
+    EXPECT_EQ(100u, r[0].length);
+
+    EXPECT_EQ(hhhttp::HTTP_RANGE_SATISFIABLE, hhhttp::parseRange("bytes=900-", 1000, &r));
+    ASSERT_EQ(1u, r.size());
+    EXPECT_EQ(900u, r[0].offset);
+    EXPECT_EQ(100u, r[0].length);
+
+    EXPECT_EQ(hhhttp::HTTP_RANGE_SATISFIABLE, hhhttp::parseRange("bytes=-2000", 1000, &r));
+    ASSERT_EQ(1u, r.size());
+    EXPECT_EQ(0u, r[0].offset);
+    EXPECT_EQ(1000u, r[0].length);
+
+    EXPECT_EQ(hhhttp::HTTP_RANGE_SATISFIABLE, hhhttp::parseRange("bytes=500-5000", 1000, &r));
+    ASSERT_EQ(1u, r.size());
+    EXPECT_EQ(500u, r[0].length);
+
+    // 排序并合并重叠和相邻的范围
+    EXPECT_EQ(hhhttp::HTTP_RANGE_SATISFIABLE,
+              hhhttp::parseRange("Bytes = 500-599, 0-9, 10-19,550-700, -100, 2000-", 1000, &r));
+    ASSERT_EQ(3u, r.size());
+    EXPECT_EQ(0u, r[0].offset);
+    EXPECT_EQ(20u, r[0].length);
+    EXPECT_EQ(500u, r[1].offset);
+    EXPECT_EQ(201u, r[1].length);
+    EXPECT_EQ(900u, r[2].offset);
+    EXPECT_EQ(100u, r[2].length);
+
+    EXPECT_EQ(hhhttp::HTTP_RANGE_UNSATISFIABLE, hhhttp::parseRange("bytes=1000-", 1000, &r));
+    EXPECT_EQ(hhhttp::HTTP_RANGE_UNSATISFIABLE, hhhttp::parseRange("bytes=-0", 1000, &r));
+    EXPECT_EQ(hhhttp::HTTP_RANGE_UNSATISFIABLE, hhhttp::parseRange("bytes=0-", 0, &r));
+    EXPECT_TRUE(r.empty());
+
+    // 格式错误以及范围太多时忽略
+    EXPECT_EQ(hhhttp::HTTP_RANGE_NONE, hhhttp::parseRange("", 1000, &r));
+    EXPECT_EQ(hhhttp::HTTP_RANGE_NONE, hhhttp::parseRange("items=0-1", 1000, &r));
+    EXPECT_EQ(hhhttp::HTTP_RANGE_NONE, hhhttp::parseRange("bytes=", 1000, &r));
+    EXPECT_EQ(hhhttp::HTTP_RANGE_NONE, hhhttp::parseRange("bytes=5-1", 1000, &r));
+    EXPECT_EQ(hhhttp::HTTP_RANGE_NONE, hhhttp::parseRange("bytes=a-1", 1000, &r));
+    EXPECT_EQ(hhhttp::HTTP_RANGE_NONE, hhhttp::parseRange("bytes=0-1,x", 1000, &r));
+    EXPECT_EQ(hhhttp::HTTP_RANGE_NONE, hhhttp::parseRange("bytes=99999999999999999999-", 1000, &r));
+    EXPECT_EQ(hhhttp::HTTP_RANGE_NONE, hhhttp::parseRange("bytes=0-0,2-2,4-4", 1000, &r, 2));
+    EXPECT_TRUE(r.empty());
+}
+
+TEST(HCHTTP_STATIC_UNITTEST, Conditional) { // NOLINT
+    const std::string etag = hhhttp::makeETag(makeStat());
+    const std::string date = hhhttp::formatHttpDate(makeStat().mtime);
+    const std::string before = hhhttp::formatHttpDate(makeStat().mtime - 1);
+    hhhttp::HttpResponseMsg resp;
+    std::vector<hhhttp::BodyPart> parts;
+
+    EXPECT_EQ(200u, prepare(makeRequest(hhhttp::HTTP_METHOD_GET), &resp, &parts));
+    EXPECT_EQ(etag, resp.header(hhhttp::HTTP_MRESF_ETAG));
+    EXPECT_EQ(date, resp.header(hhhttp::HTTP_MRESF_LAST_MODIFIED));
+    EXPECT_EQ("1000", resp.header(hhhttp::HTTP_MCOMF_CONTENT_LENGTH));
+    EXPECT_EQ("text/plain; charset=utf-8", resp.header(hhhttp::HTTP_MCOMF_CONTENT_TYPE));
+    ASSERT_EQ(1u, parts.size());
+    EXPECT_EQ(1000u, parts[0].size());
+
+    // If-None-Match 使用弱比较
+    EXPECT_EQ(304u, prepare(makeRequest(hhhttp::HTTP_METHOD_GET, hhhttp::HTTP_MREQF_IF_NONE_MATCH,
+                                        "\"x\", W/" + etag), &resp, &parts));
+    EXPECT_TRUE(parts.empty());
+    EXPECT_EQ(304u, prepare(makeRequest(hhhttp::HTTP_METHOD_HEAD, hhhttp::HTTP_MREQF_IF_NONE_MATCH, "*"),
+                            &resp, &parts));
+    EXPECT_EQ(412u, prepare(makeRequest(hhhttp::HTTP_METHOD_POST, hhhttp::HTTP_MREQF_IF_NONE_MATCH, etag),
+                            &resp, &parts));
+    EXPECT_EQ(200u, prepare(makeRequest(hhhttp::HTTP_METHOD_GET, hhhttp::HTTP_MREQF_IF_NONE_MATCH, "\"x\""),
+                            &resp, &parts));
+
+    EXPECT_EQ(304u, prepare(makeRequest(hhhttp::HTTP_METHOD_GET, hhhttp::HTTP_MREQF_IF_MODIFIED_SINCE, date),
+                            &resp, &parts));
+    EXPECT_EQ(200u, prepare(makeRequest(hhhttp::HTTP_METHOD_GET, hhhttp::HTTP_MREQF_IF_MODIFIED_SINCE, before),
+                            &resp, &parts));
+    EXPECT_EQ(200u, prepare(makeRequest(hhhttp::HTTP_METHOD_GET, hhhttp::HTTP_MREQF_IF_MODIFIED_SINCE, "bad"),
+                            &resp, &parts));
+
+    // If-Match 使用强比较
+    EXPECT_EQ(200u, prepare(makeRequest(hhhttp::HTTP_METHOD_GET, hhhttp::HTTP_MREQF_IF_MATCH, etag),
+                            &resp, &parts));
+    EXPECT_EQ(412u, prepare(makeRequest(hhhttp::HTTP_METHOD_GET, hhhttp::HTTP_MREQF_IF_MATCH, "W/" + etag),
+                            &resp, &parts));
+    EXPECT_TRUE(parts.empty());
+    EXPECT_EQ(412u, prepare(makeRequest(hhhttp::HTTP_METHOD_GET, hhhttp::HTTP_MREQF_IF_UNMODIFIED_SINCE, before),
+                            &resp, &parts));
+    EXPECT_EQ(200u, prepare(makeRequest(hhhttp::HTTP_METHOD_GET, hhhttp::HTTP_MREQF_IF_UNMODIFIED_SINCE, date),
+                            &resp, &parts));
+
+    // If-Match 存在时忽略 If-Unmodified-Since
+    auto req = makeRequest(hhhttp::HTTP_METHOD_GET, hhhttp::HTTP_MREQF_IF_MATCH, "*");
+    req.setField(hhhttp::HTTP_MREQF_IF_UNMODIFIED_SINCE, before);
+    EXPECT_EQ(200u, prepare(req, &resp, &parts));
+
+    // If-None-Match 存在时忽略 If-Modified-Since
+    req = makeRequest(hhhttp::HTTP_METHOD_GET, hhhttp::HTTP_MREQF_IF_NONE_MATCH, "\"x\"");
+    req.setField(hhhttp::HTTP_MREQF_IF_MODIFIED_SINCE, date);
+    EXPECT_EQ(200u, prepare(req, &resp, &parts));
+
+    // HEAD 只有消息头
+    EXPECT_EQ(200u, prepare(makeRequest(hhhttp::HTTP_METHOD_HEAD), &resp, &parts));
+    EXPECT_EQ("1000", resp.header(hhhttp::HTTP_MCOMF_CONTENT_LENGTH));
+    EXPECT_TRUE(parts.empty());
+}
+
+TEST(HCHTTP_STATIC_UNITTEST, Range) { // NOLINT
+    const std::string etag = hhhttp::makeETag(makeStat());
+    hhhttp::HttpResponseMsg resp;
+    std::vector<hhhttp::BodyPart> parts;
+
+    EXPECT_EQ(206u, prepare(makeRequest(hhhttp::HTTP_METHOD_GET, hhhttp::HTTP_MREQF_RANGE, "bytes=-10"),
+                            &resp, &parts));
+    EXPECT_EQ("bytes 990-999/1000", resp.header(hhhttp::HTTP_MRESF_CONTENT_RANGE));
+    EXPECT_EQ("10", resp.header(hhhttp::HTTP_MCOMF_CONTENT_LENGTH));
+    ASSERT_EQ(1u, parts.size());
+    EXPECT_TRUE(parts[0].data.empty());
+    EXPECT_EQ(990u, parts[0].offset);
+    EXPECT_EQ(10u, parts[0].length);
+
+    EXPECT_EQ(416u, prepare(makeRequest(hhhttp::HTTP_METHOD_GET, hhhttp::HTTP_MREQF_RANGE, "bytes=1000-"),
+                            &resp, &parts));
+    EXPECT_EQ("bytes */1000", resp.header(hhhttp::HTTP_MRESF_CONTENT_RANGE));
+    EXPECT_TRUE(parts.empty());
+
+    // 只有 GET 处理 Range
+    EXPECT_EQ(200u, prepare(makeRequest(hhhttp::HTTP_METHOD_HEAD, hhhttp::HTTP_MREQF_RANGE, "bytes=0-1"),
+                            &resp, &parts));
+
+    // multipart/byteranges
+    EXPECT_EQ(206u, prepare(makeRequest(hhhttp::HTTP_METHOD_GET, hhhttp::HTTP_MREQF_RANGE, "bytes=0-1,10-19"),
+                            &resp, &parts));
+    const std::string contentType(resp.header(hhhttp::HTTP_MCOMF_CONTENT_TYPE));
+    const std::string prefix("multipart/byteranges; boundary=");
+    ASSERT_EQ(0u, contentType.find(prefix));
+    const std::string boundary = contentType.substr(prefix.size());
+    EXPECT_TRUE(resp.header(hhhttp::HTTP_MRESF_CONTENT_RANGE).empty());
+    ASSERT_EQ(5u, parts.size());
+    EXPECT_EQ("\r\n--" + boundary + "\r\nContent-Type: text/plain; charset=utf-8\r\n"
+              "Content-Range: bytes 0-1/1000\r\n\r\n", parts[0].data);
+    EXPECT_EQ(2u, parts[1].length);
+    EXPECT_EQ(10u, parts[3].offset);
+    EXPECT_EQ(10u, parts[3].length);
+    EXPECT_EQ("\r\n--" + boundary + "--\r\n", parts[4].data);
+
+    uint64_t length = 0;
+
+    for (const auto &p : parts)
+        length += p.size();
+
+    EXPECT_EQ(std::to_string(length), resp.header(hhhttp::HTTP_MCOMF_CONTENT_LENGTH));
+
+    // If-Range 不成立时返回整个文件
+    auto req = makeRequest(hhhttp::HTTP_METHOD_GET, hhhttp::HTTP_MREQF_RANGE, "bytes=0-1");
+    req.setField(hhhttp::HTTP_MREQF_IF_RANGE, etag);
+    EXPECT_EQ(206u, prepare(req, &resp, &parts));
+    req.setField(hhhttp::HTTP_MREQF_IF_RANGE, hhhttp::formatHttpDate(makeStat().mtime));
+    EXPECT_EQ(206u, prepare(req, &resp, &parts));
+    req.setField(hhhttp::HTTP_MREQF_IF_RANGE, "W/" + etag);
+    EXPECT_EQ(200u, prepare(req, &resp, &parts));
+    req.setField(hhhttp::HTTP_MREQF_IF_RANGE, "\"other\"");
+    EXPECT_EQ(200u, prepare(req, &resp, &parts));
+    EXPECT_TRUE(resp.header(hhhttp::HTTP_MRESF_CONTENT_RANGE).empty());
+    req.setField(hhhttp::HTTP_MREQF_IF_RANGE, hhhttp::formatHttpDate(makeStat().mtime + 1));
+    EXPECT_EQ(200u, prepare(req, &resp, &parts));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -20,6 +20,9 @@
 
 #include <gtest/gtest.h>
 #include "happycpp/http.h"
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace hhhttp = happycpp::hchttp;
 
@@ -31,6 +34,107 @@ TEST(HCHTTP_UNITTEST, HcurlDecode) { // NOLINT
 TEST(HCHTTP_UNITTEST, HcurlEncode) { // NOLINT
     EXPECT_EQ("1234%25%5E%265345%2B-+%3Dabc",
               hhhttp::hcurl::encode("1234%^&5345+- =abc"));
+    EXPECT_EQ("", hhhttp::hcurl::encode(""));
+    EXPECT_EQ("%E4%B8%AD%09%0A~._", hhhttp::hcurl::encode("\xE4\xB8\xAD\t\n~._"));
+}
+
+TEST(HCHTTP_UNITTEST, HcurlDecodeInvalid) { // NOLINT
+    // 格式错误的 "%" 原样保留，不会越界读取
+    EXPECT_EQ("abc%", hhhttp::hcurl::decode("abc%"));
+    EXPECT_EQ("abc%4", hhhttp::hcurl::decode("abc%4"));
+    EXPECT_EQ("%zz ", hhhttp::hcurl::decode("%zz+"));
+
+    char out[16];
+    size_t size = 0;
+    EXPECT_TRUE(hhhttp::hcurl::decode("a%41+", out, &size));
+    EXPECT_EQ("aA ", std::string(out, size));
+    EXPECT_FALSE(hhhttp::hcurl::decode("ab%4", out, &size));
+    EXPECT_EQ(2u, size);
+    EXPECT_FALSE(hhhttp::hcurl::decode("%g0", out, &size));
+    EXPECT_EQ(0u, size);
+}
+
+TEST(HCHTTP_UNITTEST, HcurlRoundTrip) { // NOLINT
+    // 逐字节编码，作为 SIMD 实现的参照
+    const auto reference = [](const std::string &s) {
+        static const char hex[] = "0123456789ABCDEF";
+        std::string val;
+
+        for (char c : s) {
+            const auto uc = static_cast<uint8_t>(c);
+
+            if ((uc >= '0' && uc <= '9') || (uc >= 'A' && uc <= 'Z') || (uc >= 'a' && uc <= 'z')
+                || uc == '-' || uc == '.' || uc == '_' || uc == '~') {
+                val.push_back(c);
+            } else if (uc == ' ') {
+                val.push_back('+');
+            } else {
+                val.push_back('%');
+                val.push_back(hex[uc >> 4]);
+                val.push_back(hex[uc & 0x0F]);
+            }
+        }
+
+        return val;
+    };
+
+    uint32_t seed = 12345;
+    const auto next = [&seed]() {
+        seed = seed * 1103515245 + 12345;
+        return static_cast<uint8_t>(seed >> 16);
+    };
+
+    // 长度覆盖 SIMD 整块和尾部，内容从大部分不需要编码到全部需要编码
+    for (size_t len = 0; len < 200; ++len) {
+        for (const uint8_t density : {0, 8, 64, 255}) {
+            std::string s(len, 'a');
+
+            for (auto &c : s) {
+                if (next() < density)
+                    c = static_cast<char>(next());
+                else
+                    c = static_cast<char>('a' + next() % 26);
+            }
+
+            const std::string encoded(hhhttp::hcurl::encode(s));
+            EXPECT_EQ(reference(s), encoded);
+            EXPECT_EQ(s, hhhttp::hcurl::decode(encoded));
+
+            std::vector<char> out(encoded.size());
+            size_t size = 0;
+            EXPECT_TRUE(hhhttp::hcurl::decode(encoded, out.data(), &size));
+            EXPECT_EQ(s, std::string(out.data(), size));
+        }
+    }
+}
+
+TEST(HCHTTP_UNITTEST, ToHm) { // NOLINT
+    EXPECT_EQ(hhhttp::HTTP_METHOD_GET, hhhttp::HttpMessage::toHm("GET"));
+    EXPECT_EQ(hhhttp::HTTP_METHOD_CONNECT, hhhttp::HttpMessage::toHm("CONNECT"));
+    EXPECT_EQ(hhhttp::INVALID_HTTP_METHOD, hhhttp::HttpMessage::toHm("get"));
+    EXPECT_EQ(hhhttp::INVALID_HTTP_METHOD, hhhttp::HttpMessage::toHm(""));
+    EXPECT_EQ("DELETE", hhhttp::HttpMessage::toName(hhhttp::HTTP_METHOD_DELETE));
+    EXPECT_EQ("", hhhttp::HttpMessage::toName(hhhttp::INVALID_HTTP_METHOD));
+}
+
+TEST(HCHTTP_UNITTEST, ToHmf) { // NOLINT
+    EXPECT_EQ(hhhttp::HTTP_MCOMF_CONTENT_LENGTH, hhhttp::HttpMessage::toHmf("Content-Length"));
+    EXPECT_EQ(hhhttp::HTTP_MCOMF_CONTENT_LENGTH, hhhttp::HttpMessage::toHmf("content-length"));
+    EXPECT_EQ(hhhttp::HTTP_MRESF_ETAG, hhhttp::HttpMessage::toHmf("ETAG"));
+    EXPECT_EQ(hhhttp::HTTP_MREQF_TE, hhhttp::HttpMessage::toHmf("te"));
+    EXPECT_EQ(hhhttp::INVALID_HTTP_MSG_FIELD, hhhttp::HttpMessage::toHmf(""));
+    EXPECT_EQ(hhhttp::INVALID_HTTP_MSG_FIELD, hhhttp::HttpMessage::toHmf("Content-Lengthx"));
+    EXPECT_EQ(hhhttp::INVALID_HTTP_MSG_FIELD, hhhttp::HttpMessage::toHmf("X-Unknown"));
+    EXPECT_EQ("", hhhttp::HttpMessage::toName(hhhttp::INVALID_HTTP_MSG_FIELD));
+
+    // 所有字段都可以双向转换
+    for (int32_t i = 0; i <= hhhttp::HTTP_MRESF_NONSTD_X_CONTENT_DURATION; ++i) {
+        const auto hmf = static_cast<hhhttp::HttpMsgField>(i);
+        const std::string_view name(hhhttp::HttpMessage::toName(hmf));
+
+        EXPECT_FALSE(name.empty());
+        EXPECT_EQ(hmf, hhhttp::HttpMessage::toHmf(name));
+    }
 }
 
 TEST(HCHTTP_UNITTEST, ParseHttpMsgRequest) { // NOLINT
@@ -64,6 +168,35 @@ TEST(HCHTTP_UNITTEST, ParseHttpMsgRequest) { // NOLINT
     EXPECT_EQ("hello world\n", hm->body());
 }
 
+TEST(HCHTTP_UNITTEST, RequestArgsConcurrent) { // NOLINT
+    hhhttp::HttpRequestMsg req;
+    req.setRequestUrl("/index?a=1%202&b=%E4%B8%AD");
+
+    // 多个线程同时第一次读取同一个请求的 args()
+    const hhhttp::HttpRequestMsg &shared = req;
+    std::vector<std::thread> threads;
+    std::vector<std::string> results(4);
+
+    for (size_t i = 0; i < results.size(); ++i)
+        threads.emplace_back([&shared, &results, i] { results[i] = shared.args(); });
+
+    for (std::thread &t : threads)
+        t.join();
+
+    for (const std::string &r : results)
+        EXPECT_EQ("a=1 2&b=\xE4\xB8\xAD", r);
+
+    // 复制的请求保留已经解码的结果，修改请求路径之后重新解码
+    hhhttp::HttpRequestMsg copy(req);
+    EXPECT_EQ("a=1 2&b=\xE4\xB8\xAD", copy.args());
+    copy.setRequestUrl("/index?c=3");
+    EXPECT_EQ("c=3", copy.args());
+    EXPECT_EQ("a=1 2&b=\xE4\xB8\xAD", req.args());
+
+    req = copy;
+    EXPECT_EQ("c=3", req.args());
+}
+
 TEST(HCHTTP_UNITTEST, ParseHttpMsgResponse) { // NOLINT
     const std::string http("HTTP/1.1 416 Requested Range Not Satisfiable\r\n"
                            "Server: nginx/1.8.0\r\n"
@@ -94,6 +227,106 @@ TEST(HCHTTP_UNITTEST, ParseHttpMsgResponse) { // NOLINT
     EXPECT_EQ("", hm->body());
 }
 
+TEST(HCHTTP_UNITTEST, ParseHttpMsgRepeatedFields) { // NOLINT
+    const std::string http("HTTP/1.1 200 OK\r\n"
+                           "Set-Cookie: a=1\r\n"
+                           "set-cookie: b=2\r\n"
+                           "X-Request-Id: 42\r\n"
+                           "Content-Length: 0\r\n"
+                           "\r\n");
+
+    hhhttp::HttpMsgCtx ctx;
+    hhhttp::HttpResponseMsgPtr hm =
+            std::dynamic_pointer_cast<hhhttp::HttpResponseMsg>(ctx.parse(http));
+
+    ASSERT_NE(nullptr, hm);
+    EXPECT_EQ("a=1", hm->header(hhhttp::HTTP_MRESF_SET_COOKIE));
+
+    std::vector<std::string_view> cookies;
+    hm->headers(hhhttp::HTTP_MRESF_SET_COOKIE, &cookies);
+    ASSERT_EQ(2U, cookies.size());
+    EXPECT_EQ("a=1", cookies[0]);
+    EXPECT_EQ("b=2", cookies[1]);
+
+    EXPECT_EQ("42", hm->header("x-request-id"));
+    EXPECT_EQ("0", hm->header("CONTENT-LENGTH"));
+    EXPECT_EQ("", hm->header("X-Missing"));
+
+    size_t count = 0;
+    hm->forEachField([&count](std::string_view name, std::string_view value) {
+        ++count;
+    });
+    EXPECT_EQ(4U, count);
+
+    hm->setField(hhhttp::HTTP_MRESF_SET_COOKIE, "c=3");
+    hm->headers(hhhttp::HTTP_MRESF_SET_COOKIE, &cookies);
+    ASSERT_EQ(1U, cookies.size());
+    EXPECT_EQ("c=3", cookies[0]);
+
+    std::map<hhhttp::HttpMsgField, std::string> fields;
+    hm->header(&fields);
+    EXPECT_EQ(2U, fields.size());
+    EXPECT_EQ("c=3", fields[hhhttp::HTTP_MRESF_SET_COOKIE]);
+}
+
+TEST(HCHTTP_UNITTEST, ParseHttpMsgMalformedLines) { // NOLINT
+    // 没有冒号的行和 obs-fold 续行被跳过，后面的字段和消息体照常解析
+    const std::string http("HTTP/1.1 200 OK\r\n"
+                           "Content-Type: text/html\r\n"
+                           "this line has no colon\r\n"
+                           "X-Folded: a\r\n"
+                           " b\r\n"
+                           "Server: test\r\n"
+                           "\r\n"
+                           "<html></html>");
+
+    hhhttp::HttpMsgCtx ctx;
+    hhhttp::HttpResponseMsgPtr hm =
+            std::dynamic_pointer_cast<hhhttp::HttpResponseMsg>(ctx.parse(http));
+
+    ASSERT_NE(nullptr, hm);
+    EXPECT_EQ(200U, hm->status());
+    EXPECT_EQ("text/html", hm->header(hhhttp::HTTP_MCOMF_CONTENT_TYPE));
+    EXPECT_EQ("a", hm->header("X-Folded"));
+    EXPECT_EQ("test", hm->header(hhhttp::HTTP_MRESF_SERVER));
+    EXPECT_EQ("<html></html>", hm->body());
+
+    // 不规范的状态行(没有原因简述)
+    const std::string http2("HTTP/1.1 204\r\n"
+                            "Server: test\r\n"
+                            "X-Padding: 0123456789\r\n"
+                            "\r\n"
+                            "body");
+
+    hm = std::dynamic_pointer_cast<hhhttp::HttpResponseMsg>(ctx.parse(http2));
+
+    ASSERT_NE(nullptr, hm);
+    EXPECT_EQ(204U, hm->status());
+    EXPECT_EQ("", hm->reasonPhrase());
+    EXPECT_EQ("test", hm->header(hhhttp::HTTP_MRESF_SERVER));
+    EXPECT_EQ("body", hm->body());
+}
+
+TEST(HCHTTP_UNITTEST, ParseHttpMsgUnknownFields) { // NOLINT
+    // 未知名称的字段保留，只能按名称读取
+    const std::string http("GET /index HTTP/1.1\r\n"
+                           "Host: localhost\r\n"
+                           "X-Custom-Header: custom\r\n"
+                           "\r\n");
+
+    hhhttp::HttpMsgCtx ctx;
+    hhhttp::HttpRequestMsgPtr hm =
+            std::dynamic_pointer_cast<hhhttp::HttpRequestMsg>(ctx.parse(http));
+
+    ASSERT_NE(nullptr, hm);
+    EXPECT_EQ("custom", hm->header("x-custom-header"));
+
+    std::map<hhhttp::HttpMsgField, std::string> fields;
+    hm->header(&fields);
+    EXPECT_EQ(1U, fields.size());
+    EXPECT_EQ("localhost", fields[hhhttp::HTTP_MREQF_HOST]);
+}
+
 TEST(HCHTTP_UNITTEST, GetHeaderInfo) { // NOLINT
     hhhttp::HttpResponseMsgPtr hm =
             hhhttp::getHeaderInfo("http://127.0.0.1:8887");
@@ -0,0 +1,156 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/linux.h"
+#include <pthread.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace hccpu = happycpp::hclinux::hccpu;
+namespace hcprocfs = happycpp::hclinux::hcprocfs;
+
+namespace {
+
+    hcprocfs::CpuStat cpuStat(uint64_t user, uint64_t system, uint64_t idle, uint64_t iowait,
+                              uint64_t steal) {
+        hcprocfs::CpuStat stat{};
+        stat.user = user;
+        stat.system = system;
+        stat.idle = idle;
+        stat.iowait = iowait;
+        stat.steal = steal;
+        return stat;
+    }
+
+    void spin(std::chrono::milliseconds duration) {
+        const auto end = std::chrono::steady_clock::now() + duration;
+        volatile uint64_t n = 0;
+
+        while (std::chrono::steady_clock::now() < end)
+            n = n + 1;
+    }
+
+} /* namespace */
+
+TEST(HCLINUX_CPU_UNITTEST, Breakdown) { // NOLINT
+    const hcprocfs::CpuStat before[] = {cpuStat(100, 50, 1000, 10, 0),
+                                        cpuStat(0, 0, 0, 0, 0),
+                                        cpuStat(500, 0, 0, 0, 0)};
+    const hcprocfs::CpuStat after[] = {cpuStat(160, 70, 1100, 20, 10),
+                                       cpuStat(0, 0, 0, 0, 0),
+                                       cpuStat(400, 0, 100, 0, 0)};
+    hccpu::CpuBreakdown out[3];
+
+    hccpu::cpuBreakdown(before, after, 3, out);
+
+    // 60 + 20 + 100 + 10 + 10 = 200
+    EXPECT_DOUBLE_EQ(30, out[0].user);
+    EXPECT_DOUBLE_EQ(10, out[0].system);
+    EXPECT_DOUBLE_EQ(50, out[0].idle);
+    EXPECT_DOUBLE_EQ(5, out[0].iowait);
+    EXPECT_DOUBLE_EQ(5, out[0].steal);
+    EXPECT_DOUBLE_EQ(45, out[0].busy);
+
+    // 没有时间变化
+    EXPECT_DOUBLE_EQ(0, out[1].busy);
+    EXPECT_DOUBLE_EQ(0, out[1].idle);
+
+    // user 计数器减小按 0 处理
+    EXPECT_DOUBLE_EQ(0, out[2].user);
+    EXPECT_DOUBLE_EQ(100, out[2].idle);
+}
+
+TEST(HCLINUX_CPU_UNITTEST, Cores) { // NOLINT
+    hccpu::CpuAccounting accounting;
+    std::vector<hccpu::CpuBreakdown> cores;
+    hccpu::CpuBreakdown total{};
+
+    ASSERT_TRUE(accounting.sampleCores(&cores, &total));
+    ASSERT_FALSE(cores.empty());
+
+    spin(std::chrono::milliseconds(50));
+    ASSERT_TRUE(accounting.sampleCores(&cores, &total));
+
+    for (const hccpu::CpuBreakdown &core : cores) {
+        const double sum = core.user + core.nice + core.system + core.idle + core.iowait +
+                           core.irq + core.softirq + core.steal;
+        EXPECT_TRUE(sum == 0 || std::abs(sum - 100) < 1e-6);
+    }
+
+    EXPECT_GT(total.busy, 0);
+    EXPECT_LE(total.busy, 100.0 + 1e-6);
+}
+
+TEST(HCLINUX_CPU_UNITTEST, HotThread) { // NOLINT
+    std::atomic<bool> stop(false);
+    std::atomic<pid_t> hotTid(0);
+
+    std::thread hot([&] {
+        pthread_setname_np(pthread_self(), "hc_hot");
+        hotTid.store(static_cast<pid_t>(gettid()));
+
+        while (!stop.load())
+            spin(std::chrono::milliseconds(1));
+    });
+
+    while (hotTid.load() == 0)
+        std::this_thread::yield();
+
+    hccpu::CpuAccounting accounting;
+    std::vector<hccpu::TaskUsage> threads;
+
+    ASSERT_TRUE(accounting.sampleThreads(getpid(), &threads));
+    ASSERT_GE(threads.size(), 2u);
+
+    // 第一次采样没有使用率
+    for (const hccpu::TaskUsage &t : threads)
+        EXPECT_EQ(0, t.total);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    ASSERT_TRUE(accounting.sampleThreads(getpid(), &threads));
+    stop.store(true);
+    hot.join();
+
+    const auto it = std::find_if(threads.begin(), threads.end(), [&](const hccpu::TaskUsage &t) {
+        return t.id == hotTid.load();
+    });
+    ASSERT_NE(threads.end(), it);
+    EXPECT_STREQ("hc_hot", it->comm);
+    EXPECT_GT(it->total, 20);
+    EXPECT_DOUBLE_EQ(it->user + it->system, it->total);
+
+    std::vector<hccpu::TaskUsage> processes;
+    ASSERT_TRUE(accounting.sampleProcesses(&processes));
+    EXPECT_TRUE(std::any_of(processes.begin(), processes.end(), [](const hccpu::TaskUsage &t) {
+        return t.id == getpid();
+    }));
+
+    EXPECT_FALSE(accounting.sampleThreads(-1, &threads));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,179 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/linux.h"
+#include "happycpp/linux/metrics.h"
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace hcmetrics = happycpp::hclinux::hcmetrics;
+
+namespace {
+
+    hcmetrics::MetricsSamplerOptions fastOptions() {
+        hcmetrics::MetricsSamplerOptions options;
+        options.interval = std::chrono::milliseconds(20);
+        options.windows = {std::chrono::milliseconds(20), std::chrono::milliseconds(200),
+                           std::chrono::milliseconds(2000)};
+        return options;
+    }
+
+    bool inPercentRange(const hcmetrics::MetricValue &v) {
+        if (v.last < 0 || v.last > 100)
+            return false;
+
+        for (double avg : v.ewma) {
+            if (avg < 0 || avg > 100)
+                return false;
+        }
+
+        return true;
+    }
+
+} /* namespace */
+
+TEST(HCLINUX_METRICS_UNITTEST, Snapshot) { // NOLINT
+    hcmetrics::MetricsSampler sampler(fastOptions());
+    hcmetrics::MetricsSnapshot snap{};
+
+    // 构造函数已经采样一次
+    ASSERT_TRUE(sampler.snapshot(&snap));
+    EXPECT_GE(snap.samples, 1u);
+    EXPECT_GT(snap.mem.memTotal, 0u);
+    EXPECT_TRUE(inPercentRange(snap.memUsed));
+
+    while (snap.samples < 3) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ASSERT_TRUE(sampler.snapshot(&snap));
+    }
+
+    EXPECT_TRUE(inPercentRange(snap.cpuUsed));
+    EXPECT_TRUE(inPercentRange(snap.cpuIowait));
+    EXPECT_TRUE(inPercentRange(snap.swapUsed));
+
+    const hcmetrics::IfaceMetrics *lo = snap.iface("lo");
+    ASSERT_NE(nullptr, lo);
+    EXPECT_GE(lo->samples, 2u);
+    EXPECT_GE(lo->rxBytesRate.last, 0);
+    EXPECT_EQ(nullptr, snap.iface("happycpp0"));
+}
+
+TEST(HCLINUX_METRICS_UNITTEST, SampleNowAndEwma) { // NOLINT
+    hcmetrics::MetricsSamplerOptions options;
+    options.interval = std::chrono::hours(1);
+    options.netDev = false;
+
+    hcmetrics::MetricsSampler sampler(options);
+    hcmetrics::MetricsSnapshot before{};
+    hcmetrics::MetricsSnapshot after{};
+
+    ASSERT_TRUE(sampler.snapshot(&before));
+    EXPECT_EQ(1u, before.samples);
+    EXPECT_EQ(0u, before.ifaceCount);
+
+    // 内存使用率是瞬时值，第一次采样时移动平均等于当前值
+    EXPECT_DOUBLE_EQ(before.memUsed.last, before.memUsed.ewma[0]);
+    EXPECT_DOUBLE_EQ(before.memUsed.last, before.memUsed.ewma[2]);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_TRUE(sampler.sampleNow());
+    ASSERT_TRUE(sampler.snapshot(&after));
+    EXPECT_EQ(2u, after.samples);
+    EXPECT_GT(after.timestampNs, before.timestampNs);
+
+    // 第一次得到 cpu 使用率时，移动平均等于当前值
+    EXPECT_DOUBLE_EQ(after.cpuUsed.last, after.cpuUsed.ewma[0]);
+    EXPECT_DOUBLE_EQ(after.cpuUsed.last, after.cpuUsed.ewma[2]);
+}
+
+TEST(HCLINUX_METRICS_UNITTEST, ConcurrentReaders) { // NOLINT
+    hcmetrics::MetricsSampler sampler(fastOptions());
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> reads(0);
+    std::vector<std::thread> readers;
+
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            hcmetrics::MetricsSnapshot snap{};
+            uint64_t lastSamples = 0;
+
+            while (!stop.load()) {
+                ASSERT_TRUE(sampler.snapshot(&snap));
+                // 快照不会被撕裂：采样次数不回退，总内存在整个测试中不变
+                ASSERT_GE(snap.samples, lastSamples);
+                ASSERT_GT(snap.mem.memTotal, 0u);
+                ASSERT_TRUE(inPercentRange(snap.cpuUsed));
+                lastSamples = snap.samples;
+                reads.fetch_add(1);
+            }
+        });
+    }
+
+    for (int i = 0; i < 50; ++i)
+        sampler.sampleNow();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    stop.store(true);
+
+    for (auto &t : readers)
+        t.join();
+
+    EXPECT_GT(reads.load(), 0u);
+}
+
+TEST(HCLINUX_METRICS_UNITTEST, GetCpuUtil) { // NOLINT
+    happycpp::hclinux::hccpu::CpuUtil util{};
+    happycpp::hclinux::hccpu::getCpuUtil(&util);
+    EXPECT_GE(util.used, 0);
+    EXPECT_LE(util.used, 100);
+    EXPECT_NEAR(100, util.used + util.idle, 0.2);
+}
+
+TEST(HCLINUX_METRICS_UNITTEST, GlobalSnapshot) { // NOLINT
+    hcmetrics::MetricsSnapshot snap;
+
+    // getCpuUtil 不启动后台线程
+    EXPECT_FALSE(hcmetrics::MetricsSampler::globalSnapshot(&snap));
+
+    hcmetrics::MetricsSampler::global();
+    EXPECT_TRUE(hcmetrics::MetricsSampler::globalSnapshot(&snap));
+
+    // fork 之后的子进程没有后台线程，不使用父进程的快照
+    const pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+
+    if (pid == 0)
+        _exit(hcmetrics::MetricsSampler::globalSnapshot(&snap) ? 1 : 0);
+
+    int status = 0;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
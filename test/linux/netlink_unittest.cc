@@ -0,0 +1,410 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/linux.h"
+#include "happycpp/linux/netlink.h"
+#include <arpa/inet.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace hcnet = happycpp::hclinux::hcnet;
+namespace hcnetlink = happycpp::hclinux::hcnetlink;
+
+namespace {
+
+    //! 构造 rtnetlink 消息
+    class MsgBuilder {
+    public:
+        template<typename Header>
+        MsgBuilder(uint16_t type, const Header &header)
+                : buf_(NLMSG_SPACE(sizeof(Header)), 0) {
+            msg()->nlmsg_type = type;
+            std::memcpy(NLMSG_DATA(msg()), &header, sizeof(Header));
+            msg()->nlmsg_len = static_cast<uint32_t>(buf_.size());
+        }
+
+        MsgBuilder &attr(uint16_t type, const void *data, size_t size) {
+            const size_t offset = buf_.size();
+            buf_.resize(offset + RTA_SPACE(size), 0);
+
+            auto *rta = reinterpret_cast<struct rtattr *>(buf_.data() + offset);
+            rta->rta_type = type;
+            rta->rta_len = static_cast<uint16_t>(RTA_LENGTH(size));
+            std::memcpy(RTA_DATA(rta), data, size);
+            msg()->nlmsg_len = static_cast<uint32_t>(buf_.size());
+            return *this;
+        }
+
+        MsgBuilder &attr(uint16_t type, const std::string &s) {
+            return attr(type, s.c_str(), s.size() + 1);
+        }
+
+        MsgBuilder &addr(uint16_t type, int family, const char *text) {
+            unsigned char bytes[16];
+            inet_pton(family, text, bytes);
+            return attr(type, bytes, family == AF_INET ? 4 : 16);
+        }
+
+        template<typename T>
+        MsgBuilder &value(uint16_t type, T v) {
+            return attr(type, &v, sizeof(v));
+        }
+
+        nlmsghdr *msg() {
+            return reinterpret_cast<nlmsghdr *>(buf_.data());
+        }
+
+    private:
+        std::vector<char> buf_;
+    };
+
+    hcnetlink::LinkInfo link(int32_t index, const std::string &name, uint32_t flags,
+                             const std::string &mac) {
+        return hcnetlink::LinkInfo{index, flags, 1500, name, mac};
+    }
+
+    hcnetlink::AddrInfo addr(int32_t index, const char *ip, uint8_t prefix, const std::string &label) {
+        hcnetlink::AddrInfo a{};
+        a.index = index;
+        a.prefixLen = prefix;
+        a.label = label;
+        EXPECT_TRUE(hcnetlink::parseIpAddr(ip, &a.address));
+        return a;
+    }
+
+    hcnetlink::RouteInfo defaultRoute(const char *gateway, uint32_t priority, uint32_t table) {
+        hcnetlink::RouteInfo r{};
+        r.family = AF_INET;
+        r.type = RTN_UNICAST;
+        r.table = table;
+        r.priority = priority;
+        r.oif = 2;
+        EXPECT_TRUE(hcnetlink::parseIpAddr(gateway, &r.gateway));
+        return r;
+    }
+
+    hcnetlink::RouteInfo route(const char *dst, uint8_t dstLen, int32_t oif, uint32_t priority) {
+        hcnetlink::RouteInfo r{};
+        EXPECT_TRUE(hcnetlink::parseIpAddr(dst, &r.dst));
+        r.family = r.dst.family;
+        r.dstLen = dstLen;
+        r.type = RTN_UNICAST;
+        r.table = RT_TABLE_MAIN;
+        r.priority = priority;
+        r.oif = oif;
+        return r;
+    }
+
+} /* namespace */
+
+TEST(HCLINUX_NETLINK_UNITTEST, IpAddr) { // NOLINT
+    hcnetlink::IpAddr a{};
+    hcnetlink::IpAddr b{};
+
+    ASSERT_TRUE(hcnetlink::parseIpAddr("192.168.1.10", &a));
+    EXPECT_EQ(AF_INET, a.family);
+    EXPECT_EQ(4u, a.size());
+    EXPECT_EQ("192.168.1.10", a.toString());
+
+    ASSERT_TRUE(hcnetlink::parseIpAddr("2001:DB8::0:1", &b));
+    EXPECT_EQ(16u, b.size());
+    EXPECT_EQ("2001:db8::1", b.toString());
+    EXPECT_FALSE(a == b);
+
+    EXPECT_FALSE(hcnetlink::parseIpAddr("192.168.1", &a));
+    EXPECT_FALSE(hcnetlink::parseIpAddr("", &a));
+    EXPECT_EQ("", hcnetlink::IpAddr{}.toString());
+
+    EXPECT_EQ("0.0.0.0", hcnetlink::prefixToNetmask(0));
+    EXPECT_EQ("255.255.255.0", hcnetlink::prefixToNetmask(24));
+    EXPECT_EQ("255.255.240.0", hcnetlink::prefixToNetmask(20));
+    EXPECT_EQ("255.255.255.255", hcnetlink::prefixToNetmask(32));
+}
+
+TEST(HCLINUX_NETLINK_UNITTEST, ParseMessages) { // NOLINT
+    struct ifinfomsg ifi{};
+    ifi.ifi_index = 3;
+    ifi.ifi_flags = IFF_UP;
+    const unsigned char mac[6] = {0x52, 0x54, 0x00, 0xab, 0x0c, 0xde};
+
+    MsgBuilder linkMsg(RTM_NEWLINK, ifi);
+    linkMsg.attr(IFLA_IFNAME, "veth1234").attr(IFLA_ADDRESS, mac, sizeof(mac)).value<uint32_t>(IFLA_MTU, 9000);
+
+    hcnetlink::LinkInfo l;
+    ASSERT_TRUE(hcnetlink::parseLink(linkMsg.msg(), &l));
+    EXPECT_EQ(3, l.index);
+    EXPECT_EQ("veth1234", l.name);
+    EXPECT_EQ("52:54:00:AB:0C:DE", l.mac);
+    EXPECT_EQ(9000u, l.mtu);
+    EXPECT_TRUE(l.flags & IFF_UP);
+
+    // 点对点网卡：IFA_ADDRESS 为对端地址
+    struct ifaddrmsg ifa{};
+    ifa.ifa_family = AF_INET;
+    ifa.ifa_prefixlen = 32;
+    ifa.ifa_index = 3;
+    MsgBuilder addrMsg(RTM_NEWADDR, ifa);
+    addrMsg.addr(IFA_ADDRESS, AF_INET, "10.0.0.2").addr(IFA_LOCAL, AF_INET, "10.0.0.1").attr(IFA_LABEL, "ppp0");
+
+    hcnetlink::AddrInfo a;
+    ASSERT_TRUE(hcnetlink::parseAddr(addrMsg.msg(), &a));
+    EXPECT_EQ("10.0.0.1", a.address.toString());
+    EXPECT_EQ("ppp0", a.label);
+    EXPECT_EQ(32, a.prefixLen);
+
+    ifa.ifa_family = AF_INET6;
+    ifa.ifa_prefixlen = 64;
+    MsgBuilder addr6Msg(RTM_NEWADDR, ifa);
+    addr6Msg.addr(IFA_ADDRESS, AF_INET6, "fe80::1");
+    ASSERT_TRUE(hcnetlink::parseAddr(addr6Msg.msg(), &a));
+    EXPECT_EQ("fe80::1", a.address.toString());
+    EXPECT_TRUE(a.label.empty());
+
+    struct rtmsg rtm{};
+    rtm.rtm_family = AF_INET;
+    rtm.rtm_dst_len = 16;
+    rtm.rtm_table = RT_TABLE_MAIN;
+    rtm.rtm_type = RTN_UNICAST;
+    MsgBuilder routeMsg(RTM_NEWROUTE, rtm);
+    routeMsg.addr(RTA_DST, AF_INET, "172.16.0.0").addr(RTA_GATEWAY, AF_INET, "10.0.0.254")
+            .value<int32_t>(RTA_OIF, 3).value<uint32_t>(RTA_PRIORITY, 100);
+
+    hcnetlink::RouteInfo r{};
+    ASSERT_TRUE(hcnetlink::parseRoute(routeMsg.msg(), &r));
+    EXPECT_EQ("172.16.0.0", r.dst.toString());
+    EXPECT_EQ(16, r.dstLen);
+    EXPECT_EQ("10.0.0.254", r.gateway.toString());
+    EXPECT_EQ(3, r.oif);
+    EXPECT_EQ(100u, r.priority);
+    EXPECT_EQ(static_cast<uint32_t>(RT_TABLE_MAIN), r.table);
+
+    // 多路径路由取第一个下一跳
+    std::vector<char> nexthops(RTNH_SPACE(RTA_SPACE(4)), 0);
+    auto *nh = reinterpret_cast<struct rtnexthop *>(nexthops.data());
+    nh->rtnh_len = static_cast<uint16_t>(nexthops.size());
+    nh->rtnh_ifindex = 7;
+    auto *gw = reinterpret_cast<struct rtattr *>(nexthops.data() + RTNH_LENGTH(0));
+    gw->rta_type = RTA_GATEWAY;
+    gw->rta_len = RTA_LENGTH(4);
+    inet_pton(AF_INET, "10.9.9.9", RTA_DATA(gw));
+
+    rtm.rtm_dst_len = 0;
+    MsgBuilder multipathMsg(RTM_NEWROUTE, rtm);
+    multipathMsg.attr(RTA_MULTIPATH, nexthops.data(), nexthops.size());
+    ASSERT_TRUE(hcnetlink::parseRoute(multipathMsg.msg(), &r));
+    EXPECT_EQ(7, r.oif);
+    EXPECT_EQ("10.9.9.9", r.gateway.toString());
+    EXPECT_EQ(AF_UNSPEC, r.dst.family);
+
+    // 类型不匹配
+    EXPECT_FALSE(hcnetlink::parseLink(addrMsg.msg(), &l));
+    EXPECT_FALSE(hcnetlink::parseRoute(linkMsg.msg(), &r));
+}
+
+TEST(HCLINUX_NETLINK_UNITTEST, FillIfaceList) { // NOLINT
+    hcnetlink::NetlinkDump dump;
+    dump.links = {link(1, "lo", IFF_LOOPBACK | IFF_UP, "00:00:00:00:00:00"),
+                  link(2, "eth0", IFF_UP, "52:54:00:12:34:56"),
+                  link(3, "eth1", IFF_UP, "52:54:00:12:34:57")};
+    dump.addrs = {addr(1, "127.0.0.1", 8, "lo"),
+                  addr(2, "192.168.1.10", 24, "eth0"),
+                  addr(2, "192.168.1.11", 24, "eth0:0"),
+                  addr(2, "192.168.1.12", 24, "eth0"),
+                  addr(3, "10.1.0.5", 16, "eth1"),
+                  addr(2, "fe80::5054:ff:fe12:3456", 64, ""),
+                  addr(1, "::1", 128, "")};
+    dump.routes = {defaultRoute("192.168.1.254", 200, RT_TABLE_MAIN),
+                   defaultRoute("192.168.1.1", 100, RT_TABLE_MAIN),
+                   defaultRoute("10.1.0.1", 0, 100)};
+
+    hcnet::IfaceList list;
+    hcnet::fillIfaceList(dump, &list);
+
+    ASSERT_EQ(4u, list.size());
+    EXPECT_EQ("eth0", list[0].name_);
+    EXPECT_EQ("192.168.1.10", list[0].ip_addr_);
+    EXPECT_EQ("255.255.255.0", list[0].netmask_);
+    EXPECT_EQ("52:54:00:12:34:56", list[0].mac_);
+    EXPECT_EQ(2, list[0].index_);
+    ASSERT_EQ(1u, list[0].ip6_addrs_.size());
+    EXPECT_EQ("fe80::5054:ff:fe12:3456", list[0].ip6_addrs_[0]);
+
+    EXPECT_EQ("eth0:0", list[1].name_);
+    EXPECT_TRUE(list[1].ip6_addrs_.empty());
+
+    // 没有标签的第二个地址，跳过已经存在的 eth0:0
+    EXPECT_EQ("eth0:1", list[2].name_);
+    EXPECT_EQ("192.168.1.12", list[2].ip_addr_);
+
+    EXPECT_EQ("eth1", list[3].name_);
+    EXPECT_EQ("255.255.0.0", list[3].netmask_);
+
+    // 主路由表中 metric 最小的默认网关
+    for (const hcnet::Iface &iface : list)
+        EXPECT_EQ("192.168.1.1", iface.gateway_);
+
+    hcnet::IfaceList none;
+    dump.routes.clear();
+    hcnet::fillIfaceList(dump, &none);
+    EXPECT_EQ("0.0.0.0", none.front().gateway_);
+}
+
+TEST(HCLINUX_NETLINK_UNITTEST, ParseResolvConf) { // NOLINT
+    std::string dns1;
+    std::string dns2;
+
+    // 多个空白、行尾的 \r 和注释
+    hcnet::parseResolvConf("# generated\r\n"
+                           "nameserver  8.8.8.8\r\n"
+                           "nameserver\t 8.8.4.4 # secondary\n"
+                           "nameserver 1.1.1.1\n", &dns1, &dns2);
+    EXPECT_EQ("8.8.8.8", dns1);
+    EXPECT_EQ("8.8.4.4", dns2);
+
+    // 跳过 IPv6、非法地址和被注释的行
+    hcnet::parseResolvConf("search example.com\n"
+                           "nameserver ::1\n"
+                           "nameserver 8.8.8\n"
+                           "nameserver 10.0.0.1;local\n"
+                           ";nameserver 10.0.0.2\n"
+                           "nameserver\n"
+                           "nameserver 10.0.0.3", &dns1, &dns2);
+    EXPECT_EQ("10.0.0.1", dns1);
+    EXPECT_EQ("10.0.0.3", dns2);
+
+    // 本机地址视为没有设置
+    hcnet::parseResolvConf("nameserver 127.0.0.1\n", &dns1, &dns2);
+    EXPECT_TRUE(dns1.empty());
+    EXPECT_TRUE(dns2.empty());
+}
+
+TEST(HCLINUX_NETLINK_UNITTEST, IfaceFinderIndex) { // NOLINT
+    hcnetlink::NetlinkDump dump;
+    dump.links = {link(1, "lo", IFF_LOOPBACK | IFF_UP, "00:00:00:00:00:00"),
+                  link(2, "eth0", IFF_UP, "52:54:00:12:34:56"),
+                  link(3, "eth1", IFF_UP, "52:54:00:AB:CD:EF"),
+                  link(4, "eth2", IFF_UP, "52:54:00:12:34:58")};
+    dump.addrs = {addr(1, "127.0.0.1", 8, "lo"),
+                  addr(2, "192.168.1.10", 24, "eth0"),
+                  addr(2, "10.10.0.10", 16, "eth0:0"),
+                  addr(3, "10.1.0.5", 16, "eth1"),
+                  addr(2, "2001:db8::10", 64, ""),
+                  addr(4, "fe80::1", 64, "")};
+    dump.routes = {defaultRoute("192.168.1.1", 100, RT_TABLE_MAIN),
+                   route("192.168.1.0", 24, 2, 0),
+                   route("10.10.0.0", 16, 2, 0),
+                   route("10.1.0.0", 16, 3, 0),
+                   route("10.1.2.0", 24, 2, 0),   // 更长的前缀优先
+                   route("172.16.0.0", 12, 3, 200),
+                   route("172.16.0.0", 12, 2, 100), // metric 更小
+                   route("127.0.0.0", 8, 1, 0),
+                   route("2001:db8::", 64, 2, 256),
+                   route("2001:db8:1::", 48, 3, 256)};
+
+    hcnet::IfaceFinder finder(dump);
+    ASSERT_EQ(3u, finder.ifaces().size());
+
+    const hcnet::Iface *eth0 = finder.ifaceByName("eth0");
+    ASSERT_NE(nullptr, eth0);
+    EXPECT_EQ(&finder.ifaces()[0], eth0);
+    EXPECT_EQ("192.168.1.10", eth0->ip_addr_);
+    EXPECT_EQ(nullptr, finder.ifaceByName("eth9"));
+    EXPECT_EQ(nullptr, finder.ifaceByName("lo"));
+
+    ASSERT_NE(nullptr, finder.ifaceByIp("10.10.0.10"));
+    EXPECT_EQ("eth0:0", finder.ifaceByIp("10.10.0.10")->name_);
+    EXPECT_EQ(eth0, finder.ifaceByIp("2001:db8::10"));
+    EXPECT_EQ(eth0, finder.ifaceByIp("2001:0DB8:0:0::10"));
+    EXPECT_EQ(nullptr, finder.ifaceByIp("127.0.0.1"));
+
+    // 同一网卡的别名共享 mac，返回第一个
+    EXPECT_EQ(eth0, finder.ifaceByMac("52:54:00:12:34:56"));
+    ASSERT_NE(nullptr, finder.ifaceByMac("52:54:00:AB:CD:EF"));
+    EXPECT_EQ("eth1", finder.ifaceByMac("52:54:00:AB:CD:EF")->name_);
+    EXPECT_EQ(finder.ifaceByMac("52:54:00:AB:CD:EF"), finder.ifaceByMac("52:54:00:ab:cd:ef"));
+    EXPECT_EQ(nullptr, finder.ifaceByMac("52:54:00:12:34:58"));
+
+    // 原有接口的结果不变
+    EXPECT_EQ("192.168.1.10", finder.getIpAddrByName("eth0"));
+    EXPECT_EQ("", finder.getIpAddrByName("eth9"));
+    EXPECT_EQ("10.1.0.5", finder.getIpAddrByKeyword("10.1.0.5"));
+    EXPECT_EQ("", finder.getIpAddrByKeyword("2001:db8::10"));
+    hcnet::Iface iface;
+    EXPECT_TRUE(finder.getIfaceByName("eth1", &iface));
+    EXPECT_EQ("10.1.0.5", iface.ip_addr_);
+    EXPECT_FALSE(finder.getIfaceByName("eth9", &iface));
+
+    // 最长前缀匹配
+    EXPECT_EQ("eth0", finder.routeIface("192.168.1.77")->name_);
+    EXPECT_EQ("eth0:0", finder.routeIface("10.10.200.1")->name_);
+    EXPECT_EQ("eth1", finder.routeIface("10.1.3.4")->name_);
+    EXPECT_EQ("eth0", finder.routeIface("10.1.2.4")->name_);
+    EXPECT_EQ("eth0", finder.routeIface("172.20.0.1")->name_);
+    EXPECT_EQ("eth0", finder.routeIface("8.8.8.8")->name_);   // 默认路由
+    EXPECT_EQ("eth0", finder.routeIface("2001:db8::99")->name_);
+    EXPECT_EQ("eth1", finder.routeIface("2001:db8:1:2::1")->name_);
+    EXPECT_EQ(nullptr, finder.routeIface("2001:db9::1"));   // 没有 IPv6 默认路由
+    EXPECT_EQ(nullptr, finder.routeIface("127.0.0.2"));     // loopback 没有 Iface
+    EXPECT_EQ(nullptr, finder.routeIface("not an ip"));
+
+    // 没有路由
+    dump.routes.clear();
+    hcnet::IfaceFinder empty(dump);
+    EXPECT_EQ(nullptr, empty.routeIface("192.168.1.77"));
+    EXPECT_NE(nullptr, empty.ifaceByName("eth0"));
+}
+
+TEST(HCLINUX_NETLINK_UNITTEST, DumpLive) { // NOLINT
+    hcnetlink::NetlinkDump dump;
+    ASSERT_TRUE(hcnetlink::dumpAll(&dump));
+
+    const auto lo = std::find_if(dump.links.begin(), dump.links.end(), [](const hcnetlink::LinkInfo &l) {
+        return l.name == "lo";
+    });
+    ASSERT_NE(dump.links.end(), lo);
+    EXPECT_TRUE(lo->flags & IFF_LOOPBACK);
+    EXPECT_TRUE(std::any_of(dump.addrs.begin(), dump.addrs.end(), [&](const hcnetlink::AddrInfo &a) {
+        return a.index == lo->index && a.address.toString() == "127.0.0.1";
+    }));
+    EXPECT_FALSE(dump.routes.empty());
+
+    std::vector<std::string> names;
+    ASSERT_TRUE(hcnet::getIfaceNames(&names));
+    EXPECT_NE(names.end(), std::find(names.begin(), names.end(), "lo"));
+
+    hcnet::IfaceFinder finder;
+    hcnet::IfaceList list;
+    finder.getIfaceList(&list);
+
+    for (const hcnet::Iface &iface : list) {
+        EXPECT_TRUE(iface.verify());
+        EXPECT_NE("lo", iface.name_);
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,233 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/linux.h"
+#include "happycpp/linux/procfs.h"
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace hcprocfs = happycpp::hclinux::hcprocfs;
+
+TEST(HCLINUX_PROCFS_UNITTEST, CpuStat) { // NOLINT
+    const std::string content(
+            "cpu  100 2 30 400 5 6 7 8 9 10\n"
+            "cpu0 50 1 15 200 2 3 3 4 4 5\n"
+            "cpu2 50 1 15 200 3 3 4 4 5 5\n"
+            "intr 1250561 0 0 0\n"
+            "ctxt 123\n");
+    hcprocfs::CpuStat total{};
+    std::vector<hcprocfs::CpuStat> perCpu;
+
+    ASSERT_TRUE(hcprocfs::parseCpuStat(content, &total, &perCpu));
+    EXPECT_EQ(100u, total.user);
+    EXPECT_EQ(400u, total.idle);
+    EXPECT_EQ(10u, total.guestNice);
+    EXPECT_EQ(558u, total.total());
+    EXPECT_EQ(405u, total.idleAll());
+
+    // cpu1 离线，对应项为 0
+    ASSERT_EQ(3u, perCpu.size());
+    EXPECT_EQ(50u, perCpu[0].user);
+    EXPECT_EQ(0u, perCpu[1].total());
+    EXPECT_EQ(3u, perCpu[2].iowait);
+
+    // 老内核只有 7 列
+    ASSERT_TRUE(hcprocfs::parseCpuStat("cpu 1 2 3 4 5 6 7\n", &total));
+    EXPECT_EQ(7u, total.softirq);
+    EXPECT_EQ(0u, total.steal);
+
+    EXPECT_FALSE(hcprocfs::parseCpuStat("intr 1 2 3\n", &total));
+}
+
+TEST(HCLINUX_PROCFS_UNITTEST, MemInfo) { // NOLINT
+    hcprocfs::MemInfo info{};
+
+    ASSERT_TRUE(hcprocfs::parseMemInfo(
+            "MemTotal:        8000000 kB\n"
+            "MemFree:         1000000 kB\n"
+            "MemAvailable:    5000000 kB\n"
+            "Buffers:          200000 kB\n"
+            "Cached:          3000000 kB\n"
+            "SwapCached:        10000 kB\n"
+            "SwapTotal:       2000000 kB\n"
+            "SwapFree:        1500000 kB\n", &info));
+    EXPECT_EQ(8000000u, info.memTotal);
+    EXPECT_EQ(5000000u, info.memAvailable);
+    EXPECT_EQ(3000000u, info.cached);
+    EXPECT_EQ(2000000u, info.swapTotal);
+    EXPECT_EQ(1500000u, info.swapFree);
+
+    // 没有 MemAvailable 时估算
+    ASSERT_TRUE(hcprocfs::parseMemInfo(
+            "MemTotal: 8000 kB\nMemFree: 1000 kB\nBuffers: 200 kB\nCached: 300 kB\n", &info));
+    EXPECT_EQ(1500u, info.memAvailable);
+
+    EXPECT_FALSE(hcprocfs::parseMemInfo("MemFree: 1000 kB\n", &info));
+}
+
+TEST(HCLINUX_PROCFS_UNITTEST, LoadAvgAndCpuList) { // NOLINT
+    hcprocfs::LoadAvg load{};
+
+    ASSERT_TRUE(hcprocfs::parseLoadAvg("0.26 1.56 12.05 2/73 23457\n", &load));
+    EXPECT_DOUBLE_EQ(0.26, load.load1);
+    EXPECT_DOUBLE_EQ(1.56, load.load5);
+    EXPECT_DOUBLE_EQ(12.05, load.load15);
+    EXPECT_EQ(2u, load.running);
+    EXPECT_EQ(73u, load.total);
+    EXPECT_FALSE(hcprocfs::parseLoadAvg("0.26 1.56\n", &load));
+
+    EXPECT_EQ(1u, hcprocfs::parseCpuList("0\n"));
+    EXPECT_EQ(7u, hcprocfs::parseCpuList("0-3,8,10-11\n"));
+    EXPECT_EQ(0u, hcprocfs::parseCpuList("3-1"));
+    EXPECT_EQ(0u, hcprocfs::parseCpuList(""));
+}
+
+TEST(HCLINUX_PROCFS_UNITTEST, CpuInfo) { // NOLINT
+    hcprocfs::CpuInfo info;
+
+    ASSERT_TRUE(hcprocfs::parseCpuInfo(
+            "processor\t: 0\n"
+            "model name\t: Quad-Core AMD Opteron(tm) Processor 2350\n"
+            "physical id\t: 0\n"
+            "cpu cores\t: 4\n"
+            "\n"
+            "processor\t: 1\n"
+            "model name\t: Quad-Core AMD Opteron(tm) Processor 2350\n"
+            "physical id\t: 1\n"
+            "cpu cores\t: 4\n"
+            "\n"
+            "processor\t: 2\n"
+            "physical id\t: 1\n", &info));
+    EXPECT_EQ("Quad-Core AMD Opteron(tm) Processor 2350", info.modelName);
+    ASSERT_EQ(2u, info.modelNames.size());
+    EXPECT_EQ(info.modelName, info.modelNames[1]);
+    EXPECT_EQ(3u, info.processors);
+    EXPECT_EQ(2u, info.packages);
+    EXPECT_EQ(4u, info.coresPerPackage);
+
+    EXPECT_FALSE(hcprocfs::parseCpuInfo("Features\t: half thumb\n", &info));
+}
+
+TEST(HCLINUX_PROCFS_UNITTEST, NetDev) { // NOLINT
+    std::vector<hcprocfs::NetDevStat> stats;
+
+    ASSERT_TRUE(hcprocfs::parseNetDev(
+            "Inter-|   Receive                                                |  Transmit\n"
+            " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n"
+            "    lo: 219841989  488171    0    0    0     0          0         0 219841989  488171    0    0    0     0       0          0\n"
+            "  eth0:2046      31    1    2    0     0          0         0     1978      30    3    4    0     0       0          0\n",
+            &stats));
+    ASSERT_EQ(2u, stats.size());
+    EXPECT_STREQ("lo", stats[0].name);
+    EXPECT_EQ(219841989u, stats[0].txBytes);
+    EXPECT_STREQ("eth0", stats[1].name);
+    EXPECT_EQ(2046u, stats[1].rxBytes);
+    EXPECT_EQ(2u, stats[1].rxDropped);
+    EXPECT_EQ(30u, stats[1].txPackets);
+    EXPECT_EQ(4u, stats[1].txDropped);
+
+    EXPECT_FALSE(hcprocfs::parseNetDev("  eth0: 1 2 3\n", &stats));
+}
+
+TEST(HCLINUX_PROCFS_UNITTEST, TaskStat) { // NOLINT
+    hcprocfs::TaskStat stat{};
+
+    // comm 中包含空格和括号
+    ASSERT_TRUE(hcprocfs::parseTaskStat(
+            "4242 (my (weird) proc) S 1 4242 4242 0 -1 4194560 1234 0 5 0 "
+            "321 45 0 0 20 0 7 0 98765 12345678 900 18446744073709551615 "
+            "1 1 0 0 0 0 0 0 0 0 0 0 17 3 0 0 0 0 0\n", &stat));
+    EXPECT_EQ(4242, stat.pid);
+    EXPECT_STREQ("my (weird) proc", stat.comm);
+    EXPECT_EQ('S', stat.state);
+    EXPECT_EQ(1, stat.ppid);
+    EXPECT_EQ(321u, stat.utime);
+    EXPECT_EQ(45u, stat.stime);
+    EXPECT_EQ(7, stat.numThreads);
+    EXPECT_EQ(98765u, stat.startTime);
+    EXPECT_EQ(3, stat.processor);
+
+    // comm 最多保留 15 个字符
+    ASSERT_TRUE(hcprocfs::parseTaskStat(
+            "1 (abcdefghijklmnopqrstuvwxyz) R 0 1 1 0 -1 0 0 0 0 0 1 2 0 0 20 0 1 0 3", &stat));
+    EXPECT_STREQ("abcdefghijklmno", stat.comm);
+    EXPECT_EQ(-1, stat.processor);
+
+    EXPECT_FALSE(hcprocfs::parseTaskStat("1 (init) S 0 1", &stat));
+    EXPECT_FALSE(hcprocfs::parseTaskStat("garbage", &stat));
+}
+
+TEST(HCLINUX_PROCFS_UNITTEST, ReadLive) { // NOLINT
+    hcprocfs::CpuStat first{};
+    hcprocfs::CpuStat second{};
+    std::vector<hcprocfs::CpuStat> perCpu;
+    hcprocfs::MemInfo mem{};
+    hcprocfs::LoadAvg load{};
+
+    ASSERT_TRUE(hcprocfs::readCpuStat(&first, &perCpu));
+    ASSERT_TRUE(hcprocfs::readCpuStat(&second));
+    EXPECT_FALSE(perCpu.empty());
+    EXPECT_GE(second.total(), first.total());
+
+    ASSERT_TRUE(hcprocfs::readMemInfo(&mem));
+    EXPECT_GT(mem.memTotal, 0u);
+    EXPECT_LE(mem.memAvailable, mem.memTotal);
+    EXPECT_TRUE(hcprocfs::readLoadAvg(&load));
+
+    std::vector<hcprocfs::NetDevStat> netDev;
+    ASSERT_TRUE(hcprocfs::readNetDev(&netDev));
+    EXPECT_FALSE(netDev.empty());
+
+    EXPECT_GE(hcprocfs::onlineCpus(), 1u);
+    EXPECT_GE(happycpp::hclinux::hccpu::coreNum(), 1);
+    EXPECT_EQ(mem.memTotal / 1024, happycpp::hclinux::hcmem::totalSysMem());
+    EXPECT_FALSE(happycpp::hclinux::hcsys::currentLoad().empty());
+
+    hcprocfs::TaskStat self{};
+    ASSERT_TRUE(hcprocfs::readTaskStat(getpid(), 0, &self));
+    EXPECT_EQ(getpid(), self.pid);
+    EXPECT_STREQ("procfs_unittest", self.comm);
+
+    std::vector<hcprocfs::TaskStat> tasks;
+    ASSERT_TRUE(hcprocfs::readProcessStats(&tasks));
+    EXPECT_TRUE(std::is_sorted(tasks.begin(), tasks.end(), [](const auto &a, const auto &b) {
+        return a.pid < b.pid;
+    }));
+    EXPECT_TRUE(std::any_of(tasks.begin(), tasks.end(), [](const auto &t) {
+        return t.pid == getpid();
+    }));
+
+    ASSERT_TRUE(hcprocfs::readThreadStats(getpid(), &tasks));
+    ASSERT_FALSE(tasks.empty());
+    EXPECT_EQ(getpid(), tasks.front().pid);
+    EXPECT_FALSE(hcprocfs::readThreadStats(-1, &tasks));
+
+    hcprocfs::ProcFile missing("/proc/happycpp_not_exist");
+    std::string_view content;
+    EXPECT_FALSE(missing.read(&content));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
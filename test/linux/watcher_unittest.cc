@@ -0,0 +1,223 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/linux/watcher.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hcnet = happycpp::hclinux::hcnet;
+namespace hcnetlink = happycpp::hclinux::hcnetlink;
+
+namespace {
+
+    const char kTestAddr[] = "10.200.0.1";
+
+    bool hasAddr(const hcnet::IfaceWatcher::Snapshot &snap, const std::string &ip) {
+        return std::any_of(snap->dump.addrs.begin(), snap->dump.addrs.end(), [&ip](const hcnetlink::AddrInfo &a) {
+            return a.address.toString() == ip;
+        });
+    }
+
+    //! 等待回调收到满足条件的快照
+    class SnapshotWaiter {
+    public:
+        explicit SnapshotWaiter(hcnet::IfaceWatcher *watcher) {
+            watcher->addCallback([this](const hcnet::IfaceWatcher::Snapshot &snap) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                last_ = snap;
+                cond_.notify_all();
+            });
+        }
+
+        template<typename Predicate>
+        bool wait(Predicate predicate) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            return cond_.wait_for(lock, std::chrono::seconds(5), [&] {
+                return last_ && predicate(last_);
+            });
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        hcnet::IfaceWatcher::Snapshot last_;
+    };
+
+    //! 在 lo 上添加或者删除测试地址，没有权限时返回 false
+    bool changeTestAddr(const char *action) {
+        const std::string cmd = std::string("ip addr ") + action + " " + kTestAddr +
+                                "/24 dev lo label lo:hc >/dev/null 2>&1";
+        return std::system(cmd.c_str()) == 0;
+    }
+
+    //! 离开作用域时删除测试地址，断言失败提前返回时也不会留在 lo 上
+    class TestAddrGuard {
+    public:
+        ~TestAddrGuard() {
+            if (active_)
+                changeTestAddr("del");
+        }
+
+        //! 测试已经自己删除了地址
+        void dismiss() {
+            active_ = false;
+        }
+
+    private:
+        bool active_ = true;
+    };
+
+} /* namespace */
+
+TEST(HCLINUX_WATCHER_UNITTEST, InitialSnapshot) { // NOLINT
+    hcnet::IfaceWatcher watcher;
+    const hcnet::IfaceWatcher::Snapshot snap(watcher.snapshot());
+
+    ASSERT_TRUE(snap);
+    EXPECT_EQ(1u, snap->version);
+    EXPECT_EQ(1u, watcher.version());
+    EXPECT_TRUE(hasAddr(snap, "127.0.0.1"));
+    EXPECT_FALSE(watcher.failed());
+
+    hcnetlink::NetlinkDump dump;
+    ASSERT_TRUE(hcnetlink::dumpAll(&dump));
+    EXPECT_EQ(dump.links.size(), snap->dump.links.size());
+    EXPECT_EQ(dump.addrs.size(), snap->dump.addrs.size());
+
+    hcnet::IfaceFinder finder(dump);
+    hcnet::IfaceList expected;
+    hcnet::IfaceList actual;
+    finder.getIfaceList(&expected);
+    snap->finder.getIfaceList(&actual);
+    ASSERT_EQ(expected.size(), actual.size());
+
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i].name_, actual[i].name_);
+        EXPECT_EQ(expected[i].ip_addr_, actual[i].ip_addr_);
+    }
+}
+
+TEST(HCLINUX_WATCHER_UNITTEST, AddressChanges) { // NOLINT
+    hcnet::IfaceWatcher watcher;
+
+    // 抛出异常的回调不影响之后的回调，也不会终止后台线程
+    watcher.addCallback([](const hcnet::IfaceWatcher::Snapshot &) {
+        throw std::runtime_error("callback failed");
+    });
+
+    SnapshotWaiter waiter(&watcher);
+
+    if (!changeTestAddr("add"))
+        GTEST_SKIP() << "cannot add address to lo";
+
+    TestAddrGuard guard;
+
+    EXPECT_TRUE(waiter.wait([](const hcnet::IfaceWatcher::Snapshot &snap) {
+        return hasAddr(snap, kTestAddr);
+    }));
+
+    const hcnet::IfaceWatcher::Snapshot added(watcher.snapshot());
+    EXPECT_TRUE(hasAddr(added, kTestAddr));
+    EXPECT_GT(added->version, 1u);
+
+    const auto it = std::find_if(added->dump.addrs.begin(), added->dump.addrs.end(),
+                                 [](const hcnetlink::AddrInfo &a) {
+                                     return a.address.toString() == kTestAddr;
+                                 });
+    ASSERT_NE(added->dump.addrs.end(), it);
+    EXPECT_EQ("lo:hc", it->label);
+    EXPECT_EQ(24, it->prefixLen);
+
+    ASSERT_TRUE(changeTestAddr("del"));
+    guard.dismiss();
+
+    EXPECT_TRUE(waiter.wait([](const hcnet::IfaceWatcher::Snapshot &snap) {
+        return !hasAddr(snap, kTestAddr);
+    }));
+
+    // 旧快照不受影响
+    EXPECT_TRUE(hasAddr(added, kTestAddr));
+    EXPECT_FALSE(hasAddr(watcher.snapshot(), kTestAddr));
+    EXPECT_GT(watcher.version(), added->version);
+
+    // 增量维护的结果与重新获取的一致
+    hcnetlink::NetlinkDump dump;
+    ASSERT_TRUE(hcnetlink::dumpAll(&dump));
+    EXPECT_EQ(dump.addrs.size(), watcher.snapshot()->dump.addrs.size());
+    EXPECT_EQ(dump.routes.size(), watcher.snapshot()->dump.routes.size());
+    EXPECT_FALSE(watcher.failed());
+}
+
+TEST(HCLINUX_WATCHER_UNITTEST, ConcurrentReaders) { // NOLINT
+    hcnet::IfaceWatcher watcher;
+    std::atomic<bool> stop(false);
+    std::atomic<bool> ok(true);
+    std::vector<std::thread> readers;
+
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            uint64_t last = 0;
+
+            while (!stop.load()) {
+                const hcnet::IfaceWatcher::Snapshot snap(watcher.snapshot());
+
+                if (!snap) {
+                    ok = false;
+                    continue;
+                }
+
+                // 版本单调递增，并且每个快照都是完整的
+                if (snap->version < last || !hasAddr(snap, "127.0.0.1"))
+                    ok = false;
+
+                last = snap->version;
+            }
+        });
+    }
+
+    for (int i = 0; i < 5; ++i) {
+        if (!changeTestAddr("add"))
+            break;
+
+        changeTestAddr("del");
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    stop = true;
+
+    for (std::thread &t : readers)
+        t.join();
+
+    EXPECT_TRUE(ok.load());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
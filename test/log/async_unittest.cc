@@ -0,0 +1,292 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/log.h"
+#include "happycpp/log/async.h"
+#include "happycpp/log/binary.h"
+#include "happycpp/log/limit.h"
+#include "happycpp/filesys.h"
+#include <sys/resource.h>
+#include <unistd.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hclog = happycpp::log;
+
+namespace {
+
+    std::string tempFile() {
+        char tmpl[] = "/tmp/hc_async_log_XXXXXX";
+        const int fd = mkstemp(tmpl);
+        close(fd);
+        return tmpl;
+    }
+
+    std::vector<std::string> readLines(const std::string &file) {
+        std::vector<std::string> lines;
+        happycpp::hcfilesys::readFile(file, &lines);
+        return lines;
+    }
+
+    size_t countContaining(const std::vector<std::string> &lines, const std::string &s) {
+        size_t n = 0;
+
+        for (const auto &line : lines)
+            n += line.find(s) != std::string::npos;
+
+        return n;
+    }
+
+    // 多个线程同时写入 count 条 INFO 和 count 条 DEBUG 记录
+    void produce(hclog::AsyncLogWriter *w, size_t threads, size_t count) {
+        std::vector<std::thread> v;
+
+        for (size_t t = 0; t < threads; ++t) {
+            v.emplace_back([w, t, count]() {
+                for (size_t i = 0; i < count; ++i) {
+                    const std::string msg = std::to_string(t) + "-" + std::to_string(i);
+                    w->push(log4cplus::INFO_LOG_LEVEL, "root", "", "info " + msg);
+                    w->push(log4cplus::DEBUG_LOG_LEVEL, "root", "", "debug " + msg);
+                }
+            });
+        }
+
+        for (auto &x : v)
+            x.join();
+    }
+
+} /* namespace */
+
+TEST(HCLOG_ASYNC_UNITTEST, Format) { // NOLINT
+    const std::string file = tempFile();
+
+    {
+        hclog::AsyncLogOptions options;
+        options.file = file;
+        hclog::AsyncLogWriter w(options);
+        EXPECT_TRUE(w.push(log4cplus::WARN_LOG_LEVEL, "net", "[srv] ", "hello"));
+        w.flush();
+        EXPECT_EQ(1u, w.written());
+    }
+
+    const auto lines = readLines(file);
+    ASSERT_EQ(1u, lines.size());
+
+    // 2016-01-02 03:04:05.678 1234  WARN  net --- [srv] hello
+    const std::string &line = lines[0];
+    ASSERT_GT(line.size(), 24u);
+    EXPECT_EQ('-', line[4]);
+    EXPECT_EQ(' ', line[10]);
+    EXPECT_EQ('.', line[19]);
+    EXPECT_EQ(' ', line[23]);
+    EXPECT_NE(std::string::npos, line.find(" WARN  net --- [srv] hello"));
+    EXPECT_NE(std::string::npos, line.find(" " + std::to_string(getpid()) + " "));
+
+    remove(file.c_str());
+    EXPECT_ANY_THROW(hclog::AsyncLogWriter(hclog::AsyncLogOptions{16, hclog::LOG_OVERFLOW_BLOCK,
+                                                                  "/nonexistent/dir/log"}));
+}
+
+TEST(HCLOG_ASYNC_UNITTEST, Block) { // NOLINT
+    const std::string file = tempFile();
+    const size_t threads = 4;
+    const size_t count = 2000;
+
+    {
+        hclog::AsyncLogOptions options;
+        options.file = file;
+        options.capacity = 16;
+        options.maxBatch = 8;
+        hclog::AsyncLogWriter w(options);
+        produce(&w, threads, count);
+
+        // 析构时写完所有记录
+        EXPECT_EQ(0u, w.dropped());
+    }
+
+    const auto lines = readLines(file);
+    EXPECT_EQ(threads * count * 2, lines.size());
+    EXPECT_EQ(1u, countContaining(lines, "info 3-1999"));
+    EXPECT_EQ(1u, countContaining(lines, "debug 0-0"));
+    remove(file.c_str());
+}
+
+TEST(HCLOG_ASYNC_UNITTEST, Drop) { // NOLINT
+    const size_t threads = 4;
+    const size_t count = 5000;
+
+    for (const auto policy : {hclog::LOG_OVERFLOW_DROP_NEWEST, hclog::LOG_OVERFLOW_DROP_DEBUG_FIRST}) {
+        const std::string file = tempFile();
+        uint64_t dropped = 0;
+
+        {
+            hclog::AsyncLogOptions options;
+            options.file = file;
+            options.capacity = 8;
+            options.overflow = policy;
+            hclog::AsyncLogWriter w(options);
+            produce(&w, threads, count);
+            w.flush();
+            dropped = w.dropped();
+            EXPECT_EQ(threads * count * 2, w.written() + dropped);
+        }
+
+        const auto lines = readLines(file);
+        EXPECT_EQ(threads * count * 2, lines.size() + dropped);
+
+        // 只丢弃 DEBUG 记录
+        if (policy == hclog::LOG_OVERFLOW_DROP_DEBUG_FIRST) {
+            EXPECT_EQ(threads * count, countContaining(lines, " INFO "));
+        }
+
+        remove(file.c_str());
+    }
+}
+
+TEST(HCLOG_ASYNC_UNITTEST, WriteFailure) { // NOLINT
+    // 写入 /dev/full 总是失败(ENOSPC)，记录计入丢弃数
+    hclog::AsyncLogOptions options;
+    options.file = "/dev/full";
+    hclog::AsyncLogWriter w(options);
+
+    for (int i = 0; i < 10; ++i)
+        EXPECT_TRUE(w.push(log4cplus::INFO_LOG_LEVEL, "root", "", "lost"));
+
+    w.flush();
+    EXPECT_EQ(10u, w.written());
+    EXPECT_EQ(10u, w.dropped());
+}
+
+TEST(HCLOG_ASYNC_UNITTEST, PartialWrite) { // NOLINT
+    const std::string file = tempFile();
+    const uint32_t site = hclog::addLogSite(hclog::LogSite{
+            0, log4cplus::INFO_LOG_LEVEL, std::string(200, 'f'), 1, "v=%d", std::string(1, hclog::LOG_ARG_INT)});
+    std::string args;
+    hclog::encodeLogArgs(&args, 7);
+
+    {
+        hclog::AsyncLogOptions options;
+        options.file = file;
+        options.format = hclog::LOG_FORMAT_BINARY;
+        hclog::AsyncLogWriter w(options);
+
+        // 限制文件大小，调用点的定义只能写入一部分，之后的 writev 失败(EFBIG)
+        struct rlimit old{};
+        ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &old));
+        const auto oldHandler = signal(SIGXFSZ, SIG_IGN);
+        struct rlimit limit = old;
+        limit.rlim_cur = hclog::kBinaryLogHeaderSize + 10;
+        ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+
+        EXPECT_TRUE(w.pushBinary(log4cplus::INFO_LOG_LEVEL, site, args));
+        w.flush();
+
+        setrlimit(RLIMIT_FSIZE, &old);
+        signal(SIGXFSZ, oldHandler);
+        EXPECT_EQ(1u, w.dropped());
+
+        // 下一批先写完剩余的定义，文件仍然可以解码
+        EXPECT_TRUE(w.pushBinary(log4cplus::INFO_LOG_LEVEL, site, args));
+    }
+
+    std::ifstream in(file, std::ios::binary);
+    std::ostringstream out;
+    EXPECT_EQ(1u, hclog::decodeBinaryLog(in, out));
+    EXPECT_NE(std::string::npos, out.str().find("v=7"));
+
+    remove(file.c_str());
+}
+
+TEST(HCLOG_ASYNC_UNITTEST, ReportSuppressed) { // NOLINT
+    const std::string file = tempFile();
+
+    // 每秒 0.001 条，测试期间不会补充
+    hclog::setLogLimit("standalone", hclog::LogLimitConfig{0.001, 1, 1});
+    hclog::setLogSummaryInterval(1);
+
+    static hclog::LogLimiter limiter("standalone.cc", 7, "standalone");
+    EXPECT_TRUE(limiter.allow(log4cplus::WARN_LOG_LEVEL));
+    EXPECT_FALSE(limiter.allow(log4cplus::WARN_LOG_LEVEL));
+    EXPECT_FALSE(limiter.allow(log4cplus::WARN_LOG_LEVEL));
+
+    // 后台线程按间隔把汇报写入自己的队列，不经过 HappyLog
+    std::vector<std::string> lines;
+
+    {
+        hclog::AsyncLogOptions options;
+        options.file = file;
+        options.reportSuppressed = true;
+        hclog::AsyncLogWriter w(options);
+
+        for (int i = 0; i < 300 && lines.empty(); ++i) {
+            usleep(10000);
+            lines = readLines(file);
+        }
+    }
+
+    hclog::clearLogLimits();
+    hclog::setLogSummaryInterval(10);
+
+    ASSERT_EQ(1u, lines.size());
+    EXPECT_NE(std::string::npos,
+              lines[0].find(" WARN  standalone --- Suppressed 2 log records at standalone.cc:7"));
+    remove(file.c_str());
+}
+
+TEST(HCLOG_ASYNC_UNITTEST, HappyLog) { // NOLINT
+    const std::string file = tempFile();
+    hclog::HappyLogPtr hlog = hclog::HappyLog::getInstance();
+
+    hclog::AsyncLogOptions options;
+    options.file = file;
+    hlog->enableAsync(options);
+    hlog->setLogPrefix("[test]");
+    hlog->info("async message");
+    hlog->error(std::runtime_error("oops"));
+    hlog->debug("filtered by level");
+    hlog->flush();
+    EXPECT_EQ(2u, readLines(file).size());
+
+    hlog->warn("last message");
+    hlog->disableAsync();
+    hlog->setLogPrefix("");
+    hlog->info("sync message");
+
+    const auto lines = readLines(file);
+    ASSERT_EQ(3u, lines.size());
+    EXPECT_NE(std::string::npos, lines[0].find(" INFO  root --- [test] async message"));
+    EXPECT_NE(std::string::npos, lines[1].find(" ERROR root --- [test] Exception Error->oops"));
+    EXPECT_NE(std::string::npos, lines[2].find("last message"));
+    EXPECT_EQ(0u, hlog->droppedRecords());
+    remove(file.c_str());
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,270 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/log.h"
+#include "happycpp/log/binary.h"
+#include "happycpp/filesys.h"
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace hclog = happycpp::log;
+
+namespace {
+
+    std::string tempFile() {
+        char tmpl[] = "/tmp/hc_binary_log_XXXXXX";
+        const int fd = mkstemp(tmpl);
+        close(fd);
+        return tmpl;
+    }
+
+    std::vector<std::string> decodeLines(const std::string &file, uint64_t *records = nullptr) {
+        std::ifstream in(file, std::ios::binary);
+        std::ostringstream out;
+        const uint64_t n = hclog::decodeBinaryLog(in, out);
+
+        if (records != nullptr)
+            *records = n;
+
+        std::vector<std::string> lines;
+        std::istringstream ss(out.str());
+
+        for (std::string line; std::getline(ss, line);)
+            lines.push_back(line);
+
+        return lines;
+    }
+
+    bool endsWith(const std::string &s, const std::string &suffix) {
+        return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+} /* namespace */
+
+TEST(HCLOG_BINARY_UNITTEST, Decode) { // NOLINT
+    const std::string file = tempFile();
+    hclog::HappyLog &hlog = hclog::HappyLog::instance();
+
+    hclog::AsyncLogOptions options;
+    options.file = file;
+    options.format = hclog::LOG_FORMAT_BINARY;
+    hlog.enableAsync(options);
+
+    const std::string peer("10.0.0.1");
+    const size_t bytes = 4096;
+    const int line = __LINE__ + 1;
+    HC_BLOG_INFO("accept fd=%d peer=%s bytes=%zu", -7, peer.c_str(), bytes);
+    HC_BLOG_WARN("ratio=%.2f width=[%*d] 100%% %c %s", 0.125, 5, 42, 'x', static_cast<const char *>(nullptr));
+    HC_BLOG_ERROR("max=%llu min=%lld h=%hx", 18446744073709551615ULL, -9223372036854775807LL - 1,
+                  static_cast<unsigned short>(0xbeef));
+    HC_BLOG_DEBUG("filtered by level %d", 1);
+    hlog.info("text message");
+
+    for (int i = 0; i < 3; ++i)
+        HC_BLOG_INFO("loop %d", i);
+
+    hlog.disableAsync();
+
+    uint64_t records = 0;
+    const auto lines = decodeLines(file, &records);
+    ASSERT_EQ(7u, lines.size());
+    EXPECT_EQ(7u, records);
+
+    // 2016-01-02 03:04:05.123456789 INFO  binary_unittest.cc:42 --- message
+    EXPECT_EQ('-', lines[0][4]);
+    EXPECT_EQ('.', lines[0][19]);
+    EXPECT_EQ(' ', lines[0][29]);
+    EXPECT_NE(std::string::npos, lines[0].find(" INFO  "));
+    EXPECT_NE(std::string::npos, lines[0].find("binary_unittest.cc:" + std::to_string(line) + " --- "));
+    EXPECT_TRUE(endsWith(lines[0], " --- accept fd=-7 peer=10.0.0.1 bytes=4096"));
+    EXPECT_NE(std::string::npos, lines[1].find(" WARN  "));
+    EXPECT_TRUE(endsWith(lines[1], " --- ratio=0.12 width=[   42] 100% x (null)"));
+    EXPECT_NE(std::string::npos, lines[2].find(" ERROR "));
+    EXPECT_TRUE(endsWith(lines[2], " --- max=18446744073709551615 min=-9223372036854775808 h=beef"));
+    EXPECT_TRUE(endsWith(lines[3], " INFO  root --- text message"));
+    EXPECT_TRUE(endsWith(lines[6], " --- loop 2"));
+
+    // 时间戳单调递增
+    for (size_t i = 1; i < lines.size(); ++i)
+        EXPECT_LE(lines[i - 1].substr(0, 29), lines[i].substr(0, 29));
+
+    remove(file.c_str());
+}
+
+TEST(HCLOG_BINARY_UNITTEST, TextFallback) { // NOLINT
+    const std::string file = tempFile();
+    hclog::HappyLog &hlog = hclog::HappyLog::instance();
+
+    // 文本模式下与 HC_LOG_* 相同
+    hclog::AsyncLogOptions options;
+    options.file = file;
+    hlog.enableAsync(options);
+    HC_BLOG_INFO("fallback n=%d s=%s", 3, "abc");
+    HC_BLOG_WARN("no args 100%%");
+    hlog.disableAsync();
+
+    std::vector<std::string> lines;
+    happycpp::hcfilesys::readFile(file, &lines);
+    ASSERT_EQ(2u, lines.size());
+    EXPECT_TRUE(endsWith(lines[0], " INFO  root --- fallback n=3 s=abc"));
+    EXPECT_TRUE(endsWith(lines[1], " WARN  root --- no args 100%"));
+    remove(file.c_str());
+}
+
+TEST(HCLOG_BINARY_UNITTEST, Append) { // NOLINT
+    const std::string file = tempFile();
+    hclog::AsyncLogOptions options;
+    options.file = file;
+    options.format = hclog::LOG_FORMAT_BINARY;
+
+    // 每个写入者都写文件头和各自用到的调用点定义
+    const uint32_t site = hclog::registerLogSite(log4cplus::INFO_LOG_LEVEL, "a.cc", 1, "run %d",
+                                                 hclog::detail::LogArgTypes<int>());
+
+    for (int run = 0; run < 2; ++run) {
+        hclog::AsyncLogWriter w(options);
+        std::string args;
+        hclog::encodeLogArgs(&args, run);
+        EXPECT_TRUE(w.pushBinary(log4cplus::INFO_LOG_LEVEL, site, args));
+        EXPECT_TRUE(w.push(log4cplus::WARN_LOG_LEVEL, "net", "", "text"));
+    }
+
+    const auto lines = decodeLines(file);
+    ASSERT_EQ(4u, lines.size());
+    EXPECT_TRUE(endsWith(lines[0], " INFO  a.cc:1 --- run 0"));
+    EXPECT_TRUE(endsWith(lines[1], " WARN  net --- text"));
+    EXPECT_TRUE(endsWith(lines[2], " INFO  a.cc:1 --- run 1"));
+
+    // 文本格式不接受二进制记录
+    options.format = hclog::LOG_FORMAT_TEXT;
+    options.file = "/dev/null";
+    hclog::AsyncLogWriter w(options);
+    EXPECT_FALSE(w.pushBinary(log4cplus::INFO_LOG_LEVEL, site, ""));
+    remove(file.c_str());
+}
+
+TEST(HCLOG_BINARY_UNITTEST, Corrupt) { // NOLINT
+    std::ostringstream out;
+
+    {
+        std::istringstream in("");
+        EXPECT_EQ(0u, hclog::decodeBinaryLog(in, out));
+    }
+
+    {
+        std::istringstream in("plain text log\n");
+        EXPECT_ANY_THROW(hclog::decodeBinaryLog(in, out));
+    }
+
+    std::string data(hclog::kBinaryLogMagic, sizeof(hclog::kBinaryLogMagic));
+    data.append(16, '\0');
+
+    hclog::LogSite site{0, log4cplus::INFO_LOG_LEVEL, "a.cc", 1, "v=%d", std::string(1, hclog::LOG_ARG_INT)};
+    hclog::encodeLogSite(site, &data);
+
+    // 记录的参数被截断
+    std::string record;
+    record.append("\x15\0\0\0\0\0\0\0\0", 9);
+    record.append(8, '\0');
+    record.append("\x01\x02\x03\x04", 4);
+
+    {
+        std::istringstream in(data + record);
+        EXPECT_ANY_THROW(hclog::decodeBinaryLog(in, out));
+    }
+
+    // 条目被截断
+    {
+        std::istringstream in(data.substr(0, data.size() - 1));
+        EXPECT_ANY_THROW(hclog::decodeBinaryLog(in, out));
+    }
+
+    // 未定义的调用点
+    record[5] = 1;
+    {
+        std::istringstream in(data + record);
+        EXPECT_ANY_THROW(hclog::decodeBinaryLog(in, out));
+    }
+
+    // 转换字符与参数类型不匹配，不能交给 printf。第一项匹配，用来确认构造的条目正确
+    const struct {
+        const char *format;
+        std::string types;
+    } mismatches[] = {
+            {"v=%lld", std::string(1, hclog::LOG_ARG_INT)},
+            {"v=%n", std::string(1, hclog::LOG_ARG_INT)},
+            {"v=%lln", std::string(1, hclog::LOG_ARG_INT)},
+            {"v=%s", std::string(1, hclog::LOG_ARG_INT)},
+            {"v=%ls", std::string(1, hclog::LOG_ARG_UINT)},
+            {"v=%d", std::string(1, hclog::LOG_ARG_DOUBLE)},
+            {"v=%f", std::string(1, hclog::LOG_ARG_POINTER)},
+            {"v=%*d", std::string(2, hclog::LOG_ARG_DOUBLE)},
+    };
+
+    for (const auto &m : mismatches) {
+        std::string bad(hclog::kBinaryLogMagic, sizeof(hclog::kBinaryLogMagic));
+        bad.append(16, '\0');
+
+        hclog::LogSite badSite{0, log4cplus::INFO_LOG_LEVEL, "a.cc", 1, m.format, m.types};
+        hclog::encodeLogSite(badSite, &bad);
+
+        // 每个参数 8 字节
+        const auto size = static_cast<char>(17 + 8 * m.types.size());
+        bad.append(1, size);
+        bad.append(3, '\0');
+        bad.append(5, '\0');
+        bad.append(8 + 8 * m.types.size(), '\0');
+
+        std::istringstream in(bad);
+
+        if (&m == mismatches)
+            EXPECT_EQ(1u, hclog::decodeBinaryLog(in, out));
+        else
+            EXPECT_ANY_THROW(hclog::decodeBinaryLog(in, out)) << m.format;
+    }
+}
+
+TEST(HCLOG_BINARY_UNITTEST, EmptyFormat) { // NOLINT
+    std::string data(hclog::kBinaryLogMagic, sizeof(hclog::kBinaryLogMagic));
+    data.append(16, '\0');
+
+    // 格式字符串为空的调用点也是已经定义的
+    hclog::LogSite site{0, log4cplus::INFO_LOG_LEVEL, "a.cc", 1, "", ""};
+    hclog::encodeLogSite(site, &data);
+
+    data.append("\x11\0\0\0\0\0\0\0\0", 9);
+    data.append(8, '\0');
+
+    std::istringstream in(data);
+    std::ostringstream out;
+    EXPECT_EQ(1u, hclog::decodeBinaryLog(in, out));
+    EXPECT_TRUE(endsWith(out.str(), "a.cc:1 --- \n")) << out.str();
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
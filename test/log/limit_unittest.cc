@@ -0,0 +1,211 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/log.h"
+#include "happycpp/log/limit.h"
+#include "happycpp/exception.h"
+#include "happycpp/filesys.h"
+#include "log4cplus/helpers/property.h"
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace hclog = happycpp::log;
+
+namespace {
+
+    std::string tempFile() {
+        char tmpl[] = "/tmp/hc_limit_log_XXXXXX";
+        const int fd = mkstemp(tmpl);
+        close(fd);
+        return tmpl;
+    }
+
+    size_t countContaining(const std::vector<std::string> &lines, const std::string &s) {
+        size_t n = 0;
+
+        for (const auto &line : lines)
+            n += line.find(s) != std::string::npos;
+
+        return n;
+    }
+
+    //! 把日志写入临时文件，析构时清除所有限流参数
+    class LimitTest : public testing::Test {
+    protected:
+        std::string file_;
+
+        void SetUp() override {
+            file_ = tempFile();
+            hclog::AsyncLogOptions options;
+            options.file = file_;
+            hclog::HappyLog::instance().enableAsync(options);
+
+            // 测试期间不自动汇报，由 flush 汇报
+            hclog::setLogSummaryInterval(3600);
+        }
+
+        void TearDown() override {
+            hclog::clearLogLimits();
+            hclog::HappyLog::instance().disableAsync();
+            hclog::setLogSummaryInterval(10);
+            remove(file_.c_str());
+        }
+
+        std::vector<std::string> lines() {
+            hclog::HappyLog::instance().flush();
+            std::vector<std::string> v;
+            happycpp::hcfilesys::readFile(file_, &v);
+            return v;
+        }
+    };
+
+    // 每秒 0.001 条，测试期间不会补充
+    const hclog::LogLimitConfig kBurst5{0.001, 5, 1};
+
+} /* namespace */
+
+TEST_F(LimitTest, RateLimit) { // NOLINT
+    EXPECT_FALSE(hclog::LogLimiter::enabled());
+    hclog::setLogLimit("", kBurst5);
+    EXPECT_TRUE(hclog::LogLimiter::enabled());
+
+    // 两个调用点各自限流
+    for (int i = 0; i < 100; ++i) {
+        HC_LOG_WARN("site one %d", i);
+        HC_BLOG_WARN("site two %d", i);
+    }
+
+    const auto v = lines();
+    EXPECT_EQ(5u, countContaining(v, "site one"));
+    EXPECT_EQ(5u, countContaining(v, "site two"));
+    EXPECT_EQ(2u, countContaining(v, "Suppressed 95 log records at "));
+    EXPECT_EQ(2u, countContaining(v, "limit_unittest.cc:"));
+}
+
+TEST_F(LimitTest, Sample) { // NOLINT
+    hclog::setLogLimit("", hclog::LogLimitConfig{0, 0, 10});
+
+    for (int i = 0; i < 100; ++i) {
+        HC_LOG_INFO("sampled %d", i);
+        HC_LOG_WARN("not sampled %d", i);
+    }
+
+    const auto v = lines();
+    EXPECT_EQ(10u, countContaining(v, "--- sampled"));
+    EXPECT_EQ(1u, countContaining(v, "--- sampled 0"));
+    EXPECT_EQ(1u, countContaining(v, "--- sampled 90"));
+    EXPECT_EQ(100u, countContaining(v, "not sampled"));
+    EXPECT_EQ(1u, countContaining(v, "Suppressed 90 log records"));
+}
+
+TEST_F(LimitTest, Logger) { // NOLINT
+    hclog::HappyLog &hlog = hclog::HappyLog::instance();
+
+    // net.http 使用 net 的参数，db 不限制
+    hclog::setLogLimit("net", kBurst5);
+
+    for (int i = 0; i < 20; ++i) {
+        hlog.error("http down", "net.http");
+        hlog.warn("http slow", "net.http");
+        hlog.error("db down", "db");
+    }
+
+    const auto v = lines();
+    EXPECT_EQ(5u, countContaining(v, "http down"));
+    EXPECT_EQ(5u, countContaining(v, "http slow"));
+    EXPECT_EQ(20u, countContaining(v, "db down"));
+    EXPECT_EQ(1u, countContaining(v, "Suppressed 15 ERROR records of logger 'net.http'"));
+    EXPECT_EQ(1u, countContaining(v, "Suppressed 15 WARN records of logger 'net.http'"));
+}
+
+TEST_F(LimitTest, PeriodicSummary) { // NOLINT
+    hclog::HappyLog &hlog = hclog::HappyLog::instance();
+    hclog::setLogLimit("", kBurst5);
+    hclog::setLogSummaryInterval(1);
+
+    for (int i = 0; i < 20; ++i)
+        hlog.warn("quiet later", "periodic");
+
+    // 之后不再写日志，也不调用 flush，由后台线程按间隔汇报
+    std::vector<std::string> v;
+
+    for (int i = 0; i < 300 && countContaining(v, "Suppressed") == 0; ++i) {
+        usleep(10000);
+        v.clear();
+        happycpp::hcfilesys::readFile(file_, &v);
+    }
+
+    EXPECT_EQ(5u, countContaining(v, "quiet later"));
+    EXPECT_EQ(1u, countContaining(v, "Suppressed 15 WARN records of logger 'periodic'"));
+}
+
+TEST_F(LimitTest, Exception) { // NOLINT
+    hclog::setLogLimit("", kBurst5);
+
+    // 异常在捕获的地方写日志，按照 logger 和级别限流
+    for (int i = 0; i < 50; ++i) {
+        try {
+            ThrowHappyException("storm");
+        } catch (const happycpp::HappyException &e) {
+            hclog::HappyLog::instance().error(e);
+        }
+    }
+
+    const auto v = lines();
+    EXPECT_EQ(5u, countContaining(v, "root --- Exception Error->storm"));
+    EXPECT_EQ(1u, countContaining(v, "Suppressed 45 ERROR records of logger 'root'"));
+}
+
+TEST_F(LimitTest, Properties) { // NOLINT
+    const std::string profile = tempFile();
+
+    {
+        std::ofstream out(profile);
+        out << "log4cplus.rootLogger=INFO, Console\n"
+            << "happycpp.limit.sample=4\n"
+            << "happycpp.limit.rate.net=0.001\n"
+            << "happycpp.limit.burst.net=2\n"
+            << "happycpp.limit.sample.net=invalid\n";
+    }
+
+    hclog::loadLogLimits(log4cplus::helpers::Properties(profile));
+    remove(profile.c_str());
+
+    hclog::HappyLog &hlog = hclog::HappyLog::instance();
+
+    for (int i = 0; i < 8; ++i) {
+        hlog.info("root info");
+        hlog.warn("net warn", "net");
+    }
+
+    const auto v = lines();
+    EXPECT_EQ(2u, countContaining(v, "root info"));
+    EXPECT_EQ(2u, countContaining(v, "net warn"));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
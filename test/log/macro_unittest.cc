@@ -0,0 +1,78 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// 提高编译期的最低日志级别，WARN 以下的调用在编译时被删除
+#define HAPPYCPP_LOG_MIN_LEVEL 30000
+
+#include <gtest/gtest.h>
+#include "happycpp/log.h"
+#include <string>
+
+namespace hclog = happycpp::log;
+
+namespace {
+
+    int evaluated = 0;
+
+    const char *arg() {
+        ++evaluated;
+        return "x";
+    }
+
+} /* namespace */
+
+TEST(HCLOG_MACRO_UNITTEST, RuntimeLevel) { // NOLINT
+    hclog::HappyLog &hlog = hclog::HappyLog::instance();
+    hlog.setLogLevel(log4cplus::ERROR_LOG_LEVEL);
+    evaluated = 0;
+
+    // 运行时未启用的级别不求值参数
+    HC_LOG_WARN("macro test %s", arg());
+    EXPECT_EQ(0, evaluated);
+    HC_LOG_ERROR("macro test %s", arg());
+    EXPECT_EQ(1, evaluated);
+
+    hlog.setLogLevel(log4cplus::INFO_LOG_LEVEL);
+}
+
+TEST(HCLOG_MACRO_UNITTEST, CompileTimeFloor) { // NOLINT
+    hclog::HappyLog &hlog = hclog::HappyLog::instance();
+    hlog.setLogLevel(log4cplus::TRACE_LOG_LEVEL);
+    ASSERT_TRUE(hclog::HappyLog::isEnabled(log4cplus::TRACE_LOG_LEVEL));
+    evaluated = 0;
+
+    // 运行时已经启用，但是低于编译期的最低级别
+    HC_LOG_TRACE("macro test %s", arg());
+    HC_LOG_DEBUG("macro test %s", arg());
+    HC_LOG_INFO("macro test %s", arg());
+    HC_BLOG_INFO("macro test %s", arg());
+    EXPECT_EQ(0, evaluated);
+
+    HC_LOG_WARN("macro test %s", arg());
+    HC_BLOG_WARN("macro test %s", arg());
+    EXPECT_EQ(2, evaluated);
+
+    hlog.setLogLevel(log4cplus::INFO_LOG_LEVEL);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
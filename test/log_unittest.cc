@@ -0,0 +1,116 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <gtest/gtest.h>
+#include "happycpp/log.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hclog = happycpp::log;
+
+TEST(HCLOG_UNITTEST, Instance) { // NOLINT
+    // 多个线程同时第一次获取实例，只创建一个
+    const size_t threads = 8;
+    std::atomic<bool> go(false);
+    std::vector<hclog::HappyLog *> ptrs(threads, nullptr);
+    std::vector<std::thread> v;
+
+    for (size_t i = 0; i < threads; ++i) {
+        v.emplace_back([&go, &ptrs, i]() {
+            while (!go.load())
+                std::this_thread::yield();
+
+            ptrs[i] = &hclog::HappyLog::instance();
+        });
+    }
+
+    go.store(true);
+
+    for (auto &t : v)
+        t.join();
+
+    for (const auto p : ptrs)
+        EXPECT_EQ(&hclog::HappyLog::instance(), p);
+
+    // 已经创建之后，参数被忽略
+    EXPECT_EQ(&hclog::HappyLog::instance(), hclog::HappyLog::getInstance(log4cplus::TRACE_LOG_LEVEL).get());
+    EXPECT_EQ(&hclog::HappyLog::instance(), &hclog::HappyLog::instance("no-such-profile.properties"));
+}
+
+TEST(HCLOG_UNITTEST, Level) { // NOLINT
+    hclog::HappyLog &hlog = hclog::HappyLog::instance();
+    int evaluated = 0;
+    const auto arg = [&evaluated]() {
+        ++evaluated;
+        return "x";
+    };
+
+    hlog.setLogLevel(log4cplus::INFO_LOG_LEVEL);
+    EXPECT_FALSE(hclog::HappyLog::isEnabled(log4cplus::DEBUG_LOG_LEVEL));
+    EXPECT_TRUE(hclog::HappyLog::isEnabled(log4cplus::INFO_LOG_LEVEL));
+
+    // 未启用的级别不求值参数
+    HC_LOG_TRACE("%s", arg());
+    HC_LOG_DEBUG("%s", arg());
+    EXPECT_EQ(0, evaluated);
+    HC_LOG_INFO("level test %s", arg());
+    EXPECT_EQ(1, evaluated);
+
+    hlog.setLogLevel(log4cplus::TRACE_LOG_LEVEL);
+    EXPECT_TRUE(hclog::HappyLog::isEnabled(log4cplus::TRACE_LOG_LEVEL));
+    HC_LOG_TRACE("level test %s", arg());
+    EXPECT_EQ(2, evaluated);
+    hlog.setLogLevel(log4cplus::INFO_LOG_LEVEL);
+}
+
+TEST(HCLOG_UNITTEST, FormatLog) { // NOLINT
+    EXPECT_EQ("a=1 b=str", hclog::formatLog("a=%d b=%s", 1, "str"));
+    EXPECT_EQ("100%", hclog::formatLog("100%%"));
+
+    // 超过栈上缓冲区的长度
+    const std::string big(2000, 'z');
+    EXPECT_EQ("[" + big + "]", hclog::formatLog("[%s]", big.c_str()));
+}
+
+TEST(HCLOG_UNITTEST, NamedLogger) { // NOLINT
+    hclog::HappyLog &hlog = hclog::HappyLog::instance();
+
+    // 同一线程多次使用同一个 logger，以及多个线程同时使用
+    std::vector<std::thread> v;
+
+    for (int i = 0; i < 4; ++i) {
+        v.emplace_back([&hlog]() {
+            for (int j = 0; j < 100; ++j)
+                hlog.debug("named logger", "happycpp.test");
+        });
+    }
+
+    for (auto &t : v)
+        t.join();
+
+    hlog.info("named logger done", "happycpp.test");
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2016, Fifi Lyu. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// 把 LOG_FORMAT_BINARY 格式的日志转换为文本
+//
+// 用法：hclog-decode [FILE]...
+// 没有 FILE 或者 FILE 为 - 时，读取标准输入
+
+#include "happycpp/log/binary.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+
+namespace hclog = happycpp::log;
+
+namespace {
+
+    int decode(const char *name, std::istream &in) {
+        try {
+            hclog::decodeBinaryLog(in, std::cout);
+            return 0;
+        } catch (const std::exception &e) {
+            std::cout.flush();
+            fprintf(stderr, "hclog-decode: %s: %s\n", name, e.what());
+            return 1;
+        }
+    }
+
+} /* namespace */
+
+int main(int argc, char *argv[]) {
+    std::ios::sync_with_stdio(false);
+
+    if (argc < 2)
+        return decode("-", std::cin);
+
+    int ret = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            printf("Usage: %s [FILE]...\nDecode binary happycpp logs to text.\n", argv[0]);
+            return 0;
+        }
+
+        if (strcmp(argv[i], "-") == 0) {
+            ret |= decode("-", std::cin);
+            continue;
+        }
+
+        std::ifstream in(argv[i], std::ios::binary);
+
+        if (!in) {
+            fprintf(stderr, "hclog-decode: %s: %s\n", argv[i], strerror(errno));
+            ret = 1;
+            continue;
+        }
+
+        ret |= decode(argv[i], in);
+    }
+
+    return ret;
+}